@@ -42,6 +42,18 @@ typedef enum
 typedef struct _CoglPangoDisplayListNode CoglPangoDisplayListNode;
 typedef struct _CoglPangoDisplayListRectangle CoglPangoDisplayListRectangle;
 
+/* For small runs of text like icon labels, we can get better
+   performance going through the Cogl journal since text may then be
+   batched together with other geometry. */
+/* FIXME: 25 is a number I plucked out of thin air; it would be good
+   to determine this empirically! */
+#define COGL_PANGO_DISPLAY_LIST_MIN_BUFFER_RECTANGLES 25
+
+/* The largest number of quads that can be put in one attribute
+   buffer. This is limited by the size of the indices that are used
+   on GLES */
+#define COGL_PANGO_DISPLAY_LIST_MAX_BUFFER_QUADS (65536 / 4)
+
 struct _CoglPangoDisplayList
 {
   gboolean                color_override;
@@ -49,6 +61,12 @@ struct _CoglPangoDisplayList
   GSList                 *nodes;
   GSList                 *last_node;
   CoglPangoPipelineCache *pipeline_cache;
+
+  /* The total number of textured rectangles in all of the nodes */
+  int                     n_texture_rectangles;
+  /* Whether every node has a primitive referring to the shared
+     attribute buffers */
+  gboolean                has_primitives;
 };
 
 /* This matches the format expected by cogl_rectangles_with_texture_coords */
@@ -67,6 +85,10 @@ struct _CoglPangoDisplayListNode
 
   CoglPipeline *pipeline;
 
+  /* A primitive drawing this node's quads from one of the attribute
+     buffers shared by the whole display list */
+  CoglPrimitive *primitive;
+
   union
   {
     struct
@@ -76,8 +98,6 @@ struct _CoglPangoDisplayListNode
       /* Array of rectangles in the format expected by
          cogl_rectangles_with_texture_coords */
       GArray *rectangles;
-      /* A primitive representing those vertices */
-      CoglPrimitive *primitive;
     } texture;
 
     struct
@@ -108,10 +128,35 @@ _cogl_pango_display_list_new (CoglPangoPipelineCache *pipeline_cache)
   return dl;
 }
 
+static void
+_cogl_pango_display_list_free_primitives (CoglPangoDisplayList *dl)
+{
+  GSList *l;
+
+  if (!dl->has_primitives)
+    return;
+
+  for (l = dl->nodes; l; l = l->next)
+    {
+      CoglPangoDisplayListNode *node = l->data;
+
+      if (node->primitive)
+        {
+          cogl_object_unref (node->primitive);
+          node->primitive = NULL;
+        }
+    }
+
+  dl->has_primitives = FALSE;
+}
+
 static void
 _cogl_pango_display_list_append_node (CoglPangoDisplayList *dl,
                                       CoglPangoDisplayListNode *node)
 {
+  /* The buffers will need to be recreated to include the new node */
+  _cogl_pango_display_list_free_primitives (dl);
+
   if (dl->last_node)
     dl->last_node = dl->last_node->next = g_slist_prepend (NULL, node);
   else
@@ -152,12 +197,9 @@ _cogl_pango_display_list_add_texture (CoglPangoDisplayList *dl,
           ? (node->color_override && cogl_color_equal (&dl->color, &node->color))
           : !node->color_override))
     {
-      /* Get rid of the vertex buffer so that it will be recreated */
-      if (node->d.texture.primitive != NULL)
-        {
-          cogl_object_unref (node->d.texture.primitive);
-          node->d.texture.primitive = NULL;
-        }
+      /* Get rid of the vertex buffers so that they will be
+         recreated */
+      _cogl_pango_display_list_free_primitives (dl);
     }
   else
     {
@@ -168,10 +210,10 @@ _cogl_pango_display_list_add_texture (CoglPangoDisplayList *dl,
       node->color_override = dl->color_override;
       node->color = dl->color;
       node->pipeline = NULL;
+      node->primitive = NULL;
       node->d.texture.texture = cogl_handle_ref (texture);
       node->d.texture.rectangles
         = g_array_new (FALSE, FALSE, sizeof (CoglPangoDisplayListRectangle));
-      node->d.texture.primitive = NULL;
 
       _cogl_pango_display_list_append_node (dl, node);
     }
@@ -189,6 +231,8 @@ _cogl_pango_display_list_add_texture (CoglPangoDisplayList *dl,
   rectangle->t_1 = ty_1;
   rectangle->s_2 = tx_2;
   rectangle->t_2 = ty_2;
+
+  dl->n_texture_rectangles++;
 }
 
 void
@@ -206,6 +250,7 @@ _cogl_pango_display_list_add_rectangle (CoglPangoDisplayList *dl,
   node->d.rectangle.x_2 = x_2;
   node->d.rectangle.y_2 = y_2;
   node->pipeline = NULL;
+  node->primitive = NULL;
 
   _cogl_pango_display_list_append_node (dl, node);
 }
@@ -231,163 +276,411 @@ _cogl_pango_display_list_add_trapezoid (CoglPangoDisplayList *dl,
   node->d.trapezoid.x_12 = x_12;
   node->d.trapezoid.x_22 = x_22;
   node->pipeline = NULL;
+  node->primitive = NULL;
 
   _cogl_pango_display_list_append_node (dl, node);
 }
 
-static void
-emit_rectangles_through_journal (CoglPangoDisplayListNode *node)
-{
-  cogl_rectangles_with_texture_coords ((float *)
-                                       node->d.texture.rectangles->data,
-                                       node->d.texture.rectangles->len);
-}
-
-static void
-emit_vertex_buffer_geometry (CoglPangoDisplayListNode *node)
+/* Replaces the texture and texture coordinates of every textured
+   rectangle using the given function without touching the
+   positions. All of the rectangles in a node must end up in the same
+   texture. Returns the number of rectangles that were updated or -1
+   if the display list couldn't be updated, in which case it needs to
+   be rebuilt */
+int
+_cogl_pango_display_list_update_textures
+                                 (CoglPangoDisplayList *dl,
+                                  CoglPangoDisplayListTextureFunc func,
+                                  void *user_data)
 {
-  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
-
-  /* It's expensive to go through the Cogl journal for large runs
-   * of text in part because the journal transforms the quads in software
-   * to avoid changing the modelview matrix. So for larger runs of text
-   * we load the vertices into a VBO, and this has the added advantage
-   * that if the text doesn't change from frame to frame the VBO can
-   * be re-used avoiding the repeated cost of validating the data and
-   * mapping it into the GPU... */
+  int index = 0;
+  GSList *l;
 
-  if (node->d.texture.primitive == NULL)
+  for (l = dl->nodes; l; l = l->next)
     {
-      CoglAttributeBuffer *buffer;
-      CoglVertexP2T2 *verts, *v;
-      int n_verts;
-      gboolean allocated = FALSE;
-      CoglAttribute *attributes[2];
-      CoglPrimitive *prim;
+      CoglPangoDisplayListNode *node = l->data;
+      CoglHandle node_texture = COGL_INVALID_HANDLE;
       int i;
 
-      n_verts = node->d.texture.rectangles->len * 4;
+      if (node->type != COGL_PANGO_DISPLAY_LIST_TEXTURE)
+        continue;
 
-      buffer
-        = cogl_attribute_buffer_new (n_verts * sizeof (CoglVertexP2T2), NULL);
-
-      if ((verts = cogl_buffer_map (COGL_BUFFER (buffer),
-                                    COGL_BUFFER_ACCESS_WRITE,
-                                    COGL_BUFFER_MAP_HINT_DISCARD)) == NULL)
-        {
-          verts = g_new (CoglVertexP2T2, n_verts);
-          allocated = TRUE;
-        }
-
-      v = verts;
-
-      /* Copy the rectangles into the buffer and expand into four
-         vertices instead of just two */
       for (i = 0; i < node->d.texture.rectangles->len; i++)
         {
-          const CoglPangoDisplayListRectangle *rectangle
+          CoglPangoDisplayListRectangle *rectangle
             = &g_array_index (node->d.texture.rectangles,
                               CoglPangoDisplayListRectangle, i);
-
-          v->x = rectangle->x_1;
-          v->y = rectangle->y_1;
-          v->s = rectangle->s_1;
-          v->t = rectangle->t_1;
-          v++;
-          v->x = rectangle->x_1;
-          v->y = rectangle->y_2;
-          v->s = rectangle->s_1;
-          v->t = rectangle->t_2;
-          v++;
-          v->x = rectangle->x_2;
-          v->y = rectangle->y_2;
-          v->s = rectangle->s_2;
-          v->t = rectangle->t_2;
-          v++;
-          v->x = rectangle->x_2;
-          v->y = rectangle->y_1;
-          v->s = rectangle->s_2;
-          v->t = rectangle->t_1;
-          v++;
+          CoglHandle texture;
+
+          if (!func (index++,
+                     &texture,
+                     &rectangle->s_1, &rectangle->t_1,
+                     &rectangle->s_2, &rectangle->t_2,
+                     user_data))
+            return -1;
+
+          if (i == 0)
+            node_texture = texture;
+          else if (texture != node_texture)
+            return -1;
         }
 
-      if (allocated)
+      if (node_texture != node->d.texture.texture)
         {
-          cogl_buffer_set_data (COGL_BUFFER (buffer),
-                                0, /* offset */
-                                verts,
-                                sizeof (CoglVertexP2T2) * n_verts);
-          g_free (verts);
+          cogl_handle_ref (node_texture);
+          cogl_handle_unref (node->d.texture.texture);
+          node->d.texture.texture = node_texture;
+
+          /* The pipeline will be looked up again for the new
+             texture */
+          if (node->pipeline)
+            {
+              cogl_object_unref (node->pipeline);
+              node->pipeline = NULL;
+            }
         }
-      else
-        cogl_buffer_unmap (COGL_BUFFER (buffer));
-
-      attributes[0] = cogl_attribute_new (buffer,
-                                          "cogl_position_in",
-                                          sizeof (CoglVertexP2T2),
-                                          G_STRUCT_OFFSET (CoglVertexP2T2, x),
-                                          2, /* n_components */
-                                          COGL_ATTRIBUTE_TYPE_FLOAT);
-      attributes[1] = cogl_attribute_new (buffer,
-                                          "cogl_tex_coord0_in",
-                                          sizeof (CoglVertexP2T2),
-                                          G_STRUCT_OFFSET (CoglVertexP2T2, s),
-                                          2, /* n_components */
-                                          COGL_ATTRIBUTE_TYPE_FLOAT);
+
+    }
+
+  /* Get rid of the vertex buffers so that they will be recreated with
+     the new texture coordinates */
+  _cogl_pango_display_list_free_primitives (dl);
+
+  return index;
+}
+
+/* Collects the vertices for a set of nodes that will share one
+   attribute buffer */
+typedef struct
+{
+  /* Either CoglVertexP2T2 or CoglVertexP2 */
+  GArray *vertices;
+  gboolean textured;
+  int n_quads;
+  /* The nodes that will draw from the buffer along with the quad
+     that each one starts at */
+  GArray *nodes;
+} CoglPangoDisplayListBufferData;
+
+typedef struct
+{
+  CoglPangoDisplayListNode *node;
+  int first_quad;
+  int n_quads;
+} CoglPangoDisplayListBufferNode;
+
+static void
+_cogl_pango_display_list_buffer_data_init (CoglPangoDisplayListBufferData *data,
+                                           gboolean textured)
+{
+  data->textured = textured;
+  data->vertices = g_array_new (FALSE, FALSE,
+                                textured ?
+                                sizeof (CoglVertexP2T2) :
+                                sizeof (CoglVertexP2));
+  data->n_quads = 0;
+  data->nodes = g_array_new (FALSE, FALSE,
+                             sizeof (CoglPangoDisplayListBufferNode));
+}
+
+/* Uploads the collected vertices and creates a primitive for each
+   node that uses them */
+static void
+_cogl_pango_display_list_buffer_data_flush (CoglPangoDisplayListBufferData *data)
+{
+  CoglAttributeBuffer *buffer;
+  CoglAttribute *attributes[2];
+  int n_attributes;
+  size_t stride;
+  int i;
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  if (data->nodes->len == 0)
+    return;
+
+  stride = data->textured ? sizeof (CoglVertexP2T2) : sizeof (CoglVertexP2);
+
+  buffer = cogl_attribute_buffer_new (data->vertices->len * stride,
+                                      data->vertices->data);
+
+  attributes[0] = cogl_attribute_new (buffer,
+                                      "cogl_position_in",
+                                      stride,
+                                      0, /* offset */
+                                      2, /* n_components */
+                                      COGL_ATTRIBUTE_TYPE_FLOAT);
+  n_attributes = 1;
+
+  if (data->textured)
+    attributes[n_attributes++] =
+      cogl_attribute_new (buffer,
+                          "cogl_tex_coord0_in",
+                          stride,
+                          G_STRUCT_OFFSET (CoglVertexP2T2, s),
+                          2, /* n_components */
+                          COGL_ATTRIBUTE_TYPE_FLOAT);
+
+  for (i = 0; i < data->nodes->len; i++)
+    {
+      CoglPangoDisplayListBufferNode *buffer_node =
+        &g_array_index (data->nodes, CoglPangoDisplayListBufferNode, i);
+      CoglPrimitive *prim;
 
       prim = cogl_primitive_new_with_attributes (COGL_VERTICES_MODE_TRIANGLES,
-                                                 n_verts,
+                                                 buffer_node->n_quads * 4,
                                                  attributes,
-                                                 2 /* n_attributes */);
+                                                 n_attributes);
 
 #ifdef CLUTTER_COGL_HAS_GL
       if (ctx->driver == COGL_DRIVER_GL)
-        cogl_primitive_set_mode (prim, GL_QUADS);
+        {
+          cogl_primitive_set_mode (prim, GL_QUADS);
+          cogl_primitive_set_first_vertex (prim, buffer_node->first_quad * 4);
+        }
       else
 #endif
         {
           /* GLES doesn't support GL_QUADS so instead we use a VBO
              with indexed vertices to generate GL_TRIANGLES from the
-             quads */
+             quads. The indices for each quad are the same so the
+             first vertex is an offset into the indices */
 
-          CoglIndices *indices =
-            cogl_get_rectangle_indices (node->d.texture.rectangles->len);
+          CoglIndices *indices = cogl_get_rectangle_indices (data->n_quads);
 
           cogl_primitive_set_indices (prim, indices);
-          cogl_primitive_set_n_vertices (prim,
-                                         node->d.texture.rectangles->len * 6);
+          cogl_primitive_set_first_vertex (prim, buffer_node->first_quad * 6);
+          cogl_primitive_set_n_vertices (prim, buffer_node->n_quads * 6);
         }
 
-      node->d.texture.primitive = prim;
+      buffer_node->node->primitive = prim;
+    }
+
+  cogl_object_unref (buffer);
+  for (i = 0; i < n_attributes; i++)
+    cogl_object_unref (attributes[i]);
+
+  g_array_set_size (data->vertices, 0);
+  g_array_set_size (data->nodes, 0);
+  data->n_quads = 0;
+}
+
+static void
+_cogl_pango_display_list_buffer_data_add_node
+                                   (CoglPangoDisplayListBufferData *data,
+                                    CoglPangoDisplayListNode *node,
+                                    int n_quads)
+{
+  CoglPangoDisplayListBufferNode buffer_node;
+
+  if (data->n_quads + n_quads > COGL_PANGO_DISPLAY_LIST_MAX_BUFFER_QUADS)
+    _cogl_pango_display_list_buffer_data_flush (data);
+
+  buffer_node.node = node;
+  buffer_node.first_quad = data->n_quads;
+  buffer_node.n_quads = n_quads;
+  g_array_append_val (data->nodes, buffer_node);
+
+  data->n_quads += n_quads;
+}
+
+static void
+_cogl_pango_display_list_buffer_data_destroy
+                                   (CoglPangoDisplayListBufferData *data)
+{
+  _cogl_pango_display_list_buffer_data_flush (data);
+  g_array_free (data->vertices, TRUE);
+  g_array_free (data->nodes, TRUE);
+}
 
-      cogl_object_unref (buffer);
-      cogl_object_unref (attributes[0]);
-      cogl_object_unref (attributes[1]);
+static void
+add_shape_quad (CoglPangoDisplayListBufferData *data,
+                float x_1, float y_1,
+                float x_2, float y_2,
+                float x_3, float y_3,
+                float x_4, float y_4)
+{
+  CoglVertexP2 *v;
+
+  g_array_set_size (data->vertices, data->vertices->len + 4);
+  v = &g_array_index (data->vertices, CoglVertexP2, data->vertices->len - 4);
+
+  v[0].x = x_1;
+  v[0].y = y_1;
+  v[1].x = x_2;
+  v[1].y = y_2;
+  v[2].x = x_3;
+  v[2].y = y_3;
+  v[3].x = x_4;
+  v[3].y = y_4;
+}
+
+/* It's expensive to go through the Cogl journal for large runs of
+ * text in part because the journal transforms the quads in software
+ * to avoid changing the modelview matrix. So for larger runs of text
+ * we load the vertices into VBOs, and this has the added advantage
+ * that if the text doesn't change from frame to frame the VBOs can
+ * be re-used avoiding the repeated cost of validating the data and
+ * mapping it into the GPU...
+ *
+ * All of the textured nodes share one buffer and all of the
+ * rectangles and trapezoids share another so that a layout with lots
+ * of fonts or colors doesn't end up with lots of tiny buffers */
+static void
+_cogl_pango_display_list_ensure_primitives (CoglPangoDisplayList *dl)
+{
+  CoglPangoDisplayListBufferData texture_data, shape_data;
+  GSList *l;
+
+  if (dl->has_primitives)
+    return;
+
+  _cogl_pango_display_list_buffer_data_init (&texture_data, TRUE);
+  _cogl_pango_display_list_buffer_data_init (&shape_data, FALSE);
+
+  for (l = dl->nodes; l; l = l->next)
+    {
+      CoglPangoDisplayListNode *node = l->data;
+
+      switch (node->type)
+        {
+        case COGL_PANGO_DISPLAY_LIST_TEXTURE:
+          {
+            GArray *rectangles = node->d.texture.rectangles;
+            CoglVertexP2T2 *v;
+            int i;
+
+            _cogl_pango_display_list_buffer_data_add_node (&texture_data,
+                                                           node,
+                                                           rectangles->len);
+
+            g_array_set_size (texture_data.vertices,
+                              texture_data.vertices->len +
+                              rectangles->len * 4);
+            v = &g_array_index (texture_data.vertices,
+                                CoglVertexP2T2,
+                                texture_data.vertices->len -
+                                rectangles->len * 4);
+
+            /* Copy the rectangles into the buffer and expand into
+               four vertices instead of just two */
+            for (i = 0; i < rectangles->len; i++)
+              {
+                const CoglPangoDisplayListRectangle *rectangle
+                  = &g_array_index (rectangles,
+                                    CoglPangoDisplayListRectangle, i);
+
+                v->x = rectangle->x_1;
+                v->y = rectangle->y_1;
+                v->s = rectangle->s_1;
+                v->t = rectangle->t_1;
+                v++;
+                v->x = rectangle->x_1;
+                v->y = rectangle->y_2;
+                v->s = rectangle->s_1;
+                v->t = rectangle->t_2;
+                v++;
+                v->x = rectangle->x_2;
+                v->y = rectangle->y_2;
+                v->s = rectangle->s_2;
+                v->t = rectangle->t_2;
+                v++;
+                v->x = rectangle->x_2;
+                v->y = rectangle->y_1;
+                v->s = rectangle->s_2;
+                v->t = rectangle->t_1;
+                v++;
+              }
+          }
+          break;
+
+        case COGL_PANGO_DISPLAY_LIST_RECTANGLE:
+          _cogl_pango_display_list_buffer_data_add_node (&shape_data,
+                                                         node,
+                                                         1);
+          add_shape_quad (&shape_data,
+                          node->d.rectangle.x_1, node->d.rectangle.y_1,
+                          node->d.rectangle.x_1, node->d.rectangle.y_2,
+                          node->d.rectangle.x_2, node->d.rectangle.y_2,
+                          node->d.rectangle.x_2, node->d.rectangle.y_1);
+          break;
+
+        case COGL_PANGO_DISPLAY_LIST_TRAPEZOID:
+          /* A trapezoid is always convex so it can be drawn with the
+             same triangles as a rectangle */
+          _cogl_pango_display_list_buffer_data_add_node (&shape_data,
+                                                         node,
+                                                         1);
+          add_shape_quad (&shape_data,
+                          node->d.trapezoid.x_11, node->d.trapezoid.y_1,
+                          node->d.trapezoid.x_12, node->d.trapezoid.y_2,
+                          node->d.trapezoid.x_22, node->d.trapezoid.y_2,
+                          node->d.trapezoid.x_21, node->d.trapezoid.y_1);
+          break;
+        }
     }
 
-  cogl_primitive_draw (node->d.texture.primitive);
+  _cogl_pango_display_list_buffer_data_destroy (&texture_data);
+  _cogl_pango_display_list_buffer_data_destroy (&shape_data);
+
+  dl->has_primitives = TRUE;
 }
 
 static void
-_cogl_pango_display_list_render_texture (CoglPangoDisplayListNode *node)
+_cogl_pango_display_list_render_node_through_journal
+                                   (CoglPangoDisplayListNode *node)
 {
-  /* For small runs of text like icon labels, we can get better performance
-   * going through the Cogl journal since text may then be batched together
-   * with other geometry. */
-  /* FIXME: 25 is a number I plucked out of thin air; it would be good
-   * to determine this empirically! */
-  if (node->d.texture.rectangles->len < 25)
-    emit_rectangles_through_journal (node);
-  else
-    emit_vertex_buffer_geometry (node);
+  switch (node->type)
+    {
+    case COGL_PANGO_DISPLAY_LIST_TEXTURE:
+      cogl_rectangles_with_texture_coords ((float *)
+                                           node->d.texture.rectangles->data,
+                                           node->d.texture.rectangles->len);
+      break;
+
+    case COGL_PANGO_DISPLAY_LIST_RECTANGLE:
+      cogl_rectangle (node->d.rectangle.x_1,
+                      node->d.rectangle.y_1,
+                      node->d.rectangle.x_2,
+                      node->d.rectangle.y_2);
+      break;
+
+    case COGL_PANGO_DISPLAY_LIST_TRAPEZOID:
+      {
+        float points[8];
+        CoglPath *path;
+
+        points[0] =  node->d.trapezoid.x_11;
+        points[1] =  node->d.trapezoid.y_1;
+        points[2] =  node->d.trapezoid.x_12;
+        points[3] =  node->d.trapezoid.y_2;
+        points[4] =  node->d.trapezoid.x_22;
+        points[5] =  node->d.trapezoid.y_2;
+        points[6] =  node->d.trapezoid.x_21;
+        points[7] =  node->d.trapezoid.y_1;
+
+        path = cogl_path_new ();
+        cogl_path_polygon (path, points, 4);
+        cogl_path_fill (path);
+        cogl_object_unref (path);
+      }
+      break;
+    }
 }
 
 void
 _cogl_pango_display_list_render (CoglPangoDisplayList *dl,
                                  const CoglColor *color)
 {
+  gboolean use_primitives;
   GSList *l;
 
+  use_primitives = (dl->n_texture_rectangles >=
+                    COGL_PANGO_DISPLAY_LIST_MIN_BUFFER_RECTANGLES);
+
+  if (use_primitives)
+    _cogl_pango_display_list_ensure_primitives (dl);
+
   for (l = dl->nodes; l; l = l->next)
     {
       CoglPangoDisplayListNode *node = l->data;
@@ -420,40 +713,10 @@ _cogl_pango_display_list_render (CoglPangoDisplayList *dl,
       cogl_pipeline_set_color (node->pipeline, &draw_color);
       cogl_push_source (node->pipeline);
 
-      switch (node->type)
-        {
-        case COGL_PANGO_DISPLAY_LIST_TEXTURE:
-          _cogl_pango_display_list_render_texture (node);
-          break;
-
-        case COGL_PANGO_DISPLAY_LIST_RECTANGLE:
-          cogl_rectangle (node->d.rectangle.x_1,
-                          node->d.rectangle.y_1,
-                          node->d.rectangle.x_2,
-                          node->d.rectangle.y_2);
-          break;
-
-        case COGL_PANGO_DISPLAY_LIST_TRAPEZOID:
-          {
-            float points[8];
-            CoglPath *path;
-
-            points[0] =  node->d.trapezoid.x_11;
-            points[1] =  node->d.trapezoid.y_1;
-            points[2] =  node->d.trapezoid.x_12;
-            points[3] =  node->d.trapezoid.y_2;
-            points[4] =  node->d.trapezoid.x_22;
-            points[5] =  node->d.trapezoid.y_2;
-            points[6] =  node->d.trapezoid.x_21;
-            points[7] =  node->d.trapezoid.y_1;
-
-            path = cogl_path_new ();
-            cogl_path_polygon (path, points, 4);
-            cogl_path_fill (path);
-            cogl_object_unref (path);
-          }
-          break;
-        }
+      if (use_primitives)
+        cogl_primitive_draw (node->primitive);
+      else
+        _cogl_pango_display_list_render_node_through_journal (node);
 
       cogl_pop_source ();
     }
@@ -467,10 +730,10 @@ _cogl_pango_display_list_node_free (CoglPangoDisplayListNode *node)
       g_array_free (node->d.texture.rectangles, TRUE);
       if (node->d.texture.texture != COGL_INVALID_HANDLE)
         cogl_handle_unref (node->d.texture.texture);
-      if (node->d.texture.primitive != NULL)
-        cogl_object_unref (node->d.texture.primitive);
     }
 
+  if (node->primitive)
+    cogl_object_unref (node->primitive);
   if (node->pipeline)
     cogl_object_unref (node->pipeline);
 
@@ -484,6 +747,8 @@ _cogl_pango_display_list_clear (CoglPangoDisplayList *dl)
   g_slist_free (dl->nodes);
   dl->nodes = NULL;
   dl->last_node = NULL;
+  dl->n_texture_rectangles = 0;
+  dl->has_primitives = FALSE;
 }
 
 void
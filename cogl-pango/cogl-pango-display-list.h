@@ -32,6 +32,18 @@ G_BEGIN_DECLS
 
 typedef struct _CoglPangoDisplayList CoglPangoDisplayList;
 
+/* Used to find the new location of a textured rectangle after the
+   glyph atlas has been reorganized. The index counts all of the
+   textured rectangles in the order they were added. The function
+   should return FALSE if the rectangle can't be updated */
+typedef gboolean (* CoglPangoDisplayListTextureFunc) (int index,
+                                                      CoglHandle *texture,
+                                                      float *tx_1,
+                                                      float *ty_1,
+                                                      float *tx_2,
+                                                      float *ty_2,
+                                                      void *user_data);
+
 CoglPangoDisplayList *_cogl_pango_display_list_new (CoglPangoPipelineCache *);
 
 void _cogl_pango_display_list_set_color_override (CoglPangoDisplayList *dl,
@@ -57,6 +69,11 @@ void _cogl_pango_display_list_add_trapezoid (CoglPangoDisplayList *dl,
                                              float x_12,
                                              float x_22);
 
+int _cogl_pango_display_list_update_textures
+                                 (CoglPangoDisplayList *dl,
+                                  CoglPangoDisplayListTextureFunc func,
+                                  void *user_data);
+
 void _cogl_pango_display_list_render (CoglPangoDisplayList *dl,
                                       const CoglColor *color);
 
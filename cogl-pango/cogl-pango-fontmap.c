@@ -197,6 +197,187 @@ cogl_pango_font_map_get_use_mipmapping (CoglPangoFontMap *fm)
   return _cogl_pango_renderer_get_use_mipmapping (renderer);
 }
 
+/**
+ * cogl_pango_font_map_set_use_sdf:
+ * @fm: a #CoglPangoFontMap
+ * @value: %TRUE to store glyphs as signed distance fields
+ *
+ * Sets whether the renderer for the passed font map should store
+ * glyphs as signed distance fields. A distance field is generated
+ * once for each glyph of a font face at a fixed reference size and
+ * is then scaled with a shader when the text is drawn. This means
+ * that text that is animated or shown at many different sizes won't
+ * fill the glyph cache with a separate copy of the glyphs for every
+ * size and that the glyphs stay sharp when they are scaled up. The
+ * glyphs are not hinted so small text may look softer than with the
+ * normal glyphs.
+ *
+ * Distance fields need GLSL support so this has no effect if the
+ * driver doesn't support shaders. Mipmapping is not used for distance
+ * field glyphs.
+ *
+ * Since: 1.10
+ */
+void
+cogl_pango_font_map_set_use_sdf (CoglPangoFontMap *fm,
+                                 gboolean          value)
+{
+  CoglPangoRenderer *renderer;
+
+  renderer = COGL_PANGO_RENDERER (cogl_pango_font_map_get_renderer (fm));
+
+  _cogl_pango_renderer_set_use_sdf (renderer, value);
+}
+
+/**
+ * cogl_pango_font_map_get_use_sdf:
+ * @fm: a #CoglPangoFontMap
+ *
+ * Retrieves whether the #CoglPangoRenderer used by @fm will store
+ * glyphs as signed distance fields. This can return %FALSE even after
+ * enabling them with cogl_pango_font_map_set_use_sdf() if they are
+ * not supported by the driver.
+ *
+ * Return value: %TRUE if distance fields are used, %FALSE otherwise.
+ *
+ * Since: 1.10
+ */
+gboolean
+cogl_pango_font_map_get_use_sdf (CoglPangoFontMap *fm)
+{
+  CoglPangoRenderer *renderer;
+
+  renderer = COGL_PANGO_RENDERER (cogl_pango_font_map_get_renderer (fm));
+
+  return _cogl_pango_renderer_get_use_sdf (renderer);
+}
+
+/**
+ * cogl_pango_font_map_set_rasterization_threads:
+ * @fm: a #CoglPangoFontMap
+ * @n_threads: the number of threads to use
+ *
+ * Sets the number of threads that the renderer for the passed font
+ * map will use to rasterize glyphs that aren't in the glyph cache
+ * yet. When @n_threads is 1 the glyphs are rasterized on the calling
+ * thread which is the default. Larger values are only useful when a
+ * lot of new glyphs are drawn at once, for example when showing a
+ * page of CJK text for the first time. The glyphs are always
+ * uploaded to the glyph atlas from the calling thread.
+ *
+ * Using more than one thread requires the GLib thread system to have
+ * been initialized.
+ *
+ * Since: 1.10
+ */
+void
+cogl_pango_font_map_set_rasterization_threads (CoglPangoFontMap *fm,
+                                               int               n_threads)
+{
+  CoglPangoRenderer *renderer;
+
+  renderer = COGL_PANGO_RENDERER (cogl_pango_font_map_get_renderer (fm));
+
+  _cogl_pango_renderer_set_rasterization_threads (renderer, n_threads);
+}
+
+/**
+ * cogl_pango_font_map_get_rasterization_threads:
+ * @fm: a #CoglPangoFontMap
+ *
+ * Retrieves the number of threads that the #CoglPangoRenderer used by
+ * @fm will use to rasterize new glyphs.
+ *
+ * Return value: the number of rasterization threads
+ *
+ * Since: 1.10
+ */
+int
+cogl_pango_font_map_get_rasterization_threads (CoglPangoFontMap *fm)
+{
+  CoglPangoRenderer *renderer;
+
+  renderer = COGL_PANGO_RENDERER (cogl_pango_font_map_get_renderer (fm));
+
+  return _cogl_pango_renderer_get_rasterization_threads (renderer);
+}
+
+/**
+ * cogl_pango_font_map_set_glyph_cache_budget:
+ * @fm: a #CoglPangoFontMap
+ * @budget: the maximum number of bytes of texture memory to use for
+ *   glyphs or 0 for no limit
+ *
+ * Sets a limit on the amount of texture memory that the renderer for
+ * the passed font map will use to cache glyphs. When a new glyph would
+ * take the cache over the limit the least recently used glyphs are
+ * evicted. Glyphs that are needed by a #PangoLayout that is still
+ * being rendered are never evicted so the limit may be exceeded if
+ * there are too many of them. The space used by an evicted glyph is
+ * only reused once Cogl has finished drawing anything that uses it.
+ * The limit covers all of the glyphs cached by the renderer together,
+ * whether or not they are mipmapped or stored as distance fields.
+ *
+ * This is useful for long-running applications that show text in a
+ * lot of different fonts and sizes. By default there is no limit.
+ *
+ * Since: 1.10
+ */
+void
+cogl_pango_font_map_set_glyph_cache_budget (CoglPangoFontMap *fm,
+                                            gsize             budget)
+{
+  CoglPangoRenderer *renderer;
+
+  renderer = COGL_PANGO_RENDERER (cogl_pango_font_map_get_renderer (fm));
+
+  _cogl_pango_renderer_set_glyph_cache_budget (renderer, budget);
+}
+
+/**
+ * cogl_pango_font_map_get_glyph_cache_budget:
+ * @fm: a #CoglPangoFontMap
+ *
+ * Retrieves the limit set with
+ * cogl_pango_font_map_set_glyph_cache_budget().
+ *
+ * Return value: the maximum number of bytes of texture memory used
+ *   for glyphs or 0 if there is no limit
+ *
+ * Since: 1.10
+ */
+gsize
+cogl_pango_font_map_get_glyph_cache_budget (CoglPangoFontMap *fm)
+{
+  CoglPangoRenderer *renderer;
+
+  renderer = COGL_PANGO_RENDERER (cogl_pango_font_map_get_renderer (fm));
+
+  return _cogl_pango_renderer_get_glyph_cache_budget (renderer);
+}
+
+/**
+ * cogl_pango_font_map_get_glyph_cache_usage:
+ * @fm: a #CoglPangoFontMap
+ *
+ * Retrieves an estimate of the amount of texture memory currently
+ * used by the glyphs cached by the renderer for @fm. This includes
+ * evicted glyphs whose space hasn't been reused yet.
+ *
+ * Return value: the number of bytes used for glyphs
+ *
+ * Since: 1.10
+ */
+gsize
+cogl_pango_font_map_get_glyph_cache_usage (CoglPangoFontMap *fm)
+{
+  CoglPangoRenderer *renderer;
+
+  renderer = COGL_PANGO_RENDERER (cogl_pango_font_map_get_renderer (fm));
+
+  return _cogl_pango_renderer_get_glyph_cache_usage (renderer);
+}
+
 static GQuark
 cogl_pango_font_map_get_renderer_key (void)
 {
@@ -26,19 +26,48 @@
 #endif
 
 #include <glib.h>
+#include <pango/pangocairo.h>
 
 #include "cogl-pango-glyph-cache.h"
 #include "cogl-pango-private.h"
+#include "cogl-pango-sdf.h"
 #include "cogl/cogl-atlas.h"
 #include "cogl/cogl-atlas-texture-private.h"
+#include "cogl/cogl-private.h"
 
-typedef struct _CoglPangoGlyphCacheKey     CoglPangoGlyphCacheKey;
+/* Glyphs with an index lower than this are stored in an array in the
+   record for their font so that they can be found without hashing */
+#define COGL_PANGO_GLYPH_CACHE_N_DIRECT_GLYPHS 256
+
+/* The initial size of the hash table. This must be a power of two */
+#define COGL_PANGO_GLYPH_CACHE_MIN_SLOTS       64
+
+typedef struct _CoglPangoGlyphCacheEntry   CoglPangoGlyphCacheEntry;
+typedef struct _CoglPangoGlyphCacheFont    CoglPangoGlyphCacheFont;
+typedef struct _CoglPangoGlyphCacheSlot    CoglPangoGlyphCacheSlot;
 
 struct _CoglPangoGlyphCache
 {
-  /* Hash table to quickly check whether a particular glyph in a
-     particular font is already cached */
-  GHashTable       *hash_table;
+  /* Open addressed hash table to quickly check whether a particular
+     glyph in a particular font is already cached. Only glyphs that
+     are too high to go in the font's direct array are stored here */
+  CoglPangoGlyphCacheSlot *slots;
+  /* The size of the table. This is always a power of two */
+  unsigned int      n_slots;
+  unsigned int      n_used_slots;
+
+  /* Hash table mapping font keys to CoglPangoGlyphCacheFonts. The
+     key is the PangoFont unless the cache contains distance fields in
+     which case it is the font's reference cairo scaled font so that
+     all sizes of the same face, shape and options share their
+     glyphs */
+  GHashTable       *fonts;
+  /* The font that was last looked up and its record. Glyphs are
+     nearly always looked up in runs from the same font so this
+     avoids looking it up in the hash table. The cache holds a
+     reference on the font */
+  PangoFont        *last_pango_font;
+  CoglPangoGlyphCacheFont *last_font;
 
   /* List of CoglAtlases */
   GSList           *atlases;
@@ -46,6 +75,10 @@ struct _CoglPangoGlyphCache
   /* List of callbacks to invoke when an atlas is reorganized */
   GHookList         reorganize_callbacks;
 
+  /* List of callbacks to invoke when all of the glyphs are about to
+     be freed */
+  GHookList         clear_callbacks;
+
   /* TRUE if we've ever stored a texture in the global atlas. This is
      used to make sure we only register one callback to listen for
      global atlas reorganizations */
@@ -59,12 +92,72 @@ struct _CoglPangoGlyphCache
   /* Whether mipmapping is being used for this cache. This only
      affects whether we decide to put the glyph in the global atlas */
   gboolean          use_mipmapping;
+
+  /* Whether the glyphs are stored as signed distance fields rendered
+     at a fixed reference size instead of as coverage bitmaps */
+  gboolean          use_sdf;
+
+  /* The budget that the cache shares with the other caches of the
+     same renderer. If the cache was created without one then it has
+     its own private budget which it frees along with the cache */
+  CoglPangoGlyphCacheBudget *budget;
+  gboolean          owns_budget;
+  /* The number of bytes used by the glyphs in the cache */
+  gsize             memory_usage;
+
+  /* Queue of all the glyphs with the most recently used at the
+     head */
+  GQueue            lru_queue;
+
+  /* Glyphs that have been evicted but whose space in the atlas can't
+     be reused yet because a journal might still refer to them */
+  GSList           *evicted_glyphs;
+  gsize             evicted_memory;
+};
+
+struct _CoglPangoGlyphCacheBudget
+{
+  /* The maximum number of bytes of texture memory that the glyphs of
+     all the caches should use or 0 if there is no limit */
+  gsize             limit;
+
+  /* This is incremented every time a set of glyphs is about to be
+     looked up to render some text and is used to stamp the glyphs
+     as they are used. It is shared so that the glyphs from different
+     caches can be compared when deciding which one to evict */
+  unsigned int      age;
+
+  /* List of CoglPangoGlyphCaches using the budget */
+  GSList           *caches;
+};
+
+struct _CoglPangoGlyphCacheEntry
+{
+  /* This must be first so that an entry can be used as a value */
+  CoglPangoGlyphCacheValue  value;
+
+  CoglPangoGlyphCacheFont  *font;
+  PangoGlyph                glyph;
+};
+
+struct _CoglPangoGlyphCacheFont
+{
+  /* The cache holds a reference to the font while it has any glyphs
+     for it so the key can't be reused for a different font. With
+     distance fields this is the first font seen with the key */
+  PangoFont                *font;
+  void                     *key;
+  int                       n_glyphs;
+
+  CoglPangoGlyphCacheEntry *direct_glyphs[COGL_PANGO_GLYPH_CACHE_N_DIRECT_GLYPHS];
 };
 
-struct _CoglPangoGlyphCacheKey
+struct _CoglPangoGlyphCacheSlot
 {
-  PangoFont  *font;
-  PangoGlyph  glyph;
+  void                     *key;
+  PangoGlyph                glyph;
+  /* NULL if the slot is empty */
+  CoglPangoGlyphCacheEntry *entry;
 };
 
 static void
@@ -72,64 +165,327 @@ cogl_pango_glyph_cache_value_free (CoglPangoGlyphCacheValue *value)
 {
   if (value->texture)
     cogl_handle_unref (value->texture);
-  g_slice_free (CoglPangoGlyphCacheValue, value);
+  g_slice_free (CoglPangoGlyphCacheEntry,
+                (CoglPangoGlyphCacheEntry *) value);
+}
+
+static gsize
+cogl_pango_glyph_cache_value_get_memory (CoglPangoGlyphCacheValue *value)
+{
+  if (value->texture == COGL_INVALID_HANDLE)
+    return 0;
+  /* Glyphs in the local atlases use a single byte per pixel plus a
+     one pixel border whereas glyphs in the global atlas are RGBA */
+  else if (cogl_texture_get_format (value->texture) == COGL_PIXEL_FORMAT_A_8)
+    return (value->draw_width + 1) * (value->draw_height + 1);
+  else
+    return value->draw_width * value->draw_height * 4;
 }
 
 static void
-cogl_pango_glyph_cache_key_free (CoglPangoGlyphCacheKey *key)
+cogl_pango_glyph_cache_font_free (CoglPangoGlyphCacheFont *font)
 {
-  g_object_unref (key->font);
-  g_slice_free (CoglPangoGlyphCacheKey, key);
+  g_object_unref (font->font);
+  g_slice_free (CoglPangoGlyphCacheFont, font);
 }
 
-static guint
-cogl_pango_glyph_cache_hash_func (gconstpointer key)
+static inline unsigned int
+cogl_pango_glyph_cache_hash (void *key,
+                             PangoGlyph glyph)
 {
-  const CoglPangoGlyphCacheKey *cache_key
-    = (const CoglPangoGlyphCacheKey *) key;
+  guint64 hash;
+
+  /* Font keys are aligned and consecutive glyphs only differ in
+     the low bits so simply combining them would make the entries
+     cluster together. Instead everything is mixed using the
+     finalizer from MurmurHash3 */
+  hash = ((guint64) GPOINTER_TO_SIZE (key) ^
+          (guint64) glyph * G_GUINT64_CONSTANT (0x9e3779b97f4a7c15));
+  hash ^= hash >> 33;
+  hash *= G_GUINT64_CONSTANT (0xff51afd7ed558ccd);
+  hash ^= hash >> 33;
+  hash *= G_GUINT64_CONSTANT (0xc4ceb9fe1a85ec53);
+  hash ^= hash >> 33;
+
+  return (unsigned int) hash;
+}
 
-  /* Generate a number affected by both the font and the glyph
-     number. We can safely directly compare the pointers because the
-     key holds a reference to the font so it is not possible that a
-     different font will have the same memory address */
-  return GPOINTER_TO_UINT (cache_key->font) ^ cache_key->glyph;
+/* Returns the slot containing the glyph or the empty slot where it
+   should be inserted */
+static CoglPangoGlyphCacheSlot *
+cogl_pango_glyph_cache_find_slot (CoglPangoGlyphCache *cache,
+                                  void *key,
+                                  PangoGlyph glyph)
+{
+  unsigned int mask = cache->n_slots - 1;
+  unsigned int i = cogl_pango_glyph_cache_hash (key, glyph) & mask;
+
+  while (TRUE)
+    {
+      CoglPangoGlyphCacheSlot *slot = cache->slots + i;
+
+      if (slot->entry == NULL ||
+          (slot->key == key && slot->glyph == glyph))
+        return slot;
+
+      i = (i + 1) & mask;
+    }
 }
 
-static gboolean
-cogl_pango_glyph_cache_equal_func (gconstpointer a,
-				      gconstpointer b)
+static void
+cogl_pango_glyph_cache_init_slots (CoglPangoGlyphCache *cache,
+                                   unsigned int n_slots)
+{
+  cache->slots = g_new0 (CoglPangoGlyphCacheSlot, n_slots);
+  cache->n_slots = n_slots;
+  cache->n_used_slots = 0;
+}
+
+static void
+cogl_pango_glyph_cache_insert_slot (CoglPangoGlyphCache *cache,
+                                    CoglPangoGlyphCacheEntry *entry)
+{
+  CoglPangoGlyphCacheSlot *slot;
+
+  /* Keep the table at most half full so that the probe sequences stay
+     short */
+  if ((cache->n_used_slots + 1) * 2 > cache->n_slots)
+    {
+      CoglPangoGlyphCacheSlot *old_slots = cache->slots;
+      unsigned int old_n_slots = cache->n_slots;
+      unsigned int i;
+
+      cogl_pango_glyph_cache_init_slots (cache, old_n_slots * 2);
+
+      for (i = 0; i < old_n_slots; i++)
+        if (old_slots[i].entry)
+          {
+            slot = cogl_pango_glyph_cache_find_slot (cache,
+                                                     old_slots[i].key,
+                                                     old_slots[i].glyph);
+            *slot = old_slots[i];
+            cache->n_used_slots++;
+          }
+
+      g_free (old_slots);
+    }
+
+  slot = cogl_pango_glyph_cache_find_slot (cache,
+                                           entry->font->key,
+                                           entry->glyph);
+  slot->key = entry->font->key;
+  slot->glyph = entry->glyph;
+  slot->entry = entry;
+  cache->n_used_slots++;
+}
+
+static void
+cogl_pango_glyph_cache_remove_slot (CoglPangoGlyphCache *cache,
+                                    CoglPangoGlyphCacheEntry *entry)
+{
+  unsigned int mask = cache->n_slots - 1;
+  CoglPangoGlyphCacheSlot *slot;
+  unsigned int i, j;
+
+  slot = cogl_pango_glyph_cache_find_slot (cache,
+                                           entry->font->key,
+                                           entry->glyph);
+  g_assert (slot->entry == entry);
+
+  slot->entry = NULL;
+  cache->n_used_slots--;
+
+  /* Instead of leaving a tombstone, move back any following entries
+     that would no longer be reachable from their home slot */
+  i = slot - cache->slots;
+  for (j = (i + 1) & mask; cache->slots[j].entry; j = (j + 1) & mask)
+    {
+      unsigned int home =
+        cogl_pango_glyph_cache_hash (cache->slots[j].key,
+                                     cache->slots[j].glyph) & mask;
+
+      /* The entry can stay where it is if its home slot is cyclically
+         within (i, j] */
+      if (i < j ? (home > i && home <= j) : (home > i || home <= j))
+        continue;
+
+      cache->slots[i] = cache->slots[j];
+      cache->slots[j].entry = NULL;
+      i = j;
+    }
+}
+
+/* The last font is referenced so that its address can't be reused by
+   a different font while it is remembered */
+static void
+cogl_pango_glyph_cache_set_last_font (CoglPangoGlyphCache *cache,
+                                      PangoFont *font,
+                                      CoglPangoGlyphCacheFont *cache_font)
+{
+  if (font)
+    g_object_ref (font);
+  if (cache->last_pango_font)
+    g_object_unref (cache->last_pango_font);
+
+  cache->last_pango_font = font;
+  cache->last_font = cache_font;
+}
+
+static CoglPangoGlyphCacheFont *
+cogl_pango_glyph_cache_get_font (CoglPangoGlyphCache *cache,
+                                 PangoFont *font,
+                                 gboolean create)
+{
+  CoglPangoGlyphCacheFont *cache_font;
+  void *key;
+
+  if (cache->last_font && cache->last_pango_font == font)
+    return cache->last_font;
+
+  /* The reference font of a distance field font has the face, the
+     shape of the font matrix and the options of the font but not its
+     size. Cairo returns the same scaled font for each font that
+     matches in all of those and the first font stored for the key
+     keeps it alive */
+  if (cache->use_sdf)
+    key = _cogl_pango_sdf_get_reference_font (font);
+  else
+    key = font;
+
+  cache_font = g_hash_table_lookup (cache->fonts, key);
+
+  if (cache_font == NULL)
+    {
+      if (!create)
+        return NULL;
+
+      cache_font = g_slice_new0 (CoglPangoGlyphCacheFont);
+      cache_font->font = g_object_ref (font);
+      cache_font->key = key;
+
+      g_hash_table_insert (cache->fonts, key, cache_font);
+    }
+
+  cogl_pango_glyph_cache_set_last_font (cache, font, cache_font);
+
+  return cache_font;
+}
+
+static void
+cogl_pango_glyph_cache_release_font (CoglPangoGlyphCache *cache,
+                                     CoglPangoGlyphCacheFont *cache_font)
 {
-  const CoglPangoGlyphCacheKey *key_a
-    = (const CoglPangoGlyphCacheKey *) a;
-  const CoglPangoGlyphCacheKey *key_b
-    = (const CoglPangoGlyphCacheKey *) b;
+  /* Once there are no glyphs left for the font we can drop our
+     reference to it */
+  if (cache_font->n_glyphs == 0)
+    {
+      if (cache->last_font == cache_font)
+        cogl_pango_glyph_cache_set_last_font (cache, NULL, NULL);
 
-  /* We can safely directly compare the pointers for the fonts because
-     the key holds a reference to the font so it is not possible that
-     a different font will have the same memory address */
-  return key_a->font == key_b->font
-    && key_a->glyph == key_b->glyph;
+      g_hash_table_remove (cache->fonts, cache_font->key);
+    }
+}
+
+static void
+cogl_pango_glyph_cache_add_entry (CoglPangoGlyphCache *cache,
+                                  CoglPangoGlyphCacheEntry *entry)
+{
+  if (entry->glyph < COGL_PANGO_GLYPH_CACHE_N_DIRECT_GLYPHS)
+    entry->font->direct_glyphs[entry->glyph] = entry;
+  else
+    cogl_pango_glyph_cache_insert_slot (cache, entry);
+
+  entry->font->n_glyphs++;
+
+  entry->value.lru_link.data = entry;
+  entry->value.lru_link.prev = NULL;
+  entry->value.lru_link.next = NULL;
+  g_queue_push_head_link (&cache->lru_queue, &entry->value.lru_link);
+}
+
+static void
+cogl_pango_glyph_cache_remove_entry (CoglPangoGlyphCache *cache,
+                                     CoglPangoGlyphCacheEntry *entry)
+{
+  if (entry->glyph < COGL_PANGO_GLYPH_CACHE_N_DIRECT_GLYPHS)
+    entry->font->direct_glyphs[entry->glyph] = NULL;
+  else
+    cogl_pango_glyph_cache_remove_slot (cache, entry);
+
+  g_queue_unlink (&cache->lru_queue, &entry->value.lru_link);
+
+  entry->font->n_glyphs--;
+  cogl_pango_glyph_cache_release_font (cache, entry->font);
+  entry->font = NULL;
+}
+
+CoglPangoGlyphCacheBudget *
+_cogl_pango_glyph_cache_budget_new (void)
+{
+  CoglPangoGlyphCacheBudget *budget = g_slice_new (CoglPangoGlyphCacheBudget);
+
+  budget->limit = 0;
+  budget->age = 0;
+  budget->caches = NULL;
+
+  return budget;
+}
+
+void
+_cogl_pango_glyph_cache_budget_free (CoglPangoGlyphCacheBudget *budget)
+{
+  /* All of the caches should have been freed first */
+  g_warn_if_fail (budget->caches == NULL);
+
+  g_slice_free (CoglPangoGlyphCacheBudget, budget);
 }
 
 CoglPangoGlyphCache *
-cogl_pango_glyph_cache_new (gboolean use_mipmapping)
+cogl_pango_glyph_cache_new (gboolean use_mipmapping,
+                            gboolean use_sdf,
+                            CoglPangoGlyphCacheBudget *budget)
 {
   CoglPangoGlyphCache *cache;
 
   cache = g_malloc (sizeof (CoglPangoGlyphCache));
 
-  cache->hash_table = g_hash_table_new_full
-    (cogl_pango_glyph_cache_hash_func,
-     cogl_pango_glyph_cache_equal_func,
-     (GDestroyNotify) cogl_pango_glyph_cache_key_free,
-     (GDestroyNotify) cogl_pango_glyph_cache_value_free);
+  cogl_pango_glyph_cache_init_slots (cache,
+                                     COGL_PANGO_GLYPH_CACHE_MIN_SLOTS);
+
+  cache->fonts = g_hash_table_new_full
+    (g_direct_hash,
+     g_direct_equal,
+     NULL,
+     (GDestroyNotify) cogl_pango_glyph_cache_font_free);
+  cache->last_pango_font = NULL;
+  cache->last_font = NULL;
 
   cache->atlases = NULL;
   g_hook_list_init (&cache->reorganize_callbacks, sizeof (GHook));
+  g_hook_list_init (&cache->clear_callbacks, sizeof (GHook));
 
+  cache->using_global_atlas = FALSE;
   cache->has_dirty_glyphs = FALSE;
 
   cache->use_mipmapping = use_mipmapping;
+  cache->use_sdf = use_sdf;
+
+  if (budget)
+    {
+      cache->budget = budget;
+      cache->owns_budget = FALSE;
+    }
+  else
+    {
+      cache->budget = _cogl_pango_glyph_cache_budget_new ();
+      cache->owns_budget = TRUE;
+    }
+  cache->budget->caches = g_slist_prepend (cache->budget->caches, cache);
+
+  cache->memory_usage = 0;
+  g_queue_init (&cache->lru_queue);
+  cache->evicted_glyphs = NULL;
+  cache->evicted_memory = 0;
 
   return cache;
 }
@@ -145,12 +501,38 @@ cogl_pango_glyph_cache_reorganize_cb (void *user_data)
 void
 cogl_pango_glyph_cache_clear (CoglPangoGlyphCache *cache)
 {
+  /* Let the display lists know that the glyphs they are using are
+     about to go away */
+  g_hook_list_invoke (&cache->clear_callbacks, FALSE);
+
+  /* The atlases are being thrown away so there's no need to return
+     the space for the evicted glyphs. Any journal that still uses
+     their textures will have its own reference */
+  g_slist_foreach (cache->evicted_glyphs,
+                   (GFunc) cogl_pango_glyph_cache_value_free,
+                   NULL);
+  g_slist_free (cache->evicted_glyphs);
+  cache->evicted_glyphs = NULL;
+  cache->evicted_memory = 0;
+
+  /* Every glyph is in the LRU queue */
+  g_list_foreach (cache->lru_queue.head,
+                  (GFunc) cogl_pango_glyph_cache_value_free,
+                  NULL);
+  g_queue_init (&cache->lru_queue);
+  cache->memory_usage = 0;
+
+  g_free (cache->slots);
+  cogl_pango_glyph_cache_init_slots (cache,
+                                     COGL_PANGO_GLYPH_CACHE_MIN_SLOTS);
+
+  g_hash_table_remove_all (cache->fonts);
+  cogl_pango_glyph_cache_set_last_font (cache, NULL, NULL);
+
   g_slist_foreach (cache->atlases, (GFunc) cogl_object_unref, NULL);
   g_slist_free (cache->atlases);
   cache->atlases = NULL;
   cache->has_dirty_glyphs = FALSE;
-
-  g_hash_table_remove_all (cache->hash_table);
 }
 
 void
@@ -162,9 +544,15 @@ cogl_pango_glyph_cache_free (CoglPangoGlyphCache *cache)
 
   cogl_pango_glyph_cache_clear (cache);
 
-  g_hash_table_unref (cache->hash_table);
+  g_free (cache->slots);
+  g_hash_table_unref (cache->fonts);
 
   g_hook_list_clear (&cache->reorganize_callbacks);
+  g_hook_list_clear (&cache->clear_callbacks);
+
+  cache->budget->caches = g_slist_remove (cache->budget->caches, cache);
+  if (cache->owns_budget)
+    _cogl_pango_glyph_cache_budget_free (cache->budget);
 
   g_free (cache);
 }
@@ -208,8 +596,10 @@ cogl_pango_glyph_cache_add_to_global_atlas (CoglPangoGlyphCache *cache,
     return FALSE;
 
   /* If the cache is using mipmapping then we can't use the global
-     atlas because it would just get migrated back out */
-  if (cache->use_mipmapping)
+     atlas because it would just get migrated back out. Distance
+     fields need to be in an alpha-only texture to use the right
+     shader */
+  if (cache->use_mipmapping || cache->use_sdf)
     return FALSE;
 
   texture = _cogl_atlas_texture_new_with_size (value->draw_width,
@@ -269,6 +659,8 @@ cogl_pango_glyph_cache_add_to_local_atlas (CoglPangoGlyphCache *cache,
                                COGL_ATLAS_CLEAR_TEXTURE |
                                COGL_ATLAS_DISABLE_MIGRATION,
                                cogl_pango_glyph_cache_update_position_cb);
+      _cogl_atlas_set_memory_category (atlas,
+                                       COGL_MEMORY_CATEGORY_GLYPH_CACHE);
       COGL_NOTE (ATLAS, "Created new atlas for glyphs: %p", atlas);
       /* If we still can't reserve space then something has gone
          seriously wrong so we'll just give up */
@@ -290,30 +682,198 @@ cogl_pango_glyph_cache_add_to_local_atlas (CoglPangoGlyphCache *cache,
   return TRUE;
 }
 
+static void
+cogl_pango_glyph_cache_evict_entry (CoglPangoGlyphCache *cache,
+                                    CoglPangoGlyphCacheEntry *entry)
+{
+  CoglPangoGlyphCacheValue *value = &entry->value;
+
+  COGL_NOTE (PANGO, "evicting glyph %i", entry->glyph);
+
+  cogl_pango_glyph_cache_remove_entry (cache, entry);
+
+  cache->memory_usage -= cogl_pango_glyph_cache_value_get_memory (value);
+
+  /* A journal may still be using the glyph so the space in the
+     atlas can't be given back until it has been flushed */
+  cache->evicted_glyphs = g_slist_prepend (cache->evicted_glyphs, value);
+  cache->evicted_memory += cogl_pango_glyph_cache_value_get_memory (value);
+}
+
+static gsize
+cogl_pango_glyph_cache_budget_get_live_usage (CoglPangoGlyphCacheBudget *budget)
+{
+  gsize usage = 0;
+  GSList *l;
+
+  for (l = budget->caches; l; l = l->next)
+    usage += ((CoglPangoGlyphCache *) l->data)->memory_usage;
+
+  return usage;
+}
+
+/* Evicts the least recently used glyphs out of all of the caches
+   sharing the budget. Each cache's LRU queue is already sorted so
+   this walks them all from the tail at the same time and always
+   picks the glyph that was used the longest time ago */
+static void
+cogl_pango_glyph_cache_budget_evict (CoglPangoGlyphCacheBudget *budget)
+{
+  /* Evict down to three quarters of the budget so that we don't end
+     up evicting a glyph for every new glyph that is added */
+  gsize target = budget->limit / 4 * 3;
+  gsize usage = cogl_pango_glyph_cache_budget_get_live_usage (budget);
+  int n_caches = g_slist_length (budget->caches);
+  CoglPangoGlyphCache **caches;
+  GList **cursors;
+  GSList *l;
+  int i;
+
+  caches = g_alloca (sizeof (CoglPangoGlyphCache *) * n_caches);
+  cursors = g_alloca (sizeof (GList *) * n_caches);
+
+  for (l = budget->caches, i = 0; l; l = l->next, i++)
+    {
+      caches[i] = l->data;
+      cursors[i] = caches[i]->lru_queue.tail;
+    }
+
+  while (usage > target)
+    {
+      CoglPangoGlyphCacheEntry *entry;
+      CoglPangoGlyphCacheValue *value;
+      int oldest = -1;
+
+      for (i = 0; i < n_caches; i++)
+        if (cursors[i] &&
+            (oldest == -1 ||
+             ((CoglPangoGlyphCacheValue *) cursors[i]->data)->last_used <
+             ((CoglPangoGlyphCacheValue *) cursors[oldest]->data)->last_used))
+          oldest = i;
+
+      if (oldest == -1)
+        break;
+
+      entry = cursors[oldest]->data;
+      value = &entry->value;
+
+      /* The rest of the glyphs in this cache have been used to
+         render the current text so they can't be evicted */
+      if (value->last_used == budget->age)
+        {
+          cursors[oldest] = NULL;
+          continue;
+        }
+
+      cursors[oldest] = cursors[oldest]->prev;
+
+      /* Skip glyphs that are still referenced by a display list */
+      if (value->n_users > 0)
+        continue;
+
+      usage -= cogl_pango_glyph_cache_value_get_memory (value);
+      cogl_pango_glyph_cache_evict_entry (caches[oldest], entry);
+    }
+}
+
+static void
+cogl_pango_glyph_cache_free_evicted_glyphs (CoglPangoGlyphCache *cache)
+{
+  GSList *l, *a;
+
+  for (l = cache->evicted_glyphs; l; l = l->next)
+    {
+      CoglPangoGlyphCacheValue *value = l->data;
+
+      /* If the glyph is in one of our local atlases then we need to
+         give its space back. Glyphs in the global atlas are removed
+         when their texture is destroyed */
+      if (value->texture)
+        for (a = cache->atlases; a; a = a->next)
+          {
+            CoglAtlas *atlas = a->data;
+
+            if (atlas->texture == value->texture)
+              {
+                CoglRectangleMapEntry rectangle;
+
+                rectangle.x = value->tx_pixel;
+                rectangle.y = value->ty_pixel;
+                rectangle.width = value->draw_width + 1;
+                rectangle.height = value->draw_height + 1;
+
+                _cogl_atlas_remove (atlas, &rectangle);
+
+                break;
+              }
+          }
+
+      cogl_pango_glyph_cache_value_free (value);
+    }
+
+  g_slist_free (cache->evicted_glyphs);
+  cache->evicted_glyphs = NULL;
+  cache->evicted_memory = 0;
+}
+
 CoglPangoGlyphCacheValue *
 cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
                                gboolean             create,
                                PangoFont           *font,
                                PangoGlyph           glyph)
 {
-  CoglPangoGlyphCacheKey lookup_key;
+  CoglPangoGlyphCacheFont *cache_font;
+  CoglPangoGlyphCacheEntry *entry;
   CoglPangoGlyphCacheValue *value;
 
-  lookup_key.font = font;
-  lookup_key.glyph = glyph;
+  cache_font = cogl_pango_glyph_cache_get_font (cache, font, create);
+
+  if (cache_font == NULL)
+    return NULL;
+
+  if (glyph < COGL_PANGO_GLYPH_CACHE_N_DIRECT_GLYPHS)
+    entry = cache_font->direct_glyphs[glyph];
+  else
+    entry = cogl_pango_glyph_cache_find_slot (cache,
+                                              cache_font->key,
+                                              glyph)->entry;
 
-  value = g_hash_table_lookup (cache->hash_table, &lookup_key);
+  value = (CoglPangoGlyphCacheValue *) entry;
 
-  if (create && value == NULL)
+  if (value)
+    {
+      value->last_used = cache->budget->age;
+
+      /* Move the glyph to the front of the LRU queue. This is only
+         needed if glyphs are going to be evicted */
+      if (cache->budget->limit > 0 && value->lru_link.prev)
+        {
+          g_queue_unlink (&cache->lru_queue, &value->lru_link);
+          g_queue_push_head_link (&cache->lru_queue, &value->lru_link);
+        }
+    }
+  else if (create)
     {
-      CoglPangoGlyphCacheKey *key;
       PangoRectangle ink_rect;
 
-      value = g_slice_new (CoglPangoGlyphCacheValue);
+      entry = g_slice_new (CoglPangoGlyphCacheEntry);
+      entry->font = cache_font;
+      entry->glyph = glyph;
+
+      value = &entry->value;
       value->texture = COGL_INVALID_HANDLE;
+      value->last_used = cache->budget->age;
+      value->n_users = 0;
 
-      pango_font_get_glyph_extents (font, glyph, &ink_rect, NULL);
-      pango_extents_to_pixels (&ink_rect, NULL);
+      if (cache->use_sdf)
+        /* The extents are in pixels at the reference size and
+           include space for the distance field to spread into */
+        _cogl_pango_sdf_get_glyph_extents (font, glyph, &ink_rect);
+      else
+        {
+          pango_font_get_glyph_extents (font, glyph, &ink_rect, NULL);
+          pango_extents_to_pixels (&ink_rect, NULL);
+        }
 
       value->draw_x = ink_rect.x;
       value->draw_y = ink_rect.y;
@@ -338,6 +898,7 @@ cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
                                                           value))
             {
               cogl_pango_glyph_cache_value_free (value);
+              cogl_pango_glyph_cache_release_font (cache, cache_font);
               return NULL;
             }
 
@@ -345,47 +906,117 @@ cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
           cache->has_dirty_glyphs = TRUE;
         }
 
-      key = g_slice_new (CoglPangoGlyphCacheKey);
-      key->font = g_object_ref (font);
-      key->glyph = glyph;
+      cogl_pango_glyph_cache_add_entry (cache, entry);
+
+      cache->memory_usage += cogl_pango_glyph_cache_value_get_memory (value);
 
-      g_hash_table_insert (cache->hash_table, key, value);
+      if (cache->budget->limit > 0 &&
+          (cogl_pango_glyph_cache_budget_get_live_usage (cache->budget) >
+           cache->budget->limit))
+        cogl_pango_glyph_cache_budget_evict (cache->budget);
     }
 
   return value;
 }
 
-static void
-_cogl_pango_glyph_cache_set_dirty_glyphs_cb (gpointer key_ptr,
-                                             gpointer value_ptr,
-                                             gpointer user_data)
+void
+_cogl_pango_glyph_cache_set_dirty_glyphs (CoglPangoGlyphCache *cache,
+                                          CoglPangoGlyphCacheDirtyFunc func,
+                                          void *user_data)
 {
-  CoglPangoGlyphCacheKey *key = key_ptr;
-  CoglPangoGlyphCacheValue *value = value_ptr;
-  CoglPangoGlyphCacheDirtyFunc func = user_data;
+  GList *l;
 
-  if (value->dirty)
+  /* If we know that there are no dirty glyphs then we can shortcut
+     out early */
+  if (!cache->has_dirty_glyphs)
+    return;
+
+  /* Every glyph is in the LRU queue so we can use it to iterate
+     them */
+  for (l = cache->lru_queue.head; l; l = l->next)
     {
-      func (key->font, key->glyph, value);
+      CoglPangoGlyphCacheEntry *entry = l->data;
+
+      if (entry->value.dirty)
+        {
+          func (entry->font->font, entry->glyph, &entry->value, user_data);
 
-      value->dirty = FALSE;
+          entry->value.dirty = FALSE;
+        }
     }
+
+  cache->has_dirty_glyphs = FALSE;
 }
 
 void
-_cogl_pango_glyph_cache_set_dirty_glyphs (CoglPangoGlyphCache *cache,
-                                          CoglPangoGlyphCacheDirtyFunc func)
+_cogl_pango_glyph_cache_budget_set_limit (CoglPangoGlyphCacheBudget *budget,
+                                          gsize limit)
 {
-  /* If we know that there are no dirty glyphs then we can shortcut
-     out early */
-  if (!cache->has_dirty_glyphs)
+  budget->limit = limit;
+
+  /* Note that the LRU queues aren't kept up to date while there is
+     no budget so until the glyphs are used again this will start by
+     evicting the glyphs that were created first */
+  if (limit > 0 &&
+      cogl_pango_glyph_cache_budget_get_live_usage (budget) > limit)
+    cogl_pango_glyph_cache_budget_evict (budget);
+}
+
+gsize
+_cogl_pango_glyph_cache_budget_get_limit (CoglPangoGlyphCacheBudget *budget)
+{
+  return budget->limit;
+}
+
+gsize
+_cogl_pango_glyph_cache_budget_get_usage (CoglPangoGlyphCacheBudget *budget)
+{
+  gsize usage = 0;
+  GSList *l;
+
+  for (l = budget->caches; l; l = l->next)
+    usage += _cogl_pango_glyph_cache_get_memory_usage (l->data);
+
+  return usage;
+}
+
+gsize
+_cogl_pango_glyph_cache_get_memory_usage (CoglPangoGlyphCache *cache)
+{
+  return cache->memory_usage + cache->evicted_memory;
+}
+
+void
+_cogl_pango_glyph_cache_advance_age (CoglPangoGlyphCache *cache)
+{
+  CoglPangoGlyphCacheBudget *budget = cache->budget;
+  gsize evicted_memory = 0;
+  GSList *l;
+
+  budget->age++;
+
+  for (l = budget->caches; l; l = l->next)
+    evicted_memory += ((CoglPangoGlyphCache *) l->data)->evicted_memory;
+
+  if (evicted_memory == 0)
     return;
 
-  g_hash_table_foreach (cache->hash_table,
-                        _cogl_pango_glyph_cache_set_dirty_glyphs_cb,
-                        func);
+  /* Once no journal can be referring to the evicted glyphs we can
+     reuse their space. If the evicted glyphs are starting to use a
+     significant part of the budget then we'll force a flush rather
+     than waiting */
+  if (_cogl_has_unflushed_journals ())
+    {
+      if (evicted_memory < budget->limit / 4)
+        return;
 
-  cache->has_dirty_glyphs = FALSE;
+      cogl_flush ();
+    }
+
+  /* The evicted glyphs of all the caches sharing the budget are
+     freed because they count towards the same limit */
+  for (l = budget->caches; l; l = l->next)
+    cogl_pango_glyph_cache_free_evicted_glyphs (l->data);
 }
 
 void
@@ -412,3 +1043,28 @@ _cogl_pango_glyph_cache_remove_reorganize_callback (CoglPangoGlyphCache *cache,
   if (hook)
     g_hook_destroy_link (&cache->reorganize_callbacks, hook);
 }
+
+void
+_cogl_pango_glyph_cache_add_clear_callback (CoglPangoGlyphCache *cache,
+                                            GHookFunc func,
+                                            void *user_data)
+{
+  GHook *hook = g_hook_alloc (&cache->clear_callbacks);
+  hook->func = func;
+  hook->data = user_data;
+  g_hook_prepend (&cache->clear_callbacks, hook);
+}
+
+void
+_cogl_pango_glyph_cache_remove_clear_callback (CoglPangoGlyphCache *cache,
+                                               GHookFunc func,
+                                               void *user_data)
+{
+  GHook *hook = g_hook_find_func_data (&cache->clear_callbacks,
+                                       FALSE,
+                                       func,
+                                       user_data);
+
+  if (hook)
+    g_hook_destroy_link (&cache->clear_callbacks, hook);
+}
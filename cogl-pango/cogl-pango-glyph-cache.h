@@ -32,6 +32,7 @@ G_BEGIN_DECLS
 
 typedef struct _CoglPangoGlyphCache      CoglPangoGlyphCache;
 typedef struct _CoglPangoGlyphCacheValue CoglPangoGlyphCacheValue;
+typedef struct _CoglPangoGlyphCacheBudget CoglPangoGlyphCacheBudget;
 
 struct _CoglPangoGlyphCacheValue
 {
@@ -53,14 +54,49 @@ struct _CoglPangoGlyphCacheValue
   /* This will be set to TRUE when the glyph atlas is reorganized
      which means the glyph will need to be redrawn */
   gboolean   dirty;
+
+  /* The age of the cache when the glyph was last looked up. Glyphs
+     used at the current age are never evicted */
+  unsigned int last_used;
+
+  /* The number of display lists that are using the glyph. The glyph
+     won't be evicted while this is non-zero */
+  int        n_users;
+
+  /* Link in the cache's list of glyphs sorted by when they were last
+     used. This is also used to iterate all of the glyphs */
+  GList      lru_link;
 };
 
 typedef void (* CoglPangoGlyphCacheDirtyFunc) (PangoFont *font,
                                                PangoGlyph glyph,
-                                               CoglPangoGlyphCacheValue *value);
+                                               CoglPangoGlyphCacheValue *value,
+                                               void *user_data);
+
+/* A memory budget can be shared between several caches so that the
+   limit applies to all of their glyphs together. The least recently
+   used glyphs are evicted from whichever cache they are in */
+CoglPangoGlyphCacheBudget *
+_cogl_pango_glyph_cache_budget_new (void);
+
+void
+_cogl_pango_glyph_cache_budget_free (CoglPangoGlyphCacheBudget *budget);
+
+void
+_cogl_pango_glyph_cache_budget_set_limit (CoglPangoGlyphCacheBudget *budget,
+                                          gsize limit);
+
+gsize
+_cogl_pango_glyph_cache_budget_get_limit (CoglPangoGlyphCacheBudget *budget);
 
+gsize
+_cogl_pango_glyph_cache_budget_get_usage (CoglPangoGlyphCacheBudget *budget);
+
+/* If budget is NULL then the cache gets its own budget */
 CoglPangoGlyphCache *
-cogl_pango_glyph_cache_new (gboolean use_mipmapping);
+cogl_pango_glyph_cache_new (gboolean use_mipmapping,
+                            gboolean use_sdf,
+                            CoglPangoGlyphCacheBudget *budget);
 
 void
 cogl_pango_glyph_cache_free (CoglPangoGlyphCache *cache);
@@ -74,6 +110,12 @@ cogl_pango_glyph_cache_lookup (CoglPangoGlyphCache *cache,
 void
 cogl_pango_glyph_cache_clear (CoglPangoGlyphCache *cache);
 
+gsize
+_cogl_pango_glyph_cache_get_memory_usage (CoglPangoGlyphCache *cache);
+
+void
+_cogl_pango_glyph_cache_advance_age (CoglPangoGlyphCache *cache);
+
 void
 _cogl_pango_glyph_cache_add_reorganize_callback (CoglPangoGlyphCache *cache,
                                                  GHookFunc func,
@@ -84,9 +126,20 @@ _cogl_pango_glyph_cache_remove_reorganize_callback (CoglPangoGlyphCache *cache,
                                                     GHookFunc func,
                                                     void *user_data);
 
+void
+_cogl_pango_glyph_cache_add_clear_callback (CoglPangoGlyphCache *cache,
+                                            GHookFunc func,
+                                            void *user_data);
+
+void
+_cogl_pango_glyph_cache_remove_clear_callback (CoglPangoGlyphCache *cache,
+                                               GHookFunc func,
+                                               void *user_data);
+
 void
 _cogl_pango_glyph_cache_set_dirty_glyphs (CoglPangoGlyphCache *cache,
-                                          CoglPangoGlyphCacheDirtyFunc func);
+                                          CoglPangoGlyphCacheDirtyFunc func,
+                                          void *user_data);
 
 G_END_DECLS
 
@@ -32,6 +32,7 @@
 #include <glib.h>
 #include <cogl/cogl.h>
 #include "cogl-pango-pipeline-cache.h"
+#include "cogl-pango-sdf.h"
 
 typedef struct _CoglPangoPipelineCacheEntry CoglPangoPipelineCacheEntry;
 
@@ -43,6 +44,7 @@ struct _CoglPangoPipelineCache
   CoglPipeline *base_texture_rgba_pipeline;
 
   gboolean use_mipmapping;
+  gboolean use_sdf;
 };
 
 struct _CoglPangoPipelineCacheEntry
@@ -77,7 +79,8 @@ _cogl_pango_pipeline_cache_value_destroy (gpointer data)
 }
 
 CoglPangoPipelineCache *
-_cogl_pango_pipeline_cache_new (gboolean use_mipmapping)
+_cogl_pango_pipeline_cache_new (gboolean use_mipmapping,
+                                gboolean use_sdf)
 {
   CoglPangoPipelineCache *cache = g_new (CoglPangoPipelineCache, 1);
 
@@ -94,6 +97,7 @@ _cogl_pango_pipeline_cache_new (gboolean use_mipmapping)
   cache->base_texture_alpha_pipeline = NULL;
 
   cache->use_mipmapping = use_mipmapping;
+  cache->use_sdf = use_sdf;
 
   return cache;
 }
@@ -147,6 +151,25 @@ get_base_texture_alpha_pipeline (CoglPangoPipelineCache *cache)
       cogl_pipeline_set_layer_combine (pipeline, 0, /* layer */
                                        "RGBA = MODULATE (PREVIOUS, TEXTURE[A])",
                                        NULL);
+
+      /* Distance fields need a shader to turn the distance into a
+         coverage value. The linear filter is what lets the edge stay
+         sharp when the glyph is scaled up */
+      if (cache->use_sdf)
+        {
+          CoglHandle shader, program;
+
+          shader = cogl_create_shader (COGL_SHADER_TYPE_FRAGMENT);
+          cogl_shader_source (shader, _cogl_pango_sdf_fragment_source);
+
+          program = cogl_create_program ();
+          cogl_program_attach_shader (program, shader);
+          cogl_handle_unref (shader);
+          _cogl_pango_sdf_set_program_uniforms (program);
+
+          cogl_pipeline_set_user_program (pipeline, program);
+          cogl_handle_unref (program);
+        }
     }
 
   return cache->base_texture_alpha_pipeline;
@@ -32,6 +32,21 @@ void           _cogl_pango_renderer_clear_glyph_cache  (CoglPangoRenderer *rende
 void           _cogl_pango_renderer_set_use_mipmapping (CoglPangoRenderer *renderer,
                                                         gboolean           value);
 gboolean       _cogl_pango_renderer_get_use_mipmapping (CoglPangoRenderer *renderer);
+void           _cogl_pango_renderer_set_use_sdf        (CoglPangoRenderer *renderer,
+                                                        gboolean           value);
+gboolean       _cogl_pango_renderer_get_use_sdf        (CoglPangoRenderer *renderer);
+void           _cogl_pango_renderer_set_rasterization_threads
+                                                       (CoglPangoRenderer *renderer,
+                                                        int                n_threads);
+int            _cogl_pango_renderer_get_rasterization_threads
+                                                       (CoglPangoRenderer *renderer);
+void           _cogl_pango_renderer_set_glyph_cache_budget
+                                                       (CoglPangoRenderer *renderer,
+                                                        gsize              budget);
+gsize          _cogl_pango_renderer_get_glyph_cache_budget
+                                                       (CoglPangoRenderer *renderer);
+gsize          _cogl_pango_renderer_get_glyph_cache_usage
+                                                       (CoglPangoRenderer *renderer);
 
 G_END_DECLS
 
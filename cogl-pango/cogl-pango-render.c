@@ -33,12 +33,14 @@
 #include <pango/pangocairo.h>
 #include <pango/pango-renderer.h>
 #include <cairo.h>
+#include <string.h>
 
 #include "cogl/cogl-debug.h"
 #include "cogl/cogl-texture-private.h"
 #include "cogl-pango-private.h"
 #include "cogl-pango-glyph-cache.h"
 #include "cogl-pango-display-list.h"
+#include "cogl-pango-sdf.h"
 
 typedef struct
 {
@@ -54,11 +56,26 @@ struct _CoglPangoRenderer
      caches, one with mipmapped textures and one without */
   CoglPangoRendererCaches no_mipmap_caches;
   CoglPangoRendererCaches mipmap_caches;
+  /* Caches of glyphs stored as signed distance fields. These are
+     rendered with a shader and are never mipmapped */
+  CoglPangoRendererCaches sdf_caches;
+  /* The memory budget shared by all of the glyph caches */
+  CoglPangoGlyphCacheBudget *glyph_cache_budget;
 
   gboolean use_mipmapping;
+  gboolean use_sdf;
+
+  /* Pool of threads used to rasterize dirty glyphs or NULL if they
+     are rasterized on the calling thread */
+  GThreadPool *rasterization_pool;
+  int n_rasterization_threads;
 
   /* The current display list that is being built */
   CoglPangoDisplayList *display_list;
+  /* If the display list is going to be kept then this is an array
+     that the glyphs it uses are added to. The glyphs will not be
+     evicted from the cache until the display list is destroyed */
+  GPtrArray *display_list_glyphs;
 };
 
 struct _CoglPangoRendererClass
@@ -67,25 +84,79 @@ struct _CoglPangoRendererClass
 };
 
 typedef struct _CoglPangoRendererQdata CoglPangoRendererQdata;
+typedef struct _CoglPangoRendererLine  CoglPangoRendererLine;
 
 /* An instance of this struct gets attached to each PangoLayout to
-   cache the VBO and to detect changes to the layout */
+   cache the VBOs and to detect changes to the layout */
 struct _CoglPangoRendererQdata
 {
   CoglPangoRenderer *renderer;
-  /* The cache of the geometry for the layout */
-  CoglPangoDisplayList *display_list;
+  /* Array of CoglPangoRendererLines for each line of the layout or
+     NULL if nothing is cached */
+  GPtrArray *lines;
   /* A reference to the first line of the layout. This is just used to
      detect changes */
   PangoLayoutLine *first_line;
-  /* Whether mipmapping was previously used to render this layout. We
-     need to regenerate the display list if the mipmapping value is
-     changed because it will be using a different set of textures */
-  gboolean mipmapping_used;
+  /* The caches that were previously used to render this layout. We
+     need to regenerate the display lists if the mipmapping or distance
+     field settings are changed because it will be using a different
+     set of textures */
+  CoglPangoRendererCaches *caches_used;
+  /* Set when the glyph atlas has been reorganized so that the texture
+     coordinates in the display lists need to be updated */
+  gboolean textures_moved;
+};
+
+/* The geometry for a single line of a layout. Any change to a layout
+   makes Pango create new lines so they are matched up using a
+   signature of everything that affects how the line is drawn. The
+   display list is built with the line at the origin so that a line
+   can be reused when the lines before it change. Without a matrix
+   the glyphs are rounded to whole pixels so the part of the position
+   within a pixel is kept when the display list is built */
+struct _CoglPangoRendererLine
+{
+  GByteArray *signature;
+  guint hash;
+
+  /* The position of the line's baseline in the layout in Pango
+     units */
+  int x, y;
+  /* The part of the position that the display list is built at. This
+     is part of the signature */
+  int subpixel_x, subpixel_y;
+
+  /* The line that was most recently matched to this one. This is
+     kept so that the display list can be rebuilt if it can't be
+     updated after a reorganization */
+  PangoLayoutLine *pango_line;
+
+  /* NULL if the display list needs to be built */
+  CoglPangoDisplayList *display_list;
+  /* The glyph cache values used by the display list in the order
+     that they were added */
+  GPtrArray *glyphs;
 };
 
+static CoglPangoRendererCaches *
+cogl_pango_renderer_get_caches (CoglPangoRenderer *priv)
+{
+  if (priv->use_sdf)
+    return &priv->sdf_caches;
+  else if (priv->use_mipmapping)
+    return &priv->mipmap_caches;
+  else
+    return &priv->no_mipmap_caches;
+}
+
 static void
 _cogl_pango_ensure_glyph_cache_for_layout_line (PangoLayoutLine *line);
+static void
+_cogl_pango_ensure_glyph_cache_for_layout_line_internal (PangoLayoutLine *line);
+static void
+_cogl_pango_set_dirty_glyphs (CoglPangoRenderer *priv);
+static void
+_cogl_pango_renderer_begin_glyph_lookup (CoglPangoRenderer *priv);
 
 typedef struct
 {
@@ -121,7 +192,8 @@ static void
 cogl_pango_renderer_draw_glyph (CoglPangoRenderer        *priv,
                                 CoglPangoGlyphCacheValue *cache_value,
                                 float                     x1,
-                                float                     y1)
+                                float                     y1,
+                                float                     scale)
 {
   CoglPangoRendererSliceCbData data;
 
@@ -130,8 +202,14 @@ cogl_pango_renderer_draw_glyph (CoglPangoRenderer        *priv,
   data.display_list = priv->display_list;
   data.x1 = x1;
   data.y1 = y1;
-  data.x2 = x1 + (float) cache_value->draw_width;
-  data.y2 = y1 + (float) cache_value->draw_height;
+  data.x2 = x1 + (float) cache_value->draw_width * scale;
+  data.y2 = y1 + (float) cache_value->draw_height * scale;
+
+  if (priv->display_list_glyphs)
+    {
+      cache_value->n_users++;
+      g_ptr_array_add (priv->display_list_glyphs, cache_value);
+    }
 
   /* We iterate the internal sub textures of the texture so that we
      can get a pointer to the base texture even if the texture is in
@@ -175,14 +253,26 @@ static void
 cogl_pango_renderer_init (CoglPangoRenderer *priv)
 {
   priv->no_mipmap_caches.pipeline_cache =
-    _cogl_pango_pipeline_cache_new (FALSE);
+    _cogl_pango_pipeline_cache_new (FALSE, FALSE);
   priv->mipmap_caches.pipeline_cache =
-    _cogl_pango_pipeline_cache_new (TRUE);
+    _cogl_pango_pipeline_cache_new (TRUE, FALSE);
+  priv->sdf_caches.pipeline_cache =
+    _cogl_pango_pipeline_cache_new (FALSE, TRUE);
+
+  priv->glyph_cache_budget = _cogl_pango_glyph_cache_budget_new ();
 
-  priv->no_mipmap_caches.glyph_cache = cogl_pango_glyph_cache_new (FALSE);
-  priv->mipmap_caches.glyph_cache = cogl_pango_glyph_cache_new (TRUE);
+  priv->no_mipmap_caches.glyph_cache =
+    cogl_pango_glyph_cache_new (FALSE, FALSE, priv->glyph_cache_budget);
+  priv->mipmap_caches.glyph_cache =
+    cogl_pango_glyph_cache_new (TRUE, FALSE, priv->glyph_cache_budget);
+  priv->sdf_caches.glyph_cache =
+    cogl_pango_glyph_cache_new (FALSE, TRUE, priv->glyph_cache_budget);
 
   _cogl_pango_renderer_set_use_mipmapping (priv, FALSE);
+  priv->use_sdf = FALSE;
+
+  priv->rasterization_pool = NULL;
+  priv->n_rasterization_threads = 1;
 }
 
 static void
@@ -205,9 +295,15 @@ cogl_pango_renderer_finalize (GObject *object)
 
   cogl_pango_glyph_cache_free (priv->no_mipmap_caches.glyph_cache);
   cogl_pango_glyph_cache_free (priv->mipmap_caches.glyph_cache);
+  cogl_pango_glyph_cache_free (priv->sdf_caches.glyph_cache);
+  _cogl_pango_glyph_cache_budget_free (priv->glyph_cache_budget);
 
   _cogl_pango_pipeline_cache_free (priv->no_mipmap_caches.pipeline_cache);
   _cogl_pango_pipeline_cache_free (priv->mipmap_caches.pipeline_cache);
+  _cogl_pango_pipeline_cache_free (priv->sdf_caches.pipeline_cache);
+
+  if (priv->rasterization_pool)
+    g_thread_pool_free (priv->rasterization_pool, FALSE, TRUE);
 
   G_OBJECT_CLASS (cogl_pango_renderer_parent_class)->finalize (object);
 }
@@ -240,23 +336,66 @@ cogl_pango_render_get_qdata_key (void)
   return key;
 }
 
+static void
+cogl_pango_render_unuse_glyph (CoglPangoGlyphCacheValue *value)
+{
+  value->n_users--;
+}
+
+static void
+cogl_pango_render_line_forget_display_list (CoglPangoRendererLine *line)
+{
+  if (line->display_list)
+    {
+      _cogl_pango_display_list_free (line->display_list);
+      line->display_list = NULL;
+
+      /* Let the glyphs be evicted again */
+      g_ptr_array_foreach (line->glyphs,
+                           (GFunc) cogl_pango_render_unuse_glyph,
+                           NULL);
+      g_ptr_array_free (line->glyphs, TRUE);
+      line->glyphs = NULL;
+    }
+}
+
+static void
+cogl_pango_render_line_free (CoglPangoRendererLine *line)
+{
+  cogl_pango_render_line_forget_display_list (line);
+  if (line->pango_line)
+    pango_layout_line_unref (line->pango_line);
+  g_byte_array_free (line->signature, TRUE);
+  g_slice_free (CoglPangoRendererLine, line);
+}
+
+static void
+cogl_pango_render_qdata_textures_moved (CoglPangoRendererQdata *qdata)
+{
+  qdata->textures_moved = TRUE;
+}
+
 static void
 cogl_pango_render_qdata_forget_display_list (CoglPangoRendererQdata *qdata)
 {
-  if (qdata->display_list)
+  if (qdata->lines)
     {
-      CoglPangoRendererCaches *caches = qdata->mipmapping_used ?
-        &qdata->renderer->mipmap_caches :
-        &qdata->renderer->no_mipmap_caches;
+      CoglPangoGlyphCache *glyph_cache = qdata->caches_used->glyph_cache;
 
       _cogl_pango_glyph_cache_remove_reorganize_callback
-        (caches->glyph_cache,
+        (glyph_cache,
+         (GHookFunc) cogl_pango_render_qdata_textures_moved,
+         qdata);
+      _cogl_pango_glyph_cache_remove_clear_callback
+        (glyph_cache,
          (GHookFunc) cogl_pango_render_qdata_forget_display_list,
          qdata);
 
-      _cogl_pango_display_list_free (qdata->display_list);
-
-      qdata->display_list = NULL;
+      g_ptr_array_foreach (qdata->lines,
+                           (GFunc) cogl_pango_render_line_free,
+                           NULL);
+      g_ptr_array_free (qdata->lines, TRUE);
+      qdata->lines = NULL;
     }
 }
 
@@ -269,6 +408,370 @@ cogl_pango_render_qdata_destroy (CoglPangoRendererQdata *qdata)
   g_slice_free (CoglPangoRendererQdata, qdata);
 }
 
+static guint
+cogl_pango_render_line_hash (gconstpointer key)
+{
+  const CoglPangoRendererLine *line = key;
+
+  return line->hash;
+}
+
+static gboolean
+cogl_pango_render_line_equal (gconstpointer a,
+                              gconstpointer b)
+{
+  const CoglPangoRendererLine *line_a = a;
+  const CoglPangoRendererLine *line_b = b;
+
+  return (line_a->hash == line_b->hash &&
+          line_a->signature->len == line_b->signature->len &&
+          !memcmp (line_a->signature->data,
+                   line_b->signature->data,
+                   line_a->signature->len));
+}
+
+#define SIGNATURE_APPEND(signature, value) \
+  g_byte_array_append ((signature), (const guint8 *) &(value), sizeof (value))
+
+static void
+cogl_pango_render_line_append_attributes (GByteArray *signature,
+                                          GSList *attrs)
+{
+  GSList *l;
+
+  for (l = attrs; l; l = l->next)
+    {
+      PangoAttribute *attr = l->data;
+      PangoAttrType type = attr->klass->type;
+
+      /* Only the attributes that are used when the line is drawn
+         matter. Anything else is either already reflected in the
+         glyphs or doesn't affect the rendering */
+      switch (type)
+        {
+        case PANGO_ATTR_FOREGROUND:
+        case PANGO_ATTR_BACKGROUND:
+        case PANGO_ATTR_UNDERLINE_COLOR:
+        case PANGO_ATTR_STRIKETHROUGH_COLOR:
+          SIGNATURE_APPEND (signature, type);
+          SIGNATURE_APPEND (signature, ((PangoAttrColor *) attr)->color);
+          break;
+
+        case PANGO_ATTR_UNDERLINE:
+        case PANGO_ATTR_STRIKETHROUGH:
+        case PANGO_ATTR_RISE:
+          SIGNATURE_APPEND (signature, type);
+          SIGNATURE_APPEND (signature, ((PangoAttrInt *) attr)->value);
+          break;
+
+        case PANGO_ATTR_SHAPE:
+          /* There's no way to compare the shape renderers so this
+             uses the attribute pointer which means the line will
+             never be reused */
+          SIGNATURE_APPEND (signature, type);
+          SIGNATURE_APPEND (signature, attr);
+          break;
+
+        default:
+          break;
+        }
+    }
+}
+
+static CoglPangoRendererLine *
+cogl_pango_render_line_new (PangoLayoutLine *pango_line,
+                            const PangoMatrix *matrix,
+                            int subpixel_x,
+                            int subpixel_y)
+{
+  CoglPangoRendererLine *line = g_slice_new0 (CoglPangoRendererLine);
+  GByteArray *signature = g_byte_array_new ();
+  guint8 has_matrix = matrix != NULL;
+  guint hash = 5381;
+  GSList *l;
+  int i;
+
+  /* The matrix is applied to the glyph positions when the display
+     list is built */
+  SIGNATURE_APPEND (signature, has_matrix);
+  if (matrix)
+    SIGNATURE_APPEND (signature, *matrix);
+  SIGNATURE_APPEND (signature, subpixel_x);
+  SIGNATURE_APPEND (signature, subpixel_y);
+
+  for (l = pango_line->runs; l; l = l->next)
+    {
+      PangoLayoutRun *run = l->data;
+      PangoGlyphString *glyphs = run->glyphs;
+
+      SIGNATURE_APPEND (signature, run->item->analysis.font);
+      SIGNATURE_APPEND (signature, glyphs->num_glyphs);
+
+      /* The glyph info can't be copied directly because the unused
+         bits of the visual attributes aren't initialized */
+      for (i = 0; i < glyphs->num_glyphs; i++)
+        {
+          const PangoGlyphInfo *gi = glyphs->glyphs + i;
+
+          SIGNATURE_APPEND (signature, gi->glyph);
+          SIGNATURE_APPEND (signature, gi->geometry);
+        }
+
+      cogl_pango_render_line_append_attributes
+        (signature, run->item->analysis.extra_attrs);
+    }
+
+  for (i = 0; i < signature->len; i++)
+    hash = hash * 33 + signature->data[i];
+
+  line->signature = signature;
+  line->hash = hash;
+  line->subpixel_x = subpixel_x;
+  line->subpixel_y = subpixel_y;
+
+  return line;
+}
+
+#undef SIGNATURE_APPEND
+
+static void
+cogl_pango_render_free_unused_lines (void *key,
+                                     void *value,
+                                     void *user_data)
+{
+  GSList *lines = value;
+
+  g_slist_foreach (lines, (GFunc) cogl_pango_render_line_free, NULL);
+  g_slist_free (lines);
+}
+
+/* Updates the array of lines to match the current lines of the
+   layout, keeping any lines that haven't changed */
+static void
+cogl_pango_render_qdata_update_lines (CoglPangoRendererQdata *qdata,
+                                      PangoLayout *layout)
+{
+  CoglPangoRenderer *priv = qdata->renderer;
+  const PangoMatrix *matrix;
+  GHashTable *old_lines;
+  GPtrArray *lines;
+  PangoLayoutIter *iter;
+  gboolean has_new_lines = FALSE;
+  int i;
+
+  matrix = pango_context_get_matrix (pango_layout_get_context (layout));
+
+  /* Index the old lines by their contents. There can be more than
+     one line with the same contents so each value is a list */
+  old_lines = g_hash_table_new (cogl_pango_render_line_hash,
+                                cogl_pango_render_line_equal);
+
+  for (i = 0; i < qdata->lines->len; i++)
+    {
+      CoglPangoRendererLine *line = g_ptr_array_index (qdata->lines, i);
+      GSList *list = g_hash_table_lookup (old_lines, line);
+
+      /* If there's already an equal key then it will be kept as the
+         key but that's fine because the lines are only freed once
+         the table is no longer needed */
+      g_hash_table_insert (old_lines, line, g_slist_prepend (list, line));
+    }
+
+  lines = g_ptr_array_new ();
+
+  if ((iter = pango_layout_get_iter (layout)))
+    {
+      do
+        {
+          PangoLayoutLine *pango_line;
+          CoglPangoRendererLine *line, *old_line;
+          PangoRectangle logical_rect;
+          int x, y, subpixel_x = 0, subpixel_y = 0;
+          GSList *list;
+
+          pango_line = pango_layout_iter_get_line_readonly (iter);
+
+          /* This matches how pango_renderer_draw_layout positions
+             each line */
+          pango_layout_iter_get_line_extents (iter, NULL, &logical_rect);
+          x = logical_rect.x;
+          y = pango_layout_iter_get_baseline (iter);
+
+          /* PANGO_SCALE is a power of two so this gives the offset
+             into the pixel even for negative positions */
+          if (matrix == NULL)
+            {
+              subpixel_x = x & (PANGO_SCALE - 1);
+              subpixel_y = y & (PANGO_SCALE - 1);
+            }
+
+          line = cogl_pango_render_line_new (pango_line, matrix,
+                                             subpixel_x, subpixel_y);
+
+          if ((list = g_hash_table_lookup (old_lines, line)))
+            {
+              old_line = list->data;
+
+              /* This keeps the existing key so the new line can be
+                 freed straight away */
+              g_hash_table_insert (old_lines,
+                                   line,
+                                   g_slist_delete_link (list, list));
+              cogl_pango_render_line_free (line);
+
+              line = old_line;
+              pango_layout_line_unref (line->pango_line);
+            }
+          else
+            has_new_lines = TRUE;
+
+          line->pango_line = pango_layout_line_ref (pango_line);
+          line->x = x;
+          line->y = y;
+
+          g_ptr_array_add (lines, line);
+        }
+      while (pango_layout_iter_next_line (iter));
+
+      pango_layout_iter_free (iter);
+    }
+
+  g_hash_table_foreach (old_lines, cogl_pango_render_free_unused_lines, NULL);
+  g_hash_table_destroy (old_lines);
+
+  g_ptr_array_free (qdata->lines, TRUE);
+  qdata->lines = lines;
+
+  /* Make sure all of the glyphs for the new lines are in the glyph
+     cache before any of them are drawn */
+  if (has_new_lines)
+    {
+      _cogl_pango_renderer_begin_glyph_lookup (priv);
+
+      for (i = 0; i < lines->len; i++)
+        {
+          CoglPangoRendererLine *line = g_ptr_array_index (lines, i);
+
+          if (line->display_list == NULL)
+            _cogl_pango_ensure_glyph_cache_for_layout_line_internal
+              (line->pango_line);
+        }
+
+      _cogl_pango_set_dirty_glyphs (priv);
+    }
+}
+typedef struct
+{
+  CoglHandle texture;
+  float tex_coords[4];
+} CoglPangoRendererFindTextureData;
+
+static void
+cogl_pango_render_find_texture_cb (CoglHandle handle,
+                                   const float *slice_coords,
+                                   const float *virtual_coords,
+                                   void *user_data)
+{
+  CoglPangoRendererFindTextureData *data = user_data;
+
+  data->texture = handle;
+  memcpy (data->tex_coords, slice_coords, sizeof (float) * 4);
+}
+
+static gboolean
+cogl_pango_render_line_update_texture_cb (int index,
+                                          CoglHandle *texture,
+                                          float *tx_1,
+                                          float *ty_1,
+                                          float *tx_2,
+                                          float *ty_2,
+                                          void *user_data)
+{
+  CoglPangoRendererLine *line = user_data;
+  CoglPangoGlyphCacheValue *value;
+  CoglPangoRendererFindTextureData data;
+
+  if (index >= line->glyphs->len)
+    return FALSE;
+
+  value = g_ptr_array_index (line->glyphs, index);
+
+  /* This finds the base texture in the same way as when the display
+     list was built */
+  data.texture = COGL_INVALID_HANDLE;
+  _cogl_texture_foreach_sub_texture_in_region (value->texture,
+                                               value->tx1,
+                                               value->ty1,
+                                               value->tx2,
+                                               value->ty2,
+                                               cogl_pango_render_find_texture_cb,
+                                               &data);
+
+  if (data.texture == COGL_INVALID_HANDLE)
+    return FALSE;
+
+  *texture = data.texture;
+  *tx_1 = data.tex_coords[0];
+  *ty_1 = data.tex_coords[1];
+  *tx_2 = data.tex_coords[2];
+  *ty_2 = data.tex_coords[3];
+
+  return TRUE;
+}
+
+/* Called after the glyph atlas has been reorganized. Each glyph keeps
+   its position so only the texture coordinates need to change */
+static void
+cogl_pango_render_qdata_update_textures (CoglPangoRendererQdata *qdata)
+{
+  int i;
+
+  /* The moved glyphs are marked as dirty so they need to be redrawn
+     into their new location before they can be used */
+  _cogl_pango_set_dirty_glyphs (qdata->renderer);
+
+  for (i = 0; i < qdata->lines->len; i++)
+    {
+      CoglPangoRendererLine *line = g_ptr_array_index (qdata->lines, i);
+      int n_updated;
+
+      if (line->display_list == NULL)
+        continue;
+
+      n_updated = _cogl_pango_display_list_update_textures
+        (line->display_list,
+         cogl_pango_render_line_update_texture_cb,
+         line);
+
+      /* If the glyphs from one node have ended up in different
+         textures then the line is just built again */
+      if (n_updated != line->glyphs->len)
+        cogl_pango_render_line_forget_display_list (line);
+    }
+
+  qdata->textures_moved = FALSE;
+}
+
+static void
+cogl_pango_render_line_build (CoglPangoRendererQdata *qdata,
+                              CoglPangoRendererLine *line)
+{
+  CoglPangoRenderer *priv = qdata->renderer;
+
+  line->display_list =
+    _cogl_pango_display_list_new (qdata->caches_used->pipeline_cache);
+  line->glyphs = g_ptr_array_new ();
+
+  priv->display_list = line->display_list;
+  priv->display_list_glyphs = line->glyphs;
+  pango_renderer_draw_layout_line (PANGO_RENDERER (priv),
+                                   line->pango_line,
+                                   line->subpixel_x,
+                                   line->subpixel_y);
+  priv->display_list = NULL;
+  priv->display_list_glyphs = NULL;
+}
+
 /**
  * cogl_pango_render_layout_subpixel:
  * @layout: a #PangoLayout
@@ -291,6 +794,10 @@ cogl_pango_render_layout_subpixel (PangoLayout     *layout,
   PangoContext           *context;
   CoglPangoRenderer      *priv;
   CoglPangoRendererQdata *qdata;
+  CoglPangoRendererCaches *caches;
+  const PangoMatrix      *matrix;
+  gboolean                layout_changed;
+  int                     i;
 
   context = pango_layout_get_context (layout);
   priv = cogl_pango_get_renderer_from_context (context);
@@ -311,44 +818,84 @@ cogl_pango_render_layout_subpixel (PangoLayout     *layout,
                                cogl_pango_render_qdata_destroy);
     }
 
+  caches = cogl_pango_renderer_get_caches (priv);
+
+  if (qdata->lines && qdata->caches_used != caches)
+    cogl_pango_render_qdata_forget_display_list (qdata);
+
   /* Check if the layout has changed since the last build of the
-     display list. This trick was suggested by Behdad Esfahbod here:
+     display lists. This trick was suggested by Behdad Esfahbod here:
      http://mail.gnome.org/archives/gtk-i18n-list/2009-May/msg00019.html */
-  if (qdata->display_list &&
-      ((qdata->first_line &&
-        qdata->first_line->layout != layout) ||
-       qdata->mipmapping_used != priv->use_mipmapping))
-    cogl_pango_render_qdata_forget_display_list (qdata);
+  layout_changed = (qdata->first_line == NULL ||
+                    qdata->first_line->layout != layout);
 
-  if (qdata->display_list == NULL)
+  if (qdata->lines == NULL)
     {
-      CoglPangoRendererCaches *caches = priv->use_mipmapping ?
-        &priv->mipmap_caches :
-        &priv->no_mipmap_caches;
-
-      cogl_pango_ensure_glyph_cache_for_layout (layout);
-
-      qdata->display_list =
-        _cogl_pango_display_list_new (caches->pipeline_cache);
+      qdata->lines = g_ptr_array_new ();
+      qdata->caches_used = caches;
+      qdata->textures_moved = FALSE;
 
       /* Register for notification of when the glyph cache changes so
-         we can rebuild the display list */
+         we can update the display lists */
       _cogl_pango_glyph_cache_add_reorganize_callback
+        (caches->glyph_cache,
+         (GHookFunc) cogl_pango_render_qdata_textures_moved,
+         qdata);
+      _cogl_pango_glyph_cache_add_clear_callback
         (caches->glyph_cache,
          (GHookFunc) cogl_pango_render_qdata_forget_display_list,
          qdata);
 
-      priv->display_list = qdata->display_list;
-      pango_renderer_draw_layout (PANGO_RENDERER (priv), layout, 0, 0);
-      priv->display_list = NULL;
-
-      qdata->mipmapping_used = priv->use_mipmapping;
+      layout_changed = TRUE;
     }
 
+  /* Only the lines that have actually changed will need new display
+     lists */
+  if (layout_changed)
+    cogl_pango_render_qdata_update_lines (qdata, layout);
+
+  if (qdata->textures_moved)
+    cogl_pango_render_qdata_update_textures (qdata);
+
+  matrix = pango_context_get_matrix (context);
+  pango_renderer_set_matrix (PANGO_RENDERER (priv), matrix);
+
   cogl_push_matrix ();
   cogl_translate (x / (gfloat) PANGO_SCALE, y / (gfloat) PANGO_SCALE, 0);
-  _cogl_pango_display_list_render (qdata->display_list,
-                                   color);
+
+  for (i = 0; i < qdata->lines->len; i++)
+    {
+      CoglPangoRendererLine *line = g_ptr_array_index (qdata->lines, i);
+      float line_x, line_y;
+
+      if (line->display_list == NULL)
+        cogl_pango_render_line_build (qdata, line);
+
+      /* The display list was built with the line at the origin so
+         it needs to be moved into position the same way that
+         cogl_pango_renderer_get_device_units would have done. Without
+         a matrix the rest of the position is a whole number of
+         pixels so each glyph ends up rounded to the same pixel as if
+         the whole layout was drawn at once */
+      if (matrix)
+        {
+          line_x = ((line->x * matrix->xx + line->y * matrix->xy)
+                    / PANGO_SCALE);
+          line_y = ((line->y * matrix->yy + line->x * matrix->yx)
+                    / PANGO_SCALE);
+        }
+      else
+        {
+          line_x = (line->x - line->subpixel_x) / PANGO_SCALE;
+          line_y = (line->y - line->subpixel_y) / PANGO_SCALE;
+        }
+
+      cogl_push_matrix ();
+      cogl_translate (line_x, line_y, 0);
+      _cogl_pango_display_list_render (line->display_list, color);
+      cogl_pop_matrix ();
+    }
+
   cogl_pop_matrix ();
 
   /* Keep a reference to the first line of the layout so we can detect
@@ -417,9 +964,7 @@ cogl_pango_render_layout_line (PangoLayoutLine *line,
   if (G_UNLIKELY (!priv))
     return;
 
-  caches = (priv->use_mipmapping ?
-            &priv->mipmap_caches :
-            &priv->no_mipmap_caches);
+  caches = cogl_pango_renderer_get_caches (priv);
 
   priv->display_list = _cogl_pango_display_list_new (caches->pipeline_cache);
 
@@ -439,6 +984,7 @@ _cogl_pango_renderer_clear_glyph_cache (CoglPangoRenderer *renderer)
 {
   cogl_pango_glyph_cache_clear (renderer->mipmap_caches.glyph_cache);
   cogl_pango_glyph_cache_clear (renderer->no_mipmap_caches.glyph_cache);
+  cogl_pango_glyph_cache_clear (renderer->sdf_caches.glyph_cache);
 }
 
 void
@@ -454,6 +1000,106 @@ _cogl_pango_renderer_get_use_mipmapping (CoglPangoRenderer *renderer)
   return renderer->use_mipmapping;
 }
 
+void
+_cogl_pango_renderer_set_use_sdf (CoglPangoRenderer *renderer,
+                                  gboolean value)
+{
+  /* Distance fields can only be rendered with a shader so without
+     GLSL we just keep using the normal glyphs */
+  if (value && !cogl_features_available (COGL_FEATURE_SHADERS_GLSL))
+    {
+      COGL_NOTE (PANGO, "Distance field glyphs are not supported "
+                 "without GLSL");
+      value = FALSE;
+    }
+
+  renderer->use_sdf = value;
+}
+
+gboolean
+_cogl_pango_renderer_get_use_sdf (CoglPangoRenderer *renderer)
+{
+  return renderer->use_sdf;
+}
+
+void
+_cogl_pango_renderer_set_glyph_cache_budget (CoglPangoRenderer *renderer,
+                                             gsize budget)
+{
+  _cogl_pango_glyph_cache_budget_set_limit (renderer->glyph_cache_budget,
+                                            budget);
+}
+
+gsize
+_cogl_pango_renderer_get_glyph_cache_budget (CoglPangoRenderer *renderer)
+{
+  return _cogl_pango_glyph_cache_budget_get_limit
+    (renderer->glyph_cache_budget);
+}
+
+gsize
+_cogl_pango_renderer_get_glyph_cache_usage (CoglPangoRenderer *renderer)
+{
+  return _cogl_pango_glyph_cache_budget_get_usage
+    (renderer->glyph_cache_budget);
+}
+
+/* Called before looking up the glyphs for a new piece of text so
+   that any glyphs that it uses will be protected from eviction */
+static void
+_cogl_pango_renderer_begin_glyph_lookup (CoglPangoRenderer *priv)
+{
+  CoglPangoRendererCaches *caches = cogl_pango_renderer_get_caches (priv);
+
+  _cogl_pango_glyph_cache_advance_age (caches->glyph_cache);
+}
+
+static void rasterize_chunk_cb (void *data, void *user_data);
+
+void
+_cogl_pango_renderer_set_rasterization_threads (CoglPangoRenderer *renderer,
+                                                int n_threads)
+{
+  if (n_threads < 1)
+    n_threads = 1;
+
+  /* The thread pool can only be used if the GLib thread system has
+     been initialised */
+  if (n_threads > 1 && !g_thread_supported ())
+    {
+      g_warning ("Glyphs can only be rasterized on multiple threads if "
+                 "g_thread_init has been called");
+      n_threads = 1;
+    }
+
+  renderer->n_rasterization_threads = n_threads;
+
+  if (n_threads == 1)
+    {
+      if (renderer->rasterization_pool)
+        {
+          g_thread_pool_free (renderer->rasterization_pool, FALSE, TRUE);
+          renderer->rasterization_pool = NULL;
+        }
+    }
+  else if (renderer->rasterization_pool)
+    g_thread_pool_set_max_threads (renderer->rasterization_pool,
+                                   n_threads,
+                                   NULL);
+  else
+    renderer->rasterization_pool = g_thread_pool_new (rasterize_chunk_cb,
+                                                      NULL,
+                                                      n_threads,
+                                                      FALSE,
+                                                      NULL);
+}
+
+int
+_cogl_pango_renderer_get_rasterization_threads (CoglPangoRenderer *renderer)
+{
+  return renderer->n_rasterization_threads;
+}
+
 static CoglPangoGlyphCacheValue *
 cogl_pango_renderer_get_cached_glyph (PangoRenderer *renderer,
                                       gboolean       create,
@@ -461,59 +1107,297 @@ cogl_pango_renderer_get_cached_glyph (PangoRenderer *renderer,
                                       PangoGlyph     glyph)
 {
   CoglPangoRenderer *priv = COGL_PANGO_RENDERER (renderer);
-  CoglPangoRendererCaches *caches = (priv->use_mipmapping ?
-                                     &priv->mipmap_caches :
-                                     &priv->no_mipmap_caches);
+  CoglPangoRendererCaches *caches = cogl_pango_renderer_get_caches (priv);
 
   return cogl_pango_glyph_cache_lookup (caches->glyph_cache,
                                         create, font, glyph);
 }
 
-static void
-cogl_pango_renderer_set_dirty_glyph (PangoFont *font,
-                                     PangoGlyph glyph,
-                                     CoglPangoGlyphCacheValue *value)
+/* Glyphs in the local glyph atlases are all drawn into a CPU copy of
+   the whole atlas texture using a single cairo context. Once all of
+   the dirty glyphs have been drawn the region containing them is
+   uploaded with one call to cogl_texture_set_region. Keeping a copy
+   of the whole atlas means that any clean glyphs within that region
+   are uploaded with their existing contents. The staging image is
+   attached to the atlas texture so it goes away when the atlas is
+   reorganized into a new texture */
+typedef struct
 {
+  CoglHandle texture;
   cairo_surface_t *surface;
+  /* Only valid while a batch of dirty glyphs is being drawn */
   cairo_t *cr;
+  gboolean dirty;
+  int dirty_x1, dirty_y1, dirty_x2, dirty_y2;
+} CoglPangoGlyphStaging;
+
+/* The maximum height of the surface that a worker thread rasterizes
+   a chunk of glyphs into. This is well below cairo's limit of 32767
+   pixels */
+#define MAX_RASTERIZE_CHUNK_HEIGHT 4096
+
+/* A glyph that will be rasterized on one of the worker threads */
+typedef struct
+{
+  PangoGlyph glyph;
   cairo_scaled_font_t *scaled_font;
-  cairo_glyph_t cairo_glyph;
-  cairo_format_t format_cairo;
-  CoglPixelFormat format_cogl;
+  CoglPangoGlyphCacheValue *value;
+  /* Position of the glyph within the chunk's surface */
+  int y;
+} CoglPangoRasterizeJob;
 
-  COGL_NOTE (PANGO, "redrawing glyph %i", glyph);
+typedef struct _CoglPangoRasterizeBatch CoglPangoRasterizeBatch;
 
-  /* Glyphs that don't take up any space will end up without a
-     texture. These should never become dirty so they shouldn't end up
-     here */
-  g_return_if_fail (value->texture != COGL_INVALID_HANDLE);
+/* A set of glyphs that are all rasterized by one worker into its own
+   surface. The glyphs are stacked vertically in the surface */
+typedef struct
+{
+  CoglPangoRasterizeBatch *batch;
+  cairo_format_t format;
+  CoglPangoRasterizeJob *jobs;
+  int n_jobs;
+  int width, height;
+  cairo_surface_t *surface;
+} CoglPangoRasterizeChunk;
 
-  if (cogl_texture_get_format (value->texture) == COGL_PIXEL_FORMAT_A_8)
+struct _CoglPangoRasterizeBatch
+{
+  GMutex *mutex;
+  GCond *cond;
+  int n_pending_chunks;
+};
+
+typedef struct
+{
+  /* List of CoglPangoGlyphStagings that have dirty regions */
+  GSList *dirty_stagings;
+
+  /* If the glyphs are going to be rasterized on worker threads then
+     these are arrays of CoglPangoRasterizeJobs for the glyphs in the
+     A8 atlases and for the glyphs with their own ARGB texture */
+  gboolean use_threads;
+  GArray *alpha_jobs;
+  GArray *color_jobs;
+
+  /* Whether the glyphs from the current cache are distance fields */
+  gboolean use_sdf;
+} CoglPangoSetDirtyGlyphsState;
+
+static CoglUserDataKey glyph_staging_key;
+
+static void
+glyph_staging_free (void *user_data)
+{
+  CoglPangoGlyphStaging *staging = user_data;
+
+  if (staging->cr)
+    cairo_destroy (staging->cr);
+  cairo_surface_destroy (staging->surface);
+
+  g_slice_free (CoglPangoGlyphStaging, staging);
+}
+
+static CoglPangoGlyphStaging *
+get_glyph_staging (CoglHandle texture)
+{
+  CoglPangoGlyphStaging *staging =
+    cogl_object_get_user_data (COGL_OBJECT (texture), &glyph_staging_key);
+
+  if (staging == NULL)
     {
-      format_cairo = CAIRO_FORMAT_A8;
-      format_cogl = COGL_PIXEL_FORMAT_A_8;
+      staging = g_slice_new (CoglPangoGlyphStaging);
+      staging->texture = texture;
+      staging->surface =
+        cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                    cogl_texture_get_width (texture),
+                                    cogl_texture_get_height (texture));
+      staging->cr = NULL;
+      staging->dirty = FALSE;
+
+      cogl_object_set_user_data (COGL_OBJECT (texture),
+                                 &glyph_staging_key,
+                                 staging,
+                                 glyph_staging_free);
     }
-  else
+
+  return staging;
+}
+
+static void
+add_staging_dirty_rect (CoglPangoSetDirtyGlyphsState *state,
+                        CoglPangoGlyphStaging *staging,
+                        CoglPangoGlyphCacheValue *value)
+{
+  if (!staging->dirty)
     {
-      format_cairo = CAIRO_FORMAT_ARGB32;
+      staging->dirty = TRUE;
+      staging->dirty_x1 = G_MAXINT;
+      staging->dirty_y1 = G_MAXINT;
+      staging->dirty_x2 = 0;
+      staging->dirty_y2 = 0;
+
+      state->dirty_stagings = g_slist_prepend (state->dirty_stagings,
+                                               staging);
+    }
+
+  staging->dirty_x1 = MIN (staging->dirty_x1, value->tx_pixel);
+  staging->dirty_y1 = MIN (staging->dirty_y1, value->ty_pixel);
+  staging->dirty_x2 = MAX (staging->dirty_x2,
+                           value->tx_pixel + value->draw_width);
+  staging->dirty_y2 = MAX (staging->dirty_y2,
+                           value->ty_pixel + value->draw_height);
+}
 
-      /* Cairo stores the data in native byte order as ARGB but Cogl's
-         pixel formats specify the actual byte order. Therefore we
-         need to use a different format depending on the
-         architecture */
+static void
+draw_glyph_to_staging (CoglPangoSetDirtyGlyphsState *state,
+                       cairo_scaled_font_t *scaled_font,
+                       PangoGlyph glyph,
+                       CoglPangoGlyphCacheValue *value)
+{
+  CoglPangoGlyphStaging *staging = get_glyph_staging (value->texture);
+  cairo_glyph_t cairo_glyph;
+  cairo_t *cr;
+
+  if (staging->cr == NULL)
+    {
+      staging->cr = cairo_create (staging->surface);
+      cairo_set_source_rgba (staging->cr, 1.0, 1.0, 1.0, 1.0);
+    }
+
+  cr = staging->cr;
+
+  cairo_save (cr);
+
+  cairo_rectangle (cr,
+                   value->tx_pixel, value->ty_pixel,
+                   value->draw_width, value->draw_height);
+  cairo_clip (cr);
+
+  /* Clear whatever was previously stored in this part of the atlas */
+  cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint (cr);
+  cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+  cairo_set_scaled_font (cr, scaled_font);
+
+  cairo_glyph.x = value->tx_pixel - value->draw_x;
+  cairo_glyph.y = value->ty_pixel - value->draw_y;
+  /* The PangoCairo glyph numbers directly map to Cairo glyph
+     numbers */
+  cairo_glyph.index = glyph;
+  cairo_show_glyphs (cr, &cairo_glyph, 1);
+
+  cairo_restore (cr);
+
+  add_staging_dirty_rect (state, staging, value);
+}
+
+/* Distance fields are generated directly into the staging image
+   instead of being drawn with cairo */
+static void
+draw_sdf_glyph_to_staging (CoglPangoSetDirtyGlyphsState *state,
+                           PangoFont *font,
+                           PangoGlyph glyph,
+                           CoglPangoGlyphCacheValue *value)
+{
+  CoglPangoGlyphStaging *staging = get_glyph_staging (value->texture);
+  PangoRectangle rect;
+  int stride;
+  guint8 *data;
+
+  /* Make sure anything drawn with cairo has landed in the image */
+  cairo_surface_flush (staging->surface);
+
+  stride = cairo_image_surface_get_stride (staging->surface);
+  data = (cairo_image_surface_get_data (staging->surface) +
+          value->ty_pixel * stride + value->tx_pixel);
+
+  rect.x = value->draw_x;
+  rect.y = value->draw_y;
+  rect.width = value->draw_width;
+  rect.height = value->draw_height;
+
+  _cogl_pango_sdf_render_glyph (font, glyph, &rect, data, stride);
+
+  cairo_surface_mark_dirty_rectangle (staging->surface,
+                                      value->tx_pixel,
+                                      value->ty_pixel,
+                                      value->draw_width,
+                                      value->draw_height);
+
+  add_staging_dirty_rect (state, staging, value);
+}
+
+static void
+upload_glyph_staging (CoglPangoGlyphStaging *staging)
+{
+  int stride;
+  guint8 *data;
+
+  if (staging->cr)
+    {
+      cairo_destroy (staging->cr);
+      staging->cr = NULL;
+    }
+
+  staging->dirty = FALSE;
+
+  cairo_surface_flush (staging->surface);
+
+  stride = cairo_image_surface_get_stride (staging->surface);
+  data = (cairo_image_surface_get_data (staging->surface) +
+          staging->dirty_y1 * stride + staging->dirty_x1);
+
+  COGL_NOTE (PANGO, "uploading %ix%i region of glyph atlas %p",
+             staging->dirty_x2 - staging->dirty_x1,
+             staging->dirty_y2 - staging->dirty_y1,
+             staging->texture);
+
+  cogl_texture_set_region (staging->texture,
+                           0, /* src_x */
+                           0, /* src_y */
+                           staging->dirty_x1, /* dst_x */
+                           staging->dirty_y1, /* dst_y */
+                           staging->dirty_x2 - staging->dirty_x1,
+                           staging->dirty_y2 - staging->dirty_y1,
+                           staging->dirty_x2 - staging->dirty_x1,
+                           staging->dirty_y2 - staging->dirty_y1,
+                           COGL_PIXEL_FORMAT_A_8,
+                           stride,
+                           data);
+}
+
+static CoglPixelFormat
+get_cogl_format_for_argb32 (void)
+{
+  /* Cairo stores the data in native byte order as ARGB but Cogl's
+     pixel formats specify the actual byte order. Therefore we
+     need to use a different format depending on the
+     architecture */
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-      format_cogl = COGL_PIXEL_FORMAT_BGRA_8888_PRE;
+  return COGL_PIXEL_FORMAT_BGRA_8888_PRE;
 #else
-      format_cogl = COGL_PIXEL_FORMAT_ARGB_8888_PRE;
+  return COGL_PIXEL_FORMAT_ARGB_8888_PRE;
 #endif
-    }
+}
+
+/* Glyphs that are stored in the global atlas each have their own
+   texture so there is nothing to batch and they are drawn and
+   uploaded individually */
+static void
+draw_glyph_to_texture (cairo_scaled_font_t *scaled_font,
+                       PangoGlyph glyph,
+                       CoglPangoGlyphCacheValue *value)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  cairo_glyph_t cairo_glyph;
 
-  surface = cairo_image_surface_create (format_cairo,
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
                                         value->draw_width,
                                         value->draw_height);
   cr = cairo_create (surface);
 
-  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
   cairo_set_scaled_font (cr, scaled_font);
 
   cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
@@ -538,13 +1422,321 @@ cogl_pango_renderer_set_dirty_glyph (PangoFont *font,
                            value->draw_height, /* dst_height */
                            value->draw_width, /* width */
                            value->draw_height, /* height */
-                           format_cogl,
+                           get_cogl_format_for_argb32 (),
                            cairo_image_surface_get_stride (surface),
                            cairo_image_surface_get_data (surface));
 
   cairo_surface_destroy (surface);
 }
 
+static void
+add_rasterize_job (CoglPangoSetDirtyGlyphsState *state,
+                   PangoFont *font,
+                   PangoGlyph glyph,
+                   CoglPangoGlyphCacheValue *value)
+{
+  CoglPangoRasterizeJob job;
+  cairo_scaled_font_t *scaled_font;
+
+  /* Pango isn't thread-safe so the scaled font needs to be looked up
+     here. Cairo scaled fonts themselves can be used from multiple
+     threads */
+  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+
+  job.glyph = glyph;
+  job.scaled_font = cairo_scaled_font_reference (scaled_font);
+  job.value = value;
+  job.y = 0;
+
+  if (cogl_texture_get_format (value->texture) == COGL_PIXEL_FORMAT_A_8)
+    g_array_append_val (state->alpha_jobs, job);
+  else
+    g_array_append_val (state->color_jobs, job);
+}
+
+static void
+cogl_pango_renderer_set_dirty_glyph (PangoFont *font,
+                                     PangoGlyph glyph,
+                                     CoglPangoGlyphCacheValue *value,
+                                     void *user_data)
+{
+  CoglPangoSetDirtyGlyphsState *state = user_data;
+  cairo_scaled_font_t *scaled_font;
+
+  COGL_NOTE (PANGO, "redrawing glyph %i", glyph);
+
+  /* Glyphs that don't take up any space will end up without a
+     texture. These should never become dirty so they shouldn't end up
+     here */
+  g_return_if_fail (value->texture != COGL_INVALID_HANDLE);
+
+  /* Generating the distance field isn't done on the worker threads
+     because it needs Pango to find the reference font */
+  if (state->use_sdf)
+    {
+      draw_sdf_glyph_to_staging (state, font, glyph, value);
+      return;
+    }
+
+  if (state->use_threads)
+    {
+      add_rasterize_job (state, font, glyph, value);
+      return;
+    }
+
+  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+
+  if (cogl_texture_get_format (value->texture) == COGL_PIXEL_FORMAT_A_8)
+    draw_glyph_to_staging (state, scaled_font, glyph, value);
+  else
+    draw_glyph_to_texture (scaled_font, glyph, value);
+}
+
+/* This is run on one of the worker threads. It must not call into
+   Pango or Cogl */
+static void
+rasterize_chunk_cb (void *data, void *user_data)
+{
+  CoglPangoRasterizeChunk *chunk = data;
+  CoglPangoRasterizeBatch *batch = chunk->batch;
+  cairo_t *cr;
+  int i;
+
+  chunk->surface = cairo_image_surface_create (chunk->format,
+                                               chunk->width,
+                                               chunk->height);
+
+  /* If the surface couldn't be created then the glyphs will be
+     drawn on the main thread instead (see store_rasterize_chunk) */
+  if (cairo_surface_status (chunk->surface) != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_surface_destroy (chunk->surface);
+      chunk->surface = NULL;
+      goto done;
+    }
+
+  cr = cairo_create (chunk->surface);
+  cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
+
+  for (i = 0; i < chunk->n_jobs; i++)
+    {
+      CoglPangoRasterizeJob *job = chunk->jobs + i;
+      CoglPangoGlyphCacheValue *value = job->value;
+      cairo_glyph_t cairo_glyph;
+
+      cairo_save (cr);
+
+      cairo_rectangle (cr, 0, job->y, value->draw_width, value->draw_height);
+      cairo_clip (cr);
+
+      cairo_set_scaled_font (cr, job->scaled_font);
+
+      cairo_glyph.x = -value->draw_x;
+      cairo_glyph.y = job->y - value->draw_y;
+      cairo_glyph.index = job->glyph;
+      cairo_show_glyphs (cr, &cairo_glyph, 1);
+
+      cairo_restore (cr);
+    }
+
+  cairo_destroy (cr);
+  cairo_surface_flush (chunk->surface);
+
+ done:
+  g_mutex_lock (batch->mutex);
+  if (--batch->n_pending_chunks == 0)
+    g_cond_signal (batch->cond);
+  g_mutex_unlock (batch->mutex);
+}
+
+/* Splits the jobs into contiguous chunks and works out where each
+   glyph will go in its chunk's surface. The jobs are shared evenly
+   between n_chunks chunks but a chunk is also ended early if its
+   surface would get taller than MAX_RASTERIZE_CHUNK_HEIGHT so that
+   large batches of big glyphs don't go over cairo's size limit */
+static void
+add_rasterize_chunks (GPtrArray *chunks,
+                      CoglPangoRasterizeBatch *batch,
+                      cairo_format_t format,
+                      GArray *jobs,
+                      int n_chunks)
+{
+  int jobs_per_chunk = (jobs->len + n_chunks - 1) / n_chunks;
+  CoglPangoRasterizeChunk *chunk = NULL;
+  int i;
+
+  for (i = 0; i < jobs->len; i++)
+    {
+      CoglPangoRasterizeJob *job =
+        &g_array_index (jobs, CoglPangoRasterizeJob, i);
+
+      if (chunk == NULL ||
+          chunk->n_jobs >= jobs_per_chunk ||
+          chunk->height + job->value->draw_height > MAX_RASTERIZE_CHUNK_HEIGHT)
+        {
+          chunk = g_slice_new (CoglPangoRasterizeChunk);
+
+          chunk->batch = batch;
+          chunk->format = format;
+          chunk->jobs = job;
+          chunk->n_jobs = 0;
+          chunk->width = 1;
+          chunk->height = 0;
+          chunk->surface = NULL;
+
+          g_ptr_array_add (chunks, chunk);
+        }
+
+      job->y = chunk->height;
+      chunk->height += job->value->draw_height;
+      chunk->width = MAX (chunk->width, job->value->draw_width);
+      chunk->n_jobs++;
+    }
+}
+
+/* Copies the rasterized glyphs out of a chunk. This is run on the
+   main thread once all of the chunks are finished */
+static void
+store_rasterize_chunk (CoglPangoSetDirtyGlyphsState *state,
+                       CoglPangoRasterizeChunk *chunk)
+{
+  int chunk_stride;
+  guint8 *chunk_data;
+  int i;
+
+  /* If the worker couldn't create the surface then fall back to
+     drawing the glyphs one at a time */
+  if (chunk->surface == NULL)
+    {
+      for (i = 0; i < chunk->n_jobs; i++)
+        {
+          CoglPangoRasterizeJob *job = chunk->jobs + i;
+
+          if (chunk->format == CAIRO_FORMAT_A8)
+            draw_glyph_to_staging (state, job->scaled_font,
+                                   job->glyph, job->value);
+          else
+            draw_glyph_to_texture (job->scaled_font, job->glyph, job->value);
+        }
+
+      return;
+    }
+
+  chunk_stride = cairo_image_surface_get_stride (chunk->surface);
+  chunk_data = cairo_image_surface_get_data (chunk->surface);
+
+  for (i = 0; i < chunk->n_jobs; i++)
+    {
+      CoglPangoRasterizeJob *job = chunk->jobs + i;
+      CoglPangoGlyphCacheValue *value = job->value;
+
+      if (chunk->format == CAIRO_FORMAT_A8)
+        {
+          CoglPangoGlyphStaging *staging =
+            get_glyph_staging (value->texture);
+          int staging_stride =
+            cairo_image_surface_get_stride (staging->surface);
+          guint8 *staging_data;
+          int y;
+
+          cairo_surface_flush (staging->surface);
+          staging_data = cairo_image_surface_get_data (staging->surface);
+
+          for (y = 0; y < value->draw_height; y++)
+            memcpy (staging_data +
+                    (value->ty_pixel + y) * staging_stride +
+                    value->tx_pixel,
+                    chunk_data + (job->y + y) * chunk_stride,
+                    value->draw_width);
+
+          cairo_surface_mark_dirty_rectangle (staging->surface,
+                                              value->tx_pixel,
+                                              value->ty_pixel,
+                                              value->draw_width,
+                                              value->draw_height);
+
+          add_staging_dirty_rect (state, staging, value);
+        }
+      else
+        cogl_texture_set_region (value->texture,
+                                 0, /* src_x */
+                                 0, /* src_y */
+                                 value->tx_pixel, /* dst_x */
+                                 value->ty_pixel, /* dst_y */
+                                 value->draw_width, /* dst_width */
+                                 value->draw_height, /* dst_height */
+                                 value->draw_width, /* width */
+                                 value->draw_height, /* height */
+                                 get_cogl_format_for_argb32 (),
+                                 chunk_stride,
+                                 chunk_data + job->y * chunk_stride);
+    }
+}
+
+static void
+rasterize_jobs_on_threads (CoglPangoRenderer *priv,
+                           CoglPangoSetDirtyGlyphsState *state)
+{
+  CoglPangoRasterizeBatch batch;
+  GPtrArray *chunks;
+  int i;
+
+  chunks = g_ptr_array_new ();
+
+  batch.mutex = g_mutex_new ();
+  batch.cond = g_cond_new ();
+
+  if (state->alpha_jobs->len > 0)
+    add_rasterize_chunks (chunks, &batch, CAIRO_FORMAT_A8,
+                          state->alpha_jobs,
+                          priv->n_rasterization_threads);
+  if (state->color_jobs->len > 0)
+    add_rasterize_chunks (chunks, &batch, CAIRO_FORMAT_ARGB32,
+                          state->color_jobs,
+                          priv->n_rasterization_threads);
+
+  batch.n_pending_chunks = chunks->len;
+
+  for (i = 0; i < chunks->len; i++)
+    g_thread_pool_push (priv->rasterization_pool,
+                        g_ptr_array_index (chunks, i),
+                        NULL);
+
+  g_mutex_lock (batch.mutex);
+  while (batch.n_pending_chunks > 0)
+    g_cond_wait (batch.cond, batch.mutex);
+  g_mutex_unlock (batch.mutex);
+
+  for (i = 0; i < chunks->len; i++)
+    {
+      CoglPangoRasterizeChunk *chunk = g_ptr_array_index (chunks, i);
+
+      store_rasterize_chunk (state, chunk);
+
+      if (chunk->surface)
+        cairo_surface_destroy (chunk->surface);
+      g_slice_free (CoglPangoRasterizeChunk, chunk);
+    }
+
+  g_ptr_array_free (chunks, TRUE);
+
+  g_mutex_free (batch.mutex);
+  g_cond_free (batch.cond);
+}
+
+static void
+free_rasterize_jobs (GArray *jobs)
+{
+  int i;
+
+  for (i = 0; i < jobs->len; i++)
+    cairo_scaled_font_destroy (g_array_index (jobs,
+                                              CoglPangoRasterizeJob,
+                                              i).scaled_font);
+
+  g_array_free (jobs, TRUE);
+}
+
 static void
 _cogl_pango_ensure_glyph_cache_for_layout_line_internal (PangoLayoutLine *line)
 {
@@ -582,10 +1774,47 @@ _cogl_pango_ensure_glyph_cache_for_layout_line_internal (PangoLayoutLine *line)
 static void
 _cogl_pango_set_dirty_glyphs (CoglPangoRenderer *priv)
 {
+  CoglPangoSetDirtyGlyphsState state;
+
+  state.dirty_stagings = NULL;
+  state.use_threads = priv->rasterization_pool != NULL;
+
+  if (state.use_threads)
+    {
+      state.alpha_jobs = g_array_new (FALSE, FALSE,
+                                      sizeof (CoglPangoRasterizeJob));
+      state.color_jobs = g_array_new (FALSE, FALSE,
+                                      sizeof (CoglPangoRasterizeJob));
+    }
+
+  state.use_sdf = FALSE;
+  _cogl_pango_glyph_cache_set_dirty_glyphs
+    (priv->mipmap_caches.glyph_cache,
+     cogl_pango_renderer_set_dirty_glyph,
+     &state);
   _cogl_pango_glyph_cache_set_dirty_glyphs
-    (priv->mipmap_caches.glyph_cache, cogl_pango_renderer_set_dirty_glyph);
+    (priv->no_mipmap_caches.glyph_cache,
+     cogl_pango_renderer_set_dirty_glyph,
+     &state);
+  state.use_sdf = TRUE;
   _cogl_pango_glyph_cache_set_dirty_glyphs
-    (priv->no_mipmap_caches.glyph_cache, cogl_pango_renderer_set_dirty_glyph);
+    (priv->sdf_caches.glyph_cache,
+     cogl_pango_renderer_set_dirty_glyph,
+     &state);
+
+  if (state.use_threads)
+    {
+      if (state.alpha_jobs->len + state.color_jobs->len > 0)
+        rasterize_jobs_on_threads (priv, &state);
+
+      free_rasterize_jobs (state.alpha_jobs);
+      free_rasterize_jobs (state.color_jobs);
+    }
+
+  /* Now that all of the glyphs have been drawn we can upload a
+     single region for each atlas */
+  g_slist_foreach (state.dirty_stagings, (GFunc) upload_glyph_staging, NULL);
+  g_slist_free (state.dirty_stagings);
 }
 
 static void
@@ -597,6 +1826,8 @@ _cogl_pango_ensure_glyph_cache_for_layout_line (PangoLayoutLine *line)
   context = pango_layout_get_context (line->layout);
   priv = cogl_pango_get_renderer_from_context (context);
 
+  _cogl_pango_renderer_begin_glyph_lookup (priv);
+
   _cogl_pango_ensure_glyph_cache_for_layout_line_internal (line);
 
   /* Now that we know all of the positions are settled we'll fill in
@@ -619,6 +1850,8 @@ cogl_pango_ensure_glyph_cache_for_layout (PangoLayout *layout)
   if ((iter = pango_layout_get_iter (layout)) == NULL)
     return;
 
+  _cogl_pango_renderer_begin_glyph_lookup (priv);
+
   do
     {
       PangoLayoutLine *line;
@@ -771,11 +2004,17 @@ cogl_pango_renderer_draw_glyphs (PangoRenderer    *renderer,
 {
   CoglPangoRenderer *priv = (CoglPangoRenderer *) renderer;
   CoglPangoGlyphCacheValue *cache_value;
+  float scale = 1.0f;
   int i;
 
   cogl_pango_renderer_set_color_for_part (renderer,
 					  PANGO_RENDER_PART_FOREGROUND);
 
+  /* Distance fields are stored at a reference size so they need to be
+     scaled to the size of the font */
+  if (font && cogl_pango_renderer_get_caches (priv) == &priv->sdf_caches)
+    scale = _cogl_pango_sdf_get_scale (font);
+
   for (i = 0; i < glyphs->num_glyphs; i++)
     {
       PangoGlyphInfo *gi = glyphs->glyphs + i;
@@ -834,10 +2073,10 @@ cogl_pango_renderer_draw_glyphs (PangoRenderer    *renderer,
             }
 	  else if (cache_value->texture)
 	    {
-	      x += (float)(cache_value->draw_x);
-	      y += (float)(cache_value->draw_y);
+	      x += (float)(cache_value->draw_x) * scale;
+	      y += (float)(cache_value->draw_y) * scale;
 
-              cogl_pango_renderer_draw_glyph (priv, cache_value, x, y);
+              cogl_pango_renderer_draw_glyph (priv, cache_value, x, y, scale);
 	    }
 	}
 
@@ -0,0 +1,338 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+#include <pango/pangocairo.h>
+
+#include "cogl-pango-sdf.h"
+
+/* Used as 'infinity' in the distance transform. It needs to be finite
+   so that subtracting two of them doesn't give a NaN */
+#define COGL_PANGO_SDF_FAR 1e20f
+
+const char
+_cogl_pango_sdf_fragment_source[] =
+  /* The pipeline cache points this at the first texture unit (see
+     _cogl_pango_sdf_set_program_uniforms) */
+  "uniform sampler2D cogl_pango_sdf_texture;\n"
+  "\n"
+  "void\n"
+  "main ()\n"
+  "{\n"
+  "  float dist = texture2D (cogl_pango_sdf_texture,\n"
+  "                          cogl_tex_coord_in[0].st).a;\n"
+  /* Without derivatives we can't tell how big a pixel is so we just
+     use a fixed amount of smoothing which works for medium sizes */
+  "#if defined (GL_ES) && !defined (GL_OES_standard_derivatives)\n"
+  "  float width = 0.08;\n"
+  "#else\n"
+  "  float width = fwidth (dist) * 0.7;\n"
+  "#endif\n"
+  "  cogl_color_out = cogl_color_in *\n"
+  "    smoothstep (0.5 - width, 0.5 + width, dist);\n"
+  "}\n";
+
+void
+_cogl_pango_sdf_set_program_uniforms (CoglHandle program)
+{
+  int location = cogl_program_get_uniform_location (program,
+                                                    "cogl_pango_sdf_texture");
+
+  /* Layers are always bound to the texture unit with the same index
+     as the layer when the pipeline has a user program */
+  cogl_program_set_uniform_1i (program, location, 0);
+}
+
+static GQuark
+cogl_pango_sdf_get_reference_font_key (void)
+{
+  static GQuark key = 0;
+
+  if (G_UNLIKELY (key == 0))
+    key = g_quark_from_static_string ("CoglPangoSdfReferenceFont");
+
+  return key;
+}
+
+cairo_scaled_font_t *
+_cogl_pango_sdf_get_reference_font (PangoFont *font)
+{
+  cairo_scaled_font_t *reference_font;
+
+  reference_font =
+    g_object_get_qdata (G_OBJECT (font),
+                        cogl_pango_sdf_get_reference_font_key ());
+
+  if (reference_font == NULL)
+    {
+      cairo_scaled_font_t *scaled_font;
+      cairo_font_options_t *options;
+      cairo_matrix_t font_matrix, ctm;
+      double scale;
+
+      scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+
+      /* Keep the shape of the font matrix so that things like
+         synthetic italics still work */
+      cairo_scaled_font_get_font_matrix (scaled_font, &font_matrix);
+      scale = COGL_PANGO_SDF_REFERENCE_SIZE / font_matrix.yy;
+      cairo_matrix_scale (&font_matrix, scale, scale);
+
+      cairo_matrix_init_identity (&ctm);
+
+      /* Hinting fits the outlines to the pixel grid at one particular
+         size so it would look wrong once the glyphs are scaled */
+      options = cairo_font_options_create ();
+      cairo_scaled_font_get_font_options (scaled_font, options);
+      cairo_font_options_set_hint_style (options, CAIRO_HINT_STYLE_NONE);
+      cairo_font_options_set_hint_metrics (options, CAIRO_HINT_METRICS_OFF);
+      cairo_font_options_set_antialias (options, CAIRO_ANTIALIAS_GRAY);
+
+      reference_font =
+        cairo_scaled_font_create (cairo_scaled_font_get_font_face (scaled_font),
+                                  &font_matrix,
+                                  &ctm,
+                                  options);
+
+      cairo_font_options_destroy (options);
+
+      g_object_set_qdata_full (G_OBJECT (font),
+                               cogl_pango_sdf_get_reference_font_key (),
+                               reference_font,
+                               (GDestroyNotify) cairo_scaled_font_destroy);
+    }
+
+  return reference_font;
+}
+
+float
+_cogl_pango_sdf_get_scale (PangoFont *font)
+{
+  cairo_scaled_font_t *scaled_font;
+  cairo_matrix_t font_matrix;
+
+  scaled_font = pango_cairo_font_get_scaled_font (PANGO_CAIRO_FONT (font));
+  cairo_scaled_font_get_font_matrix (scaled_font, &font_matrix);
+
+  return font_matrix.yy / COGL_PANGO_SDF_REFERENCE_SIZE;
+}
+
+void
+_cogl_pango_sdf_get_glyph_extents (PangoFont *font,
+                                   PangoGlyph glyph,
+                                   PangoRectangle *rect)
+{
+  cairo_scaled_font_t *reference_font;
+  cairo_text_extents_t extents;
+  cairo_glyph_t cairo_glyph;
+  int x1, y1, x2, y2;
+
+  reference_font = _cogl_pango_sdf_get_reference_font (font);
+
+  cairo_glyph.index = glyph;
+  cairo_glyph.x = 0;
+  cairo_glyph.y = 0;
+  cairo_scaled_font_glyph_extents (reference_font, &cairo_glyph, 1, &extents);
+
+  if (extents.width <= 0 || extents.height <= 0)
+    {
+      rect->x = rect->y = rect->width = rect->height = 0;
+      return;
+    }
+
+  x1 = floor (extents.x_bearing) - COGL_PANGO_SDF_SPREAD;
+  y1 = floor (extents.y_bearing) - COGL_PANGO_SDF_SPREAD;
+  x2 = (ceil (extents.x_bearing + extents.width) +
+        COGL_PANGO_SDF_SPREAD);
+  y2 = (ceil (extents.y_bearing + extents.height) +
+        COGL_PANGO_SDF_SPREAD);
+
+  rect->x = x1;
+  rect->y = y1;
+  rect->width = x2 - x1;
+  rect->height = y2 - y1;
+}
+
+/* One dimensional squared Euclidean distance transform from
+   Felzenszwalb and Huttenlocher, "Distance Transforms of Sampled
+   Functions". v and z are scratch buffers of n and n + 1 elements */
+static void
+cogl_pango_sdf_transform_1d (const float *f,
+                             float *d,
+                             int n,
+                             int *v,
+                             float *z)
+{
+  int k = 0;
+  int q;
+
+  v[0] = 0;
+  z[0] = -COGL_PANGO_SDF_FAR;
+  z[1] = COGL_PANGO_SDF_FAR;
+
+  for (q = 1; q < n; q++)
+    {
+      float s;
+
+      /* Pop the parabolas that are completely below the new one. The
+         first one never gets popped because z[0] is -infinity */
+      while (TRUE)
+        {
+          int p = v[k];
+
+          s = ((f[q] + q * q) - (f[p] + p * p)) / (2 * q - 2 * p);
+
+          if (s > z[k])
+            break;
+
+          k--;
+        }
+
+      k++;
+      v[k] = q;
+      z[k] = s;
+      z[k + 1] = COGL_PANGO_SDF_FAR;
+    }
+
+  k = 0;
+  for (q = 0; q < n; q++)
+    {
+      while (z[k + 1] < q)
+        k++;
+
+      d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+/* Replaces each value in the grid with the squared distance to the
+   nearest zero value */
+static void
+cogl_pango_sdf_transform_2d (float *grid,
+                             int width,
+                             int height)
+{
+  int max_size = MAX (width, height);
+  float *f = g_alloca (sizeof (float) * max_size);
+  float *d = g_alloca (sizeof (float) * max_size);
+  float *z = g_alloca (sizeof (float) * (max_size + 1));
+  int *v = g_alloca (sizeof (int) * max_size);
+  int x, y;
+
+  for (x = 0; x < width; x++)
+    {
+      for (y = 0; y < height; y++)
+        f[y] = grid[y * width + x];
+      cogl_pango_sdf_transform_1d (f, d, height, v, z);
+      for (y = 0; y < height; y++)
+        grid[y * width + x] = d[y];
+    }
+
+  for (y = 0; y < height; y++)
+    {
+      cogl_pango_sdf_transform_1d (grid + y * width, d, width, v, z);
+      memcpy (grid + y * width, d, sizeof (float) * width);
+    }
+}
+
+void
+_cogl_pango_sdf_render_glyph (PangoFont *font,
+                              PangoGlyph glyph,
+                              const PangoRectangle *rect,
+                              guint8 *data,
+                              int rowstride)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  cairo_glyph_t cairo_glyph;
+  guint8 *coverage;
+  int coverage_stride;
+  float *outside, *inside;
+  int x, y;
+
+  /* Rasterize the glyph normally at the reference size */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                        rect->width, rect->height);
+  cr = cairo_create (surface);
+  cairo_set_scaled_font (cr, _cogl_pango_sdf_get_reference_font (font));
+  cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
+  cairo_glyph.index = glyph;
+  cairo_glyph.x = -rect->x;
+  cairo_glyph.y = -rect->y;
+  cairo_show_glyphs (cr, &cairo_glyph, 1);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  coverage = cairo_image_surface_get_data (surface);
+  coverage_stride = cairo_image_surface_get_stride (surface);
+
+  /* 'outside' gets the distance from each pixel to the nearest pixel
+     inside the glyph and 'inside' the distance to the nearest pixel
+     outside of it */
+  outside = g_new (float, rect->width * rect->height);
+  inside = g_new (float, rect->width * rect->height);
+
+  for (y = 0; y < rect->height; y++)
+    for (x = 0; x < rect->width; x++)
+      {
+        gboolean is_inside = coverage[y * coverage_stride + x] >= 128;
+
+        outside[y * rect->width + x] = is_inside ? 0.0f : COGL_PANGO_SDF_FAR;
+        inside[y * rect->width + x] = is_inside ? COGL_PANGO_SDF_FAR : 0.0f;
+      }
+
+  cogl_pango_sdf_transform_2d (outside, rect->width, rect->height);
+  cogl_pango_sdf_transform_2d (inside, rect->width, rect->height);
+
+  for (y = 0; y < rect->height; y++)
+    for (x = 0; x < rect->width; x++)
+      {
+        int i = y * rect->width + x;
+        float alpha = coverage[y * coverage_stride + x] / 255.0f;
+        float distance;
+        int value;
+
+        /* The distances are measured between pixel centres but the
+           edge is roughly half way between the two pixels */
+        if (outside[i] > 0.0f)
+          distance = 0.5f - sqrtf (outside[i]);
+        else
+          distance = sqrtf (inside[i]) - 0.5f;
+
+        /* Pixels on the edge know more precisely where the edge is
+           from their anti-aliased coverage */
+        if (alpha > 0.0f && alpha < 1.0f && fabsf (distance) <= 0.5f)
+          distance = alpha - 0.5f;
+
+        value = 128 + distance * 127 / COGL_PANGO_SDF_SPREAD;
+        data[y * rowstride + x] = CLAMP (value, 0, 255);
+      }
+
+  g_free (outside);
+  g_free (inside);
+  cairo_surface_destroy (surface);
+}
@@ -0,0 +1,81 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __COGL_PANGO_SDF_H__
+#define __COGL_PANGO_SDF_H__
+
+#include <glib.h>
+#include <pango/pango-font.h>
+#include <cairo.h>
+#include <cogl/cogl.h>
+
+G_BEGIN_DECLS
+
+/* When signed distance fields are used each glyph is rasterized once
+   at this size in pixels regardless of the size of the font it is
+   drawn with */
+#define COGL_PANGO_SDF_REFERENCE_SIZE 48
+
+/* The number of pixels at the reference size that the distance field
+   extends on either side of the glyph outline */
+#define COGL_PANGO_SDF_SPREAD         6
+
+/* Returns the font's scaled font at the reference size without any
+   hinting. Fonts that only differ by size share the same reference
+   font because Cairo caches the scaled fonts. The font keeps a
+   reference to it */
+cairo_scaled_font_t *
+_cogl_pango_sdf_get_reference_font (PangoFont *font);
+
+/* Returns the factor to scale the reference sized glyphs by to draw
+   them with the given font */
+float
+_cogl_pango_sdf_get_scale (PangoFont *font);
+
+/* Gets the size of the distance field for a glyph in pixels at the
+   reference size. This includes the spread around the outline */
+void
+_cogl_pango_sdf_get_glyph_extents (PangoFont *font,
+                                   PangoGlyph glyph,
+                                   PangoRectangle *rect);
+
+/* Generates the distance field for a glyph into the given 8-bit
+   buffer. The rectangle should be the one returned by
+   _cogl_pango_sdf_get_glyph_extents */
+void
+_cogl_pango_sdf_render_glyph (PangoFont *font,
+                              PangoGlyph glyph,
+                              const PangoRectangle *rect,
+                              guint8 *data,
+                              int rowstride);
+
+/* Source for a GLSL fragment shader that renders a glyph from a
+   distance field in the first layer */
+extern const char _cogl_pango_sdf_fragment_source[];
+
+/* Sets the uniforms needed by a program containing the shader above */
+void
+_cogl_pango_sdf_set_program_uniforms (CoglHandle program);
+
+G_END_DECLS
+
+#endif /* __COGL_PANGO_SDF_H__ */
@@ -50,6 +50,21 @@ void           cogl_pango_ensure_glyph_cache_for_layout (PangoLayout      *layou
 void           cogl_pango_font_map_set_use_mipmapping   (CoglPangoFontMap *fm,
                                                          gboolean          value);
 gboolean       cogl_pango_font_map_get_use_mipmapping   (CoglPangoFontMap *fm);
+void           cogl_pango_font_map_set_use_sdf          (CoglPangoFontMap *fm,
+                                                         gboolean          value);
+gboolean       cogl_pango_font_map_get_use_sdf          (CoglPangoFontMap *fm);
+void           cogl_pango_font_map_set_rasterization_threads
+                                                        (CoglPangoFontMap *fm,
+                                                         int               n_threads);
+int            cogl_pango_font_map_get_rasterization_threads
+                                                        (CoglPangoFontMap *fm);
+void           cogl_pango_font_map_set_glyph_cache_budget
+                                                        (CoglPangoFontMap *fm,
+                                                         gsize             budget);
+gsize          cogl_pango_font_map_get_glyph_cache_budget
+                                                        (CoglPangoFontMap *fm);
+gsize          cogl_pango_font_map_get_glyph_cache_usage
+                                                        (CoglPangoFontMap *fm);
 PangoRenderer *cogl_pango_font_map_get_renderer         (CoglPangoFontMap *fm);
 
 #define COGL_PANGO_TYPE_RENDERER                (cogl_pango_renderer_get_type ())
@@ -69,6 +69,15 @@ _cogl_atlas_texture_new_with_size (unsigned int     width,
                                    CoglTextureFlags flags,
                                    CoglPixelFormat  internal_format);
 
+/* Does some of the work to defragment the atlases, copying at most
+   about max_bytes of texture data. In multi-page mode this empties the
+   least used pages by moving their textures into the other pages,
+   otherwise a fragmented atlas is compacted incrementally. This is
+   intended to be called when the application is idle. Returns TRUE
+   if there is more work left to do */
+gboolean
+_cogl_atlas_texture_compact (unsigned int max_bytes);
+
 void
 _cogl_atlas_texture_add_reorganize_callback (GHookFunc callback,
                                              void *user_data);
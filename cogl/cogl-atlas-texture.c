@@ -43,8 +43,10 @@
 #include "cogl-journal-private.h"
 #include "cogl-pipeline-opengl-private.h"
 #include "cogl-atlas.h"
+#include "cogl-blit.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 static void _cogl_atlas_texture_free (CoglAtlasTexture *sub_tex);
 
@@ -187,6 +189,34 @@ _cogl_atlas_texture_atlas_destroyed_cb (void *user_data)
   ctx->atlases = g_slist_remove (ctx->atlases, user_data);
 }
 
+static gboolean
+_cogl_atlas_texture_use_pages (void)
+{
+  static int use_pages = -1;
+
+  if (use_pages == -1)
+    {
+      const char *mode_string;
+
+      /* By default the atlas is grown and reorganized whenever a
+         texture doesn't fit. With the 'pages' mode each atlas has a
+         fixed size and a new one is started instead so that existing
+         textures never have to be copied */
+      if ((mode_string = g_getenv ("COGL_ATLAS_MODE")) == NULL ||
+          !strcmp (mode_string, "resize"))
+        use_pages = FALSE;
+      else if (!strcmp (mode_string, "pages"))
+        use_pages = TRUE;
+      else
+        {
+          g_warning ("Unknown atlas mode %s", mode_string);
+          use_pages = FALSE;
+        }
+    }
+
+  return use_pages;
+}
+
 static CoglAtlas *
 _cogl_atlas_texture_create_atlas (void)
 {
@@ -197,7 +227,8 @@ _cogl_atlas_texture_create_atlas (void)
   _COGL_GET_CONTEXT (ctx, COGL_INVALID_HANDLE);
 
   atlas = _cogl_atlas_new (COGL_PIXEL_FORMAT_RGBA_8888,
-                           0,
+                           _cogl_atlas_texture_use_pages () ?
+                           COGL_ATLAS_FIXED_SIZE : 0,
                            _cogl_atlas_texture_update_position_cb);
 
   _cogl_atlas_add_reorganize_callback (atlas,
@@ -562,6 +593,11 @@ _cogl_atlas_texture_set_region (CoglTexture    *tex,
                                                         dst_width, dst_height,
                                                         bmp);
 
+      /* If the atlas is being compacted then the rectangle needs to be
+         copied again */
+      _cogl_atlas_invalidate_rectangle (atlas_tex->atlas,
+                                        &atlas_tex->rectangle);
+
       cogl_object_unref (bmp);
 
       return ret;
@@ -774,6 +810,224 @@ _cogl_atlas_texture_new_from_bitmap (CoglBitmap      *bmp,
   return atlas_tex_handle;
 }
 
+static gboolean
+_cogl_atlas_texture_move_to_atlas (CoglAtlasTexture *atlas_tex,
+                                   CoglAtlas *dst_atlas)
+{
+  CoglAtlas *src_atlas = atlas_tex->atlas;
+  CoglRectangleMapEntry old_rectangle = atlas_tex->rectangle;
+  CoglHandle src_texture;
+  CoglBlitData blit_data;
+
+  /* Keep the old texture alive until the data has been copied out of
+     it because reserving the space will replace the sub texture */
+  src_texture = cogl_handle_ref (src_atlas->texture);
+
+  if (!_cogl_atlas_reserve_space (dst_atlas,
+                                  old_rectangle.width,
+                                  old_rectangle.height,
+                                  atlas_tex))
+    {
+      cogl_handle_unref (src_texture);
+      return FALSE;
+    }
+
+  /* Notify cogl-pipeline.c that the texture's underlying GL texture
+   * storage is changing so it knows it may need to bind a new texture
+   * if the CoglTexture is reused with the same texture unit. */
+  _cogl_pipeline_texture_storage_change_notify (COGL_TEXTURE (atlas_tex));
+
+  /* Copy the data including the border */
+  _cogl_blit_begin (&blit_data, dst_atlas->texture, src_texture);
+  _cogl_blit (&blit_data,
+              old_rectangle.x, old_rectangle.y,
+              atlas_tex->rectangle.x, atlas_tex->rectangle.y,
+              old_rectangle.width, old_rectangle.height);
+  _cogl_blit_end (&blit_data);
+
+  cogl_handle_unref (src_texture);
+
+  _cogl_atlas_remove (src_atlas, &old_rectangle);
+
+  atlas_tex->atlas = cogl_object_ref (dst_atlas);
+  cogl_object_unref (src_atlas);
+
+  return TRUE;
+}
+
+typedef struct
+{
+  CoglAtlas *atlas;
+  CoglAtlasStats stats;
+} CoglAtlasTexturePage;
+
+static int
+_cogl_atlas_texture_compare_page_usage_cb (const void *a,
+                                           const void *b)
+{
+  const CoglAtlasTexturePage *pa = a;
+  const CoglAtlasTexturePage *pb = b;
+
+  return (pa->stats.used_space < pb->stats.used_space ? -1 :
+          pa->stats.used_space > pb->stats.used_space ? 1 : 0);
+}
+
+static gboolean
+_cogl_atlas_texture_compact_pages (unsigned int max_bytes)
+{
+  CoglAtlasTexturePage *pages;
+  unsigned int n_pages, i, j, k;
+  gboolean flushed = FALSE;
+  /* Always move at least one texture so that we make progress */
+  unsigned int budget = MAX (max_bytes, 1);
+  unsigned int bytes_moved = 0;
+  int n_moved = 0;
+  GSList *l;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  n_pages = g_slist_length (ctx->atlases);
+
+  if (n_pages < 2)
+    return FALSE;
+
+  pages = g_new (CoglAtlasTexturePage, n_pages);
+
+  /* Take a reference on every page so that they stay alive until
+     we've finished even if all of their textures are moved out */
+  for (l = ctx->atlases, i = 0; l; l = l->next, i++)
+    {
+      pages[i].atlas = cogl_object_ref (l->data);
+      _cogl_atlas_get_stats (pages[i].atlas, &pages[i].stats);
+
+      COGL_NOTE (ATLAS, "%p: Atlas page has %u textures, is %i%% full "
+                 "and %i%% fragmented",
+                 pages[i].atlas,
+                 pages[i].stats.n_rectangles,
+                 pages[i].stats.occupancy,
+                 pages[i].stats.fragmentation);
+    }
+
+  /* Try to empty the least used pages first */
+  qsort (pages, n_pages, sizeof (CoglAtlasTexturePage),
+         _cogl_atlas_texture_compare_page_usage_cb);
+
+  for (i = 0; i < n_pages - 1 && bytes_moved < budget; i++)
+    {
+      CoglAtlas *src_atlas = pages[i].atlas;
+      CoglAtlasTextureGetRectanglesData data;
+      unsigned int free_space = 0;
+
+      /* The pages are sorted so none of the remaining pages are worth
+         emptying either */
+      if (pages[i].stats.occupancy >= 50)
+        break;
+
+      if (src_atlas->map == NULL)
+        continue;
+
+      /* Don't move anything unless there is at least enough free
+         space in the fuller pages to take all of the textures */
+      for (j = i + 1; j < n_pages; j++)
+        if (pages[j].atlas->map)
+          free_space +=
+            _cogl_rectangle_map_get_remaining_space (pages[j].atlas->map);
+
+      if (free_space < pages[i].stats.used_space)
+        continue;
+
+      /* We don't know if any journal entries currently depend on
+       * OpenGL texture coordinates that would be invalidated by
+       * moving the textures so we flush all journals first. */
+      if (!flushed)
+        {
+          cogl_flush ();
+          flushed = TRUE;
+        }
+
+      /* We have to get a separate array of the textures because
+         CoglRectangleMap doesn't support removing rectangles during
+         iteration */
+      data.textures =
+        g_new (CoglAtlasTexture *,
+               _cogl_rectangle_map_get_n_rectangles (src_atlas->map));
+      data.n_textures = 0;
+      _cogl_rectangle_map_foreach (src_atlas->map,
+                                   _cogl_atlas_texture_get_rectangles_cb,
+                                   &data);
+
+      /* Fill up the fullest pages first */
+      for (k = 0; k < data.n_textures && bytes_moved < budget; k++)
+        for (j = n_pages - 1; j > i; j--)
+          if (pages[j].atlas->map &&
+              _cogl_atlas_texture_move_to_atlas (data.textures[k],
+                                                 pages[j].atlas))
+            {
+              bytes_moved += (data.textures[k]->rectangle.width *
+                              data.textures[k]->rectangle.height * 4);
+              n_moved++;
+              break;
+            }
+
+      g_free (data.textures);
+
+      COGL_NOTE (ATLAS, "%p: Atlas page compacted, %u textures left",
+                 src_atlas,
+                 _cogl_rectangle_map_get_n_rectangles (src_atlas->map));
+    }
+
+  /* Any pages that have been emptied will be destroyed here */
+  for (i = 0; i < n_pages; i++)
+    cogl_object_unref (pages[i].atlas);
+
+  g_free (pages);
+
+  /* Notify any listeners that textures in the atlas have moved */
+  if (n_moved > 0)
+    g_hook_list_invoke (&ctx->atlas_reorganize_callbacks, FALSE);
+
+  /* If we ran out of budget there may be more pages to empty */
+  return bytes_moved >= budget;
+}
+
+gboolean
+_cogl_atlas_texture_compact (unsigned int max_bytes)
+{
+  GSList *l;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  if (_cogl_atlas_texture_use_pages ())
+    return _cogl_atlas_texture_compact_pages (max_bytes);
+
+  /* Carry on with an atlas that is already being compacted */
+  for (l = ctx->atlases; l; l = l->next)
+    {
+      CoglAtlas *atlas = l->data;
+
+      if (atlas->compaction)
+        return !_cogl_atlas_compact (atlas, max_bytes, NULL);
+    }
+
+  /* Otherwise start on the first atlas whose free space is badly
+     fragmented */
+  for (l = ctx->atlases; l; l = l->next)
+    {
+      CoglAtlas *atlas = l->data;
+      CoglAtlasStats stats;
+
+      if (atlas->compacted)
+        continue;
+
+      _cogl_atlas_get_stats (atlas, &stats);
+
+      if (stats.fragmentation >= 50)
+        return !_cogl_atlas_compact (atlas, max_bytes, NULL);
+    }
+
+  return FALSE;
+}
+
 void
 _cogl_atlas_texture_add_reorganize_callback (GHookFunc callback,
                                              void *user_data)
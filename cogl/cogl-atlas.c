@@ -41,8 +41,10 @@
 #include "cogl-blit.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 static void _cogl_atlas_free (CoglAtlas *atlas);
+static void _cogl_atlas_cancel_compaction (CoglAtlas *atlas);
 
 COGL_OBJECT_INTERNAL_DEFINE (Atlas, atlas);
 
@@ -58,6 +60,10 @@ _cogl_atlas_new (CoglPixelFormat texture_format,
   atlas->texture = NULL;
   atlas->flags = flags;
   atlas->texture_format = texture_format;
+  atlas->memory_category = COGL_MEMORY_CATEGORY_ATLAS;
+  atlas->map_policy = COGL_RECTANGLE_MAP_FIRST_FIT;
+  atlas->compaction = NULL;
+  atlas->compacted = FALSE;
   g_hook_list_init (&atlas->pre_reorganize_callbacks, sizeof (GHook));
   g_hook_list_init (&atlas->post_reorganize_callbacks, sizeof (GHook));
 
@@ -69,6 +75,8 @@ _cogl_atlas_free (CoglAtlas *atlas)
 {
   COGL_NOTE (ATLAS, "%p: Atlas destroyed", atlas);
 
+  _cogl_atlas_cancel_compaction (atlas);
+
   if (atlas->texture)
     cogl_handle_unref (atlas->texture);
   if (atlas->map)
@@ -89,6 +97,33 @@ typedef struct _CoglAtlasRepositionData
   CoglRectangleMapEntry new_position;
 } CoglAtlasRepositionData;
 
+typedef struct _CoglAtlasCompactionEntry
+{
+  CoglAtlasRepositionData position;
+  /* Whether the data has been copied to the new position yet */
+  gboolean copied;
+} CoglAtlasCompactionEntry;
+
+struct _CoglAtlasCompaction
+{
+  /* The map and texture that the rectangles are being moved to. The
+     old map stays in atlas->map until every rectangle has been copied
+     so that the users of the atlas don't see anything change until
+     the compaction is finished */
+  CoglRectangleMap *map;
+  CoglHandle texture;
+
+  /* Array of CoglAtlasCompactionEntry. The user_data of entries whose
+     rectangle has been removed is set to NULL */
+  GArray *entries;
+  /* Maps the old position of each entry that is still in the atlas
+     to its index in the array plus one so that entries can be found
+     quickly when a rectangle is removed or modified */
+  GHashTable *entry_indices;
+  /* Index of the first entry that may not have been copied yet */
+  unsigned int next_entry;
+};
+
 static void
 _cogl_atlas_migrate (CoglAtlas               *atlas,
                      unsigned int             n_textures,
@@ -206,7 +241,7 @@ _cogl_atlas_get_initial_size (CoglPixelFormat format,
 }
 
 static CoglRectangleMap *
-_cogl_atlas_create_map (CoglPixelFormat          format,
+_cogl_atlas_create_map (CoglAtlas               *atlas,
                         unsigned int             map_width,
                         unsigned int             map_height,
                         unsigned int             n_textures,
@@ -217,7 +252,7 @@ _cogl_atlas_create_map (CoglPixelFormat          format,
 
   _COGL_GET_CONTEXT (ctx, NULL);
 
-  ctx->texture_driver->pixel_format_to_gl (format,
+  ctx->texture_driver->pixel_format_to_gl (atlas->texture_format,
                                            &gl_intformat,
                                            NULL, /* gl_format */
                                            &gl_type);
@@ -234,6 +269,8 @@ _cogl_atlas_create_map (CoglPixelFormat          format,
                                                              NULL);
       unsigned int i;
 
+      _cogl_rectangle_map_set_policy (new_atlas, atlas->map_policy);
+
       COGL_NOTE (ATLAS, "Trying to resize the atlas to %ux%u",
                  map_width, map_height);
 
@@ -302,6 +339,9 @@ _cogl_atlas_create_texture (CoglAtlas *atlas,
                                            NULL);
     }
 
+  if (tex != COGL_INVALID_HANDLE)
+    _cogl_texture_set_memory_category (tex, atlas->memory_category);
+
   return tex;
 }
 
@@ -319,6 +359,63 @@ _cogl_atlas_compare_size_cb (const void *a,
   return a_size < b_size ? 1 : a_size > b_size ? -1 : 0;
 }
 
+static gboolean
+_cogl_atlas_reserve_space_in_new_page (CoglAtlas    *atlas,
+                                       unsigned int  width,
+                                       unsigned int  height,
+                                       void         *user_data)
+{
+  CoglRectangleMap *new_map;
+  CoglHandle new_tex;
+  CoglRectangleMapEntry new_position;
+  unsigned int map_width, map_height;
+
+  /* A fixed size atlas is never reorganized so once it has a map
+     there's nothing more we can do. The caller will have to start a
+     new page */
+  if (atlas->map)
+    {
+      COGL_NOTE (ATLAS, "%p: Atlas page is full", atlas);
+      return FALSE;
+    }
+
+  _cogl_atlas_get_initial_size (atlas->texture_format,
+                                &map_width, &map_height);
+
+  if (width > map_width || height > map_height)
+    {
+      COGL_NOTE (ATLAS, "%p: Texture is too big for an atlas page", atlas);
+      return FALSE;
+    }
+
+  new_map = _cogl_rectangle_map_new (map_width, map_height, NULL);
+  _cogl_rectangle_map_set_policy (new_map, atlas->map_policy);
+
+  /* The map is empty so this can't fail */
+  _cogl_rectangle_map_add (new_map, width, height, user_data, &new_position);
+
+  new_tex = _cogl_atlas_create_texture (atlas, map_width, map_height);
+
+  if (new_tex == COGL_INVALID_HANDLE)
+    {
+      COGL_NOTE (ATLAS, "%p: Could not create a CoglTexture2D", atlas);
+      _cogl_rectangle_map_free (new_map);
+      return FALSE;
+    }
+
+  COGL_NOTE (ATLAS, "%p: Created atlas page with size %ux%u",
+             atlas, map_width, map_height);
+
+  atlas->map = new_map;
+  atlas->texture = new_tex;
+
+  /* There were no textures in the atlas before so we don't need to
+     notify anyone about a reorganization */
+  atlas->update_position_cb (user_data, new_tex, &new_position);
+
+  return TRUE;
+}
+
 static void
 _cogl_atlas_notify_pre_reorganize (CoglAtlas *atlas)
 {
@@ -331,6 +428,369 @@ _cogl_atlas_notify_post_reorganize (CoglAtlas *atlas)
   g_hook_list_invoke (&atlas->post_reorganize_callbacks, FALSE);
 }
 
+static void
+_cogl_atlas_cancel_compaction (CoglAtlas *atlas)
+{
+  CoglAtlasCompaction *compaction = atlas->compaction;
+
+  if (compaction == NULL)
+    return;
+
+  COGL_NOTE (ATLAS, "%p: Atlas compaction abandoned", atlas);
+
+  _cogl_rectangle_map_free (compaction->map);
+  cogl_handle_unref (compaction->texture);
+  g_array_free (compaction->entries, TRUE);
+  g_hash_table_destroy (compaction->entry_indices);
+  g_slice_free (CoglAtlasCompaction, compaction);
+
+  atlas->compaction = NULL;
+}
+
+/* The users of the atlas only know about the old positions. These
+   are unique because they are all still in the old map and no
+   rectangle can be at the same top-left corner as another. The
+   coordinates are always less than the maximum texture size so they
+   fit in 16 bits each. The size is checked when the entry is looked
+   up */
+static void *
+_cogl_atlas_compaction_get_key (const CoglRectangleMapEntry *rectangle)
+{
+  return GUINT_TO_POINTER ((rectangle->y << 16) | rectangle->x);
+}
+
+static void
+_cogl_atlas_compaction_append_entry (CoglAtlasCompaction *compaction,
+                                     const CoglAtlasCompactionEntry *entry)
+{
+  g_array_append_val (compaction->entries, *entry);
+  g_hash_table_insert (compaction->entry_indices,
+                       _cogl_atlas_compaction_get_key
+                       (&entry->position.old_position),
+                       GUINT_TO_POINTER (compaction->entries->len));
+}
+
+static CoglAtlasCompactionEntry *
+_cogl_atlas_compaction_find_entry (CoglAtlasCompaction *compaction,
+                                   const CoglRectangleMapEntry *rectangle,
+                                   unsigned int *index_out)
+{
+  CoglAtlasCompactionEntry *entry;
+  unsigned int index;
+
+  index = GPOINTER_TO_UINT (g_hash_table_lookup
+                            (compaction->entry_indices,
+                             _cogl_atlas_compaction_get_key (rectangle)));
+
+  if (index == 0)
+    return NULL;
+
+  entry = &g_array_index (compaction->entries,
+                          CoglAtlasCompactionEntry,
+                          index - 1);
+
+  if (entry->position.old_position.width != rectangle->width ||
+      entry->position.old_position.height != rectangle->height)
+    return NULL;
+
+  if (index_out)
+    *index_out = index - 1;
+
+  return entry;
+}
+
+static void
+_cogl_atlas_compaction_add (CoglAtlas *atlas,
+                            void *user_data,
+                            const CoglRectangleMapEntry *rectangle)
+{
+  CoglAtlasCompaction *compaction = atlas->compaction;
+  CoglAtlasCompactionEntry entry;
+
+  if (!_cogl_rectangle_map_add (compaction->map,
+                                rectangle->width, rectangle->height,
+                                user_data,
+                                &entry.position.new_position))
+    {
+      _cogl_atlas_cancel_compaction (atlas);
+      return;
+    }
+
+  /* The data for the rectangle hasn't been uploaded yet so it will
+     have to be copied along with the others */
+  entry.position.user_data = user_data;
+  entry.position.old_position = *rectangle;
+  entry.copied = FALSE;
+
+  _cogl_atlas_compaction_append_entry (compaction, &entry);
+}
+
+static gboolean
+_cogl_atlas_begin_compaction (CoglAtlas *atlas)
+{
+  CoglAtlasGetRectanglesData data;
+  CoglAtlasCompaction *compaction;
+  CoglRectangleMap *new_map;
+  CoglHandle new_tex;
+  unsigned int map_width, map_height, i;
+
+  if (atlas->map == NULL ||
+      _cogl_rectangle_map_get_n_rectangles (atlas->map) == 0)
+    return FALSE;
+
+  data.textures = g_malloc (sizeof (CoglAtlasRepositionData) *
+                            _cogl_rectangle_map_get_n_rectangles (atlas->map));
+  data.n_textures = 0;
+  _cogl_rectangle_map_foreach (atlas->map,
+                               _cogl_atlas_get_rectangles_cb,
+                               &data);
+
+  qsort (data.textures, data.n_textures,
+         sizeof (CoglAtlasRepositionData),
+         _cogl_atlas_compare_size_cb);
+
+  /* Start from the initial size so that the atlas can shrink if a
+     lot of textures have been removed. A fixed size atlas has to keep
+     its current size */
+  if ((atlas->flags & COGL_ATLAS_FIXED_SIZE))
+    {
+      map_width = _cogl_rectangle_map_get_width (atlas->map);
+      map_height = _cogl_rectangle_map_get_height (atlas->map);
+    }
+  else
+    _cogl_atlas_get_initial_size (atlas->texture_format,
+                                  &map_width, &map_height);
+
+  new_map = _cogl_atlas_create_map (atlas,
+                                    map_width, map_height,
+                                    data.n_textures, data.textures);
+
+  if (new_map &&
+      (atlas->flags & COGL_ATLAS_FIXED_SIZE) &&
+      (_cogl_rectangle_map_get_width (new_map) != map_width ||
+       _cogl_rectangle_map_get_height (new_map) != map_height))
+    {
+      _cogl_rectangle_map_free (new_map);
+      new_map = NULL;
+    }
+
+  if (new_map == NULL)
+    {
+      g_free (data.textures);
+      return FALSE;
+    }
+
+  new_tex = _cogl_atlas_create_texture (atlas,
+                                        _cogl_rectangle_map_get_width (new_map),
+                                        _cogl_rectangle_map_get_height (new_map));
+
+  if (new_tex == COGL_INVALID_HANDLE)
+    {
+      _cogl_rectangle_map_free (new_map);
+      g_free (data.textures);
+      return FALSE;
+    }
+
+  compaction = g_slice_new (CoglAtlasCompaction);
+  compaction->map = new_map;
+  compaction->texture = new_tex;
+  compaction->entries = g_array_sized_new (FALSE, FALSE,
+                                           sizeof (CoglAtlasCompactionEntry),
+                                           data.n_textures);
+  compaction->entry_indices = g_hash_table_new (g_direct_hash,
+                                                g_direct_equal);
+  compaction->next_entry = 0;
+
+  for (i = 0; i < data.n_textures; i++)
+    {
+      CoglAtlasCompactionEntry entry;
+
+      entry.position = data.textures[i];
+      entry.copied = FALSE;
+      _cogl_atlas_compaction_append_entry (compaction, &entry);
+    }
+
+  g_free (data.textures);
+
+  atlas->compaction = compaction;
+
+  COGL_NOTE (ATLAS, "%p: Started compacting atlas into %ix%i",
+             atlas,
+             _cogl_rectangle_map_get_width (new_map),
+             _cogl_rectangle_map_get_height (new_map));
+
+  return TRUE;
+}
+
+static void
+_cogl_atlas_finish_compaction (CoglAtlas *atlas)
+{
+  CoglAtlasCompaction *compaction = atlas->compaction;
+  unsigned int i;
+
+  /* All of the data is already in the new texture so the only thing
+     left is to switch the users of the atlas over to it */
+  _cogl_atlas_notify_pre_reorganize (atlas);
+
+  for (i = 0; i < compaction->entries->len; i++)
+    {
+      CoglAtlasCompactionEntry *entry =
+        &g_array_index (compaction->entries, CoglAtlasCompactionEntry, i);
+
+      if (entry->position.user_data)
+        atlas->update_position_cb (entry->position.user_data,
+                                   compaction->texture,
+                                   &entry->position.new_position);
+    }
+
+  _cogl_rectangle_map_free (atlas->map);
+  cogl_handle_unref (atlas->texture);
+
+  atlas->map = compaction->map;
+  atlas->texture = compaction->texture;
+
+  g_array_free (compaction->entries, TRUE);
+  g_hash_table_destroy (compaction->entry_indices);
+  g_slice_free (CoglAtlasCompaction, compaction);
+  atlas->compaction = NULL;
+  atlas->compacted = TRUE;
+
+  COGL_NOTE (ATLAS, "%p: Atlas compacted to %ix%i and is %i%% waste",
+             atlas,
+             _cogl_rectangle_map_get_width (atlas->map),
+             _cogl_rectangle_map_get_height (atlas->map),
+             _cogl_rectangle_map_get_remaining_space (atlas->map) *
+             100 / (_cogl_rectangle_map_get_width (atlas->map) *
+                    _cogl_rectangle_map_get_height (atlas->map)));
+
+  _cogl_atlas_notify_post_reorganize (atlas);
+}
+
+/* Copies at most max_bytes worth of rectangles into a compacted copy
+   of the atlas. The first call starts the compaction and the atlas
+   only switches over to the new layout once every rectangle has been
+   copied, so this can be spread out over several idle frames. A
+   single rectangle that is bigger than max_bytes is still copied so
+   that the compaction always makes progress. Reserving space that
+   doesn't fit in the compacted layout abandons the compaction. The
+   number of bytes copied is stored in bytes_copied_out if it isn't
+   NULL. Returns TRUE once there is nothing left to do */
+gboolean
+_cogl_atlas_compact (CoglAtlas *atlas,
+                     unsigned int max_bytes,
+                     unsigned int *bytes_copied_out)
+{
+  CoglAtlasCompaction *compaction;
+  unsigned int bytes_copied = 0;
+  int bpp;
+
+  if (bytes_copied_out)
+    *bytes_copied_out = 0;
+
+  if (atlas->compaction == NULL)
+    {
+      if (atlas->compacted)
+        return TRUE;
+
+      /* If the atlas can't be compacted now then there's no point in
+         trying again until something is removed */
+      if (!_cogl_atlas_begin_compaction (atlas))
+        {
+          atlas->compacted = TRUE;
+          return TRUE;
+        }
+    }
+
+  compaction = atlas->compaction;
+  bpp = _cogl_get_format_bpp (atlas->texture_format);
+
+  /* If the 'disable migration' flag is set then the users of the atlas
+     will fill in the rectangles themselves when they are told about
+     the new positions so there's nothing to copy */
+  if (!(atlas->flags & COGL_ATLAS_DISABLE_MIGRATION))
+    {
+      CoglBlitData blit_data;
+      gboolean blit_started = FALSE;
+
+      while (compaction->next_entry < compaction->entries->len)
+        {
+          CoglAtlasCompactionEntry *entry =
+            &g_array_index (compaction->entries, CoglAtlasCompactionEntry,
+                            compaction->next_entry);
+          unsigned int size;
+
+          if (entry->copied)
+            {
+              compaction->next_entry++;
+              continue;
+            }
+
+          size = (entry->position.new_position.width *
+                  entry->position.new_position.height * bpp);
+
+          /* Always copy at least one rectangle so that we make
+             progress */
+          if (bytes_copied > 0 && bytes_copied + size > max_bytes)
+            break;
+
+          compaction->next_entry++;
+
+          if (!blit_started)
+            {
+              _cogl_blit_begin (&blit_data,
+                                compaction->texture,
+                                atlas->texture);
+              blit_started = TRUE;
+            }
+
+          _cogl_blit (&blit_data,
+                      entry->position.old_position.x,
+                      entry->position.old_position.y,
+                      entry->position.new_position.x,
+                      entry->position.new_position.y,
+                      entry->position.new_position.width,
+                      entry->position.new_position.height);
+
+          entry->copied = TRUE;
+          bytes_copied += size;
+        }
+
+      if (blit_started)
+        _cogl_blit_end (&blit_data);
+
+      if (bytes_copied_out)
+        *bytes_copied_out = bytes_copied;
+
+      if (compaction->next_entry < compaction->entries->len)
+        return FALSE;
+    }
+
+  _cogl_atlas_finish_compaction (atlas);
+
+  return TRUE;
+}
+
+/* Should be called whenever the data of a rectangle changes so that
+   an incremental compaction knows to copy it again */
+void
+_cogl_atlas_invalidate_rectangle (CoglAtlas *atlas,
+                                  const CoglRectangleMapEntry *rectangle)
+{
+  CoglAtlasCompactionEntry *entry;
+  unsigned int index;
+
+  if (atlas->compaction &&
+      (entry = _cogl_atlas_compaction_find_entry (atlas->compaction,
+                                                  rectangle,
+                                                  &index)) &&
+      entry->copied)
+    {
+      entry->copied = FALSE;
+      atlas->compaction->next_entry =
+        MIN (atlas->compaction->next_entry, index);
+    }
+}
+
 gboolean
 _cogl_atlas_reserve_space (CoglAtlas             *atlas,
                            unsigned int           width,
@@ -364,9 +824,23 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
                                  atlas->texture,
                                  &new_position);
 
+      /* The rectangle also needs a place in the compacted atlas */
+      if (atlas->compaction)
+        _cogl_atlas_compaction_add (atlas, user_data, &new_position);
+
       return TRUE;
     }
 
+  /* Pages of a multi-page atlas are never moved */
+  if ((atlas->flags & COGL_ATLAS_FIXED_SIZE))
+    return _cogl_atlas_reserve_space_in_new_page (atlas,
+                                                  width, height,
+                                                  user_data);
+
+  /* Any compaction in progress is based on the old layout so it will
+     have to start again */
+  _cogl_atlas_cancel_compaction (atlas);
+
   /* If we make it here then we need to reorganize the atlas. First
      we'll notify any users of the atlas that this is going to happen
      so that for example in CoglAtlasTexture it can notify that the
@@ -422,7 +896,7 @@ _cogl_atlas_reserve_space (CoglAtlas             *atlas,
     _cogl_atlas_get_initial_size (atlas->texture_format,
                                   &map_width, &map_height);
 
-  new_map = _cogl_atlas_create_map (atlas->texture_format,
+  new_map = _cogl_atlas_create_map (atlas,
                                     map_width, map_height,
                                     data.n_textures, data.textures);
 
@@ -506,8 +980,26 @@ void
 _cogl_atlas_remove (CoglAtlas *atlas,
                     const CoglRectangleMapEntry *rectangle)
 {
+  CoglAtlasCompactionEntry *entry;
+
   _cogl_rectangle_map_remove (atlas->map, rectangle);
 
+  if (atlas->compaction &&
+      (entry = _cogl_atlas_compaction_find_entry (atlas->compaction,
+                                                  rectangle,
+                                                  NULL)))
+    {
+      _cogl_rectangle_map_remove (atlas->compaction->map,
+                                  &entry->position.new_position);
+      g_hash_table_remove (atlas->compaction->entry_indices,
+                           _cogl_atlas_compaction_get_key (rectangle));
+      entry->position.user_data = NULL;
+      entry->copied = TRUE;
+    }
+
+  /* Removing rectangles is what fragments the atlas */
+  atlas->compacted = FALSE;
+
   COGL_NOTE (ATLAS, "%p: Removed rectangle sized %ix%i",
              atlas,
              rectangle->width,
@@ -522,6 +1014,63 @@ _cogl_atlas_remove (CoglAtlas *atlas,
                     _cogl_rectangle_map_get_height (atlas->map)));
 };
 
+void
+_cogl_atlas_get_stats (CoglAtlas *atlas,
+                       CoglAtlasStats *stats)
+{
+  unsigned int area, remaining;
+
+  if (atlas->map == NULL)
+    {
+      memset (stats, 0, sizeof (CoglAtlasStats));
+      return;
+    }
+
+  stats->width = _cogl_rectangle_map_get_width (atlas->map);
+  stats->height = _cogl_rectangle_map_get_height (atlas->map);
+  stats->n_rectangles = _cogl_rectangle_map_get_n_rectangles (atlas->map);
+
+  area = stats->width * stats->height;
+  remaining = _cogl_rectangle_map_get_remaining_space (atlas->map);
+
+  stats->used_space = area - remaining;
+  stats->largest_free_space = _cogl_rectangle_map_get_largest_gap (atlas->map);
+  stats->occupancy = (guint64) stats->used_space * 100 / area;
+
+  /* If all of the free space is in one rectangle then the atlas isn't
+     fragmented at all */
+  if (remaining > 0)
+    stats->fragmentation = ((guint64) (remaining - stats->largest_free_space) *
+                            100 / remaining);
+  else
+    stats->fragmentation = 0;
+}
+
+void
+_cogl_atlas_set_memory_category (CoglAtlas *atlas,
+                                 CoglMemoryCategory category)
+{
+  atlas->memory_category = category;
+
+  if (atlas->texture)
+    _cogl_texture_set_memory_category (atlas->texture, category);
+}
+
+/* Selects how the atlas picks the space for new rectangles. This
+   affects the current map as well as any maps created later when the
+   atlas is reorganized */
+void
+_cogl_atlas_set_packing_policy (CoglAtlas *atlas,
+                                CoglRectangleMapPolicy policy)
+{
+  atlas->map_policy = policy;
+
+  if (atlas->map)
+    _cogl_rectangle_map_set_policy (atlas->map, policy);
+  if (atlas->compaction)
+    _cogl_rectangle_map_set_policy (atlas->compaction->map, policy);
+}
+
 CoglHandle
 _cogl_atlas_copy_rectangle (CoglAtlas        *atlas,
                             unsigned int      x,
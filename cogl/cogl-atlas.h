@@ -26,6 +26,7 @@
 
 #include "cogl-rectangle-map.h"
 #include "cogl-object-private.h"
+#include "cogl-memory-usage.h"
 
 typedef void
 (* CoglAtlasUpdatePositionCallback) (void *user_data,
@@ -35,10 +36,30 @@ typedef void
 typedef enum
 {
   COGL_ATLAS_CLEAR_TEXTURE     = (1 << 0),
-  COGL_ATLAS_DISABLE_MIGRATION = (1 << 1)
+  COGL_ATLAS_DISABLE_MIGRATION = (1 << 1),
+  /* The atlas is never resized or reorganized. Once it is full
+     _cogl_atlas_reserve_space will just fail so that the caller can
+     start another atlas as a new page */
+  COGL_ATLAS_FIXED_SIZE        = (1 << 2)
 } CoglAtlasFlags;
 
+typedef struct _CoglAtlasStats
+{
+  unsigned int width, height;
+  unsigned int n_rectangles;
+  /* Number of pixels covered by rectangles */
+  unsigned int used_space;
+  /* Area of the largest empty rectangle */
+  unsigned int largest_free_space;
+  /* Percentage of the atlas that is covered by rectangles */
+  int occupancy;
+  /* Percentage of the free space that is not part of the largest
+     empty rectangle */
+  int fragmentation;
+} CoglAtlasStats;
+
 typedef struct _CoglAtlas CoglAtlas;
+typedef struct _CoglAtlasCompaction CoglAtlasCompaction;
 
 #define COGL_ATLAS(object) ((CoglAtlas *) object)
 
@@ -51,9 +72,21 @@ struct _CoglAtlas
   CoglHandle texture;
   CoglPixelFormat texture_format;
   CoglAtlasFlags flags;
+  /* Category that the memory of the atlas texture is counted under */
+  CoglMemoryCategory memory_category;
 
   CoglAtlasUpdatePositionCallback update_position_cb;
 
+  /* Packing policy used for every map that the atlas creates */
+  CoglRectangleMapPolicy map_policy;
+
+  /* State of an incremental compaction started with
+     _cogl_atlas_compact or NULL if there isn't one in progress */
+  CoglAtlasCompaction *compaction;
+  /* TRUE if no rectangles have been removed since the last
+     compaction so there is no point in doing another */
+  gboolean compacted;
+
   GHookList pre_reorganize_callbacks;
   GHookList post_reorganize_callbacks;
 };
@@ -73,6 +106,27 @@ void
 _cogl_atlas_remove (CoglAtlas *atlas,
                     const CoglRectangleMapEntry *rectangle);
 
+void
+_cogl_atlas_get_stats (CoglAtlas *atlas,
+                       CoglAtlasStats *stats);
+
+gboolean
+_cogl_atlas_compact (CoglAtlas *atlas,
+                     unsigned int max_bytes,
+                     unsigned int *bytes_copied_out);
+
+void
+_cogl_atlas_invalidate_rectangle (CoglAtlas *atlas,
+                                  const CoglRectangleMapEntry *rectangle);
+
+void
+_cogl_atlas_set_memory_category (CoglAtlas *atlas,
+                                 CoglMemoryCategory category);
+
+void
+_cogl_atlas_set_packing_policy (CoglAtlas *atlas,
+                                CoglRectangleMapPolicy policy);
+
 CoglHandle
 _cogl_atlas_copy_rectangle (CoglAtlas        *atlas,
                             unsigned int      x,
@@ -340,6 +340,46 @@ _cogl_bitmap_fallback_can_premult (CoglPixelFormat format)
 CoglBitmap *
 _cogl_bitmap_fallback_convert (CoglBitmap      *src_bmp,
                                CoglPixelFormat  dst_format)
+{
+  CoglBitmap      *dst_bmp;
+  CoglPixelFormat  src_format;
+  int              dst_rowstride;
+  int              width, height;
+
+  src_format = _cogl_bitmap_get_format (src_bmp);
+  width = _cogl_bitmap_get_width (src_bmp);
+  height = _cogl_bitmap_get_height (src_bmp);
+
+  /* Make sure conversion supported */
+  if (!_cogl_bitmap_fallback_can_convert (src_format, dst_format))
+    return NULL;
+
+  /* Initialize destination bitmap */
+  dst_rowstride = sizeof(guint8) * _cogl_get_format_bpp (dst_format) * width;
+  /* Copy the premult bit if the new format has an alpha channel */
+  if ((dst_format & COGL_A_BIT))
+    dst_format = ((src_format & COGL_PREMULT_BIT) |
+                  (dst_format & COGL_UNPREMULT_MASK));
+
+  /* Allocate a new buffer to hold converted data */
+  dst_bmp = _cogl_bitmap_new_from_data (g_malloc (height * dst_rowstride),
+                                        dst_format,
+                                        width, height, dst_rowstride,
+                                        (CoglBitmapDestroyNotify) g_free,
+                                        NULL);
+
+  if (!_cogl_bitmap_fallback_convert_into (src_bmp, dst_bmp))
+    {
+      cogl_object_unref (dst_bmp);
+      return NULL;
+    }
+
+  return dst_bmp;
+}
+
+gboolean
+_cogl_bitmap_fallback_convert_into (CoglBitmap *src_bmp,
+                                    CoglBitmap *dst_bmp)
 {
   guint8          *src_data;
   guint8          *dst_data;
@@ -353,33 +393,36 @@ _cogl_bitmap_fallback_convert (CoglBitmap      *src_bmp,
   guint8           temp_rgba[4] = {0,0,0,0};
   int              width, height;
   CoglPixelFormat  src_format;
+  CoglPixelFormat  dst_format;
 
   src_format = _cogl_bitmap_get_format (src_bmp);
   src_rowstride = _cogl_bitmap_get_rowstride (src_bmp);
-  width = _cogl_bitmap_get_width (src_bmp);
-  height = _cogl_bitmap_get_height (src_bmp);
+  dst_format = _cogl_bitmap_get_format (dst_bmp);
+  dst_rowstride = _cogl_bitmap_get_rowstride (dst_bmp);
+  width = MIN (_cogl_bitmap_get_width (src_bmp),
+               _cogl_bitmap_get_width (dst_bmp));
+  height = MIN (_cogl_bitmap_get_height (src_bmp),
+                _cogl_bitmap_get_height (dst_bmp));
 
   /* Make sure conversion supported */
   if (!_cogl_bitmap_fallback_can_convert (src_format, dst_format))
-    return NULL;
+    return FALSE;
 
   src_data = _cogl_bitmap_map (src_bmp, COGL_BUFFER_ACCESS_READ, 0);
   if (src_data == NULL)
-    return NULL;
+    return FALSE;
+
+  dst_data = _cogl_bitmap_map (dst_bmp, COGL_BUFFER_ACCESS_WRITE,
+                               COGL_BUFFER_MAP_HINT_DISCARD);
+  if (dst_data == NULL)
+    {
+      _cogl_bitmap_unmap (src_bmp);
+      return FALSE;
+    }
 
   src_bpp = _cogl_get_format_bpp (src_format);
   dst_bpp = _cogl_get_format_bpp (dst_format);
 
-  /* Initialize destination bitmap */
-  dst_rowstride = sizeof(guint8) * dst_bpp * width;
-  /* Copy the premult bit if the new format has an alpha channel */
-  if ((dst_format & COGL_A_BIT))
-    dst_format = ((src_format & COGL_PREMULT_BIT) |
-                  (dst_format & COGL_UNPREMULT_MASK));
-
-  /* Allocate a new buffer to hold converted data */
-  dst_data = g_malloc (height * dst_rowstride);
-
   /* FIXME: Optimize */
   for (y = 0; y < height; y++)
     {
@@ -436,13 +479,10 @@ _cogl_bitmap_fallback_convert (CoglBitmap      *src_bmp,
 	}
     }
 
+  _cogl_bitmap_unmap (dst_bmp);
   _cogl_bitmap_unmap (src_bmp);
 
-  return _cogl_bitmap_new_from_data (dst_data,
-                                     dst_format,
-                                     width, height, dst_rowstride,
-                                     (CoglBitmapDestroyNotify) g_free,
-                                     NULL);
+  return TRUE;
 }
 
 gboolean
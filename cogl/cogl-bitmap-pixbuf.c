@@ -30,11 +30,13 @@
 #include "cogl-bitmap-private.h"
 
 #include <string.h>
+#include <errno.h>
 
 #ifdef USE_QUARTZ
 #include <ApplicationServices/ApplicationServices.h>
 #elif defined(USE_GDKPIXBUF)
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib/gstdio.h>
 #endif
 
 gboolean
@@ -91,9 +93,10 @@ _cogl_bitmap_get_size_from_file (const char *filename,
 }
 
 /* the error does not contain the filename as the caller already has it */
-CoglBitmap *
-_cogl_bitmap_from_file (const char  *filename,
-			GError     **error)
+gboolean
+_cogl_bitmap_decode_file (const char          *filename,
+                          CoglBitmapFileData  *file_data,
+                          GError             **error)
 {
   CFURLRef url;
   CGImageSourceRef image_source;
@@ -123,7 +126,7 @@ _cogl_bitmap_from_file (const char  *filename,
                            COGL_BITMAP_ERROR,
                            COGL_BITMAP_ERROR_FAILED,
                            g_strerror (save_errno));
-      return NULL;
+      return FALSE;
     }
 
   /* Unknown images would be cleanly caught as zero width/height below, but try
@@ -137,7 +140,7 @@ _cogl_bitmap_from_file (const char  *filename,
                            COGL_BITMAP_ERROR,
                            COGL_BITMAP_ERROR_UNKNOWN_TYPE,
                            "Unknown image type");
-      return NULL;
+      return FALSE;
     }
 
   CFRelease (type);
@@ -155,7 +158,7 @@ _cogl_bitmap_from_file (const char  *filename,
                            COGL_BITMAP_ERROR,
                            COGL_BITMAP_ERROR_CORRUPT_IMAGE,
                            "Image has zero width or height");
-      return NULL;
+      return FALSE;
     }
 
   /* allocate buffer big enough to hold pixel data */
@@ -180,12 +183,15 @@ _cogl_bitmap_from_file (const char  *filename,
   CGContextRelease (bitmap_context);
 
   /* store bitmap info */
-  return _cogl_bitmap_new_from_data (out_data,
-                                     COGL_PIXEL_FORMAT_ARGB_8888,
-                                     width, height,
-                                     rowstride,
-                                     (CoglBitmapDestroyNotify) g_free,
-                                     NULL);
+  file_data->data = out_data;
+  file_data->format = COGL_PIXEL_FORMAT_ARGB_8888;
+  file_data->width = width;
+  file_data->height = height;
+  file_data->rowstride = rowstride;
+  file_data->destroy_fn = (CoglBitmapDestroyNotify) g_free;
+  file_data->destroy_fn_data = NULL;
+
+  return TRUE;
 }
 
 #elif defined(USE_GDKPIXBUF)
@@ -210,9 +216,10 @@ _cogl_bitmap_unref_pixbuf (guint8 *pixels,
   g_object_unref (pixbuf);
 }
 
-CoglBitmap *
-_cogl_bitmap_from_file (const char   *filename,
-			GError      **error)
+gboolean
+_cogl_bitmap_decode_file (const char          *filename,
+                          CoglBitmapFileData  *file_data,
+                          GError             **error)
 {
   GdkPixbuf        *pixbuf;
   gboolean          has_alpha;
@@ -270,13 +277,195 @@ _cogl_bitmap_from_file (const char   *filename,
      to read past the end of bpp*width on the last row even if the
      rowstride is much larger so we don't need to worry about
      GdkPixbuf's semantics that it may under-allocate the buffer. */
-  return _cogl_bitmap_new_from_data (gdk_pixbuf_get_pixels (pixbuf),
-                                     pixel_format,
-                                     width,
-                                     height,
+  file_data->data = gdk_pixbuf_get_pixels (pixbuf);
+  file_data->format = pixel_format;
+  file_data->width = width;
+  file_data->height = height;
+  file_data->rowstride = rowstride;
+  file_data->destroy_fn = _cogl_bitmap_unref_pixbuf;
+  file_data->destroy_fn_data = pixbuf;
+
+  return TRUE;
+}
+
+/* Size of the chunks of the file given to the pixbuf loader */
+#define COGL_BITMAP_LOADER_CHUNK_SIZE 65536
+
+typedef struct
+{
+  CoglBitmapSizeCallback size_callback;
+  CoglBitmapBandCallback band_callback;
+  void *user_data;
+
+  CoglPixelFormat format;
+  /* Rows before this have already been given to the band callback */
+  int next_row;
+  /* Set if the loader updated anything other than the next full rows,
+     eg. for interlaced or bottom-up images. In that case the whole
+     image is given to the band callback again at the end */
+  gboolean out_of_order;
+  /* Set when one of the callbacks returned FALSE */
+  gboolean cancelled;
+} CoglBitmapBandLoader;
+
+static gboolean
+_cogl_bitmap_band_loader_emit (CoglBitmapBandLoader *band_loader,
+                               GdkPixbuf *pixbuf,
+                               int y,
+                               int n_rows)
+{
+  int rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  CoglBitmap *band;
+  gboolean ret;
+
+  /* The band shares the memory of the pixbuf */
+  band = _cogl_bitmap_new_from_data (gdk_pixbuf_get_pixels (pixbuf) +
+                                     y * rowstride,
+                                     band_loader->format,
+                                     gdk_pixbuf_get_width (pixbuf),
+                                     n_rows,
                                      rowstride,
-                                     _cogl_bitmap_unref_pixbuf,
-                                     pixbuf);
+                                     NULL, NULL);
+
+  ret = band_loader->band_callback (band, y, band_loader->user_data);
+
+  cogl_object_unref (band);
+
+  if (!ret)
+    band_loader->cancelled = TRUE;
+
+  return ret;
+}
+
+static void
+_cogl_bitmap_area_prepared_cb (GdkPixbufLoader *loader,
+                               CoglBitmapBandLoader *band_loader)
+{
+  GdkPixbuf *pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+
+  /* GdkPixbuf only uses 8-bit RGB or RGBA */
+  band_loader->format = (gdk_pixbuf_get_has_alpha (pixbuf) ?
+                         COGL_PIXEL_FORMAT_RGBA_8888 :
+                         COGL_PIXEL_FORMAT_RGB_888);
+
+  if (!band_loader->size_callback (gdk_pixbuf_get_width (pixbuf),
+                                   gdk_pixbuf_get_height (pixbuf),
+                                   band_loader->format,
+                                   band_loader->user_data))
+    band_loader->cancelled = TRUE;
+}
+
+static void
+_cogl_bitmap_area_updated_cb (GdkPixbufLoader *loader,
+                              int x,
+                              int y,
+                              int width,
+                              int height,
+                              CoglBitmapBandLoader *band_loader)
+{
+  GdkPixbuf *pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+
+  if (band_loader->cancelled || band_loader->out_of_order)
+    return;
+
+  /* Rows can only be passed on once they are complete and we can
+     only be sure of that if the loader works down the image */
+  if (x != 0 ||
+      width != gdk_pixbuf_get_width (pixbuf) ||
+      y != band_loader->next_row)
+    {
+      band_loader->out_of_order = TRUE;
+      return;
+    }
+
+  if (_cogl_bitmap_band_loader_emit (band_loader, pixbuf, y, height))
+    band_loader->next_row = y + height;
+}
+
+gboolean
+_cogl_bitmap_from_file_in_bands (const char *filename,
+                                 CoglBitmapSizeCallback size_callback,
+                                 CoglBitmapBandCallback band_callback,
+                                 void *user_data,
+                                 GError **error)
+{
+  CoglBitmapBandLoader band_loader;
+  GdkPixbufLoader *loader;
+  GdkPixbuf *pixbuf;
+  guint8 *chunk;
+  gboolean ret = TRUE;
+  size_t n_read;
+  FILE *file;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if ((file = g_fopen (filename, "rb")) == NULL)
+    {
+      int save_errno = errno;
+      g_set_error (error,
+                   G_FILE_ERROR,
+                   g_file_error_from_errno (save_errno),
+                   "Failed to open file '%s': %s",
+                   filename,
+                   g_strerror (save_errno));
+      return FALSE;
+    }
+
+  band_loader.size_callback = size_callback;
+  band_loader.band_callback = band_callback;
+  band_loader.user_data = user_data;
+  band_loader.next_row = 0;
+  band_loader.out_of_order = FALSE;
+  band_loader.cancelled = FALSE;
+
+  loader = gdk_pixbuf_loader_new ();
+  g_signal_connect (loader, "area-prepared",
+                    G_CALLBACK (_cogl_bitmap_area_prepared_cb),
+                    &band_loader);
+  g_signal_connect (loader, "area-updated",
+                    G_CALLBACK (_cogl_bitmap_area_updated_cb),
+                    &band_loader);
+
+  /* Feeding the file to the loader a chunk at a time lets each band
+     be used while the rest of the file is decoded */
+  chunk = g_malloc (COGL_BITMAP_LOADER_CHUNK_SIZE);
+
+  while (ret && !band_loader.cancelled &&
+         (n_read = fread (chunk, 1, COGL_BITMAP_LOADER_CHUNK_SIZE, file)) > 0)
+    ret = gdk_pixbuf_loader_write (loader, chunk, n_read, error);
+
+  g_free (chunk);
+  fclose (file);
+
+  if (ret && !band_loader.cancelled)
+    ret = gdk_pixbuf_loader_close (loader, error);
+  else
+    gdk_pixbuf_loader_close (loader, NULL);
+
+  pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+
+  if (ret && !band_loader.cancelled && pixbuf == NULL)
+    {
+      g_set_error_literal (error,
+                           COGL_BITMAP_ERROR,
+                           COGL_BITMAP_ERROR_CORRUPT_IMAGE,
+                           "The image contains no pixels");
+      ret = FALSE;
+    }
+
+  /* Give any rows that couldn't be passed on while decoding */
+  if (ret && !band_loader.cancelled)
+    {
+      int y = band_loader.out_of_order ? 0 : band_loader.next_row;
+      int height = gdk_pixbuf_get_height (pixbuf);
+
+      if (y < height)
+        _cogl_bitmap_band_loader_emit (&band_loader, pixbuf, y, height - y);
+    }
+
+  g_object_unref (loader);
+
+  return ret && !band_loader.cancelled;
 }
 
 #else
@@ -297,11 +486,11 @@ _cogl_bitmap_get_size_from_file (const char *filename,
   return TRUE;
 }
 
-CoglBitmap *
-_cogl_bitmap_from_file (const char  *filename,
-			GError     **error)
+gboolean
+_cogl_bitmap_decode_file (const char          *filename,
+                          CoglBitmapFileData  *file_data,
+                          GError             **error)
 {
-  CoglBitmap *bmp;
   int      stb_pixel_format;
   int      width;
   int      height;
@@ -316,16 +505,64 @@ _cogl_bitmap_from_file (const char  *filename,
   if (pixels == NULL)
     return FALSE;
 
-  /* Store bitmap info */
-  bmp = _cogl_bitmap_new_from_data (g_memdup (pixels, height * width * 4),
-                                    COGL_PIXEL_FORMAT_RGBA_8888,
-                                    width, height,
-                                    width * 4,
-                                    (CoglBitmapDestroyNotify) g_free,
-                                    NULL);
+  /* Store bitmap info. The pixels from stb are used directly to
+     avoid copying the whole image */
+  file_data->data = pixels;
+  file_data->format = COGL_PIXEL_FORMAT_RGBA_8888;
+  file_data->width = width;
+  file_data->height = height;
+  file_data->rowstride = width * 4;
+  file_data->destroy_fn = (CoglBitmapDestroyNotify) stbi_image_free;
+  file_data->destroy_fn_data = NULL;
 
-  free (pixels);
+  return TRUE;
+}
+#endif
 
-  return bmp;
+CoglBitmap *
+_cogl_bitmap_from_file (const char  *filename,
+			GError     **error)
+{
+  CoglBitmapFileData file_data;
+
+  if (!_cogl_bitmap_decode_file (filename, &file_data, error))
+    return NULL;
+
+  return _cogl_bitmap_new_from_data (file_data.data,
+                                     file_data.format,
+                                     file_data.width,
+                                     file_data.height,
+                                     file_data.rowstride,
+                                     file_data.destroy_fn,
+                                     file_data.destroy_fn_data);
 }
+
+#if defined(USE_QUARTZ) || !defined(USE_GDKPIXBUF)
+
+/* These backends can't decode progressively so the whole image is
+   given as one band */
+gboolean
+_cogl_bitmap_from_file_in_bands (const char *filename,
+                                 CoglBitmapSizeCallback size_callback,
+                                 CoglBitmapBandCallback band_callback,
+                                 void *user_data,
+                                 GError **error)
+{
+  CoglBitmap *bmp;
+  gboolean ret;
+
+  if ((bmp = _cogl_bitmap_from_file (filename, error)) == NULL)
+    return FALSE;
+
+  ret = (size_callback (_cogl_bitmap_get_width (bmp),
+                        _cogl_bitmap_get_height (bmp),
+                        _cogl_bitmap_get_format (bmp),
+                        user_data) &&
+         band_callback (bmp, 0, user_data));
+
+  cogl_object_unref (bmp);
+
+  return ret;
+}
+
 #endif
@@ -108,6 +108,13 @@ CoglBitmap *
 _cogl_bitmap_fallback_convert (CoglBitmap *bmp,
 			       CoglPixelFormat   dst_format);
 
+/* Converts the pixels of src_bmp into the existing dst_bmp using the
+   format of dst_bmp. The premult status of the data is not
+   changed. */
+gboolean
+_cogl_bitmap_fallback_convert_into (CoglBitmap *src_bmp,
+                                    CoglBitmap *dst_bmp);
+
 gboolean
 _cogl_bitmap_unpremult (CoglBitmap *dst_bmp);
 
@@ -124,6 +131,78 @@ CoglBitmap *
 _cogl_bitmap_from_file (const char *filename,
 			GError     **error);
 
+/* The pixels of an image decoded by _cogl_bitmap_decode_file(). The
+   destroy function must be called with the data once it isn't
+   needed */
+typedef struct
+{
+  guint8 *data;
+  CoglPixelFormat format;
+  int width;
+  int height;
+  int rowstride;
+  CoglBitmapDestroyNotify destroy_fn;
+  void *destroy_fn_data;
+} CoglBitmapFileData;
+
+/*
+ * _cogl_bitmap_decode_file:
+ * @filename: the file to load
+ * @file_data: return location for the decoded pixels
+ * @error: return location for a #GError
+ *
+ * Decodes an image in the same way as _cogl_bitmap_from_file() but
+ * without creating a #CoglBitmap. Creating Cogl objects isn't thread
+ * safe so this can be used to decode images on a worker thread.
+ *
+ * Return value: %TRUE if the image was decoded
+ */
+gboolean
+_cogl_bitmap_decode_file (const char *filename,
+                          CoglBitmapFileData *file_data,
+                          GError **error);
+
+typedef gboolean
+(* CoglBitmapSizeCallback) (int width,
+                            int height,
+                            CoglPixelFormat format,
+                            void *user_data);
+
+typedef gboolean
+(* CoglBitmapBandCallback) (CoglBitmap *band,
+                            int y,
+                            void *user_data);
+
+/*
+ * _cogl_bitmap_from_file_in_bands:
+ * @filename: the file to load
+ * @size_callback: called once the size and format of the image are
+ *   known, before any of the rows are decoded
+ * @band_callback: called with a bitmap containing some full rows of
+ *   the image as soon as they are decoded. @y is the first row in the
+ *   band. The bitmap is only valid during the callback
+ * @user_data: data for the callbacks
+ * @error: return location for a #GError
+ *
+ * Decodes an image progressively where the image backend allows it so
+ * that the rows can be used while the rest of the file is still being
+ * decoded. The bands are usually in order from the top of the image
+ * but a row may be given more than once, for example with interlaced
+ * images. Backends that can't decode progressively give the whole
+ * image as a single band.
+ *
+ * Loading stops if either callback returns %FALSE in which case
+ * %FALSE is returned without setting @error.
+ *
+ * Return value: %TRUE if the whole image was loaded
+ */
+gboolean
+_cogl_bitmap_from_file_in_bands (const char *filename,
+                                 CoglBitmapSizeCallback size_callback,
+                                 CoglBitmapBandCallback band_callback,
+                                 void *user_data,
+                                 GError **error);
+
 CoglBitmap *
 _cogl_bitmap_fallback_from_file (const char *filename);
 
@@ -135,6 +214,15 @@ CoglBitmap *
 _cogl_bitmap_convert_format_and_premult (CoglBitmap *bmp,
                                          CoglPixelFormat   dst_format);
 
+/* Converts the pixels of src_bmp to the format and premult status of
+   the existing dst_bmp. Unlike
+   _cogl_bitmap_convert_format_and_premult this doesn't create or
+   destroy any objects so it can be called from a worker thread as
+   long as nothing else is using either bitmap at the same time. */
+gboolean
+_cogl_bitmap_convert_into (CoglBitmap *src_bmp,
+                           CoglBitmap *dst_bmp);
+
 void
 _cogl_bitmap_copy_subregion (CoglBitmap *src,
 			     CoglBitmap *dst,
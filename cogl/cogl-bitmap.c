@@ -91,12 +91,27 @@ _cogl_get_format_bpp (CoglPixelFormat format)
     2, /* 4444     */
     2, /* 5551     */
     2, /* YUV      */
-    1  /* G_8      */
+    1, /* G_8      */
+    /* The compressed formats don't have a whole number of bytes per
+       pixel */
+    0, /* ETC1     */
+    0, /* ETC2     */
+    0, /* ETC2_EAC */
+    0, /* DXT1     */
+    0, /* DXT3     */
+    0, /* DXT5     */
+    0  /* ASTC_4x4 */
   };
 
   return bpp_lut [format & COGL_UNORDERED_MASK];
 }
 
+gboolean
+_cogl_pixel_format_is_compressed (CoglPixelFormat format)
+{
+  return (format & COGL_UNORDERED_MASK) >= COGL_PIXEL_FORMAT_RGB_ETC1;
+}
+
 gboolean
 _cogl_bitmap_convert_premult_status (CoglBitmap      *bmp,
                                      CoglPixelFormat  dst_format)
@@ -181,6 +196,46 @@ _cogl_bitmap_convert_format_and_premult (CoglBitmap *bmp,
   return dst_bmp;
 }
 
+gboolean
+_cogl_bitmap_convert_into (CoglBitmap *src_bmp,
+                           CoglBitmap *dst_bmp)
+{
+  CoglPixelFormat src_format = _cogl_bitmap_get_format (src_bmp);
+  CoglPixelFormat dst_format = _cogl_bitmap_get_format (dst_bmp);
+
+  /* The pixels are first converted keeping the premult status of the
+     source and then the destination is fixed up in-place */
+  if ((dst_format & COGL_A_BIT))
+    _cogl_bitmap_set_format (dst_bmp,
+                             (src_format & COGL_PREMULT_BIT) |
+                             (dst_format & COGL_UNPREMULT_MASK));
+
+  if ((src_format & COGL_UNPREMULT_MASK) ==
+      (dst_format & COGL_UNPREMULT_MASK))
+    _cogl_bitmap_copy_subregion (src_bmp, dst_bmp,
+                                 0, 0, /* src_x/y */
+                                 0, 0, /* dst_x/y */
+                                 MIN (_cogl_bitmap_get_width (src_bmp),
+                                      _cogl_bitmap_get_width (dst_bmp)),
+                                 MIN (_cogl_bitmap_get_height (src_bmp),
+                                      _cogl_bitmap_get_height (dst_bmp)));
+  else if (!_cogl_bitmap_fallback_convert_into (src_bmp, dst_bmp))
+    {
+      _cogl_bitmap_set_format (dst_bmp, dst_format);
+      return FALSE;
+    }
+
+  /* See _cogl_bitmap_convert_format_and_premult for why the premult
+     status is only changed when both formats have an alpha channel */
+  if ((src_format & COGL_A_BIT) == COGL_A_BIT &&
+      (dst_format & COGL_A_BIT) == COGL_A_BIT)
+    return _cogl_bitmap_convert_premult_status (dst_bmp, dst_format);
+
+  _cogl_bitmap_set_format (dst_bmp, dst_format);
+
+  return TRUE;
+}
+
 CoglBitmap *
 _cogl_bitmap_copy (CoglBitmap *src_bmp)
 {
@@ -941,6 +941,156 @@ error:
     }
 }
 
+/* The cache is bounded so that an application generating lots of
+ * unique strings can't make it grow indefinitely. If the limit is
+ * reached we simply start again with an empty cache. */
+#define COGL_BLEND_STRING_CACHE_MAX_ENTRIES 64
+
+typedef struct _CoglBlendStringCacheEntry
+{
+  /* The key... */
+  CoglBlendStringContext context;
+  char *string;
+
+  /* The value; if the string failed to compile then n_statements
+   * will be 0 and error will hold a copy of the error */
+  int n_statements;
+  CoglBlendStringStatement statements[2];
+  GError *error;
+} CoglBlendStringCacheEntry;
+
+struct _CoglBlendStringCache
+{
+  GHashTable *table;
+};
+
+/* The cache may be used from any thread that is compiling blend
+ * strings so we protect the hash table with a lock. The parsing
+ * itself doesn't depend on any shared state so it is done without
+ * holding the lock. */
+G_LOCK_DEFINE_STATIC (blend_string_cache);
+
+static unsigned int
+blend_string_cache_entry_hash (const void *data)
+{
+  const CoglBlendStringCacheEntry *entry = data;
+
+  return g_str_hash (entry->string) ^ entry->context;
+}
+
+static gboolean
+blend_string_cache_entry_equal (const void *a, const void *b)
+{
+  const CoglBlendStringCacheEntry *entry0 = a;
+  const CoglBlendStringCacheEntry *entry1 = b;
+
+  return (entry0->context == entry1->context &&
+          strcmp (entry0->string, entry1->string) == 0);
+}
+
+static void
+blend_string_cache_entry_free (void *data)
+{
+  CoglBlendStringCacheEntry *entry = data;
+
+  g_free (entry->string);
+  if (entry->error)
+    g_error_free (entry->error);
+  g_slice_free (CoglBlendStringCacheEntry, entry);
+}
+
+CoglBlendStringCache *
+_cogl_blend_string_cache_new (void)
+{
+  CoglBlendStringCache *cache = g_new (CoglBlendStringCache, 1);
+
+  /* The entries are used as both the key and the value */
+  cache->table = g_hash_table_new_full (blend_string_cache_entry_hash,
+                                        blend_string_cache_entry_equal,
+                                        blend_string_cache_entry_free,
+                                        NULL);
+
+  return cache;
+}
+
+void
+_cogl_blend_string_cache_free (CoglBlendStringCache *cache)
+{
+  g_hash_table_destroy (cache->table);
+  g_free (cache);
+}
+
+static int
+blend_string_cache_entry_get_result (CoglBlendStringCacheEntry *entry,
+                                     CoglBlendStringStatement *statements,
+                                     GError **error)
+{
+  if (entry->n_statements == 0)
+    {
+      if (error && entry->error)
+        *error = g_error_copy (entry->error);
+      return 0;
+    }
+
+  memcpy (statements, entry->statements,
+          sizeof (CoglBlendStringStatement) * entry->n_statements);
+
+  return entry->n_statements;
+}
+
+int
+_cogl_blend_string_cache_compile (CoglBlendStringCache *cache,
+                                  const char *string,
+                                  CoglBlendStringContext context,
+                                  CoglBlendStringStatement *statements,
+                                  GError **error)
+{
+  CoglBlendStringCacheEntry key;
+  CoglBlendStringCacheEntry *entry;
+  int n_statements;
+
+  key.context = context;
+  key.string = (char *) string;
+
+  G_LOCK (blend_string_cache);
+
+  entry = g_hash_table_lookup (cache->table, &key);
+  if (entry)
+    {
+      n_statements =
+        blend_string_cache_entry_get_result (entry, statements, error);
+      G_UNLOCK (blend_string_cache);
+      return n_statements;
+    }
+
+  G_UNLOCK (blend_string_cache);
+
+  entry = g_slice_new (CoglBlendStringCacheEntry);
+  entry->context = context;
+  entry->string = g_strdup (string);
+  entry->error = NULL;
+  entry->n_statements = _cogl_blend_string_compile (string,
+                                                    context,
+                                                    entry->statements,
+                                                    &entry->error);
+
+  n_statements =
+    blend_string_cache_entry_get_result (entry, statements, error);
+
+  G_LOCK (blend_string_cache);
+
+  if (g_hash_table_size (cache->table) >= COGL_BLEND_STRING_CACHE_MAX_ENTRIES)
+    g_hash_table_remove_all (cache->table);
+
+  /* If another thread compiled the same string in the mean time then
+   * this will just replace its entry */
+  g_hash_table_replace (cache->table, entry, entry);
+
+  G_UNLOCK (blend_string_cache);
+
+  return n_statements;
+}
+
 /*
  * INTERNAL TESTING CODE ...
  */
@@ -128,6 +128,28 @@ _cogl_blend_string_compile (const char *string,
                             CoglBlendStringStatement *statements,
                             GError **error);
 
+typedef struct _CoglBlendStringCache CoglBlendStringCache;
+
+CoglBlendStringCache *
+_cogl_blend_string_cache_new (void);
+
+void
+_cogl_blend_string_cache_free (CoglBlendStringCache *cache);
+
+/*
+ * Behaves the same as _cogl_blend_string_compile except that the
+ * result of compiling @string (including any error) is remembered in
+ * @cache so that compiling the same string again doesn't need to
+ * re-parse it. Toolkits tend to use a handful of literal blend
+ * strings over and over so this avoids a lot of redundant parsing.
+ */
+int
+_cogl_blend_string_cache_compile (CoglBlendStringCache *cache,
+                                  const char *string,
+                                  CoglBlendStringContext context,
+                                  CoglBlendStringStatement *statements,
+                                  GError **error);
+
 void
 _cogl_blend_string_split_rgba_statement (CoglBlendStringStatement *statement,
                                          CoglBlendStringStatement *rgb,
@@ -33,6 +33,7 @@
 #include "cogl.h"
 #include "cogl-object-private.h"
 #include "cogl-buffer.h"
+#include "cogl-memory-usage.h"
 
 G_BEGIN_DECLS
 
@@ -96,6 +97,11 @@ struct _CoglBuffer
 
   int                     immutable_ref;
 
+  /* Category that the size of a buffer object is counted under in the
+     memory usage of the context. Buffers emulated with malloc aren't
+     counted */
+  CoglMemoryCategory      memory_category;
+
   guint                   store_created:1;
 };
 
@@ -121,6 +127,10 @@ _cogl_buffer_initialize (CoglBuffer          *buffer,
 void
 _cogl_buffer_fini (CoglBuffer *buffer);
 
+void
+_cogl_buffer_set_memory_category (CoglBuffer *buffer,
+                                  CoglMemoryCategory category);
+
 void *
 _cogl_buffer_bind (CoglBuffer *buffer,
                    CoglBufferBindTarget target);
@@ -128,6 +138,12 @@ _cogl_buffer_bind (CoglBuffer *buffer,
 void
 _cogl_buffer_unbind (CoglBuffer *buffer);
 
+/* Creates an empty store for a buffer object if it doesn't have one
+   yet so that GL can write into it, for example when it is bound as
+   the destination of glReadPixels. The buffer must be bound. */
+void
+_cogl_buffer_ensure_store (CoglBuffer *buffer);
+
 CoglBufferUsageHint
 _cogl_buffer_get_usage_hint (CoglBuffer *buffer);
 
@@ -271,6 +271,7 @@ _cogl_buffer_initialize (CoglBuffer           *buffer,
   buffer->update_hint   = update_hint;
   buffer->data          = NULL;
   buffer->immutable_ref = 0;
+  buffer->memory_category = COGL_MEMORY_CATEGORY_BUFFER;
 
   if (use_malloc)
     {
@@ -288,6 +289,10 @@ _cogl_buffer_initialize (CoglBuffer           *buffer,
 
       GE( ctx, glGenBuffers (1, &buffer->gl_handle) );
       buffer->flags |= COGL_BUFFER_FLAG_BUFFER_OBJECT;
+
+      _cogl_context_update_memory_usage (ctx,
+                                         buffer->memory_category,
+                                         0, size);
     }
 }
 
@@ -300,11 +305,39 @@ _cogl_buffer_fini (CoglBuffer *buffer)
   g_return_if_fail (buffer->immutable_ref == 0);
 
   if (buffer->flags & COGL_BUFFER_FLAG_BUFFER_OBJECT)
-    GE( ctx, glDeleteBuffers (1, &buffer->gl_handle) );
+    {
+      GE( ctx, glDeleteBuffers (1, &buffer->gl_handle) );
+
+      _cogl_context_update_memory_usage (ctx,
+                                         buffer->memory_category,
+                                         buffer->size, 0);
+    }
   else
     g_free (buffer->data);
 }
 
+void
+_cogl_buffer_set_memory_category (CoglBuffer *buffer,
+                                  CoglMemoryCategory category)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  if (buffer->memory_category == category)
+    return;
+
+  if (buffer->flags & COGL_BUFFER_FLAG_BUFFER_OBJECT)
+    {
+      _cogl_context_update_memory_usage (ctx,
+                                         buffer->memory_category,
+                                         buffer->size, 0);
+      _cogl_context_update_memory_usage (ctx,
+                                         category,
+                                         0, buffer->size);
+    }
+
+  buffer->memory_category = category;
+}
+
 GLenum
 _cogl_buffer_access_to_gl_enum (CoglBufferAccess access)
 {
@@ -382,6 +415,37 @@ _cogl_buffer_unbind (CoglBuffer *buffer)
   ctx->current_buffer[buffer->last_target] = NULL;
 }
 
+void
+_cogl_buffer_ensure_store (CoglBuffer *buffer)
+{
+  GLenum gl_enum;
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  /* the buffer should already be bound */
+  g_return_if_fail (ctx->current_buffer[buffer->last_target] == buffer);
+
+  if (!(buffer->flags & COGL_BUFFER_FLAG_BUFFER_OBJECT) ||
+      buffer->store_created)
+    return;
+
+  gl_enum = _cogl_buffer_hints_to_gl_enum (buffer->usage_hint,
+                                           buffer->update_hint);
+
+#ifdef HAVE_COGL_GL
+  /* GL writes into a pack buffer and the application reads it back */
+  if (buffer->last_target == COGL_BUFFER_BIND_TARGET_PIXEL_PACK)
+    gl_enum = GL_STREAM_READ;
+#endif
+
+  GE( ctx, glBufferData (convert_bind_target_to_gl_target
+                         (buffer->last_target),
+                         buffer->size,
+                         NULL,
+                         gl_enum) );
+  buffer->store_created = TRUE;
+}
+
 unsigned int
 cogl_buffer_get_size (CoglBuffer *buffer)
 {
@@ -0,0 +1,124 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef __COGL_COMPRESSED_IMAGE_PRIVATE_H
+#define __COGL_COMPRESSED_IMAGE_PRIVATE_H
+
+#include <glib.h>
+
+#include "cogl-internal.h"
+
+typedef struct
+{
+  int width;
+  int height;
+
+  /* Points into the file data of the image */
+  const guint8 *data;
+  int data_size;
+} CoglCompressedImageLevel;
+
+/* An image loaded from a KTX or DDS container. The data for every
+   mipmap level that was stored in the file is kept compressed */
+typedef struct
+{
+  CoglPixelFormat format;
+  int width;
+  int height;
+
+  int n_levels;
+  CoglCompressedImageLevel *levels;
+
+  guint8 *file_data;
+} CoglCompressedImage;
+
+/*
+ * _cogl_compressed_image_new_from_file:
+ * @filename: the file to load
+ * @error: return location for a #GError
+ *
+ * Loads a compressed image from a KTX or DDS file. If the file isn't
+ * in either of those containers then %NULL is returned without
+ * setting @error so that the caller can try loading it as a regular
+ * image instead.
+ *
+ * Return value: a new #CoglCompressedImage or %NULL
+ */
+CoglCompressedImage *
+_cogl_compressed_image_new_from_file (const char *filename,
+                                      GError **error);
+
+void
+_cogl_compressed_image_free (CoglCompressedImage *image);
+
+/*
+ * _cogl_compressed_format_get_data_size:
+ * @format: a compressed #CoglPixelFormat
+ * @width: width of the image in pixels
+ * @height: height of the image in pixels
+ *
+ * Return value: the number of bytes of compressed data needed for an
+ *   image of the given size
+ */
+int
+_cogl_compressed_format_get_data_size (CoglPixelFormat format,
+                                       int width,
+                                       int height);
+
+/*
+ * _cogl_compressed_format_to_gl:
+ * @format: a compressed #CoglPixelFormat
+ * @out_glintformat: return location for the GL internal format
+ *
+ * Checks whether the driver can use @format directly.
+ *
+ * Return value: %TRUE if the format is supported
+ */
+gboolean
+_cogl_compressed_format_to_gl (CoglPixelFormat format,
+                               GLenum *out_glintformat);
+
+/*
+ * _cogl_compressed_format_decode:
+ * @format: a compressed #CoglPixelFormat
+ * @width: width of the image in pixels
+ * @height: height of the image in pixels
+ * @data: the compressed data
+ * @dst: where to write the decompressed pixels
+ * @dst_rowstride: rowstride of @dst
+ *
+ * Decompresses an image into %COGL_PIXEL_FORMAT_RGBA_8888. This is
+ * used when the driver doesn't support the format. ASTC can't be
+ * decompressed.
+ *
+ * Return value: %TRUE if the image could be decompressed
+ */
+gboolean
+_cogl_compressed_format_decode (CoglPixelFormat format,
+                                int width,
+                                int height,
+                                const guint8 *data,
+                                guint8 *dst,
+                                int dst_rowstride);
+
+#endif /* __COGL_COMPRESSED_IMAGE_PRIVATE_H */
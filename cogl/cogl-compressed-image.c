@@ -0,0 +1,920 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "cogl.h"
+#include "cogl-internal.h"
+#include "cogl-context-private.h"
+#include "cogl-compressed-image-private.h"
+
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+#endif
+
+/* Limits to avoid overflowing the size calculations with a broken
+   file */
+#define COGL_COMPRESSED_IMAGE_MAX_SIZE 65536
+#define COGL_COMPRESSED_IMAGE_MAX_LEVELS 17
+
+typedef struct
+{
+  CoglPixelFormat format;
+  GLenum gl_format;
+  CoglPrivateFeatureFlags feature;
+} CoglCompressedFormatInfo;
+
+static const CoglCompressedFormatInfo
+_cogl_compressed_formats[] =
+  {
+    { COGL_PIXEL_FORMAT_RGB_ETC1, GL_ETC1_RGB8_OES,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC1 },
+    { COGL_PIXEL_FORMAT_RGB_ETC2, GL_COMPRESSED_RGB8_ETC2,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC2 },
+    { COGL_PIXEL_FORMAT_RGBA_ETC2_EAC, GL_COMPRESSED_RGBA8_ETC2_EAC,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC2 },
+    { COGL_PIXEL_FORMAT_RGB_S3TC_DXT1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_S3TC },
+    { COGL_PIXEL_FORMAT_RGBA_S3TC_DXT1, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_S3TC },
+    { COGL_PIXEL_FORMAT_RGBA_S3TC_DXT3, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_S3TC },
+    { COGL_PIXEL_FORMAT_RGBA_S3TC_DXT5, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_S3TC },
+    { COGL_PIXEL_FORMAT_RGBA_ASTC_4x4, GL_COMPRESSED_RGBA_ASTC_4x4_KHR,
+      COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ASTC }
+  };
+
+static const CoglCompressedFormatInfo *
+_cogl_compressed_format_get_info (CoglPixelFormat format)
+{
+  int i;
+
+  for (i = 0; i < G_N_ELEMENTS (_cogl_compressed_formats); i++)
+    if (_cogl_compressed_formats[i].format == format)
+      return _cogl_compressed_formats + i;
+
+  return NULL;
+}
+
+static int
+_cogl_compressed_format_get_block_size (CoglPixelFormat format)
+{
+  switch (format)
+    {
+    case COGL_PIXEL_FORMAT_RGB_ETC1:
+    case COGL_PIXEL_FORMAT_RGB_ETC2:
+    case COGL_PIXEL_FORMAT_RGB_S3TC_DXT1:
+    case COGL_PIXEL_FORMAT_RGBA_S3TC_DXT1:
+      return 8;
+
+    default:
+      return 16;
+    }
+}
+
+int
+_cogl_compressed_format_get_data_size (CoglPixelFormat format,
+                                       int width,
+                                       int height)
+{
+  /* All of the formats use 4x4 blocks */
+  return (((width + 3) / 4) * ((height + 3) / 4) *
+          _cogl_compressed_format_get_block_size (format));
+}
+
+gboolean
+_cogl_compressed_format_to_gl (CoglPixelFormat format,
+                               GLenum *out_glintformat)
+{
+  const CoglCompressedFormatInfo *info;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  info = _cogl_compressed_format_get_info (format);
+
+  if (info == NULL)
+    return FALSE;
+
+  if ((ctx->private_feature_flags & info->feature))
+    {
+      *out_glintformat = info->gl_format;
+      return TRUE;
+    }
+
+  /* ETC2 decoders can also decode ETC1 data */
+  if (format == COGL_PIXEL_FORMAT_RGB_ETC1 &&
+      (ctx->private_feature_flags &
+       COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC2))
+    {
+      *out_glintformat = GL_COMPRESSED_RGB8_ETC2;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* The decoders below each decode one 4x4 block into 16 RGBA pixels
+   stored in rows */
+
+static guint8
+clamp_component (int value)
+{
+  return CLAMP (value, 0, 255);
+}
+
+static int
+sign_extend_3 (int value)
+{
+  return (value & 0x4) ? value - 8 : value;
+}
+
+static void
+expand_565 (unsigned int color,
+            guint8 *rgba)
+{
+  unsigned int r = (color >> 11) & 0x1f;
+  unsigned int g = (color >> 5) & 0x3f;
+  unsigned int b = color & 0x1f;
+
+  rgba[0] = (r << 3) | (r >> 2);
+  rgba[1] = (g << 2) | (g >> 4);
+  rgba[2] = (b << 3) | (b >> 2);
+  rgba[3] = 255;
+}
+
+/* DXT1 blocks can use a three color mode where the fourth color is
+   black. It is only transparent in the RGBA variant of the format */
+static void
+decode_dxt_color_block (const guint8 *src,
+                        gboolean allow_three_colors,
+                        gboolean has_alpha,
+                        guint8 *block)
+{
+  unsigned int c0 = src[0] | (src[1] << 8);
+  unsigned int c1 = src[2] | (src[3] << 8);
+  guint32 indices = (src[4] | (src[5] << 8) | (src[6] << 16) |
+                     ((guint32) src[7] << 24));
+  guint8 colors[4][4];
+  int i;
+
+  expand_565 (c0, colors[0]);
+  expand_565 (c1, colors[1]);
+
+  /* DXT3 and DXT5 always use the four color mode */
+  if (c0 > c1 || !allow_three_colors)
+    {
+      for (i = 0; i < 3; i++)
+        {
+          colors[2][i] = (2 * colors[0][i] + colors[1][i]) / 3;
+          colors[3][i] = (colors[0][i] + 2 * colors[1][i]) / 3;
+        }
+      colors[2][3] = 255;
+      colors[3][3] = 255;
+    }
+  else
+    {
+      for (i = 0; i < 3; i++)
+        colors[2][i] = (colors[0][i] + colors[1][i]) / 2;
+      colors[2][3] = 255;
+      memset (colors[3], 0, 4);
+      if (!has_alpha)
+        colors[3][3] = 255;
+    }
+
+  for (i = 0; i < 16; i++)
+    memcpy (block + i * 4, colors[(indices >> (i * 2)) & 0x3], 4);
+}
+
+static void
+decode_dxt3_alpha_block (const guint8 *src,
+                         guint8 *block)
+{
+  int i;
+
+  for (i = 0; i < 16; i++)
+    block[i * 4 + 3] = ((src[i / 2] >> ((i & 1) * 4)) & 0xf) * 17;
+}
+
+static void
+decode_dxt5_alpha_block (const guint8 *src,
+                         guint8 *block)
+{
+  guint8 alphas[8];
+  guint64 indices = 0;
+  int i;
+
+  alphas[0] = src[0];
+  alphas[1] = src[1];
+
+  if (alphas[0] > alphas[1])
+    for (i = 1; i < 7; i++)
+      alphas[i + 1] = ((7 - i) * alphas[0] + i * alphas[1]) / 7;
+  else
+    {
+      for (i = 1; i < 5; i++)
+        alphas[i + 1] = ((5 - i) * alphas[0] + i * alphas[1]) / 5;
+      alphas[6] = 0;
+      alphas[7] = 255;
+    }
+
+  for (i = 0; i < 6; i++)
+    indices |= (guint64) src[i + 2] << (i * 8);
+
+  for (i = 0; i < 16; i++)
+    block[i * 4 + 3] = alphas[(indices >> (i * 3)) & 0x7];
+}
+
+static const int etc1_modifier_table[8][4] =
+  {
+    { 2, 8, -2, -8 },
+    { 5, 17, -5, -17 },
+    { 9, 29, -9, -29 },
+    { 13, 42, -13, -42 },
+    { 18, 60, -18, -60 },
+    { 24, 80, -24, -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 }
+  };
+
+static const int etc2_distance_table[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+static const int eac_modifier_table[16][8] =
+  {
+    { -3, -6, -9, -15, 2, 5, 8, 14 },
+    { -3, -7, -10, -13, 2, 6, 9, 12 },
+    { -2, -5, -8, -13, 1, 4, 7, 12 },
+    { -2, -4, -6, -13, 1, 3, 5, 12 },
+    { -3, -6, -8, -12, 2, 5, 7, 11 },
+    { -3, -7, -9, -11, 2, 6, 8, 10 },
+    { -4, -7, -8, -11, 3, 6, 7, 10 },
+    { -3, -5, -8, -11, 2, 4, 7, 10 },
+    { -2, -6, -8, -10, 1, 5, 7, 9 },
+    { -2, -5, -8, -10, 1, 4, 7, 9 },
+    { -2, -4, -8, -10, 1, 3, 7, 9 },
+    { -2, -5, -7, -10, 1, 4, 6, 9 },
+    { -3, -4, -7, -10, 2, 3, 6, 9 },
+    { -1, -2, -3, -10, 0, 1, 2, 9 },
+    { -4, -6, -8, -9, 3, 5, 7, 8 },
+    { -3, -5, -7, -9, 2, 4, 6, 8 }
+  };
+
+/* The ETC pixel indices are stored in columns with the most
+   significant bits of all of the pixels in the top half */
+static int
+etc_pixel_index (const guint8 *src,
+                 int x,
+                 int y)
+{
+  guint32 indices = ((src[4] << 24) | (src[5] << 16) |
+                     (src[6] << 8) | src[7]);
+  int bit = x * 4 + y;
+
+  return ((((indices >> (bit + 16)) & 1) << 1) |
+          ((indices >> bit) & 1));
+}
+
+static guint8
+expand_4 (int value)
+{
+  return (value << 4) | value;
+}
+
+static guint8
+expand_5 (int value)
+{
+  return (value << 3) | (value >> 2);
+}
+
+static guint8
+expand_6 (int value)
+{
+  return (value << 2) | (value >> 4);
+}
+
+static guint8
+expand_7 (int value)
+{
+  return (value << 1) | (value >> 6);
+}
+
+/* The individual and differential modes which are all that ETC1
+   has */
+static void
+decode_etc1_block (const guint8 *src,
+                   guint8 *block)
+{
+  guint8 base[2][3];
+  int table[2];
+  gboolean flip = src[3] & 0x1;
+  int x, y, i;
+
+  if ((src[3] & 0x2))
+    for (i = 0; i < 3; i++)
+      {
+        int c1 = src[i] >> 3;
+        int c2 = c1 + sign_extend_3 (src[i] & 0x7);
+
+        base[0][i] = expand_5 (c1);
+        base[1][i] = expand_5 (c2 & 0x1f);
+      }
+  else
+    for (i = 0; i < 3; i++)
+      {
+        base[0][i] = expand_4 (src[i] >> 4);
+        base[1][i] = expand_4 (src[i] & 0xf);
+      }
+
+  table[0] = src[3] >> 5;
+  table[1] = (src[3] >> 2) & 0x7;
+
+  for (y = 0; y < 4; y++)
+    for (x = 0; x < 4; x++)
+      {
+        int sub_block = flip ? y >= 2 : x >= 2;
+        int modifier =
+          etc1_modifier_table[table[sub_block]][etc_pixel_index (src, x, y)];
+        guint8 *p = block + (y * 4 + x) * 4;
+
+        for (i = 0; i < 3; i++)
+          p[i] = clamp_component (base[sub_block][i] + modifier);
+        p[3] = 255;
+      }
+}
+
+/* The ETC2 T and H modes each pick from four colours made from two
+   base colours and a distance */
+static void
+decode_etc2_th_block (const guint8 *src,
+                      gboolean t_mode,
+                      guint8 *block)
+{
+  guint8 base[2][3];
+  guint8 paint[4][3];
+  int distance;
+  int x, y, i;
+
+  if (t_mode)
+    {
+      base[0][0] = expand_4 ((((src[0] >> 3) & 0x3) << 2) | (src[0] & 0x3));
+      base[0][1] = expand_4 (src[1] >> 4);
+      base[0][2] = expand_4 (src[1] & 0xf);
+      base[1][0] = expand_4 (src[2] >> 4);
+      base[1][1] = expand_4 (src[2] & 0xf);
+      base[1][2] = expand_4 (src[3] >> 4);
+
+      distance = etc2_distance_table[((src[3] >> 1) & 0x6) | (src[3] & 0x1)];
+
+      for (i = 0; i < 3; i++)
+        {
+          paint[0][i] = base[0][i];
+          paint[1][i] = clamp_component (base[1][i] + distance);
+          paint[2][i] = base[1][i];
+          paint[3][i] = clamp_component (base[1][i] - distance);
+        }
+    }
+  else
+    {
+      guint32 value1, value2;
+
+      base[0][0] = expand_4 ((src[0] >> 3) & 0xf);
+      base[0][1] = expand_4 (((src[0] & 0x7) << 1) | ((src[1] >> 4) & 0x1));
+      base[0][2] = expand_4 ((src[1] & 0x8) |
+                             ((src[1] & 0x3) << 1) |
+                             ((src[2] >> 7) & 0x1));
+      base[1][0] = expand_4 ((src[2] >> 3) & 0xf);
+      base[1][1] = expand_4 (((src[2] & 0x7) << 1) | ((src[3] >> 7) & 0x1));
+      base[1][2] = expand_4 ((src[3] >> 3) & 0xf);
+
+      /* The order of the base colours gives one more bit of the
+         distance index */
+      value1 = (base[0][0] << 16) | (base[0][1] << 8) | base[0][2];
+      value2 = (base[1][0] << 16) | (base[1][1] << 8) | base[1][2];
+
+      distance = etc2_distance_table[(src[3] & 0x4) |
+                                     ((src[3] & 0x1) << 1) |
+                                     (value1 >= value2)];
+
+      for (i = 0; i < 3; i++)
+        {
+          paint[0][i] = clamp_component (base[0][i] + distance);
+          paint[1][i] = clamp_component (base[0][i] - distance);
+          paint[2][i] = clamp_component (base[1][i] + distance);
+          paint[3][i] = clamp_component (base[1][i] - distance);
+        }
+    }
+
+  for (y = 0; y < 4; y++)
+    for (x = 0; x < 4; x++)
+      {
+        guint8 *p = block + (y * 4 + x) * 4;
+
+        memcpy (p, paint[etc_pixel_index (src, x, y)], 3);
+        p[3] = 255;
+      }
+}
+
+/* The ETC2 planar mode interpolates between three colours */
+static void
+decode_etc2_planar_block (const guint8 *src,
+                          guint8 *block)
+{
+  int o[3], h[3], v[3];
+  int x, y, i;
+
+  o[0] = expand_6 ((src[0] >> 1) & 0x3f);
+  o[1] = expand_7 (((src[0] & 0x1) << 6) | ((src[1] >> 1) & 0x3f));
+  o[2] = expand_6 (((src[1] & 0x1) << 5) |
+                   (src[2] & 0x18) |
+                   ((src[2] & 0x3) << 1) |
+                   ((src[3] >> 7) & 0x1));
+  h[0] = expand_6 (((src[3] & 0x7c) >> 1) | (src[3] & 0x1));
+  h[1] = expand_7 ((src[4] >> 1) & 0x7f);
+  h[2] = expand_6 (((src[4] & 0x1) << 5) | ((src[5] >> 3) & 0x1f));
+  v[0] = expand_6 (((src[5] & 0x7) << 3) | ((src[6] >> 5) & 0x7));
+  v[1] = expand_7 (((src[6] & 0x1f) << 2) | ((src[7] >> 6) & 0x3));
+  v[2] = expand_6 (src[7] & 0x3f);
+
+  for (y = 0; y < 4; y++)
+    for (x = 0; x < 4; x++)
+      {
+        guint8 *p = block + (y * 4 + x) * 4;
+
+        for (i = 0; i < 3; i++)
+          p[i] = clamp_component ((x * (h[i] - o[i]) +
+                                   y * (v[i] - o[i]) +
+                                   4 * o[i] + 2) >> 2);
+        p[3] = 255;
+      }
+}
+
+static void
+decode_etc2_rgb_block (const guint8 *src,
+                       guint8 *block)
+{
+  /* ETC2 reuses differential blocks where one of the second base
+     colour components would overflow for its new modes */
+  if ((src[3] & 0x2))
+    {
+      int r = (src[0] >> 3) + sign_extend_3 (src[0] & 0x7);
+      int g = (src[1] >> 3) + sign_extend_3 (src[1] & 0x7);
+      int b = (src[2] >> 3) + sign_extend_3 (src[2] & 0x7);
+
+      if (r < 0 || r > 31)
+        {
+          decode_etc2_th_block (src, TRUE, block);
+          return;
+        }
+      if (g < 0 || g > 31)
+        {
+          decode_etc2_th_block (src, FALSE, block);
+          return;
+        }
+      if (b < 0 || b > 31)
+        {
+          decode_etc2_planar_block (src, block);
+          return;
+        }
+    }
+
+  decode_etc1_block (src, block);
+}
+
+static void
+decode_eac_alpha_block (const guint8 *src,
+                        guint8 *block)
+{
+  int base = src[0];
+  int multiplier = src[1] >> 4;
+  const int *modifiers = eac_modifier_table[src[1] & 0xf];
+  guint64 indices = 0;
+  int x, y, i;
+
+  for (i = 2; i < 8; i++)
+    indices = (indices << 8) | src[i];
+
+  /* The indices are stored in columns starting from the most
+     significant bits */
+  for (y = 0; y < 4; y++)
+    for (x = 0; x < 4; x++)
+      {
+        int bit = ((3 - y) + (3 - x) * 4) * 3;
+        int modifier = modifiers[(indices >> bit) & 0x7];
+
+        block[(y * 4 + x) * 4 + 3] =
+          clamp_component (base + modifier * multiplier);
+      }
+}
+
+gboolean
+_cogl_compressed_format_decode (CoglPixelFormat format,
+                                int width,
+                                int height,
+                                const guint8 *data,
+                                guint8 *dst,
+                                int dst_rowstride)
+{
+  int block_size = _cogl_compressed_format_get_block_size (format);
+  guint8 block[4 * 4 * 4];
+  int bx, by, y;
+
+  for (by = 0; by < height; by += 4)
+    for (bx = 0; bx < width; bx += 4)
+      {
+        switch (format)
+          {
+          case COGL_PIXEL_FORMAT_RGB_ETC1:
+          case COGL_PIXEL_FORMAT_RGB_ETC2:
+            decode_etc2_rgb_block (data, block);
+            break;
+
+          case COGL_PIXEL_FORMAT_RGBA_ETC2_EAC:
+            decode_etc2_rgb_block (data + 8, block);
+            decode_eac_alpha_block (data, block);
+            break;
+
+          case COGL_PIXEL_FORMAT_RGB_S3TC_DXT1:
+            decode_dxt_color_block (data, TRUE, FALSE, block);
+            break;
+
+          case COGL_PIXEL_FORMAT_RGBA_S3TC_DXT1:
+            decode_dxt_color_block (data, TRUE, TRUE, block);
+            break;
+
+          case COGL_PIXEL_FORMAT_RGBA_S3TC_DXT3:
+            decode_dxt_color_block (data + 8, FALSE, FALSE, block);
+            decode_dxt3_alpha_block (data, block);
+            break;
+
+          case COGL_PIXEL_FORMAT_RGBA_S3TC_DXT5:
+            decode_dxt_color_block (data + 8, FALSE, FALSE, block);
+            decode_dxt5_alpha_block (data, block);
+            break;
+
+          default:
+            /* ASTC is too complicated to be worth decoding on the
+               CPU */
+            return FALSE;
+          }
+
+        data += block_size;
+
+        /* Blocks at the right and bottom edges may hang over the
+           image */
+        for (y = 0; y < 4 && by + y < height; y++)
+          memcpy (dst + (by + y) * dst_rowstride + bx * 4,
+                  block + y * 4 * 4,
+                  MIN (4, width - bx) * 4);
+      }
+
+  return TRUE;
+}
+
+static const guint8
+ktx_identifier[12] =
+  { 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+static guint32
+read_uint32_le (const guint8 *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static gboolean
+_cogl_compressed_image_check_size (CoglCompressedImage *image,
+                                   guint32 width,
+                                   guint32 height,
+                                   guint32 n_levels,
+                                   GError **error)
+{
+  if (width < 1 || width > COGL_COMPRESSED_IMAGE_MAX_SIZE ||
+      height < 1 || height > COGL_COMPRESSED_IMAGE_MAX_SIZE ||
+      n_levels > COGL_COMPRESSED_IMAGE_MAX_LEVELS)
+    {
+      g_set_error (error, COGL_BITMAP_ERROR,
+                   COGL_BITMAP_ERROR_CORRUPT_IMAGE,
+                   "Invalid image size");
+      return FALSE;
+    }
+
+  image->width = width;
+  image->height = height;
+  image->n_levels = MAX (n_levels, 1);
+  image->levels = g_new0 (CoglCompressedImageLevel, image->n_levels);
+
+  return TRUE;
+}
+
+static void
+_cogl_compressed_image_set_level (CoglCompressedImage *image,
+                                  int level,
+                                  gsize offset,
+                                  int data_size)
+{
+  CoglCompressedImageLevel *l = image->levels + level;
+
+  l->width = MAX (image->width >> level, 1);
+  l->height = MAX (image->height >> level, 1);
+  l->data = image->file_data + offset;
+  l->data_size = data_size;
+}
+
+static gboolean
+_cogl_compressed_image_load_ktx (CoglCompressedImage *image,
+                                 gsize length,
+                                 GError **error)
+{
+  guint32 header[13];
+  guint32 gl_type, gl_internal_format;
+  guint32 depth, n_array_elements, n_faces, n_levels;
+  gsize offset;
+  int i;
+
+  if (length < sizeof (ktx_identifier) + sizeof (header))
+    goto corrupt;
+
+  for (i = 0; i < G_N_ELEMENTS (header); i++)
+    header[i] = read_uint32_le (image->file_data +
+                                sizeof (ktx_identifier) + i * 4);
+
+  /* The first field tells us the endianness of the file */
+  if (header[0] == 0x01020304)
+    for (i = 0; i < G_N_ELEMENTS (header); i++)
+      header[i] = GUINT32_SWAP_LE_BE (header[i]);
+  else if (header[0] != 0x04030201)
+    goto corrupt;
+
+  gl_type = header[1];
+  gl_internal_format = header[4];
+  depth = header[8];
+  n_array_elements = header[9];
+  n_faces = header[10];
+  n_levels = header[11];
+
+  /* A GL type of 0 means the data is compressed */
+  image->format = COGL_PIXEL_FORMAT_ANY;
+  if (gl_type == 0)
+    for (i = 0; i < G_N_ELEMENTS (_cogl_compressed_formats); i++)
+      if (_cogl_compressed_formats[i].gl_format == gl_internal_format)
+        image->format = _cogl_compressed_formats[i].format;
+
+  if (image->format == COGL_PIXEL_FORMAT_ANY)
+    {
+      g_set_error (error, COGL_BITMAP_ERROR,
+                   COGL_BITMAP_ERROR_UNKNOWN_TYPE,
+                   "Unsupported KTX texture format 0x%x",
+                   gl_internal_format);
+      return FALSE;
+    }
+
+  if (depth > 1 || n_array_elements > 0 || n_faces != 1)
+    {
+      g_set_error (error, COGL_BITMAP_ERROR,
+                   COGL_BITMAP_ERROR_UNKNOWN_TYPE,
+                   "Only 2D KTX textures are supported");
+      return FALSE;
+    }
+
+  if (!_cogl_compressed_image_check_size (image,
+                                          header[6], header[7],
+                                          n_levels,
+                                          error))
+    return FALSE;
+
+  /* Skip the key/value data */
+  offset = sizeof (ktx_identifier) + sizeof (header);
+  if (header[12] > length - offset)
+    goto corrupt;
+  offset += header[12];
+
+  for (i = 0; i < image->n_levels; i++)
+    {
+      guint32 image_size;
+      int expected_size;
+
+      if (length - offset < 4)
+        goto corrupt;
+
+      image_size = read_uint32_le (image->file_data + offset);
+      if (header[0] == 0x01020304)
+        image_size = GUINT32_SWAP_LE_BE (image_size);
+      offset += 4;
+
+      _cogl_compressed_image_set_level (image, i, offset, image_size);
+
+      expected_size =
+        _cogl_compressed_format_get_data_size (image->format,
+                                               image->levels[i].width,
+                                               image->levels[i].height);
+      if (image_size < expected_size || image_size > length - offset)
+        goto corrupt;
+
+      /* Each level is padded to four bytes */
+      offset += (image_size + 3) & ~3;
+      offset = MIN (offset, length);
+    }
+
+  return TRUE;
+
+ corrupt:
+  g_set_error (error, COGL_BITMAP_ERROR,
+               COGL_BITMAP_ERROR_CORRUPT_IMAGE,
+               "Invalid KTX file");
+  return FALSE;
+}
+
+/* Offsets of the fields we need in a DDS file, including the four
+   byte magic number */
+#define DDS_HEADER_SIZE 128
+#define DDS_FLAGS_OFFSET 8
+#define DDS_HEIGHT_OFFSET 12
+#define DDS_WIDTH_OFFSET 16
+#define DDS_MIPMAP_COUNT_OFFSET 28
+#define DDS_PIXEL_FORMAT_FLAGS_OFFSET 80
+#define DDS_FOURCC_OFFSET 84
+
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDPF_FOURCC 0x4
+
+static gboolean
+_cogl_compressed_image_load_dds (CoglCompressedImage *image,
+                                 gsize length,
+                                 GError **error)
+{
+  const guint8 *data = image->file_data;
+  const guint8 *fourcc;
+  guint32 n_levels = 1;
+  gsize offset;
+  int i;
+
+  if (length < DDS_HEADER_SIZE)
+    goto corrupt;
+
+  fourcc = data + DDS_FOURCC_OFFSET;
+
+  if (!(read_uint32_le (data + DDS_PIXEL_FORMAT_FLAGS_OFFSET) & DDPF_FOURCC))
+    image->format = COGL_PIXEL_FORMAT_ANY;
+  else if (!memcmp (fourcc, "DXT1", 4))
+    image->format = COGL_PIXEL_FORMAT_RGBA_S3TC_DXT1;
+  else if (!memcmp (fourcc, "DXT3", 4))
+    image->format = COGL_PIXEL_FORMAT_RGBA_S3TC_DXT3;
+  else if (!memcmp (fourcc, "DXT5", 4))
+    image->format = COGL_PIXEL_FORMAT_RGBA_S3TC_DXT5;
+  else
+    image->format = COGL_PIXEL_FORMAT_ANY;
+
+  if (image->format == COGL_PIXEL_FORMAT_ANY)
+    {
+      g_set_error (error, COGL_BITMAP_ERROR,
+                   COGL_BITMAP_ERROR_UNKNOWN_TYPE,
+                   "Only DXT1, DXT3 and DXT5 DDS files are supported");
+      return FALSE;
+    }
+
+  if ((read_uint32_le (data + DDS_FLAGS_OFFSET) & DDSD_MIPMAPCOUNT))
+    n_levels = read_uint32_le (data + DDS_MIPMAP_COUNT_OFFSET);
+
+  if (!_cogl_compressed_image_check_size (image,
+                                          read_uint32_le (data +
+                                                          DDS_WIDTH_OFFSET),
+                                          read_uint32_le (data +
+                                                          DDS_HEIGHT_OFFSET),
+                                          n_levels,
+                                          error))
+    return FALSE;
+
+  /* The levels follow the header without any padding */
+  offset = DDS_HEADER_SIZE;
+
+  for (i = 0; i < image->n_levels; i++)
+    {
+      int size;
+
+      _cogl_compressed_image_set_level (image, i, offset, 0);
+
+      size = _cogl_compressed_format_get_data_size (image->format,
+                                                    image->levels[i].width,
+                                                    image->levels[i].height);
+      if (size > length - offset)
+        goto corrupt;
+
+      image->levels[i].data_size = size;
+      offset += size;
+    }
+
+  return TRUE;
+
+ corrupt:
+  g_set_error (error, COGL_BITMAP_ERROR,
+               COGL_BITMAP_ERROR_CORRUPT_IMAGE,
+               "Invalid DDS file");
+  return FALSE;
+}
+
+CoglCompressedImage *
+_cogl_compressed_image_new_from_file (const char *filename,
+                                      GError **error)
+{
+  CoglCompressedImage *image;
+  guint8 magic[sizeof (ktx_identifier)];
+  gboolean is_ktx, is_dds;
+  gboolean ret;
+  size_t n_read;
+  gsize length;
+  FILE *file;
+
+  /* Only peek at the start of the file so that regular images don't
+     need to be read twice. Any error opening the file will be
+     reported by the regular image loader */
+  if ((file = g_fopen (filename, "rb")) == NULL)
+    return NULL;
+  n_read = fread (magic, 1, sizeof (magic), file);
+  fclose (file);
+
+  is_ktx = (n_read == sizeof (magic) &&
+            !memcmp (magic, ktx_identifier, sizeof (ktx_identifier)));
+  is_dds = n_read >= 4 && !memcmp (magic, "DDS ", 4);
+
+  if (!is_ktx && !is_dds)
+    return NULL;
+
+  image = g_slice_new0 (CoglCompressedImage);
+
+  if (!g_file_get_contents (filename,
+                            (char **) &image->file_data,
+                            &length,
+                            error))
+    {
+      _cogl_compressed_image_free (image);
+      return NULL;
+    }
+
+  if (is_ktx)
+    ret = _cogl_compressed_image_load_ktx (image, length, error);
+  else
+    ret = _cogl_compressed_image_load_dds (image, length, error);
+
+  if (!ret)
+    {
+      _cogl_compressed_image_free (image);
+      return NULL;
+    }
+
+  return image;
+}
+
+void
+_cogl_compressed_image_free (CoglCompressedImage *image)
+{
+  g_free (image->levels);
+  g_free (image->file_data);
+  g_slice_free (CoglCompressedImage, image);
+}
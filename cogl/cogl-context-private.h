@@ -26,6 +26,7 @@
 
 #include "cogl-internal.h"
 #include "cogl-context.h"
+#include "cogl-memory-usage.h"
 #include "cogl-winsys-private.h"
 #include "cogl-flags.h"
 
@@ -43,6 +44,7 @@
 #include "cogl-atlas.h"
 #include "cogl-texture-driver.h"
 #include "cogl-pipeline-cache.h"
+#include "cogl-blend-string.h"
 
 typedef struct
 {
@@ -51,6 +53,8 @@ typedef struct
   GLubyte c[4];
 } CoglTextureGLVertex;
 
+#define COGL_MEMORY_N_CATEGORIES (COGL_MEMORY_CATEGORY_BUFFER + 1)
+
 struct _CoglContext
 {
   CoglObject _parent;
@@ -94,6 +98,14 @@ struct _CoglContext
   GArray           *texture_units;
   int               active_texture_unit;
 
+  /* Maps the unit index of each layer of the last flushed pipeline to
+     the texture unit its texture was actually bound to */
+  GArray           *texture_unit_map;
+  /* The number of binds and active texture unit switches that
+     remapping has saved in the current frame */
+  unsigned int      texture_binds_saved;
+  unsigned int      active_texture_switches_saved;
+
   CoglPipelineFogState legacy_fog_state;
 
   /* Pipelines */
@@ -108,6 +120,9 @@ struct _CoglContext
 
   CoglPipelineCache *pipeline_cache;
 
+  /* Compiled blend and texture combine strings */
+  CoglBlendStringCache *blend_string_cache;
+
   /* Textures */
   CoglHandle        default_gl_texture_2d_tex;
   CoglHandle        default_gl_texture_rect_tex;
@@ -183,6 +198,19 @@ struct _CoglContext
   GSList           *atlases;
   GHookList         atlas_reorganize_callbacks;
 
+  /* Pool of threads used for work that doesn't need the GL context
+     such as converting pixel data. It is created the first time
+     _cogl_context_push_work is called */
+  GThreadPool      *worker_pool;
+
+  /* Estimated number of bytes of GPU memory allocated for each
+     CoglMemoryCategory */
+  gsize             memory_usage[COGL_MEMORY_N_CATEGORIES];
+  gsize             total_memory_usage;
+  gsize             memory_budget;
+  CoglMemoryBudgetCallback memory_budget_callback;
+  void             *memory_budget_user_data;
+
   /* This debugging variable is used to pick a colour for visually
      displaying the quad batches. It needs to be global so that it can
      be reset by cogl_clear. It needs to be reset to increase the
@@ -241,6 +269,14 @@ struct _CoglContext
   GByteArray       *buffer_map_fallback_array;
   gboolean          buffer_map_fallback_in_use;
 
+  /* Used by the GLES texture driver to pack a sub-region of a bitmap
+     before uploading it when the driver can't upload from the middle
+     of a larger image. It is kept around so that updating lots of
+     small regions, such as glyphs in an atlas, doesn't need an
+     allocation each time. Large regions don't use it so it stays
+     small */
+  GByteArray       *texture_upload_scratch_array;
+
   CoglWinsysRectangleState rectangle_state;
 
   /* FIXME: remove these when we remove the last xlib based clutter
@@ -298,6 +334,34 @@ gboolean
 _cogl_context_update_features (CoglContext *context,
                                GError **error);
 
+typedef void (* CoglWorkFunc) (void *user_data);
+
+/* Runs @func on one of the worker threads of the context. If the
+ * context doesn't have worker threads then it is run immediately
+ * instead. The function must not use the GL context or create any
+ * Cogl objects. Any work that is still pending when the context is
+ * destroyed is finished first. */
+void
+_cogl_context_push_work (CoglContext *context,
+                         CoglWorkFunc func,
+                         void *user_data);
+
+/* Returns whether _cogl_context_push_work will really use another
+ * thread. This is FALSE if GLib threads aren't available or the
+ * disable-threads debug option is set */
+gboolean
+_cogl_context_has_worker_threads (CoglContext *context);
+
+/* Records that an allocation in @category has changed size from
+ * @old_size to @new_size bytes. Allocations are added by passing an
+ * @old_size of 0 and freed by passing a @new_size of 0. This calls
+ * the budget callback if the total usage goes over the budget. */
+void
+_cogl_context_update_memory_usage (CoglContext *context,
+                                   CoglMemoryCategory category,
+                                   gsize old_size,
+                                   gsize new_size);
+
 /* Obtains the context and returns retval if NULL */
 #define _COGL_GET_CONTEXT(ctxvar, retval) \
 CoglContext *ctxvar = _cogl_context_get_default (); \
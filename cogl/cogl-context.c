@@ -54,6 +54,9 @@
 #define GL_POINT_SPRITE 0x8861
 #endif
 
+/* Maximum number of threads used by _cogl_context_push_work */
+#define COGL_CONTEXT_N_WORKER_THREADS 2
+
 #ifdef HAVE_COGL_GL
 extern const CoglTextureDriver _cogl_texture_driver_gl;
 #endif
@@ -156,6 +159,13 @@ cogl_context_new (CoglDisplay *display,
 
   context->rectangle_state = COGL_WINSYS_RECTANGLE_STATE_UNKNOWN;
 
+  /* This needs to be initialised before any textures are created */
+  memset (context->memory_usage, 0, sizeof (context->memory_usage));
+  context->total_memory_usage = 0;
+  context->memory_budget = 0;
+  context->memory_budget_callback = NULL;
+  context->memory_budget_user_data = NULL;
+
   memset (context->winsys_features, 0, sizeof (context->winsys_features));
 
   if (!display)
@@ -226,6 +236,9 @@ cogl_context_new (CoglDisplay *display,
 
   context->texture_units =
     g_array_new (FALSE, FALSE, sizeof (CoglTextureUnit));
+  context->texture_unit_map = g_array_new (FALSE, FALSE, sizeof (int));
+  context->texture_binds_saved = 0;
+  context->active_texture_switches_saved = 0;
 
   /* See cogl-pipeline.c for more details about why we leave texture unit 1
    * active by default... */
@@ -293,6 +306,8 @@ cogl_context_new (CoglDisplay *display,
 
   context->pipeline_cache = cogl_pipeline_cache_new ();
 
+  context->blend_string_cache = _cogl_blend_string_cache_new ();
+
   for (i = 0; i < COGL_BUFFER_BIND_TARGET_COUNT; i++)
     context->current_buffer[i] = NULL;
 
@@ -372,9 +387,13 @@ cogl_context_new (CoglDisplay *display,
   context->atlases = NULL;
   g_hook_list_init (&context->atlas_reorganize_callbacks, sizeof (GHook));
 
+  context->worker_pool = NULL;
+
   _context->buffer_map_fallback_array = g_byte_array_new ();
   _context->buffer_map_fallback_in_use = FALSE;
 
+  _context->texture_upload_scratch_array = g_byte_array_new ();
+
   /* As far as I can tell, GL_POINT_SPRITE doesn't have any effect
      unless GL_COORD_REPLACE is enabled for an individual
      layer. Therefore it seems like it should be ok to just leave it
@@ -394,9 +413,15 @@ _cogl_context_free (CoglContext *context)
 {
   const CoglWinsysVtable *winsys = _cogl_context_get_winsys (context);
 
+  /* Let any pending work finish before anything it might be using is
+     destroyed */
+  if (context->worker_pool)
+    g_thread_pool_free (context->worker_pool, FALSE, TRUE);
+
   winsys->context_deinit (context);
 
   _cogl_destroy_texture_units ();
+  g_array_free (context->texture_unit_map, TRUE);
 
   if (context->window_buffer)
     {
@@ -474,13 +499,131 @@ _cogl_context_free (CoglContext *context)
 
   cogl_pipeline_cache_free (context->pipeline_cache);
 
+  _cogl_blend_string_cache_free (context->blend_string_cache);
+
   g_byte_array_free (context->buffer_map_fallback_array, TRUE);
+  g_byte_array_free (context->texture_upload_scratch_array, TRUE);
 
   cogl_object_unref (context->display);
 
   g_free (context);
 }
 
+typedef struct
+{
+  CoglWorkFunc func;
+  void *user_data;
+} CoglWorkItem;
+
+static void
+_cogl_context_run_work_cb (void *data,
+                           void *user_data)
+{
+  CoglWorkItem *item = data;
+
+  item->func (item->user_data);
+
+  g_slice_free (CoglWorkItem, item);
+}
+
+gboolean
+_cogl_context_has_worker_threads (CoglContext *context)
+{
+  return (g_thread_supported () &&
+          !COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_THREADS));
+}
+
+void
+_cogl_context_push_work (CoglContext *context,
+                         CoglWorkFunc func,
+                         void *user_data)
+{
+  CoglWorkItem *item;
+
+  if (!_cogl_context_has_worker_threads (context))
+    {
+      func (user_data);
+      return;
+    }
+
+  if (context->worker_pool == NULL)
+    context->worker_pool = g_thread_pool_new (_cogl_context_run_work_cb,
+                                              NULL,
+                                              COGL_CONTEXT_N_WORKER_THREADS,
+                                              FALSE,
+                                              NULL);
+
+  item = g_slice_new (CoglWorkItem);
+  item->func = func;
+  item->user_data = user_data;
+
+  g_thread_pool_push (context->worker_pool, item, NULL);
+}
+
+void
+_cogl_context_update_memory_usage (CoglContext *context,
+                                   CoglMemoryCategory category,
+                                   gsize old_size,
+                                   gsize new_size)
+{
+  gsize old_total = context->total_memory_usage;
+
+  context->memory_usage[category] =
+    context->memory_usage[category] - old_size + new_size;
+  context->total_memory_usage = old_total - old_size + new_size;
+
+  /* The callback is only called when the usage crosses the budget so
+     that it isn't called for every allocation while the application
+     is trying to free things */
+  if (context->memory_budget > 0 &&
+      context->memory_budget_callback &&
+      old_total <= context->memory_budget &&
+      context->total_memory_usage > context->memory_budget)
+    context->memory_budget_callback (context,
+                                     context->total_memory_usage,
+                                     context->memory_budget,
+                                     context->memory_budget_user_data);
+}
+
+gsize
+cogl_context_get_memory_usage (CoglContext *context,
+                               CoglMemoryCategory category)
+{
+  g_return_val_if_fail (cogl_is_context (context), 0);
+  g_return_val_if_fail (category < COGL_MEMORY_N_CATEGORIES, 0);
+
+  return context->memory_usage[category];
+}
+
+gsize
+cogl_context_get_total_memory_usage (CoglContext *context)
+{
+  g_return_val_if_fail (cogl_is_context (context), 0);
+
+  return context->total_memory_usage;
+}
+
+void
+cogl_context_set_memory_budget (CoglContext *context,
+                                gsize budget,
+                                CoglMemoryBudgetCallback callback,
+                                void *user_data)
+{
+  g_return_if_fail (cogl_is_context (context));
+
+  context->memory_budget = budget;
+  context->memory_budget_callback = callback;
+  context->memory_budget_user_data = user_data;
+}
+
+gsize
+cogl_context_get_memory_budget (CoglContext *context)
+{
+  g_return_val_if_fail (cogl_is_context (context), 0);
+
+  return context->memory_budget;
+}
+
 CoglContext *
 _cogl_context_get_default (void)
 {
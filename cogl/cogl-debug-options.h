@@ -107,6 +107,12 @@ OPT (DUMP_ATLAS_IMAGE,
      "dump-atlas-image",
      "Dump atlas images",
      "Dump texture atlas changes to an image file")
+OPT (RECTANGLE_MAP_TRACE,
+     "Cogl Specialist",
+     "trace-rectangle-maps",
+     "Trace rectangle maps",
+     "Write the rectangles added to and removed from each atlas map "
+     "to a file that can be replayed with test-rectangle-map")
 OPT (DISABLE_ATLAS,
      "Root Cause",
      "disable-atlas",
@@ -180,6 +186,12 @@ OPT (DISABLE_FAST_READ_PIXEL,
      "Disable read pixel optimization",
      "Disable optimization for reading 1px for simple "
      "scenes of opaque rectangles")
+OPT (DISABLE_THREADS,
+     "Root Cause",
+     "disable-threads",
+     "Disable worker threads",
+     "Does the work that would be given to worker threads on the main "
+     "thread instead and uploads sliced textures without them")
 OPT (CLIPPING,
      "Cogl Tracing",
      "clipping",
@@ -66,6 +66,8 @@ typedef enum {
   COGL_DEBUG_DISABLE_FAST_READ_PIXEL,
   COGL_DEBUG_CLIPPING,
   COGL_DEBUG_WINSYS,
+  COGL_DEBUG_RECTANGLE_MAP_TRACE,
+  COGL_DEBUG_DISABLE_THREADS,
 
   COGL_DEBUG_N_FLAGS
 } CoglDebugFlags;
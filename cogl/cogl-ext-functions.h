@@ -526,6 +526,22 @@ COGL_EXT_FUNCTION (GLint, glGetAttribLocation,
 
 COGL_EXT_END ()
 
+COGL_EXT_BEGIN (texture_compression, 1, 3,
+                COGL_EXT_IN_GLES |
+                COGL_EXT_IN_GLES2,
+                "ARB\0",
+                "texture_compression\0")
+COGL_EXT_FUNCTION (void, glCompressedTexImage2D,
+                   (GLenum                target,
+                    GLint                 level,
+                    GLenum                internalformat,
+                    GLsizei               width,
+                    GLsizei               height,
+                    GLint                 border,
+                    GLsizei               imageSize,
+                    const GLvoid         *data))
+COGL_EXT_END ()
+
 COGL_EXT_BEGIN (vbos, 1, 5,
                 COGL_EXT_IN_GLES |
                 COGL_EXT_IN_GLES2,
@@ -649,3 +665,20 @@ COGL_EXT_FUNCTION (void, glEGLImageTargetRenderbufferStorage,
                    (GLenum           target,
                     GLeglImageOES    image))
 COGL_EXT_END ()
+
+/* GLsync is declared as a pointer here so that this doesn't depend on
+   the GL headers being new enough to have the type */
+COGL_EXT_BEGIN (sync, 3, 2,
+                0, /* not in either GLES */
+                "ARB:\0",
+                "sync\0")
+COGL_EXT_FUNCTION (void *, glFenceSync,
+                   (GLenum                condition,
+                    GLbitfield            flags))
+COGL_EXT_FUNCTION (GLenum, glClientWaitSync,
+                   (void                 *sync,
+                    GLbitfield            flags,
+                    guint64               timeout))
+COGL_EXT_FUNCTION (void, glDeleteSync,
+                   (void                 *sync))
+COGL_EXT_END ()
@@ -108,6 +108,8 @@ typedef struct _CoglOffscreen
   CoglFramebuffer  _parent;
   GLuint          fbo_handle;
   GSList          *renderbuffers;
+  /* Estimated size of the depth and stencil renderbuffers */
+  gsize           renderbuffer_memory_size;
   CoglHandle      texture;
 } CoglOffscreen;
 
@@ -40,6 +40,7 @@
 #include "cogl-journal-private.h"
 #include "cogl-winsys-private.h"
 #include "cogl-pipeline-state-private.h"
+#include "cogl-pipeline-opengl-private.h"
 
 #ifndef GL_FRAMEBUFFER
 #define GL_FRAMEBUFFER		0x8D40
@@ -700,6 +701,7 @@ try_creating_fbo (CoglOffscreen *offscreen,
   GLenum tex_gl_target;
   GLuint fbo_gl_handle;
   GLenum status;
+  int renderbuffer_bpp = 0;
 
   _COGL_GET_CONTEXT (ctx, FALSE);
 
@@ -747,6 +749,7 @@ try_creating_fbo (CoglOffscreen *offscreen,
       offscreen->renderbuffers =
         g_slist_prepend (offscreen->renderbuffers,
                          GUINT_TO_POINTER (gl_depth_stencil_handle));
+      renderbuffer_bpp += 4;
     }
 
   if (flags & _TRY_DEPTH)
@@ -765,6 +768,7 @@ try_creating_fbo (CoglOffscreen *offscreen,
       offscreen->renderbuffers =
         g_slist_prepend (offscreen->renderbuffers,
                          GUINT_TO_POINTER (gl_depth_handle));
+      renderbuffer_bpp += 2;
     }
 
   if (flags & _TRY_STENCIL)
@@ -781,6 +785,7 @@ try_creating_fbo (CoglOffscreen *offscreen,
       offscreen->renderbuffers =
         g_slist_prepend (offscreen->renderbuffers,
                          GUINT_TO_POINTER (gl_stencil_handle));
+      renderbuffer_bpp += 1;
     }
 
   /* Make sure it's complete */
@@ -804,6 +809,10 @@ try_creating_fbo (CoglOffscreen *offscreen,
       return FALSE;
     }
 
+  offscreen->renderbuffer_memory_size = ((gsize) data->level_width *
+                                         data->level_height *
+                                         renderbuffer_bpp);
+
   return TRUE;
 }
 
@@ -915,6 +924,11 @@ _cogl_offscreen_new_to_texture_full (CoglHandle texhandle,
 
       fb->allocated = TRUE;
 
+      _cogl_context_update_memory_usage (ctx,
+                                         COGL_MEMORY_CATEGORY_FRAMEBUFFER,
+                                         0,
+                                         offscreen->renderbuffer_memory_size);
+
       return ret;
     }
   else
@@ -950,6 +964,11 @@ _cogl_offscreen_free (CoglOffscreen *offscreen)
     }
   g_slist_free (offscreen->renderbuffers);
 
+  _cogl_context_update_memory_usage (ctx,
+                                     COGL_MEMORY_CATEGORY_FRAMEBUFFER,
+                                     offscreen->renderbuffer_memory_size,
+                                     0);
+
   GE (ctx, glDeleteFramebuffers (1, &offscreen->fbo_handle));
 
   if (offscreen->texture != COGL_INVALID_HANDLE)
@@ -1705,6 +1724,8 @@ cogl_framebuffer_swap_buffers (CoglFramebuffer *framebuffer)
         _cogl_framebuffer_get_winsys (framebuffer);
       winsys->onscreen_swap_buffers (COGL_ONSCREEN (framebuffer));
     }
+
+  _cogl_pipeline_reset_texture_unit_remap_stats ();
 }
 
 void
@@ -1727,6 +1748,8 @@ cogl_framebuffer_swap_region (CoglFramebuffer *framebuffer,
                                     rectangles,
                                     n_rectangles);
     }
+
+  _cogl_pipeline_reset_texture_unit_remap_stats ();
 }
 
 #ifdef COGL_HAS_X11_SUPPORT
@@ -96,6 +96,9 @@ cogl_gl_error_to_string (GLenum error_code);
 int
 _cogl_get_format_bpp (CoglPixelFormat format);
 
+gboolean
+_cogl_pixel_format_is_compressed (CoglPixelFormat format);
+
 void
 _cogl_enable (unsigned long flags);
 
@@ -128,7 +131,13 @@ typedef enum
 typedef enum
 {
   COGL_PRIVATE_FEATURE_TEXTURE_2D_FROM_EGL_IMAGE = 1L<<0,
-  COGL_PRIVATE_FEATURE_MESA_PACK_INVERT = 1L<<1
+  COGL_PRIVATE_FEATURE_MESA_PACK_INVERT = 1L<<1,
+  COGL_PRIVATE_FEATURE_STANDARD_DERIVATIVES = 1L<<2,
+  COGL_PRIVATE_FEATURE_UNPACK_SUBIMAGE = 1L<<3,
+  COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC1 = 1L<<4,
+  COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC2 = 1L<<5,
+  COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_S3TC = 1L<<6,
+  COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ASTC = 1L<<7
 } CoglPrivateFeatureFlags;
 
 gboolean
@@ -37,6 +37,7 @@
 #include "cogl-framebuffer-private.h"
 #include "cogl-profile.h"
 #include "cogl-attribute-private.h"
+#include "cogl-buffer-private.h"
 #include "cogl-point-in-poly-private.h"
 #include "cogl-private.h"
 
@@ -1129,6 +1130,8 @@ create_attribute_buffer (CoglJournal *journal,
   if (vbo == NULL)
     {
       vbo = cogl_attribute_buffer_new (n_bytes, NULL);
+      _cogl_buffer_set_memory_category (COGL_BUFFER (vbo),
+                                        COGL_MEMORY_CATEGORY_JOURNAL);
       journal->vbo_pool[journal->next_vbo_in_pool] = vbo;
     }
   else if (cogl_buffer_get_size (COGL_BUFFER (vbo)) < n_bytes)
@@ -1136,6 +1139,8 @@ create_attribute_buffer (CoglJournal *journal,
       /* If the buffer is too small then we'll just recreate it */
       cogl_object_unref (vbo);
       vbo = cogl_attribute_buffer_new (n_bytes, NULL);
+      _cogl_buffer_set_memory_category (COGL_BUFFER (vbo),
+                                        COGL_MEMORY_CATEGORY_JOURNAL);
       journal->vbo_pool[journal->next_vbo_in_pool] = vbo;
     }
 
@@ -0,0 +1,195 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+
+#if !defined(__COGL_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_MEMORY_USAGE_H__
+#define __COGL_MEMORY_USAGE_H__
+
+#include <glib.h>
+
+#include <cogl/cogl-context.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-memory-usage
+ * @short_description: Functions for tracking how much GPU memory is
+ *   used by Cogl
+ *
+ * Cogl keeps an estimate of the amount of GPU memory that it has
+ * allocated for the textures, renderbuffers and buffer objects of
+ * each context. The estimate is based on the size and format of each
+ * allocation so it won't include any padding or other overhead added
+ * by the driver.
+ *
+ * An application can also set a soft budget for the context to be
+ * told when the estimate grows past it. This can be used to drop
+ * caches of textures before the GPU runs out of memory.
+ */
+
+/* All of the cogl-memory-usage API is currently experimental so we
+ * suffix the actual symbols with _EXP so if somone is monitoring for
+ * ABI changes it will hopefully be clearer to them what's going on if
+ * any of the symbols dissapear at a later date.
+ */
+#define cogl_context_get_memory_usage cogl_context_get_memory_usage_EXP
+#define cogl_context_get_total_memory_usage \
+  cogl_context_get_total_memory_usage_EXP
+#define cogl_context_set_memory_budget cogl_context_set_memory_budget_EXP
+#define cogl_context_get_memory_budget cogl_context_get_memory_budget_EXP
+
+/**
+ * CoglMemoryCategory:
+ * @COGL_MEMORY_CATEGORY_TEXTURE_2D: Regular 2D textures
+ * @COGL_MEMORY_CATEGORY_TEXTURE_3D: 3D textures
+ * @COGL_MEMORY_CATEGORY_TEXTURE_RECTANGLE: Rectangle textures
+ * @COGL_MEMORY_CATEGORY_SLICED_TEXTURE: The slices of textures that
+ *   are too big for a single GL texture, including the waste
+ * @COGL_MEMORY_CATEGORY_ATLAS: The shared textures used to store
+ *   small textures in an atlas
+ * @COGL_MEMORY_CATEGORY_GLYPH_CACHE: The textures used to cache
+ *   glyphs for CoglPango
+ * @COGL_MEMORY_CATEGORY_PIXMAP: Textures containing the contents of
+ *   X pixmaps
+ * @COGL_MEMORY_CATEGORY_FRAMEBUFFER: The depth and stencil
+ *   renderbuffers of offscreen framebuffers
+ * @COGL_MEMORY_CATEGORY_JOURNAL: The vertex buffers used to draw
+ *   batched rectangles
+ * @COGL_MEMORY_CATEGORY_BUFFER: Any other buffer objects such as
+ *   attribute, index and pixel buffers
+ *
+ * The categories that the estimated GPU memory usage is broken down
+ * into.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+typedef enum
+{
+  COGL_MEMORY_CATEGORY_TEXTURE_2D,
+  COGL_MEMORY_CATEGORY_TEXTURE_3D,
+  COGL_MEMORY_CATEGORY_TEXTURE_RECTANGLE,
+  COGL_MEMORY_CATEGORY_SLICED_TEXTURE,
+  COGL_MEMORY_CATEGORY_ATLAS,
+  COGL_MEMORY_CATEGORY_GLYPH_CACHE,
+  COGL_MEMORY_CATEGORY_PIXMAP,
+  COGL_MEMORY_CATEGORY_FRAMEBUFFER,
+  COGL_MEMORY_CATEGORY_JOURNAL,
+  COGL_MEMORY_CATEGORY_BUFFER
+} CoglMemoryCategory;
+
+/**
+ * CoglMemoryBudgetCallback:
+ * @context: the #CoglContext that went over its budget
+ * @usage: the estimated total memory usage in bytes
+ * @budget: the budget that was set with
+ *   cogl_context_set_memory_budget()
+ * @user_data: the data passed to cogl_context_set_memory_budget()
+ *
+ * The type of the function that is called when the estimated memory
+ * usage of a context grows past its budget.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+typedef void (* CoglMemoryBudgetCallback) (CoglContext *context,
+                                           gsize usage,
+                                           gsize budget,
+                                           void *user_data);
+
+/**
+ * cogl_context_get_memory_usage:
+ * @context: a #CoglContext
+ * @category: the #CoglMemoryCategory to query
+ *
+ * Return value: the estimated number of bytes of GPU memory used by
+ *   @context for @category
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gsize
+cogl_context_get_memory_usage (CoglContext *context,
+                               CoglMemoryCategory category);
+
+/**
+ * cogl_context_get_total_memory_usage:
+ * @context: a #CoglContext
+ *
+ * Return value: the estimated number of bytes of GPU memory used by
+ *   @context for all of the categories
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gsize
+cogl_context_get_total_memory_usage (CoglContext *context);
+
+/**
+ * cogl_context_set_memory_budget:
+ * @context: a #CoglContext
+ * @budget: the budget in bytes or 0 to remove the budget
+ * @callback: (allow-none): the function to call when the budget is
+ *   exceeded
+ * @user_data: data for @callback
+ *
+ * Sets a soft limit on the estimated GPU memory usage of
+ * @context. Nothing stops Cogl from allocating more than the budget
+ * but @callback is called whenever an allocation takes the total
+ * usage from within the budget to over it. It isn't called again
+ * until the usage drops back within the budget.
+ *
+ * The callback is called from inside the Cogl function that made the
+ * allocation so it must not destroy any Cogl objects. Instead it
+ * should arrange for the caches to be dropped later, for example
+ * from an idle handler.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+void
+cogl_context_set_memory_budget (CoglContext *context,
+                                gsize budget,
+                                CoglMemoryBudgetCallback callback,
+                                void *user_data);
+
+/**
+ * cogl_context_get_memory_budget:
+ * @context: a #CoglContext
+ *
+ * Return value: the budget set with cogl_context_set_memory_budget()
+ *   or 0 if there isn't one
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gsize
+cogl_context_get_memory_budget (CoglContext *context);
+
+G_END_DECLS
+
+#endif /* __COGL_MEMORY_USAGE_H__ */
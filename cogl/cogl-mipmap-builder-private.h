@@ -0,0 +1,129 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifndef __COGL_MIPMAP_BUILDER_PRIVATE_H
+#define __COGL_MIPMAP_BUILDER_PRIVATE_H
+
+#include <glib.h>
+
+#include "cogl-bitmap.h"
+
+/* A CoglMipmapBuilder keeps a copy of every level of a texture in
+   system memory so that the mipmaps can be generated on the CPU. When
+   part of the first level is replaced only the matching parts of the
+   smaller levels are filtered again */
+typedef struct _CoglMipmapBuilder CoglMipmapBuilder;
+
+typedef void
+(* CoglMipmapBuilderLevelCallback) (int level,
+                                    int width,
+                                    int height,
+                                    int y,
+                                    int n_rows,
+                                    const guint8 *data,
+                                    int rowstride,
+                                    void *user_data);
+
+/*
+ * _cogl_mipmap_builder_format_supported:
+ * @format: a #CoglPixelFormat
+ *
+ * Return value: %TRUE if a builder can be created for @format. Only
+ *   formats with one byte per component are supported.
+ */
+gboolean
+_cogl_mipmap_builder_format_supported (CoglPixelFormat format);
+
+/*
+ * _cogl_mipmap_builder_new:
+ * @width: width of the first level
+ * @height: height of the first level
+ * @format: the format that the levels are stored and filtered in
+ * @linear_light: whether the colour components are sRGB encoded and
+ *   should be filtered in linear light
+ *
+ * Creates a builder for a full mipmap chain down to 1x1. The
+ * contents of the first level are undefined until they are set with
+ * _cogl_mipmap_builder_set_region().
+ */
+CoglMipmapBuilder *
+_cogl_mipmap_builder_new (int width,
+                          int height,
+                          CoglPixelFormat format,
+                          gboolean linear_light);
+
+void
+_cogl_mipmap_builder_free (CoglMipmapBuilder *builder);
+
+/*
+ * _cogl_mipmap_builder_clear:
+ * @builder: a #CoglMipmapBuilder
+ *
+ * Fills the first level with zeroes and marks all of it as dirty.
+ * This is used for textures that are created without any data.
+ */
+void
+_cogl_mipmap_builder_clear (CoglMipmapBuilder *builder);
+
+CoglPixelFormat
+_cogl_mipmap_builder_get_format (CoglMipmapBuilder *builder);
+
+/*
+ * _cogl_mipmap_builder_set_region:
+ * @builder: a #CoglMipmapBuilder
+ * @bmp: the source bitmap which will be converted to the format of
+ *   the builder if necessary
+ *
+ * Copies a region of @bmp into the first level and marks it as
+ * dirty.
+ *
+ * Return value: %FALSE if the bitmap couldn't be converted
+ */
+gboolean
+_cogl_mipmap_builder_set_region (CoglMipmapBuilder *builder,
+                                 CoglBitmap *bmp,
+                                 int src_x,
+                                 int src_y,
+                                 int dst_x,
+                                 int dst_y,
+                                 int width,
+                                 int height);
+
+/*
+ * _cogl_mipmap_builder_update:
+ * @builder: a #CoglMipmapBuilder
+ * @callback: called for every level after the first
+ * @user_data: data for @callback
+ *
+ * Filters the dirty region of the first level into the smaller
+ * levels. @callback is called once for each level with the band of
+ * rows that changed so that they can be uploaded. The rows are always
+ * the full width of the level and tightly packed. The first time this
+ * is called the band is always the whole level.
+ */
+void
+_cogl_mipmap_builder_update (CoglMipmapBuilder *builder,
+                             CoglMipmapBuilderLevelCallback callback,
+                             void *user_data);
+
+#endif /* __COGL_MIPMAP_BUILDER_PRIVATE_H */
@@ -0,0 +1,462 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "cogl.h"
+#include "cogl-internal.h"
+#include "cogl-bitmap-private.h"
+#include "cogl-mipmap-builder-private.h"
+
+/* Number of bits used to store linear light values */
+#define COGL_MIPMAP_BUILDER_LINEAR_BITS 12
+#define COGL_MIPMAP_BUILDER_LINEAR_MAX ((1 << COGL_MIPMAP_BUILDER_LINEAR_BITS) - 1)
+
+typedef struct
+{
+  int width;
+  int height;
+  /* The rows are tightly packed so that any band of them can be
+     uploaded without needing GL_UNPACK_ROW_LENGTH */
+  guint8 *data;
+} CoglMipmapBuilderLevel;
+
+struct _CoglMipmapBuilder
+{
+  CoglPixelFormat format;
+  int bpp;
+  /* Index of the alpha component within a pixel or -1. The alpha is
+     never sRGB encoded */
+  int alpha_component;
+  gboolean linear_light;
+
+  int n_levels;
+  CoglMipmapBuilderLevel *levels;
+
+  /* The region of the first level that has changed since the last
+     update. It is empty when x2 <= x1 */
+  int dirty_x1, dirty_y1;
+  int dirty_x2, dirty_y2;
+};
+
+static guint16 srgb_to_linear_table[256];
+static guint8 linear_to_srgb_table[COGL_MIPMAP_BUILDER_LINEAR_MAX + 1];
+
+static void
+_cogl_mipmap_builder_init_srgb_tables (void)
+{
+  static gsize initialized = 0;
+  int i;
+
+  if (!g_once_init_enter (&initialized))
+    return;
+
+  for (i = 0; i < 256; i++)
+    {
+      float c = i / 255.0f;
+
+      if (c <= 0.04045f)
+        c = c / 12.92f;
+      else
+        c = powf ((c + 0.055f) / 1.055f, 2.4f);
+
+      srgb_to_linear_table[i] = c * COGL_MIPMAP_BUILDER_LINEAR_MAX + 0.5f;
+    }
+
+  for (i = 0; i <= COGL_MIPMAP_BUILDER_LINEAR_MAX; i++)
+    {
+      float c = i / (float) COGL_MIPMAP_BUILDER_LINEAR_MAX;
+
+      if (c <= 0.0031308f)
+        c = c * 12.92f;
+      else
+        c = 1.055f * powf (c, 1.0f / 2.4f) - 0.055f;
+
+      linear_to_srgb_table[i] = CLAMP (c * 255.0f + 0.5f, 0, 255);
+    }
+
+  g_once_init_leave (&initialized, 1);
+}
+
+gboolean
+_cogl_mipmap_builder_format_supported (CoglPixelFormat format)
+{
+  switch (format & COGL_UNPREMULT_MASK)
+    {
+    case COGL_PIXEL_FORMAT_A_8:
+    case COGL_PIXEL_FORMAT_G_8:
+    case COGL_PIXEL_FORMAT_RGB_888:
+    case COGL_PIXEL_FORMAT_BGR_888:
+    case COGL_PIXEL_FORMAT_RGBA_8888:
+    case COGL_PIXEL_FORMAT_BGRA_8888:
+    case COGL_PIXEL_FORMAT_ARGB_8888:
+    case COGL_PIXEL_FORMAT_ABGR_8888:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+CoglMipmapBuilder *
+_cogl_mipmap_builder_new (int width,
+                          int height,
+                          CoglPixelFormat format,
+                          gboolean linear_light)
+{
+  CoglMipmapBuilder *builder;
+  int level;
+
+  g_return_val_if_fail (_cogl_mipmap_builder_format_supported (format), NULL);
+
+  builder = g_slice_new (CoglMipmapBuilder);
+
+  builder->format = format;
+  builder->bpp = _cogl_get_format_bpp (format);
+  builder->linear_light = linear_light;
+
+  if (format == COGL_PIXEL_FORMAT_A_8 || (format & COGL_AFIRST_BIT))
+    builder->alpha_component = 0;
+  else if ((format & COGL_A_BIT))
+    builder->alpha_component = 3;
+  else
+    builder->alpha_component = -1;
+
+  if (linear_light)
+    _cogl_mipmap_builder_init_srgb_tables ();
+
+  builder->n_levels = 1;
+  while ((MAX (width, height) >> builder->n_levels) > 0)
+    builder->n_levels++;
+
+  builder->levels = g_new (CoglMipmapBuilderLevel, builder->n_levels);
+
+  for (level = 0; level < builder->n_levels; level++)
+    {
+      CoglMipmapBuilderLevel *l = builder->levels + level;
+
+      l->width = MAX (width >> level, 1);
+      l->height = MAX (height >> level, 1);
+      l->data = g_malloc (l->width * l->height * builder->bpp);
+    }
+
+  builder->dirty_x1 = builder->dirty_y1 = 0;
+  builder->dirty_x2 = builder->dirty_y2 = 0;
+
+  return builder;
+}
+
+void
+_cogl_mipmap_builder_free (CoglMipmapBuilder *builder)
+{
+  int level;
+
+  for (level = 0; level < builder->n_levels; level++)
+    g_free (builder->levels[level].data);
+
+  g_free (builder->levels);
+
+  g_slice_free (CoglMipmapBuilder, builder);
+}
+
+void
+_cogl_mipmap_builder_clear (CoglMipmapBuilder *builder)
+{
+  CoglMipmapBuilderLevel *level = builder->levels;
+
+  memset (level->data, 0, level->width * level->height * builder->bpp);
+
+  builder->dirty_x1 = builder->dirty_y1 = 0;
+  builder->dirty_x2 = level->width;
+  builder->dirty_y2 = level->height;
+}
+
+CoglPixelFormat
+_cogl_mipmap_builder_get_format (CoglMipmapBuilder *builder)
+{
+  return builder->format;
+}
+
+gboolean
+_cogl_mipmap_builder_set_region (CoglMipmapBuilder *builder,
+                                 CoglBitmap *bmp,
+                                 int src_x,
+                                 int src_y,
+                                 int dst_x,
+                                 int dst_y,
+                                 int width,
+                                 int height)
+{
+  CoglMipmapBuilderLevel *level = builder->levels;
+  CoglPixelFormat bmp_format = _cogl_bitmap_get_format (bmp);
+  int bmp_rowstride = _cogl_bitmap_get_rowstride (bmp);
+  int rowstride = level->width * builder->bpp;
+  CoglBitmap *src_region, *dst_region;
+  guint8 *data;
+  gboolean ret;
+
+  if ((data = _cogl_bitmap_map (bmp, COGL_BUFFER_ACCESS_READ, 0)) == NULL)
+    return FALSE;
+
+  /* Wrap both regions in bitmaps so that the bitmap code can do any
+     format conversion while copying */
+  src_region =
+    _cogl_bitmap_new_from_data (data +
+                                src_y * bmp_rowstride +
+                                src_x * _cogl_get_format_bpp (bmp_format),
+                                bmp_format,
+                                width, height,
+                                bmp_rowstride,
+                                NULL, NULL);
+  dst_region =
+    _cogl_bitmap_new_from_data (level->data +
+                                dst_y * rowstride +
+                                dst_x * builder->bpp,
+                                builder->format,
+                                width, height,
+                                rowstride,
+                                NULL, NULL);
+
+  ret = _cogl_bitmap_convert_into (src_region, dst_region);
+
+  cogl_object_unref (dst_region);
+  cogl_object_unref (src_region);
+
+  _cogl_bitmap_unmap (bmp);
+
+  if (!ret)
+    return FALSE;
+
+  if (builder->dirty_x2 <= builder->dirty_x1)
+    {
+      builder->dirty_x1 = dst_x;
+      builder->dirty_y1 = dst_y;
+      builder->dirty_x2 = dst_x + width;
+      builder->dirty_y2 = dst_y + height;
+    }
+  else
+    {
+      builder->dirty_x1 = MIN (builder->dirty_x1, dst_x);
+      builder->dirty_y1 = MIN (builder->dirty_y1, dst_y);
+      builder->dirty_x2 = MAX (builder->dirty_x2, dst_x + width);
+      builder->dirty_y2 = MAX (builder->dirty_y2, dst_y + height);
+    }
+
+  return TRUE;
+}
+
+#ifdef __SSE2__
+
+/* Filters two four byte destination pixels at a time. Returns the
+   first destination pixel that wasn't filtered */
+static int
+_cogl_mipmap_builder_filter_row_box_sse2 (const guint8 *row0,
+                                          const guint8 *row1,
+                                          int src_width,
+                                          guint8 *dst,
+                                          int x1,
+                                          int x2)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  const __m128i round = _mm_set1_epi16 (2);
+  int x;
+
+  /* Each iteration reads four source pixels so it has to stop before
+     any pixels that would need to be clamped to the edge */
+  for (x = x1; x + 2 <= x2 && (x + 2) * 2 <= src_width; x += 2)
+    {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (row0 + x * 8));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (row1 + x * 8));
+      __m128i lo, hi, sum;
+
+      /* Add the two rows with 16 bits per component */
+      lo = _mm_add_epi16 (_mm_unpacklo_epi8 (a, zero),
+                          _mm_unpacklo_epi8 (b, zero));
+      hi = _mm_add_epi16 (_mm_unpackhi_epi8 (a, zero),
+                          _mm_unpackhi_epi8 (b, zero));
+
+      /* Each half now has two neighbouring pixels so add them */
+      lo = _mm_add_epi16 (lo, _mm_srli_si128 (lo, 8));
+      hi = _mm_add_epi16 (hi, _mm_srli_si128 (hi, 8));
+
+      sum = _mm_unpacklo_epi64 (lo, hi);
+      sum = _mm_srli_epi16 (_mm_add_epi16 (sum, round), 2);
+
+      _mm_storel_epi64 ((__m128i *) (dst + x * 4),
+                        _mm_packus_epi16 (sum, zero));
+    }
+
+  return x;
+}
+
+#endif /* __SSE2__ */
+
+static void
+_cogl_mipmap_builder_filter_row_box (CoglMipmapBuilder *builder,
+                                     const guint8 *row0,
+                                     const guint8 *row1,
+                                     int src_width,
+                                     guint8 *dst,
+                                     int x1,
+                                     int x2)
+{
+  int bpp = builder->bpp;
+  int x = x1;
+  int c;
+
+#ifdef __SSE2__
+  if (bpp == 4)
+    x = _cogl_mipmap_builder_filter_row_box_sse2 (row0, row1, src_width,
+                                                  dst, x1, x2);
+#endif
+
+  for (; x < x2; x++)
+    {
+      int sx0 = x * 2 * bpp;
+      int sx1 = MIN (x * 2 + 1, src_width - 1) * bpp;
+
+      for (c = 0; c < bpp; c++)
+        dst[x * bpp + c] = (row0[sx0 + c] + row0[sx1 + c] +
+                            row1[sx0 + c] + row1[sx1 + c] + 2) >> 2;
+    }
+}
+
+static void
+_cogl_mipmap_builder_filter_row_linear (CoglMipmapBuilder *builder,
+                                        const guint8 *row0,
+                                        const guint8 *row1,
+                                        int src_width,
+                                        guint8 *dst,
+                                        int x1,
+                                        int x2)
+{
+  int bpp = builder->bpp;
+  int x, c;
+
+  for (x = x1; x < x2; x++)
+    {
+      int sx0 = x * 2 * bpp;
+      int sx1 = MIN (x * 2 + 1, src_width - 1) * bpp;
+
+      for (c = 0; c < bpp; c++)
+        if (c == builder->alpha_component)
+          dst[x * bpp + c] = (row0[sx0 + c] + row0[sx1 + c] +
+                              row1[sx0 + c] + row1[sx1 + c] + 2) >> 2;
+        else
+          {
+            int sum = (srgb_to_linear_table[row0[sx0 + c]] +
+                       srgb_to_linear_table[row0[sx1 + c]] +
+                       srgb_to_linear_table[row1[sx0 + c]] +
+                       srgb_to_linear_table[row1[sx1 + c]]);
+
+            dst[x * bpp + c] = linear_to_srgb_table[(sum + 2) >> 2];
+          }
+    }
+}
+
+/* Filters a region of a level from the level above it using a 2x2
+   box filter. If the level above has an odd size then its last row
+   or column is ignored except when it is only one pixel wide */
+static void
+_cogl_mipmap_builder_filter_region (CoglMipmapBuilder *builder,
+                                    int level,
+                                    int x1,
+                                    int y1,
+                                    int x2,
+                                    int y2)
+{
+  CoglMipmapBuilderLevel *src = builder->levels + level - 1;
+  CoglMipmapBuilderLevel *dst = builder->levels + level;
+  int src_rowstride = src->width * builder->bpp;
+  int dst_rowstride = dst->width * builder->bpp;
+  int y;
+
+  for (y = y1; y < y2; y++)
+    {
+      const guint8 *row0 = src->data + y * 2 * src_rowstride;
+      const guint8 *row1 =
+        src->data + MIN (y * 2 + 1, src->height - 1) * src_rowstride;
+      guint8 *dst_row = dst->data + y * dst_rowstride;
+
+      if (builder->linear_light)
+        _cogl_mipmap_builder_filter_row_linear (builder,
+                                                row0, row1, src->width,
+                                                dst_row, x1, x2);
+      else
+        _cogl_mipmap_builder_filter_row_box (builder,
+                                             row0, row1, src->width,
+                                             dst_row, x1, x2);
+    }
+}
+
+void
+_cogl_mipmap_builder_update (CoglMipmapBuilder *builder,
+                             CoglMipmapBuilderLevelCallback callback,
+                             void *user_data)
+{
+  int x1 = builder->dirty_x1, y1 = builder->dirty_y1;
+  int x2 = builder->dirty_x2, y2 = builder->dirty_y2;
+  int level;
+
+  if (x2 <= x1 || y2 <= y1)
+    return;
+
+  for (level = 1; level < builder->n_levels; level++)
+    {
+      CoglMipmapBuilderLevel *dst = builder->levels + level;
+      int rowstride = dst->width * builder->bpp;
+
+      /* Each pixel depends on a 2x2 block of the level above */
+      x1 /= 2;
+      y1 /= 2;
+      x2 = MIN ((x2 + 1) / 2, dst->width);
+      y2 = MIN ((y2 + 1) / 2, dst->height);
+
+      /* This can happen if only the ignored last row or column of an
+         odd sized level changed */
+      if (x2 <= x1 || y2 <= y1)
+        break;
+
+      _cogl_mipmap_builder_filter_region (builder, level, x1, y1, x2, y2);
+
+      callback (level,
+                dst->width, dst->height,
+                y1, y2 - y1,
+                dst->data + y1 * rowstride,
+                rowstride,
+                user_data);
+    }
+
+  builder->dirty_x1 = builder->dirty_y1 = 0;
+  builder->dirty_x2 = builder->dirty_y2 = 0;
+}
@@ -29,14 +29,24 @@
 #include "config.h"
 #endif
 
+#include "cogl-debug.h"
 #include "cogl-pipeline-private.h"
 #include "cogl-pipeline-cache.h"
 #include "cogl-context-private.h"
 
+typedef struct
+{
+  unsigned int hits;
+  unsigned int misses;
+} CoglPipelineCodegenStats;
+
 struct _CoglPipelineCache
 {
   GHashTable *fragment_hash;
   GHashTable *vertex_hash;
+
+  CoglPipelineCodegenStats fragment_codegen_stats;
+  CoglPipelineCodegenStats vertex_codegen_stats;
 };
 
 static unsigned int
@@ -104,7 +114,7 @@ pipeline_vertex_equal (const void *a, const void *b)
 CoglPipelineCache *
 cogl_pipeline_cache_new (void)
 {
-  CoglPipelineCache *cache = g_new (CoglPipelineCache, 1);
+  CoglPipelineCache *cache = g_new0 (CoglPipelineCache, 1);
 
   cache->fragment_hash = g_hash_table_new_full (pipeline_fragment_hash,
                                                 pipeline_fragment_equal,
@@ -206,6 +216,40 @@ _cogl_pipeline_cache_get_vertex_template (CoglPipelineCache *cache,
   return template;
 }
 
+void
+_cogl_pipeline_cache_record_codegen (CoglPipelineCache *cache,
+                                     GLenum shader_type,
+                                     gboolean hit)
+{
+  CoglPipelineCodegenStats *stats;
+  const char *shader_name;
+
+  if (shader_type == GL_VERTEX_SHADER)
+    {
+      stats = &cache->vertex_codegen_stats;
+      shader_name = "vertex";
+    }
+  else
+    {
+      stats = &cache->fragment_codegen_stats;
+      shader_name = "fragment";
+    }
+
+  if (hit)
+    stats->hits++;
+  else
+    stats->misses++;
+
+  if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_SHOW_SOURCE)))
+    g_message ("%s shader codegen cache %s: %u hits, %u misses "
+               "(%.1f%% hit rate)",
+               shader_name,
+               hit ? "hit" : "miss",
+               stats->hits,
+               stats->misses,
+               stats->hits * 100.0f / (stats->hits + stats->misses));
+}
+
 CoglPipeline *
 _cogl_pipeline_cache_get_combined_template (CoglPipelineCache *cache,
                                             CoglPipeline *key_pipeline)
@@ -25,6 +25,7 @@
 #define __COGL_PIPELINE_CACHE_H__
 
 #include "cogl-pipeline.h"
+#include "cogl-internal.h"
 
 typedef struct _CoglPipelineCache CoglPipelineCache;
 
@@ -60,6 +61,17 @@ CoglPipeline *
 _cogl_pipeline_cache_get_vertex_template (CoglPipelineCache *cache,
                                           CoglPipeline *key_pipeline);
 
+/*
+ * Records whether the GLSL source for a shader of type @shader_type
+ * could be reused from an earlier pipeline with the same codegen
+ * state (@hit is TRUE) or whether it had to be generated. The running
+ * hit rate is reported when COGL_DEBUG=show-source is enabled.
+ */
+void
+_cogl_pipeline_cache_record_codegen (CoglPipelineCache *cache,
+                                     GLenum shader_type,
+                                     gboolean hit);
+
 /*
  * Gets a pipeline from the cache that has the same state as
  * @key_pipeline for the combination of the state state in
@@ -121,6 +121,9 @@ _cogl_pipeline_fragend_fixed_add_layer (CoglPipeline *pipeline,
   CoglTextureUnit *unit =
     _cogl_get_texture_unit (_cogl_pipeline_layer_get_unit_index (layer));
   int unit_index = unit->index;
+  CoglPipelineLayer *tex_authority;
+  CoglPipelineLayer *target_authority;
+  GLenum gl_target;
   int n_rgb_func_args;
   int n_alpha_func_args;
 
@@ -143,21 +146,23 @@ _cogl_pipeline_fragend_fixed_add_layer (CoglPipeline *pipeline,
       return TRUE;
     }
 
+  /* The fragend is flushed before the textures are bound so the
+   * target has to come from the layer rather than the unit */
+  tex_authority =
+    _cogl_pipeline_layer_get_authority (layer,
+                                        COGL_PIPELINE_LAYER_STATE_TEXTURE_DATA);
+  target_authority =
+    _cogl_pipeline_layer_get_authority (layer,
+                                        COGL_PIPELINE_LAYER_STATE_TEXTURE_TARGET);
+  /* XXX: currently layers with no associated texture fallback to
+   * using ctx->default_gl_texture_2d_tex so they have a texture
+   * target of GL_TEXTURE_2D */
+  gl_target =
+    tex_authority->texture ? target_authority->target : GL_TEXTURE_2D;
+
   /* Handle enabling or disabling the right texture target */
   if (layers_difference & COGL_PIPELINE_LAYER_STATE_TEXTURE_TARGET)
     {
-      CoglPipelineLayer *tex_authority =
-        _cogl_pipeline_layer_get_authority (layer,
-                                            COGL_PIPELINE_LAYER_STATE_TEXTURE_DATA);
-      CoglPipelineLayer *target_authority =
-        _cogl_pipeline_layer_get_authority (layer,
-                                            COGL_PIPELINE_LAYER_STATE_TEXTURE_TARGET);
-      /* XXX: currently layers with no associated texture fallback to
-       * using ctx->default_gl_texture_2d_tex so they have a texture
-       * target of GL_TEXTURE_2D */
-      GLenum gl_target =
-        tex_authority->texture ? target_authority->target : GL_TEXTURE_2D;
-
       _cogl_set_active_texture_unit (unit_index);
 
       /* The common GL code handles binding the right texture so we
@@ -188,8 +193,8 @@ _cogl_pipeline_fragend_fixed_add_layer (CoglPipeline *pipeline,
           unit->enabled_gl_target == 0)
         {
           _cogl_set_active_texture_unit (unit_index);
-          GE (ctx, glEnable (unit->gl_target));
-          unit->enabled_gl_target = unit->gl_target;
+          GE (ctx, glEnable (gl_target));
+          unit->enabled_gl_target = gl_target;
         }
     }
 
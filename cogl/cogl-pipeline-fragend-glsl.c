@@ -90,6 +90,14 @@ typedef struct
   GString *header, *source;
   UnitState *unit_state;
 
+  /* Copies of the last generated source. The generated code doesn't
+     depend on the user program so if the shader needs to be
+     recompiled because the user program changed we can skip the
+     code generation */
+  char *cached_header, *cached_source;
+  int n_tex_coord_attribs;
+  gboolean needs_compile;
+
   /* List of layers that we haven't generated code for yet. These are
      in reverse order. As soon as we're about to generate code for
      layer we'll remove it from the list so we don't generate it
@@ -140,6 +148,8 @@ destroy_shader_state (void *user_data)
         GE( ctx, glDeleteShader (shader_state->gl_shader) );
 
       g_free (shader_state->unit_state);
+      g_free (shader_state->cached_header);
+      g_free (shader_state->cached_source);
 
       g_slice_free (CoglPipelineShaderState, shader_state);
     }
@@ -184,6 +194,7 @@ _cogl_pipeline_fragend_glsl_start (CoglPipeline *pipeline,
   CoglPipeline *authority;
   CoglPipeline *template_pipeline = NULL;
   CoglProgram *user_program;
+  gboolean recorded_codegen = FALSE;
   int i;
 
   _COGL_GET_CONTEXT (ctx, FALSE);
@@ -236,6 +247,14 @@ _cogl_pipeline_fragend_glsl_start (CoglPipeline *pipeline,
                                                             authority);
 
               shader_state = get_shader_state (template_pipeline);
+
+              if (shader_state && shader_state->cached_source)
+                {
+                  _cogl_pipeline_cache_record_codegen (ctx->pipeline_cache,
+                                                       GL_FRAGMENT_SHADER,
+                                                       TRUE);
+                  recorded_codegen = TRUE;
+                }
             }
 
           if (shader_state)
@@ -289,6 +308,23 @@ _cogl_pipeline_fragend_glsl_start (CoglPipeline *pipeline,
       _cogl_program_has_fragment_shader (user_program))
     return TRUE;
 
+  shader_state->needs_compile = TRUE;
+
+  /* If we've already generated the source for this state then we can
+     just compile that again */
+  if (shader_state->cached_source)
+    {
+      if (!recorded_codegen)
+        _cogl_pipeline_cache_record_codegen (ctx->pipeline_cache,
+                                             GL_FRAGMENT_SHADER,
+                                             TRUE);
+      return TRUE;
+    }
+
+  _cogl_pipeline_cache_record_codegen (ctx->pipeline_cache,
+                                       GL_FRAGMENT_SHADER,
+                                       FALSE);
+
   /* We reuse two grow-only GStrings for code-gen. One string
      contains the uniform and attribute declarations while the
      other contains the main function. We need two strings
@@ -857,6 +893,209 @@ add_alpha_test_snippet (CoglPipeline *pipeline,
 
 #endif /*  HAVE_COGL_GLES2 */
 
+/* Hand written shaders for the most common single layer pipelines.
+ * These are used instead of the generic combine code generation when
+ * a layer's combine state exactly matches one of the entries. They
+ * generate the same arithmetic as the generic path but avoid the
+ * intermediate texel and layer variables. */
+typedef struct
+{
+  CoglPipelineCombineFunc func;
+  CoglPipelineCombineSource src[2];
+  CoglPipelineCombineOp rgb_op[2];
+  const char *source;
+} ShaderTemplate;
+
+static const ShaderTemplate
+shader_templates[] =
+  {
+    /* texture * color. This is the default combine mode */
+    { COGL_PIPELINE_COMBINE_FUNC_MODULATE,
+      { COGL_PIPELINE_COMBINE_SOURCE_PREVIOUS,
+        COGL_PIPELINE_COMBINE_SOURCE_TEXTURE },
+      { COGL_PIPELINE_COMBINE_OP_SRC_COLOR,
+        COGL_PIPELINE_COMBINE_OP_SRC_COLOR },
+      "  cogl_color_out = cogl_color_in * "
+      "texture2D (_cogl_sampler_%i, cogl_tex_coord_in[%i].st);\n" },
+    /* texture only: "RGBA = REPLACE (TEXTURE)" */
+    { COGL_PIPELINE_COMBINE_FUNC_REPLACE,
+      { COGL_PIPELINE_COMBINE_SOURCE_TEXTURE },
+      { COGL_PIPELINE_COMBINE_OP_SRC_COLOR },
+      "  cogl_color_out = "
+      "texture2D (_cogl_sampler_%i, cogl_tex_coord_in[%i].st);\n" },
+    /* A8 glyph * color as used by CoglPango:
+       "RGBA = MODULATE (PREVIOUS, TEXTURE[A])" */
+    { COGL_PIPELINE_COMBINE_FUNC_MODULATE,
+      { COGL_PIPELINE_COMBINE_SOURCE_PREVIOUS,
+        COGL_PIPELINE_COMBINE_SOURCE_TEXTURE },
+      { COGL_PIPELINE_COMBINE_OP_SRC_COLOR,
+        COGL_PIPELINE_COMBINE_OP_SRC_ALPHA },
+      "  cogl_color_out = cogl_color_in * "
+      "texture2D (_cogl_sampler_%i, cogl_tex_coord_in[%i].st).a;\n" }
+  };
+
+static gboolean
+combine_matches_template (CoglPipelineLayerBigState *big_state,
+                          const ShaderTemplate *template)
+{
+  int n_args = _cogl_get_n_args_for_combine_func (template->func);
+  int i;
+
+  if (big_state->texture_combine_rgb_func != template->func ||
+      big_state->texture_combine_alpha_func != template->func)
+    return FALSE;
+
+  for (i = 0; i < n_args; i++)
+    if (big_state->texture_combine_rgb_src[i] != template->src[i] ||
+        big_state->texture_combine_alpha_src[i] != template->src[i] ||
+        big_state->texture_combine_rgb_op[i] != template->rgb_op[i] ||
+        big_state->texture_combine_alpha_op[i] !=
+        COGL_PIPELINE_COMBINE_OP_SRC_ALPHA)
+      return FALSE;
+
+  return TRUE;
+}
+
+/* Tries to replace the whole combine chain with one of the shader
+   templates. Returns FALSE if the pipeline needs the generic code */
+static gboolean
+add_template_source (CoglPipeline *pipeline,
+                     CoglPipelineShaderState *shader_state)
+{
+  LayerData *layer_data;
+  CoglPipelineLayer *layer, *combine_authority;
+  CoglHandle texture;
+  int unit_index;
+  int i;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  /* color only */
+  if (COGL_LIST_EMPTY (&shader_state->layers))
+    {
+      g_string_append (shader_state->source,
+                       "  cogl_color_out = cogl_color_in;\n");
+      return TRUE;
+    }
+
+  layer_data = COGL_LIST_FIRST (&shader_state->layers);
+  if (COGL_LIST_NEXT (layer_data, list_node))
+    return FALSE;
+
+  layer = layer_data->layer;
+  unit_index = _cogl_pipeline_layer_get_unit_index (layer);
+
+  if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DISABLE_TEXTURING)))
+    return FALSE;
+
+  /* The templates only cover regular 2D textures sampled using the
+     texture coordinates */
+  texture = _cogl_pipeline_layer_get_texture (layer);
+  if (texture != COGL_INVALID_HANDLE)
+    {
+      GLenum gl_target;
+
+      cogl_texture_get_gl_texture (texture, NULL, &gl_target);
+      if (gl_target != GL_TEXTURE_2D)
+        return FALSE;
+    }
+
+  if (ctx->driver == COGL_DRIVER_GLES2 &&
+      cogl_pipeline_get_layer_point_sprite_coords_enabled (pipeline,
+                                                           layer->index))
+    return FALSE;
+
+  combine_authority =
+    _cogl_pipeline_layer_get_authority (layer,
+                                        COGL_PIPELINE_LAYER_STATE_COMBINE);
+
+  for (i = 0; i < G_N_ELEMENTS (shader_templates); i++)
+    if (combine_matches_template (combine_authority->big_state,
+                                  shader_templates + i))
+      {
+        g_string_append_printf (shader_state->header,
+                                "uniform sampler2D _cogl_sampler_%i;\n",
+                                unit_index);
+        g_string_append_printf (shader_state->source,
+                                shader_templates[i].source,
+                                unit_index, unit_index);
+        shader_state->unit_state[unit_index].sampled = TRUE;
+
+        COGL_LIST_REMOVE (layer_data, list_node);
+        g_slice_free (LayerData, layer_data);
+
+        return TRUE;
+      }
+
+  return FALSE;
+}
+
+static void
+add_combine_source (CoglPipeline *pipeline,
+                    CoglPipelineShaderState *shader_state)
+{
+  /* We only need to generate code to calculate the fragment value
+     for the last layer. If the value of this layer depends on any
+     previous layers then it will recursively generate the code
+     for those layers */
+  if (!COGL_LIST_EMPTY (&shader_state->layers))
+    {
+      CoglPipelineLayer *last_layer;
+      LayerData *layer_data, *tmp;
+
+      last_layer = COGL_LIST_FIRST (&shader_state->layers)->layer;
+
+      ensure_layer_generated (pipeline, last_layer->index);
+      g_string_append_printf (shader_state->source,
+                              "  cogl_color_out = layer%i;\n",
+                              last_layer->index);
+
+      COGL_LIST_FOREACH_SAFE (layer_data, &shader_state->layers,
+                              list_node, tmp)
+        g_slice_free (LayerData, layer_data);
+    }
+  else
+    g_string_append (shader_state->source,
+                     "  cogl_color_out = cogl_color_in;\n");
+}
+
+static void
+generate_source (CoglPipeline *pipeline,
+                 CoglPipelineShaderState *shader_state)
+{
+  int i, n_layers;
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  if (!add_template_source (pipeline, shader_state))
+    add_combine_source (pipeline, shader_state);
+
+#ifdef HAVE_COGL_GLES2
+  if (ctx->driver == COGL_DRIVER_GLES2)
+    add_alpha_test_snippet (pipeline, shader_state);
+#endif
+
+  g_string_append (shader_state->source, "}\n");
+
+  /* Find the highest texture unit that is sampled to pass as the
+     number of texture coordinate attributes */
+  shader_state->n_tex_coord_attribs = 0;
+  n_layers = cogl_pipeline_get_n_layers (pipeline);
+  for (i = 0; i < n_layers; i++)
+    if (shader_state->unit_state[i].sampled)
+      shader_state->n_tex_coord_attribs = i + 1;
+
+  g_free (shader_state->cached_header);
+  g_free (shader_state->cached_source);
+  shader_state->cached_header = g_strndup (shader_state->header->str,
+                                           shader_state->header->len);
+  shader_state->cached_source = g_strndup (shader_state->source->str,
+                                           shader_state->source->len);
+
+  shader_state->header = NULL;
+  shader_state->source = NULL;
+}
+
 gboolean
 _cogl_pipeline_fragend_glsl_end (CoglPipeline *pipeline,
                                  unsigned long pipelines_difference)
@@ -866,13 +1105,13 @@ _cogl_pipeline_fragend_glsl_end (CoglPipeline *pipeline,
   _COGL_GET_CONTEXT (ctx, FALSE);
 
   if (shader_state->source)
+    generate_source (pipeline, shader_state);
+
+  if (shader_state->needs_compile)
     {
       const char *source_strings[2];
-      GLint lengths[2];
       GLint compile_status;
       GLuint shader;
-      int n_tex_coord_attribs = 0;
-      int i, n_layers;
 
       COGL_STATIC_COUNTER (fragend_glsl_compile_counter,
                            "glsl fragment compile counter",
@@ -881,55 +1120,17 @@ _cogl_pipeline_fragend_glsl_end (CoglPipeline *pipeline,
                            0 /* no application private data */);
       COGL_COUNTER_INC (_cogl_uprof_context, fragend_glsl_compile_counter);
 
-      /* We only need to generate code to calculate the fragment value
-         for the last layer. If the value of this layer depends on any
-         previous layers then it will recursively generate the code
-         for those layers */
-      if (!COGL_LIST_EMPTY (&shader_state->layers))
-        {
-          CoglPipelineLayer *last_layer;
-          LayerData *layer_data, *tmp;
-
-          last_layer = COGL_LIST_FIRST (&shader_state->layers)->layer;
-
-          ensure_layer_generated (pipeline, last_layer->index);
-          g_string_append_printf (shader_state->source,
-                                  "  cogl_color_out = layer%i;\n",
-                                  last_layer->index);
-
-          COGL_LIST_FOREACH_SAFE (layer_data, &shader_state->layers,
-                                  list_node, tmp)
-            g_slice_free (LayerData, layer_data);
-        }
-      else
-        g_string_append (shader_state->source,
-                         "  cogl_color_out = cogl_color_in;\n");
-
-#ifdef HAVE_COGL_GLES2
-      if (ctx->driver == COGL_DRIVER_GLES2)
-        add_alpha_test_snippet (pipeline, shader_state);
-#endif
-
-      g_string_append (shader_state->source, "}\n");
-
       GE_RET( shader, ctx, glCreateShader (GL_FRAGMENT_SHADER) );
 
-      lengths[0] = shader_state->header->len;
-      source_strings[0] = shader_state->header->str;
-      lengths[1] = shader_state->source->len;
-      source_strings[1] = shader_state->source->str;
-
-      /* Find the highest texture unit that is sampled to pass as the
-         number of texture coordinate attributes */
-      n_layers = cogl_pipeline_get_n_layers (pipeline);
-      for (i = 0; i < n_layers; i++)
-        if (shader_state->unit_state[i].sampled)
-          n_tex_coord_attribs = i + 1;
+      source_strings[0] = shader_state->cached_header;
+      source_strings[1] = shader_state->cached_source;
 
       _cogl_shader_set_source_with_boilerplate (shader, GL_FRAGMENT_SHADER,
+                                                shader_state->
                                                 n_tex_coord_attribs,
                                                 2, /* count */
-                                                source_strings, lengths);
+                                                source_strings,
+                                                NULL /* null terminated */);
 
       GE( ctx, glCompileShader (shader) );
       GE( ctx, glGetShaderiv (shader, GL_COMPILE_STATUS, &compile_status) );
@@ -945,8 +1146,7 @@ _cogl_pipeline_fragend_glsl_end (CoglPipeline *pipeline,
           g_warning ("Shader compilation failed:\n%s", shader_log);
         }
 
-      shader_state->header = NULL;
-      shader_state->source = NULL;
+      shader_state->needs_compile = FALSE;
       shader_state->gl_shader = shader;
     }
 
@@ -1006,6 +1006,8 @@ cogl_pipeline_set_layer_combine (CoglPipeline *pipeline,
   GError *internal_error = NULL;
   int count;
 
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
   g_return_val_if_fail (cogl_is_pipeline (pipeline), FALSE);
 
   /* Note: this will ensure that the layer exists, creating one if it
@@ -1021,10 +1023,11 @@ cogl_pipeline_set_layer_combine (CoglPipeline *pipeline,
   authority = _cogl_pipeline_layer_get_authority (layer, state);
 
   count =
-    _cogl_blend_string_compile (combine_description,
-                                COGL_BLEND_STRING_CONTEXT_TEXTURE_COMBINE,
-                                statements,
-                                &internal_error);
+    _cogl_blend_string_cache_compile (ctx->blend_string_cache,
+                                      combine_description,
+                                      COGL_BLEND_STRING_CONTEXT_TEXTURE_COMBINE,
+                                      statements,
+                                      &internal_error);
   if (!count)
     {
       if (error)
@@ -135,6 +135,25 @@ _cogl_destroy_texture_units (void);
 void
 _cogl_set_active_texture_unit (int unit_index);
 
+/* Returns the texture unit that the texture of the layer with the
+ * given unit index was bound to when the current pipeline was
+ * flushed. The GLSL fragend may sample a layer from a different unit
+ * than its unit index to avoid rebinding textures that are already
+ * bound to another unit. */
+int
+_cogl_pipeline_get_bound_texture_unit (int unit_index);
+
+/* Gets the number of glBindTexture and glActiveTexture calls that
+ * remapping the texture units has avoided since the last time a
+ * framebuffer was swapped. The uprof counters keep the totals for
+ * the whole run but these are reset at the end of every frame */
+void
+_cogl_pipeline_get_texture_unit_remap_stats (unsigned int *n_binds_saved,
+                                             unsigned int *n_switches_saved);
+
+void
+_cogl_pipeline_reset_texture_unit_remap_stats (void);
+
 void
 _cogl_bind_gl_texture_transient (GLenum gl_target,
                                  GLuint gl_texture,
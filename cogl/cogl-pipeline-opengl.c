@@ -36,6 +36,7 @@
 #include "cogl-pipeline-private.h"
 #include "cogl-context-private.h"
 #include "cogl-texture-private.h"
+#include "cogl-profile.h"
 
 /* This is needed to set the color attribute on GLES2 */
 #ifdef HAVE_COGL_GLES2
@@ -228,9 +229,18 @@ _cogl_pipeline_texture_storage_change_notify (CoglHandle texture)
       CoglTextureUnit *unit =
         &g_array_index (ctx->texture_units, CoglTextureUnit, i);
 
+      /* The flag is tracked on the unit that the layer's texture was
+       * actually bound to which may differ from the layer's index if
+       * the units were remapped */
       if (unit->layer &&
           _cogl_pipeline_layer_get_texture (unit->layer) == texture)
-        unit->texture_storage_changed = TRUE;
+        {
+          int bound_unit_index = _cogl_pipeline_get_bound_texture_unit (i);
+
+          if (bound_unit_index != -1)
+            _cogl_get_texture_unit (bound_unit_index)->
+              texture_storage_changed = TRUE;
+        }
 
       /* NB: the texture may be bound to multiple texture units so
        * we continue to check the rest */
@@ -743,10 +753,274 @@ get_max_activateable_texture_units (void)
   return ctx->max_activateable_texture_units;
 }
 
+int
+_cogl_pipeline_get_bound_texture_unit (int unit_index)
+{
+  _COGL_GET_CONTEXT (ctx, unit_index);
+
+  if (unit_index >= ctx->texture_unit_map->len)
+    return unit_index;
+
+  return g_array_index (ctx->texture_unit_map, int, unit_index);
+}
+
+void
+_cogl_pipeline_get_texture_unit_remap_stats (unsigned int *n_binds_saved,
+                                             unsigned int *n_switches_saved)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  *n_binds_saved = ctx->texture_binds_saved;
+  *n_switches_saved = ctx->active_texture_switches_saved;
+}
+
+void
+_cogl_pipeline_reset_texture_unit_remap_stats (void)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  ctx->texture_binds_saved = 0;
+  ctx->active_texture_switches_saved = 0;
+}
+
+static CoglHandle
+get_layer_texture_for_flush (CoglPipelineLayer *layer)
+{
+  CoglPipelineLayer *authority =
+    _cogl_pipeline_layer_get_authority (layer,
+                                        COGL_PIPELINE_LAYER_STATE_TEXTURE_DATA);
+
+  _COGL_GET_CONTEXT (ctx, COGL_INVALID_HANDLE);
+
+  return (authority->texture == COGL_INVALID_HANDLE ?
+          ctx->default_gl_texture_2d_tex :
+          authority->texture);
+}
+
+/* The texture units used to sample each layer only need to match the
+ * layer indices for the fixed function and ARBfp fragends and for
+ * user programs, which may refer to the units directly. When the GLSL
+ * fragend generates the whole fragment shader the unit is only
+ * referenced via the _cogl_sampler_N uniforms so we are free to pick
+ * any unit. */
+static gboolean
+can_remap_texture_units (CoglPipeline *pipeline)
+{
+#ifdef COGL_PIPELINE_FRAGEND_GLSL
+  return (pipeline->fragend == COGL_PIPELINE_FRAGEND_GLSL &&
+          cogl_pipeline_get_user_program (pipeline) == COGL_INVALID_HANDLE);
+#else
+  return FALSE;
+#endif
+}
+
+typedef struct
+{
+  int i;
+  GLuint *gl_textures;
+} CoglPipelineGetGLTexturesState;
+
+static gboolean
+get_layer_gl_textures_cb (CoglPipelineLayer *layer, void *user_data)
+{
+  CoglPipelineGetGLTexturesState *state = user_data;
+  GLenum gl_target;
+
+  cogl_texture_get_gl_texture (get_layer_texture_for_flush (layer),
+                               &state->gl_textures[state->i++],
+                               &gl_target);
+
+  return TRUE;
+}
+
+/* Finishes updating the map after the units for the first @n_layers
+ * indices have been picked. Any higher index whose unit has now been
+ * taken by one of those layers no longer has its last texture bound
+ * so it is marked as unknown. Returns whether any of the first
+ * @n_layers indices moved to a different unit */
+static gboolean
+finish_texture_unit_map (const int *old_map, int n_layers)
+{
+  int *map;
+  gboolean changed = FALSE;
+  int i, j;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  map = &g_array_index (ctx->texture_unit_map, int, 0);
+
+  for (i = n_layers; i < ctx->texture_unit_map->len; i++)
+    for (j = 0; j < n_layers; j++)
+      if (map[i] == map[j])
+        {
+          map[i] = -1;
+          break;
+        }
+
+  for (i = 0; i < n_layers; i++)
+    if (old_map[i] != map[i])
+      changed = TRUE;
+
+  return changed;
+}
+
+/* This decides which texture unit each layer of @pipeline will be
+ * bound to and stores the result in ctx->texture_unit_map.
+ *
+ * If remapping is possible we try to keep textures on the units they
+ * are already bound to so that switching between pipelines that share
+ * textures in different layer positions doesn't need to rebind
+ * anything. Any remaining layers use their own index if that unit
+ * hasn't been claimed already or otherwise the lowest free unit.
+ *
+ * Returns TRUE if any layer is mapped to a different unit than the
+ * same layer index was in the previous map. In that case the texture
+ * bound to a unit doesn't necessarily correspond to the last layer
+ * flushed for that layer index so all of the bindings need to be
+ * checked. */
+static gboolean
+update_texture_unit_map (CoglPipeline *pipeline, int n_layers)
+{
+  CoglPipelineGetGLTexturesState state;
+  int n_old_units;
+  int *old_map;
+  int n_units;
+  gboolean *claimed;
+  int *map;
+  int i, unit_index;
+
+  COGL_STATIC_COUNTER (texture_binds_saved_counter,
+                       "texture unit binds saved counter",
+                       "Increments each time remapping a layer to the "
+                       "texture unit its texture is already bound to "
+                       "avoids a glBindTexture",
+                       0 /* no application private data */);
+  COGL_STATIC_COUNTER (active_texture_saved_counter,
+                       "active texture unit switches saved counter",
+                       "Increments each time remapping a layer to the "
+                       "texture unit its texture is already bound to "
+                       "avoids a glActiveTexture",
+                       0 /* no application private data */);
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  /* The map is never shrunk so that it always remembers which unit
+   * each layer index was last flushed to, even if the previous
+   * pipeline had fewer layers. Layer indices that have never been
+   * flushed start out on their own unit and -1 means the unit is
+   * unknown */
+  n_old_units = ctx->texture_unit_map->len;
+  if (n_layers > n_old_units)
+    {
+      g_array_set_size (ctx->texture_unit_map, n_layers);
+      for (i = n_old_units; i < n_layers; i++)
+        g_array_index (ctx->texture_unit_map, int, i) = i;
+    }
+
+  map = &g_array_index (ctx->texture_unit_map, int, 0);
+  old_map = g_alloca (sizeof (int) * MAX (n_layers, 1));
+  memcpy (old_map, map, sizeof (int) * n_layers);
+
+  n_units = get_max_activateable_texture_units ();
+
+  if (!can_remap_texture_units (pipeline) || n_layers > n_units)
+    {
+      for (i = 0; i < n_layers; i++)
+        map[i] = i;
+      return finish_texture_unit_map (old_map, n_layers);
+    }
+
+  state.i = 0;
+  state.gl_textures = g_alloca (sizeof (GLuint) * n_layers);
+  _cogl_pipeline_foreach_layer_internal (pipeline,
+                                         get_layer_gl_textures_cb,
+                                         &state);
+
+  claimed = g_alloca (sizeof (gboolean) * n_units);
+  memset (claimed, 0, sizeof (gboolean) * n_units);
+
+  /* First keep any textures that are already bound where they are.
+   *
+   * NB: we can't trust the binding of a unit with a dirty_gl_texture
+   * (see _cogl_bind_gl_texture_transient) or of foreign textures
+   * whose names may have been recycled. */
+  for (i = 0; i < n_layers; i++)
+    {
+      map[i] = -1;
+
+      for (unit_index = 0;
+           unit_index < MIN (n_units, ctx->texture_units->len);
+           unit_index++)
+        {
+          CoglTextureUnit *unit =
+            &g_array_index (ctx->texture_units, CoglTextureUnit, unit_index);
+
+          if (!claimed[unit_index] &&
+              unit->gl_texture == state.gl_textures[i] &&
+              !unit->dirty_gl_texture &&
+              !unit->is_foreign)
+            {
+              map[i] = unit_index;
+              claimed[unit_index] = TRUE;
+
+              if (unit_index != i)
+                {
+                  CoglTextureUnit *default_unit = _cogl_get_texture_unit (i);
+
+                  if (default_unit->gl_texture != state.gl_textures[i])
+                    {
+                      COGL_COUNTER_INC (_cogl_uprof_context,
+                                        texture_binds_saved_counter);
+                      ctx->texture_binds_saved++;
+                      if (ctx->active_texture_unit != i)
+                        {
+                          COGL_COUNTER_INC (_cogl_uprof_context,
+                                            active_texture_saved_counter);
+                          ctx->active_texture_switches_saved++;
+                        }
+                    }
+                }
+              break;
+            }
+        }
+    }
+
+  /* Then find a home for the rest */
+  for (i = 0; i < n_layers; i++)
+    {
+      if (map[i] != -1)
+        continue;
+
+      if (!claimed[i])
+        unit_index = i;
+      else
+        for (unit_index = 0; claimed[unit_index]; unit_index++)
+          ;
+
+      map[i] = unit_index;
+      claimed[unit_index] = TRUE;
+    }
+
+  return finish_texture_unit_map (old_map, n_layers);
+}
+
+static gboolean
+is_texture_unit_1_in_use (int n_layers)
+{
+  int i;
+
+  for (i = 0; i < n_layers; i++)
+    if (_cogl_pipeline_get_bound_texture_unit (i) == 1)
+      return TRUE;
+
+  return FALSE;
+}
+
 typedef struct
 {
   int i;
   unsigned long *layer_differences;
+  gboolean check_all_bindings;
 } CoglPipelineFlushLayerState;
 
 static gboolean
@@ -776,25 +1050,26 @@ flush_layers_common_gl_state_cb (CoglPipelineLayer *layer, void *user_data)
       return FALSE;
     }
 
-  if (layers_difference & COGL_PIPELINE_LAYER_STATE_TEXTURE_DATA)
+  /* If the texture units have been remapped then the unit that the
+   * layer's texture is bound to isn't necessarily the same as last
+   * time so we always need to check the binding. */
+  if ((layers_difference & COGL_PIPELINE_LAYER_STATE_TEXTURE_DATA) ||
+      flush_state->check_all_bindings)
     {
-      unsigned long state = COGL_PIPELINE_LAYER_STATE_TEXTURE_DATA;
-      CoglPipelineLayer *authority =
-        _cogl_pipeline_layer_get_authority (layer, state);
+      int        texture_unit_index =
+        _cogl_pipeline_get_bound_texture_unit (unit_index);
+      CoglTextureUnit *texture_unit =
+        _cogl_get_texture_unit (texture_unit_index);
       CoglHandle texture;
       GLuint     gl_texture;
       GLenum     gl_target;
 
-      texture = (authority->texture == COGL_INVALID_HANDLE ?
-                 ctx->default_gl_texture_2d_tex :
-                 authority->texture);
+      texture = get_layer_texture_for_flush (layer);
 
       cogl_texture_get_gl_texture (texture,
                                    &gl_texture,
                                    &gl_target);
 
-      _cogl_set_active_texture_unit (unit_index);
-
       /* NB: There are several Cogl components and some code in
        * Clutter that will temporarily bind arbitrary GL textures to
        * query and modify texture object parameters. If you look at
@@ -820,23 +1095,29 @@ flush_layers_common_gl_state_cb (CoglPipelineLayer *layer, void *user_data)
        * associated with the texture unit then we can't assume that we
        * aren't seeing a recycled texture name so we have to bind.
        */
-      if (unit->gl_texture != gl_texture || unit->is_foreign)
+      if (texture_unit->gl_texture != gl_texture || texture_unit->is_foreign)
         {
-          if (unit_index == 1)
-            unit->dirty_gl_texture = TRUE;
+          if (texture_unit_index == 1)
+            texture_unit->dirty_gl_texture = TRUE;
           else
-            GE (ctx, glBindTexture (gl_target, gl_texture));
-          unit->gl_texture = gl_texture;
-          unit->gl_target = gl_target;
+            {
+              _cogl_set_active_texture_unit (texture_unit_index);
+              GE (ctx, glBindTexture (gl_target, gl_texture));
+            }
+          texture_unit->gl_texture = gl_texture;
+          texture_unit->gl_target = gl_target;
         }
 
-      unit->is_foreign = _cogl_texture_is_foreign (texture);
+      texture_unit->is_foreign = _cogl_texture_is_foreign (texture);
 
       /* The texture_storage_changed boolean indicates if the
        * CoglTexture's underlying GL texture storage has changed since
        * it was flushed to the texture unit. We've just flushed the
        * latest state so we can reset this. */
-      unit->texture_storage_changed = FALSE;
+      texture_unit->texture_storage_changed = FALSE;
+
+      /* Looking up the bound unit may have grown the array of units */
+      unit = _cogl_get_texture_unit (unit_index);
     }
 
   /* Under GLES2 the fragment shader will use gl_PointCoord instead of
@@ -876,6 +1157,7 @@ _cogl_pipeline_flush_common_gl_state (CoglPipeline  *pipeline,
                                       gboolean       skip_gl_color)
 {
   CoglPipelineFlushLayerState state;
+  int n_layers = cogl_pipeline_get_n_layers (pipeline);
 
   _COGL_GET_CONTEXT (ctx, NO_RETVAL);
 
@@ -885,6 +1167,7 @@ _cogl_pipeline_flush_common_gl_state (CoglPipeline  *pipeline,
 
   state.i = 0;
   state.layer_differences = layer_differences;
+  state.check_all_bindings = update_texture_unit_map (pipeline, n_layers);
   _cogl_pipeline_foreach_layer_internal (pipeline,
                                          flush_layers_common_gl_state_cb,
                                          &state);
@@ -991,6 +1274,7 @@ compare_layer_differences_cb (CoglPipelineLayer *layer, void *user_data)
 {
   CoglPipelineCompareLayersState *state = user_data;
   CoglTextureUnit *unit = _cogl_get_texture_unit (state->i);
+  int bound_unit_index;
 
   if (unit->layer == layer)
     state->layer_differences[state->i] = unit->layer_changes_since_flush;
@@ -1011,7 +1295,9 @@ compare_layer_differences_cb (CoglPipelineLayer *layer, void *user_data)
    * unit->texture_intern_changed flag. If we see that's been set here
    * then we force an update of the texture state...
    */
-  if (unit->texture_storage_changed)
+  bound_unit_index = _cogl_pipeline_get_bound_texture_unit (state->i);
+  if (bound_unit_index != -1 &&
+      _cogl_get_texture_unit (bound_unit_index)->texture_storage_changed)
     state->layer_differences[state->i] |=
       COGL_PIPELINE_LAYER_STATE_TEXTURE_DATA;
 
@@ -1199,29 +1485,11 @@ _cogl_pipeline_flush_gl_state (CoglPipeline *pipeline,
   else
     layer_differences = NULL;
 
-  /* First flush everything that's the same regardless of which
-   * pipeline backend is being used...
-   *
-   * 1) top level state:
-   *  glColor (or skip if a vertex attribute is being used for color)
-   *  blend state
-   *  alpha test state (except for GLES 2.0)
-   *
-   * 2) then foreach layer:
-   *  determine gl_target/gl_texture
-   *  bind texture
-   *
-   *  Note: After _cogl_pipeline_flush_common_gl_state you can expect
-   *  all state of the layers corresponding texture unit to be
-   *  updated.
-   */
-  _cogl_pipeline_flush_common_gl_state (pipeline,
-                                        pipelines_difference,
-                                        layer_differences,
-                                        skip_gl_color);
-
-  /* Now flush the fragment processing state according to the current
-   * fragment processing backend.
+  /* Flush the fragment processing state according to the current
+   * fragment processing backend. This is done before the common
+   * state so that the fragend is known when deciding which texture
+   * units the layers are bound to. The fragends don't depend on the
+   * textures already being bound.
    *
    * Note: Some of the backends may not support the current pipeline
    * configuration and in that case it will report an error and we
@@ -1281,6 +1549,27 @@ _cogl_pipeline_flush_gl_state (CoglPipeline *pipeline,
   if (G_UNLIKELY (i >= G_N_ELEMENTS (_cogl_pipeline_fragends)))
     g_warning ("No usable pipeline fragment backend was found!");
 
+  /* Then flush everything that's the same regardless of which
+   * pipeline backend is being used...
+   *
+   * 1) top level state:
+   *  glColor (or skip if a vertex attribute is being used for color)
+   *  blend state
+   *  alpha test state (except for GLES 2.0)
+   *
+   * 2) then foreach layer:
+   *  determine gl_target/gl_texture
+   *  bind texture
+   *
+   *  Note: After _cogl_pipeline_flush_common_gl_state you can expect
+   *  all state of the layers corresponding texture unit to be
+   *  updated.
+   */
+  _cogl_pipeline_flush_common_gl_state (pipeline,
+                                        pipelines_difference,
+                                        layer_differences,
+                                        skip_gl_color);
+
   /* Now flush the vertex processing state according to the current
    * vertex processing backend.
    */
@@ -1383,7 +1672,7 @@ done:
    * modes with the texture objects not the texture units... */
   foreach_texture_unit_update_filter_and_wrap_modes ();
 
-  /* If this pipeline has more than one layer then we always need
+  /* If this pipeline samples from texture unit 1 then we always need
    * to make sure we rebind the texture for unit 1.
    *
    * NB: various components of Cogl may temporarily bind arbitrary
@@ -1392,7 +1681,8 @@ done:
    * _cogl_bind_gl_texture_transient)
    */
   unit1 = _cogl_get_texture_unit (1);
-  if (cogl_pipeline_get_n_layers (pipeline) > 1 && unit1->dirty_gl_texture)
+  if (unit1->dirty_gl_texture &&
+      is_texture_unit_1_in_use (cogl_pipeline_get_n_layers (pipeline)))
     {
       _cogl_set_active_texture_unit (1);
       GE (ctx, glBindTexture (unit1->gl_target, unit1->gl_texture));
@@ -35,6 +35,7 @@
 #include "cogl-object-private.h"
 #include "cogl-profile.h"
 #include "cogl-queue.h"
+#include "cogl-util.h"
 
 #include <glib.h>
 
@@ -744,11 +745,12 @@ struct _CoglPipeline
    * const GList of layers, which we track here... */
   GList                *deprecated_get_layers_list;
 
-  /* XXX: consider adding an authorities cache to speed up sparse
-   * property value lookups:
-   * CoglPipeline *authorities_cache[COGL_PIPELINE_N_SPARSE_PROPERTIES];
-   * and corresponding authorities_cache_dirty:1 bitfield
-   */
+  /* A lazily allocated, flattened table of the authority for each
+   * sparse state group so that looking up a property value doesn't
+   * need to walk up the ancestry. This is indexed by
+   * CoglPipelineStateIndex and is only valid when
+   * ->authorities_cache_dirty is FALSE. */
+  CoglPipeline        **authorities_cache;
 
   /* bitfields */
 
@@ -775,6 +777,10 @@ struct _CoglPipeline
   unsigned int          layers_cache_dirty:1;
   unsigned int          deprecated_get_layers_list_dirty:1;
 
+  /* Note: we maintain the invariable that if a pipeline has a dirty
+   * authorities_cache then so do all of its descendants. */
+  unsigned int          authorities_cache_dirty:1;
+
   /* For debugging purposes it's possible to associate a static const
    * string with a pipeline which can be an aid when trying to trace
    * where the pipeline originates from */
@@ -873,11 +879,29 @@ _cogl_pipeline_get_parent (CoglPipeline *pipeline)
   return COGL_PIPELINE (parent_node);
 }
 
+void
+_cogl_pipeline_dirty_authorities_cache (CoglPipeline *pipeline);
+
+void
+_cogl_pipeline_update_authorities_cache (CoglPipeline *pipeline);
+
 static inline CoglPipeline *
 _cogl_pipeline_get_authority (CoglPipeline *pipeline,
                               unsigned long difference)
 {
-  CoglPipeline *authority = pipeline;
+  CoglPipeline *authority;
+
+  /* The common case is looking up a single sparse state group which
+   * we can resolve directly from the authorities cache... */
+  if (G_LIKELY ((difference & (difference - 1)) == 0 &&
+                (difference & COGL_PIPELINE_STATE_ALL_SPARSE)))
+    {
+      if (G_UNLIKELY (pipeline->authorities_cache_dirty))
+        _cogl_pipeline_update_authorities_cache (pipeline);
+      return pipeline->authorities_cache[_cogl_util_ffs (difference) - 1];
+    }
+
+  authority = pipeline;
   while (!(authority->differences & difference))
     authority = _cogl_pipeline_get_parent (authority);
   return authority;
@@ -83,6 +83,11 @@ typedef struct _UnitState
   unsigned int dirty_combine_constant:1;
   unsigned int dirty_texture_matrix:1;
 
+  GLint sampler_uniform;
+  /* The texture unit that sampler_uniform was last set to or -1 if
+     it hasn't been set since the program was linked */
+  int sampler_unit;
+
   GLint combine_constant_uniform;
 
   GLint texture_matrix_uniform;
@@ -423,12 +428,12 @@ get_uniform_cb (CoglPipeline *pipeline,
           ctx, glGetUniformLocation (state->gl_program,
                                      ctx->codegen_source_buffer->str) );
 
-  /* We can set the uniform immediately because the samplers are the
-     unit index not the texture object number so it will never
-     change. Unfortunately GL won't let us use a constant instead of a
-     uniform */
-  if (uniform_location != -1)
-    GE( ctx, glUniform1i (uniform_location, state->unit) );
+  /* The texture unit that each layer is bound to may be remapped
+     whenever a pipeline is flushed (see update_texture_unit_map in
+     cogl-pipeline-opengl.c) so the value of the sampler is updated
+     along with the other constants in update_constants_cb */
+  unit_state->sampler_uniform = uniform_location;
+  unit_state->sampler_unit = -1;
 
   g_string_set_size (ctx->codegen_source_buffer, 0);
   g_string_append_printf (ctx->codegen_source_buffer,
@@ -467,10 +472,22 @@ update_constants_cb (CoglPipeline *pipeline,
 {
   UpdateUniformsState *state = user_data;
   CoglPipelineProgramState *program_state = state->program_state;
-  UnitState *unit_state = &program_state->unit_state[state->unit++];
+  int unit_index = state->unit++;
+  UnitState *unit_state = &program_state->unit_state[unit_index];
 
   _COGL_GET_CONTEXT (ctx, FALSE);
 
+  if (unit_state->sampler_uniform != -1)
+    {
+      int texture_unit = _cogl_pipeline_get_bound_texture_unit (unit_index);
+
+      if (unit_state->sampler_unit != texture_unit)
+        {
+          GE (ctx, glUniform1i (unit_state->sampler_uniform, texture_unit));
+          unit_state->sampler_unit = texture_unit;
+        }
+    }
+
   if (unit_state->combine_constant_uniform != -1 &&
       (state->update_all || unit_state->dirty_combine_constant))
     {
@@ -831,10 +831,11 @@ cogl_pipeline_set_blend (CoglPipeline *pipeline,
   g_return_val_if_fail (cogl_is_pipeline (pipeline), FALSE);
 
   count =
-    _cogl_blend_string_compile (blend_description,
-                                COGL_BLEND_STRING_CONTEXT_BLENDING,
-                                statements,
-                                &internal_error);
+    _cogl_blend_string_cache_compile (ctx->blend_string_cache,
+                                      blend_description,
+                                      COGL_BLEND_STRING_CONTEXT_BLENDING,
+                                      statements,
+                                      &internal_error);
   if (!count)
     {
       if (error)
@@ -898,7 +899,10 @@ cogl_pipeline_set_blend (CoglPipeline *pipeline,
         _cogl_pipeline_get_authority (parent, state);
 
       if (_cogl_pipeline_blend_state_equal (authority, old_authority))
-        pipeline->differences &= ~state;
+        {
+          pipeline->differences &= ~state;
+          _cogl_pipeline_dirty_authorities_cache (pipeline);
+        }
     }
 
   /* If we weren't previously the authority on this state then we need
@@ -908,6 +912,7 @@ cogl_pipeline_set_blend (CoglPipeline *pipeline,
   if (pipeline != authority)
     {
       pipeline->differences |= state;
+      _cogl_pipeline_dirty_authorities_cache (pipeline);
       _cogl_pipeline_prune_redundant_ancestry (pipeline);
     }
 
@@ -1013,7 +1018,10 @@ cogl_pipeline_set_user_program (CoglPipeline *pipeline,
         _cogl_pipeline_get_authority (parent, state);
 
       if (old_authority->big_state->user_program == program)
-        pipeline->differences &= ~state;
+        {
+          pipeline->differences &= ~state;
+          _cogl_pipeline_dirty_authorities_cache (pipeline);
+        }
     }
   else if (pipeline != authority)
     {
@@ -1022,6 +1030,7 @@ cogl_pipeline_set_user_program (CoglPipeline *pipeline,
        * that some of our ancestry will now become redundant, so we
        * aim to reparent ourselves if that's true... */
       pipeline->differences |= state;
+      _cogl_pipeline_dirty_authorities_cache (pipeline);
       _cogl_pipeline_prune_redundant_ancestry (pipeline);
     }
 
@@ -50,6 +50,14 @@ typedef struct
   GLuint gl_shader;
   GString *header, *source;
 
+  /* Copies of the last generated source. The generated code doesn't
+     depend on the user program so if the shader needs to be
+     recompiled because the user program changed we can skip the
+     code generation */
+  char *cached_header, *cached_source;
+  int n_tex_coord_attribs;
+  gboolean needs_compile;
+
   /* Age of the user program that was current when the shader was
      generated. We need to keep track of this because if the user
      program changes then we may need to redecide whether to generate
@@ -88,6 +96,9 @@ destroy_shader_state (void *user_data)
       if (shader_state->gl_shader)
         GE( ctx, glDeleteShader (shader_state->gl_shader) );
 
+      g_free (shader_state->cached_header);
+      g_free (shader_state->cached_source);
+
       g_slice_free (CoglPipelineShaderState, shader_state);
     }
 }
@@ -130,6 +141,7 @@ _cogl_pipeline_vertend_glsl_start (CoglPipeline *pipeline,
   CoglPipelineShaderState *shader_state;
   CoglPipeline *template_pipeline = NULL;
   CoglProgram *user_program;
+  gboolean recorded_codegen = FALSE;
 
   _COGL_GET_CONTEXT (ctx, FALSE);
 
@@ -175,6 +187,14 @@ _cogl_pipeline_vertend_glsl_start (CoglPipeline *pipeline,
                                                           authority);
 
               shader_state = get_shader_state (template_pipeline);
+
+              if (shader_state && shader_state->cached_source)
+                {
+                  _cogl_pipeline_cache_record_codegen (ctx->pipeline_cache,
+                                                       GL_VERTEX_SHADER,
+                                                       TRUE);
+                  recorded_codegen = TRUE;
+                }
             }
 
           if (shader_state)
@@ -225,28 +245,50 @@ _cogl_pipeline_vertend_glsl_start (CoglPipeline *pipeline,
       _cogl_program_has_vertex_shader (user_program))
     return TRUE;
 
-  /* We reuse two grow-only GStrings for code-gen. One string
-     contains the uniform and attribute declarations while the
-     other contains the main function. We need two strings
-     because we need to dynamically declare attributes as the
-     add_layer callback is invoked */
-  g_string_set_size (ctx->codegen_header_buffer, 0);
-  g_string_set_size (ctx->codegen_source_buffer, 0);
-  shader_state->header = ctx->codegen_header_buffer;
-  shader_state->source = ctx->codegen_source_buffer;
-
-  g_string_append (shader_state->source,
-                   "void\n"
-                   "main ()\n"
-                   "{\n");
-
-  if (ctx->driver == COGL_DRIVER_GLES2)
-    /* There is no builtin uniform for the pointsize on GLES2 so we need
-       to copy it from the custom uniform in the vertex shader */
-    g_string_append (shader_state->source,
-                     "  cogl_point_size_out = cogl_point_size_in;\n");
+  shader_state->needs_compile = TRUE;
+
+  /* If we've already generated the source for this state then we can
+     just compile that again. We still need to go through the rest of
+     the flush for the point size below though */
+  if (shader_state->cached_source)
+    {
+      if (!recorded_codegen)
+        _cogl_pipeline_cache_record_codegen (ctx->pipeline_cache,
+                                             GL_VERTEX_SHADER,
+                                             TRUE);
+    }
+  else
+    {
+      _cogl_pipeline_cache_record_codegen (ctx->pipeline_cache,
+                                           GL_VERTEX_SHADER,
+                                           FALSE);
+
+      /* We reuse two grow-only GStrings for code-gen. One string
+         contains the uniform and attribute declarations while the
+         other contains the main function. We need two strings
+         because we need to dynamically declare attributes as the
+         add_layer callback is invoked */
+      g_string_set_size (ctx->codegen_header_buffer, 0);
+      g_string_set_size (ctx->codegen_source_buffer, 0);
+      shader_state->header = ctx->codegen_header_buffer;
+      shader_state->source = ctx->codegen_source_buffer;
+
+      g_string_append (shader_state->source,
+                       "void\n"
+                       "main ()\n"
+                       "{\n");
+
+      if (ctx->driver == COGL_DRIVER_GLES2)
+        /* There is no builtin uniform for the pointsize on GLES2 so
+           we need to copy it from the custom uniform in the vertex
+           shader */
+        g_string_append (shader_state->source,
+                         "  cogl_point_size_out = cogl_point_size_in;\n");
+    }
+
   /* On regular OpenGL we'll just flush the point size builtin */
-  else if (pipelines_difference & COGL_PIPELINE_STATE_POINT_SIZE)
+  if (ctx->driver != COGL_DRIVER_GLES2 &&
+      (pipelines_difference & COGL_PIPELINE_STATE_POINT_SIZE))
     {
       CoglPipeline *authority =
         _cogl_pipeline_get_authority (pipeline, COGL_PIPELINE_STATE_POINT_SIZE);
@@ -330,12 +372,33 @@ _cogl_pipeline_vertend_glsl_end (CoglPipeline *pipeline,
   shader_state = get_shader_state (pipeline);
 
   if (shader_state->source)
+    {
+      g_string_append (shader_state->source,
+                       "  cogl_position_out = "
+                       "cogl_modelview_projection_matrix * "
+                       "cogl_position_in;\n"
+                       "  cogl_color_out = cogl_color_in;\n"
+                       "}\n");
+
+      shader_state->n_tex_coord_attribs =
+        cogl_pipeline_get_n_layers (pipeline);
+
+      g_free (shader_state->cached_header);
+      g_free (shader_state->cached_source);
+      shader_state->cached_header = g_strndup (shader_state->header->str,
+                                               shader_state->header->len);
+      shader_state->cached_source = g_strndup (shader_state->source->str,
+                                               shader_state->source->len);
+
+      shader_state->header = NULL;
+      shader_state->source = NULL;
+    }
+
+  if (shader_state->needs_compile)
     {
       const char *source_strings[2];
-      GLint lengths[2];
       GLint compile_status;
       GLuint shader;
-      int n_layers;
 
       COGL_STATIC_COUNTER (vertend_glsl_compile_counter,
                            "glsl vertex compile counter",
@@ -344,26 +407,17 @@ _cogl_pipeline_vertend_glsl_end (CoglPipeline *pipeline,
                            0 /* no application private data */);
       COGL_COUNTER_INC (_cogl_uprof_context, vertend_glsl_compile_counter);
 
-      g_string_append (shader_state->source,
-                       "  cogl_position_out = "
-                       "cogl_modelview_projection_matrix * "
-                       "cogl_position_in;\n"
-                       "  cogl_color_out = cogl_color_in;\n"
-                       "}\n");
-
       GE_RET( shader, ctx, glCreateShader (GL_VERTEX_SHADER) );
 
-      lengths[0] = shader_state->header->len;
-      source_strings[0] = shader_state->header->str;
-      lengths[1] = shader_state->source->len;
-      source_strings[1] = shader_state->source->str;
-
-      n_layers = cogl_pipeline_get_n_layers (pipeline);
+      source_strings[0] = shader_state->cached_header;
+      source_strings[1] = shader_state->cached_source;
 
       _cogl_shader_set_source_with_boilerplate (shader, GL_VERTEX_SHADER,
-                                                n_layers,
+                                                shader_state->
+                                                n_tex_coord_attribs,
                                                 2, /* count */
-                                                source_strings, lengths);
+                                                source_strings,
+                                                NULL /* null terminated */);
 
       GE( ctx, glCompileShader (shader) );
       GE( ctx, glGetShaderiv (shader, GL_COMPILE_STATUS, &compile_status) );
@@ -379,8 +433,7 @@ _cogl_pipeline_vertend_glsl_end (CoglPipeline *pipeline,
           g_warning ("Shader compilation failed:\n%s", shader_log);
         }
 
-      shader_state->header = NULL;
-      shader_state->source = NULL;
+      shader_state->needs_compile = FALSE;
       shader_state->gl_shader = shader;
     }
 
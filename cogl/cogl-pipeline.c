@@ -229,6 +229,9 @@ _cogl_pipeline_init_default_pipeline (void)
   pipeline->vertend = COGL_PIPELINE_VERTEND_UNDEFINED;
   pipeline->differences = COGL_PIPELINE_STATE_ALL_SPARSE;
 
+  pipeline->authorities_cache = NULL;
+  pipeline->authorities_cache_dirty = TRUE;
+
   pipeline->real_blend_enable = FALSE;
 
   pipeline->blend_enable = COGL_PIPELINE_BLEND_ENABLE_AUTOMATIC;
@@ -343,6 +346,69 @@ recursively_free_layer_caches (CoglPipeline *pipeline)
                                      NULL);
 }
 
+static gboolean
+recursively_dirty_authorities_caches_cb (CoglPipelineNode *node,
+                                         void *user_data)
+{
+  _cogl_pipeline_dirty_authorities_cache (COGL_PIPELINE (node));
+  return TRUE;
+}
+
+/* This marks the authorities_cache of a pipeline and all of its
+ * descendants as dirty.
+ *
+ * This must be called whenever a pipeline's ->differences mask or its
+ * ancestry changes since that may change which pipeline is the
+ * authority for some state group of any of its descendants. */
+void
+_cogl_pipeline_dirty_authorities_cache (CoglPipeline *pipeline)
+{
+  if (pipeline->authorities_cache_dirty)
+    return;
+
+  pipeline->authorities_cache_dirty = TRUE;
+
+  _cogl_pipeline_node_foreach_child (COGL_PIPELINE_NODE (pipeline),
+                                     recursively_dirty_authorities_caches_cb,
+                                     NULL);
+}
+
+void
+_cogl_pipeline_update_authorities_cache (CoglPipeline *pipeline)
+{
+  CoglPipeline *parent = _cogl_pipeline_get_parent (pipeline);
+  unsigned long differences;
+
+  if (G_LIKELY (!pipeline->authorities_cache_dirty))
+    return;
+
+  if (pipeline->authorities_cache == NULL)
+    pipeline->authorities_cache =
+      g_slice_alloc (sizeof (CoglPipeline *) *
+                     COGL_PIPELINE_STATE_SPARSE_COUNT);
+
+  /* To maintain the invariable that a dirty cache implies dirty
+   * caches for all descendants we always derive our cache from an
+   * up to date parent cache. Only the root pipeline is an authority
+   * for all sparse state so that terminates the recursion. */
+  if (parent)
+    {
+      _cogl_pipeline_update_authorities_cache (parent);
+      memcpy (pipeline->authorities_cache, parent->authorities_cache,
+              sizeof (CoglPipeline *) * COGL_PIPELINE_STATE_SPARSE_COUNT);
+    }
+
+  differences = pipeline->differences & COGL_PIPELINE_STATE_ALL_SPARSE;
+  while (differences)
+    {
+      int index = _cogl_util_ffs (differences) - 1;
+      pipeline->authorities_cache[index] = pipeline;
+      differences &= ~(1L << index);
+    }
+
+  pipeline->authorities_cache_dirty = FALSE;
+}
+
 static void
 _cogl_pipeline_set_parent (CoglPipeline *pipeline,
                            CoglPipeline *parent,
@@ -359,6 +425,10 @@ _cogl_pipeline_set_parent (CoglPipeline *pipeline,
   if (pipeline->differences & COGL_PIPELINE_STATE_LAYERS)
     recursively_free_layer_caches (pipeline);
 
+  /* Similarly the authority for any state group may now be different
+   * for this pipeline and all of its descendants... */
+  _cogl_pipeline_dirty_authorities_cache (pipeline);
+
   /* If the backends are also caching state along with the pipeline
    * that depends on the pipeline's ancestry then it may be notified
    * here...
@@ -447,6 +517,9 @@ _cogl_pipeline_copy (CoglPipeline *src, gboolean is_weak)
   pipeline->deprecated_get_layers_list = NULL;
   pipeline->deprecated_get_layers_list_dirty = TRUE;
 
+  pipeline->authorities_cache = NULL;
+  pipeline->authorities_cache_dirty = TRUE;
+
   pipeline->fragend = src->fragend;
 
   pipeline->vertend = src->vertend;
@@ -552,6 +625,10 @@ _cogl_pipeline_free (CoglPipeline *pipeline)
 
   recursively_free_layer_caches (pipeline);
 
+  if (pipeline->authorities_cache)
+    g_slice_free1 (sizeof (CoglPipeline *) * COGL_PIPELINE_STATE_SPARSE_COUNT,
+                   pipeline->authorities_cache);
+
   g_slice_free (CoglPipeline, pipeline);
 }
 
@@ -1070,6 +1147,7 @@ check_for_blending_change:
     _cogl_pipeline_update_blend_enable (dest, differences);
 
   dest->differences |= differences;
+  _cogl_pipeline_dirty_authorities_cache (dest);
 }
 
 static void
@@ -1395,6 +1473,7 @@ _cogl_pipeline_pre_change_notify (CoglPipeline     *pipeline,
     {
       _cogl_pipeline_init_multi_property_sparse_state (pipeline, change);
       pipeline->differences |= change;
+      _cogl_pipeline_dirty_authorities_cache (pipeline);
     }
 
   /* Each pipeline has a sorted cache of the layers it depends on
@@ -1439,6 +1518,7 @@ _cogl_pipeline_add_layer_difference (CoglPipeline *pipeline,
                                     !inc_n_layers);
 
   pipeline->differences |= COGL_PIPELINE_STATE_LAYERS;
+  _cogl_pipeline_dirty_authorities_cache (pipeline);
 
   pipeline->layer_differences =
     g_list_prepend (pipeline->layer_differences, layer);
@@ -1473,6 +1553,7 @@ _cogl_pipeline_remove_layer_difference (CoglPipeline *pipeline,
   cogl_object_unref (layer);
 
   pipeline->differences |= COGL_PIPELINE_STATE_LAYERS;
+  _cogl_pipeline_dirty_authorities_cache (pipeline);
 
   pipeline->layer_differences =
     g_list_remove (pipeline->layer_differences, layer);
@@ -1499,7 +1580,10 @@ _cogl_pipeline_try_reverting_layers_authority (CoglPipeline *authority,
         }
 
       if (old_authority->n_layers == authority->n_layers)
-        authority->differences &= ~COGL_PIPELINE_STATE_LAYERS;
+        {
+          authority->differences &= ~COGL_PIPELINE_STATE_LAYERS;
+          _cogl_pipeline_dirty_authorities_cache (authority);
+        }
     }
 }
 
@@ -1573,6 +1657,7 @@ _cogl_pipeline_prune_to_n_layers (CoglPipeline *pipeline, int n)
                                          &state);
 
   pipeline->differences |= COGL_PIPELINE_STATE_LAYERS;
+  _cogl_pipeline_dirty_authorities_cache (pipeline);
   pipeline->n_layers = n;
 
   /* It's possible that this pipeline owns some of the layers being
@@ -1587,6 +1672,7 @@ _cogl_pipeline_prune_to_n_layers (CoglPipeline *pipeline, int n)
     }
 
   pipeline->differences |= COGL_PIPELINE_STATE_LAYERS;
+  _cogl_pipeline_dirty_authorities_cache (pipeline);
 }
 
 static void
@@ -2605,34 +2691,16 @@ _cogl_pipeline_resolve_authorities (CoglPipeline *pipeline,
                                     unsigned long differences,
                                     CoglPipeline **authorities)
 {
-  unsigned long remaining = differences;
-  CoglPipeline *authority = pipeline;
-
-  do
-    {
-      unsigned long found = authority->differences & remaining;
-      int i;
-
-      if (found == 0)
-        continue;
-
-      for (i = 0; TRUE; i++)
-        {
-          unsigned long state = (1L<<i);
+  unsigned long remaining = differences & COGL_PIPELINE_STATE_ALL_SPARSE;
 
-          if (state & found)
-            authorities[i] = authority;
-          else if (state > found)
-            break;
-        }
+  _cogl_pipeline_update_authorities_cache (pipeline);
 
-      remaining &= ~found;
-      if (remaining == 0)
-        return;
+  while (remaining)
+    {
+      int index = _cogl_util_ffs (remaining) - 1;
+      authorities[index] = pipeline->authorities_cache[index];
+      remaining &= ~(1L << index);
     }
-  while ((authority = _cogl_pipeline_get_parent (authority)));
-
-  g_assert (remaining == 0);
 }
 
 /* Comparison of two arbitrary pipelines is done by:
@@ -2868,7 +2936,10 @@ _cogl_pipeline_update_authority (CoglPipeline *pipeline,
         _cogl_pipeline_get_authority (parent, state);
 
       if (comparitor (authority, old_authority))
-        pipeline->differences &= ~state;
+        {
+          pipeline->differences &= ~state;
+          _cogl_pipeline_dirty_authorities_cache (pipeline);
+        }
     }
   else if (pipeline != authority)
     {
@@ -2877,6 +2948,7 @@ _cogl_pipeline_update_authority (CoglPipeline *pipeline,
        * that some of our ancestry will now become redundant, so we
        * aim to reparent ourselves if that's true... */
       pipeline->differences |= state;
+      _cogl_pipeline_dirty_authorities_cache (pipeline);
       _cogl_pipeline_prune_redundant_ancestry (pipeline);
     }
 }
@@ -61,6 +61,9 @@ _cogl_push_source (CoglPipeline *pipeline, gboolean enable_legacy);
 gboolean
 _cogl_get_enable_legacy_state (void);
 
+gboolean
+_cogl_has_unflushed_journals (void);
+
 G_END_DECLS
 
 #endif /* __COGL_PRIVATE_H__ */
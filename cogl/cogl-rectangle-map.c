@@ -29,6 +29,7 @@
 #endif
 
 #include <glib.h>
+#include <stdio.h>
 
 #include "cogl-rectangle-map.h"
 #include "cogl-debug.h"
@@ -71,12 +72,24 @@ struct _CoglRectangleMap
 
   unsigned int space_remaining;
 
+  CoglRectangleMapPolicy policy;
+
   GDestroyNotify value_destroy_func;
 
   /* Stack used for walking the structure. This is only used during
      the lifetime of a single function call but it is kept here as an
      optimisation to avoid reallocating it every time it is needed */
   GArray *stack;
+
+#ifdef COGL_ENABLE_DEBUG
+  /* File that the additions and removals are written to when the
+     trace-rectangle-maps debug option is enabled or NULL otherwise */
+  FILE *trace_file;
+  /* Maps the position of each rectangle in the map to the id that it
+     was given in the trace */
+  GHashTable *trace_ids;
+  unsigned int next_trace_id;
+#endif
 };
 
 struct _CoglRectangleMapNode
@@ -124,6 +137,83 @@ _cogl_rectangle_map_node_free (CoglRectangleMapNode *node)
   g_slice_free (CoglRectangleMapNode, node);
 }
 
+#ifdef COGL_ENABLE_DEBUG
+
+/* The traces use the same format as the tests/micro-perf/
+   test-rectangle-map benchmark so that the operations of a real
+   application can be replayed with each of the packing policies */
+
+static void
+_cogl_rectangle_map_trace_begin (CoglRectangleMap *map,
+                                 unsigned int width,
+                                 unsigned int height)
+{
+  static unsigned int n_traces = 0;
+  char *filename;
+
+  filename = g_strdup_printf ("cogl-rectangle-map-%u.trace", n_traces++);
+  map->trace_file = fopen (filename, "w");
+
+  if (map->trace_file == NULL)
+    g_warning ("Failed to open %s to trace the rectangle map", filename);
+  else
+    {
+      fprintf (map->trace_file, "size %u %u\n", width, height);
+      map->trace_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+      map->next_trace_id = 0;
+    }
+
+  g_free (filename);
+}
+
+static void *
+_cogl_rectangle_map_trace_get_key (const CoglRectangleMapEntry *rectangle)
+{
+  /* No two rectangles in the map can start at the same position */
+  return GUINT_TO_POINTER ((rectangle->y << 16) | rectangle->x);
+}
+
+static void
+_cogl_rectangle_map_trace_add (CoglRectangleMap *map,
+                               unsigned int width,
+                               unsigned int height,
+                               const CoglRectangleMapEntry *rectangle)
+{
+  unsigned int id = map->next_trace_id++;
+
+  /* Additions that didn't fit are traced as well so that the replay
+     sees the same demand. rectangle is NULL for those */
+  fprintf (map->trace_file, "add %u %u %u\n", id, width, height);
+
+  if (rectangle)
+    g_hash_table_insert (map->trace_ids,
+                         _cogl_rectangle_map_trace_get_key (rectangle),
+                         GUINT_TO_POINTER (id));
+}
+
+static void
+_cogl_rectangle_map_trace_remove (CoglRectangleMap *map,
+                                  const CoglRectangleMapEntry *rectangle)
+{
+  void *key = _cogl_rectangle_map_trace_get_key (rectangle);
+  void *id;
+
+  if (g_hash_table_lookup_extended (map->trace_ids, key, NULL, &id))
+    {
+      fprintf (map->trace_file, "remove %u\n", GPOINTER_TO_UINT (id));
+      g_hash_table_remove (map->trace_ids, key);
+    }
+}
+
+static void
+_cogl_rectangle_map_trace_end (CoglRectangleMap *map)
+{
+  fclose (map->trace_file);
+  g_hash_table_destroy (map->trace_ids);
+}
+
+#endif /* COGL_ENABLE_DEBUG */
+
 CoglRectangleMap *
 _cogl_rectangle_map_new (unsigned int width,
                          unsigned int height,
@@ -144,9 +234,16 @@ _cogl_rectangle_map_new (unsigned int width,
   map->n_rectangles = 0;
   map->value_destroy_func = value_destroy_func;
   map->space_remaining = width * height;
+  map->policy = COGL_RECTANGLE_MAP_FIRST_FIT;
 
   map->stack = g_array_new (FALSE, FALSE, sizeof (CoglRectangleMapStackEntry));
 
+#ifdef COGL_ENABLE_DEBUG
+  map->trace_file = NULL;
+  if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_RECTANGLE_MAP_TRACE)))
+    _cogl_rectangle_map_trace_begin (map, width, height);
+#endif
+
   return map;
 }
 
@@ -340,6 +437,50 @@ _cogl_rectangle_map_verify (CoglRectangleMap *map)
 
 #endif /* COGL_ENABLE_DEBUG */
 
+void
+_cogl_rectangle_map_set_policy (CoglRectangleMap *map,
+                                CoglRectangleMapPolicy policy)
+{
+  map->policy = policy;
+}
+
+static guint64
+_cogl_rectangle_map_score_node (CoglRectangleMapPolicy policy,
+                                CoglRectangleMapNode *node,
+                                unsigned int width,
+                                unsigned int height)
+{
+  unsigned int leftover_width = node->rectangle.width - width;
+  unsigned int leftover_height = node->rectangle.height - height;
+  unsigned int short_side = MIN (leftover_width, leftover_height);
+  unsigned int long_side = MAX (leftover_width, leftover_height);
+
+  /* Returns a score for putting the rectangle in the given empty
+     node. Lower scores are better and a score of zero is a perfect
+     fit */
+  switch (policy)
+    {
+    case COGL_RECTANGLE_MAP_BEST_AREA_FIT:
+      return (((guint64) (node->rectangle.width * node->rectangle.height -
+                          width * height) << 32) |
+              short_side);
+
+    case COGL_RECTANGLE_MAP_BEST_SHORT_SIDE_FIT:
+      return ((guint64) short_side << 32) | long_side;
+
+    case COGL_RECTANGLE_MAP_SHELF:
+      /* Prefer the row with the closest height and then the rows
+         nearest the top so that the bottom is kept free for new
+         rows */
+      return ((guint64) leftover_height << 32) | node->rectangle.y;
+
+    case COGL_RECTANGLE_MAP_FIRST_FIT:
+      break;
+    }
+
+  return 0;
+}
+
 gboolean
 _cogl_rectangle_map_add (CoglRectangleMap *map,
                          unsigned int width,
@@ -351,6 +492,7 @@ _cogl_rectangle_map_add (CoglRectangleMap *map,
   /* Stack of nodes to search in */
   GArray *stack = map->stack;
   CoglRectangleMapNode *found_node = NULL;
+  guint64 best_score = G_MAXUINT64;
 
   /* Zero-sized rectangles break the algorithm for removing rectangles
      so we'll disallow them */
@@ -360,7 +502,9 @@ _cogl_rectangle_map_add (CoglRectangleMap *map,
   g_array_set_size (stack, 0);
   _cogl_rectangle_map_stack_push (stack, map->root, FALSE);
 
-  /* Depth-first search for an empty node that is big enough */
+  /* Depth-first search for an empty node that is big enough. With
+     the first fit policy we stop at the first one, otherwise we keep
+     looking for the one with the best score */
   while (stack->len > 0)
     {
       CoglRectangleMapStackEntry *stack_top;
@@ -382,9 +526,21 @@ _cogl_rectangle_map_add (CoglRectangleMap *map,
         {
           if (node->type == COGL_RECTANGLE_MAP_EMPTY_LEAF)
             {
-              /* We've found a node we can use */
-              found_node = node;
-              break;
+              guint64 score = _cogl_rectangle_map_score_node (map->policy,
+                                                              node,
+                                                              width,
+                                                              height);
+
+              if (score < best_score)
+                {
+                  /* We've found a node we can use */
+                  found_node = node;
+                  best_score = score;
+
+                  /* We can't do any better than a score of zero */
+                  if (score == 0)
+                    break;
+                }
             }
           else if (node->type == COGL_RECTANGLE_MAP_BRANCH)
             {
@@ -414,8 +570,11 @@ _cogl_rectangle_map_add (CoglRectangleMap *map,
       CoglRectangleMapNode *node;
 
       /* Split according to whichever axis will leave us with the
-         largest space */
-      if (found_node->rectangle.width - width >
+         largest space. The shelf policy always splits off a row of
+         the same height first so that the rest of the row can be used
+         for the next rectangles */
+      if (map->policy != COGL_RECTANGLE_MAP_SHELF &&
+          found_node->rectangle.width - width >
           found_node->rectangle.height - height)
         {
           found_node =
@@ -454,6 +613,10 @@ _cogl_rectangle_map_add (CoglRectangleMap *map,
       map->space_remaining -= rectangle_size;
 
 #ifdef COGL_ENABLE_DEBUG
+      if (G_UNLIKELY (map->trace_file))
+        _cogl_rectangle_map_trace_add (map, width, height,
+                                       &found_node->rectangle);
+
       if (G_UNLIKELY (COGL_DEBUG_ENABLED (COGL_DEBUG_DUMP_ATLAS_IMAGE)))
         {
 #ifdef HAVE_CAIRO
@@ -468,7 +631,14 @@ _cogl_rectangle_map_add (CoglRectangleMap *map,
       return TRUE;
     }
   else
-    return FALSE;
+    {
+#ifdef COGL_ENABLE_DEBUG
+      if (G_UNLIKELY (map->trace_file))
+        _cogl_rectangle_map_trace_add (map, width, height, NULL);
+#endif
+
+      return FALSE;
+    }
 }
 
 void
@@ -544,6 +714,11 @@ _cogl_rectangle_map_remove (CoglRectangleMap *map,
       map->n_rectangles--;
       /* and more space */
       map->space_remaining += rectangle_size;
+
+#ifdef COGL_ENABLE_DEBUG
+      if (G_UNLIKELY (map->trace_file))
+        _cogl_rectangle_map_trace_remove (map, rectangle);
+#endif
     }
 
 #ifdef COGL_ENABLE_DEBUG
@@ -583,6 +758,14 @@ _cogl_rectangle_map_get_n_rectangles (CoglRectangleMap *map)
   return map->n_rectangles;
 }
 
+unsigned int
+_cogl_rectangle_map_get_largest_gap (CoglRectangleMap *map)
+{
+  /* The root node keeps track of the area of the largest empty leaf
+     in the whole tree */
+  return map->root->largest_gap;
+}
+
 static void
 _cogl_rectangle_map_internal_foreach (CoglRectangleMap *map,
                                       CoglRectangleMapInternalForeachCb func,
@@ -695,6 +878,11 @@ _cogl_rectangle_map_free (CoglRectangleMap *map)
 
   g_array_free (map->stack, TRUE);
 
+#ifdef COGL_ENABLE_DEBUG
+  if (map->trace_file)
+    _cogl_rectangle_map_trace_end (map);
+#endif
+
   g_free (map);
 }
 
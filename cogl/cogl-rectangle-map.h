@@ -39,11 +39,31 @@ struct _CoglRectangleMapEntry
   unsigned int width, height;
 };
 
+typedef enum
+{
+  /* Use the first empty space found in a depth-first search of the
+     tree. This is the fastest */
+  COGL_RECTANGLE_MAP_FIRST_FIT,
+  /* Use the empty space that leaves the least area unused */
+  COGL_RECTANGLE_MAP_BEST_AREA_FIT,
+  /* Use the empty space that leaves the smallest gap along its
+     shorter side */
+  COGL_RECTANGLE_MAP_BEST_SHORT_SIDE_FIT,
+  /* Keep rectangles of the same height together in rows. This works
+     well for glyphs of a single font which mostly have similar
+     heights */
+  COGL_RECTANGLE_MAP_SHELF
+} CoglRectangleMapPolicy;
+
 CoglRectangleMap *
 _cogl_rectangle_map_new (unsigned int width,
                          unsigned int height,
                          GDestroyNotify value_destroy_func);
 
+void
+_cogl_rectangle_map_set_policy (CoglRectangleMap *map,
+                                CoglRectangleMapPolicy policy);
+
 gboolean
 _cogl_rectangle_map_add (CoglRectangleMap *map,
                          unsigned int width,
@@ -67,6 +87,9 @@ _cogl_rectangle_map_get_remaining_space (CoglRectangleMap *map);
 unsigned int
 _cogl_rectangle_map_get_n_rectangles (CoglRectangleMap *map);
 
+unsigned int
+_cogl_rectangle_map_get_largest_gap (CoglRectangleMap *map);
+
 void
 _cogl_rectangle_map_foreach (CoglRectangleMap *map,
                              CoglRectangleMapCallback callback,
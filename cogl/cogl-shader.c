@@ -184,8 +184,8 @@ _cogl_shader_set_source_with_boilerplate (GLuint shader_gl_handle,
   const char *vertex_boilerplate;
   const char *fragment_boilerplate;
 
-  const char **strings = g_alloca (sizeof (char *) * (count_in + 3));
-  GLint *lengths = g_alloca (sizeof (GLint) * (count_in + 3));
+  const char **strings = g_alloca (sizeof (char *) * (count_in + 4));
+  GLint *lengths = g_alloca (sizeof (GLint) * (count_in + 4));
   int count = 0;
   char *tex_coord_declarations = NULL;
 
@@ -211,6 +211,21 @@ _cogl_shader_set_source_with_boilerplate (GLuint shader_gl_handle,
       lengths[count++] = sizeof (texture_3d_extension) - 1;
     }
 
+  /* The derivative functions are always available in fragment shaders
+     on big GL but GLES2 needs an extension. Enabling it lets shaders
+     check for GL_OES_standard_derivatives to see if they can be
+     used */
+  if (ctx->driver == COGL_DRIVER_GLES2 &&
+      shader_gl_type == GL_FRAGMENT_SHADER &&
+      (ctx->private_feature_flags &
+       COGL_PRIVATE_FEATURE_STANDARD_DERIVATIVES))
+    {
+      static const char derivatives_extension[] =
+        "#extension GL_OES_standard_derivatives : enable\n";
+      strings[count] = derivatives_extension;
+      lengths[count++] = sizeof (derivatives_extension) - 1;
+    }
+
   if (shader_gl_type == GL_VERTEX_SHADER)
     {
       strings[count] = vertex_boilerplate;
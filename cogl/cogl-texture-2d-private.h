@@ -27,6 +27,8 @@
 #include "cogl-handle.h"
 #include "cogl-pipeline-private.h"
 #include "cogl-texture-private.h"
+#include "cogl-compressed-image-private.h"
+#include "cogl-mipmap-builder-private.h"
 
 struct _CoglTexture2D
 {
@@ -50,17 +52,56 @@ struct _CoglTexture2D
   gboolean        is_foreign;
 
   CoglTexturePixel first_pixel;
+
+  /* Set when the mipmaps are generated on the CPU */
+  CoglMipmapBuilder *mipmap_builder;
+  /* Whether the levels after the first have been created in GL by
+     the mipmap builder yet */
+  gboolean        mipmap_levels_allocated;
 };
 
 GQuark
 _cogl_handle_texture_2d_get_type (void);
 
+/*
+ * _cogl_texture_2d_new_with_size:
+ *
+ * This is the same as cogl_texture_2d_new_with_size() except that
+ * the #CoglTextureFlags are also applied. With
+ * %COGL_TEXTURE_CPU_MIPMAP the copy used to build the mipmaps starts
+ * out cleared to zero.
+ */
+CoglTexture2D *
+_cogl_texture_2d_new_with_size (CoglContext *ctx,
+                                int width,
+                                int height,
+                                CoglTextureFlags flags,
+                                CoglPixelFormat internal_format,
+                                GError **error);
+
 CoglHandle
 _cogl_texture_2d_new_from_bitmap (CoglBitmap      *bmp,
                                   CoglTextureFlags flags,
                                   CoglPixelFormat  internal_format,
                                   GError         **error);
 
+/*
+ * _cogl_texture_2d_new_from_compressed_image:
+ * @image: a #CoglCompressedImage loaded from a file
+ * @flags: the #CoglTextureFlags for the texture
+ * @error: return location for a #GError
+ *
+ * Creates a texture from the compressed data of @image. If the
+ * driver doesn't support the format of the image then it is
+ * decompressed on the CPU and the texture will be
+ * %COGL_PIXEL_FORMAT_RGBA_8888 instead. Every mipmap level in the
+ * image is used.
+ */
+CoglHandle
+_cogl_texture_2d_new_from_compressed_image (CoglCompressedImage *image,
+                                            CoglTextureFlags flags,
+                                            GError **error);
+
 #if defined (COGL_HAS_EGL_SUPPORT) && defined (EGL_KHR_image_base)
 /* NB: The reason we require the width, height and format to be passed
  * even though they may seem redundant is because GLES 1/2 don't
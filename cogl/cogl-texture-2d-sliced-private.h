@@ -48,6 +48,9 @@ struct _CoglTexture2DSliced
 GQuark
 _cogl_handle_texture_2d_sliced_get_type (void);
 
+gboolean
+_cogl_is_texture_2d_sliced (void *object);
+
 CoglHandle
 _cogl_texture_2d_sliced_new_with_size (unsigned int     width,
                                        unsigned int     height,
@@ -469,6 +469,212 @@ _cogl_texture_2d_sliced_upload_to_gl (CoglTexture2DSliced *tex_2ds,
   return TRUE;
 }
 
+/* State shared between the main thread and the worker threads while
+   the slices of a new texture are being prepared */
+typedef struct
+{
+  GMutex *mutex;
+  GCond *cond;
+} CoglTexture2DSlicedPrepareState;
+
+typedef struct
+{
+  CoglTexture2DSlicedPrepareState *state;
+
+  /* Bitmap pointing into the mapped source data for the part of the
+     image covered by this slice */
+  CoglBitmap *src_bmp;
+  /* Staging bitmap the size of the whole slice, including the waste */
+  CoglBitmap *dst_bmp;
+  guint8 *dst_data;
+
+  /* Protected by the state's mutex */
+  gboolean done;
+  gboolean success;
+} CoglTexture2DSlicedSlicePrep;
+
+/* Fills the waste of a prepared slice with copies of the rightmost
+   column and the bottom row of the image data, the same as
+   _cogl_texture_2d_sliced_set_waste does for a direct upload */
+static void
+_cogl_texture_2d_sliced_fill_staging_waste (guint8 *data,
+                                            int bpp,
+                                            int rowstride,
+                                            int data_width,
+                                            int data_height,
+                                            int slice_width,
+                                            int slice_height)
+{
+  int x, y;
+
+  if (data_width < slice_width)
+    for (y = 0; y < data_height; y++)
+      {
+        guint8 *row = data + y * rowstride;
+        const guint8 *src = row + (data_width - 1) * bpp;
+
+        for (x = data_width; x < slice_width; x++)
+          memcpy (row + x * bpp, src, bpp);
+      }
+
+  for (y = data_height; y < slice_height; y++)
+    memcpy (data + y * rowstride,
+            data + (data_height - 1) * rowstride,
+            slice_width * bpp);
+}
+
+/* Runs on a worker thread so it must not touch GL or create any
+   objects. All of the bitmaps were created up front by the main
+   thread */
+static void
+_cogl_texture_2d_sliced_prepare_slice_cb (void *user_data)
+{
+  CoglTexture2DSlicedSlicePrep *prep = user_data;
+  CoglTexture2DSlicedPrepareState *state = prep->state;
+  gboolean success;
+
+  success = _cogl_bitmap_convert_into (prep->src_bmp, prep->dst_bmp);
+
+  if (success)
+    _cogl_texture_2d_sliced_fill_staging_waste
+      (prep->dst_data,
+       _cogl_get_format_bpp (_cogl_bitmap_get_format (prep->dst_bmp)),
+       _cogl_bitmap_get_rowstride (prep->dst_bmp),
+       _cogl_bitmap_get_width (prep->src_bmp),
+       _cogl_bitmap_get_height (prep->src_bmp),
+       _cogl_bitmap_get_width (prep->dst_bmp),
+       _cogl_bitmap_get_height (prep->dst_bmp));
+
+  g_mutex_lock (state->mutex);
+  prep->success = success;
+  prep->done = TRUE;
+  g_cond_broadcast (state->cond);
+  g_mutex_unlock (state->mutex);
+}
+
+/* Alternative to _cogl_texture_2d_sliced_upload_to_gl for textures
+   with lots of slices. The sub-image copy, format conversion and
+   waste fill for each slice are done on the context's worker threads
+   into a separate staging buffer per slice. Each slice is then
+   uploaded in one go by this thread as soon as it is ready so the
+   uploads overlap with the preparation of the remaining slices. The
+   bitmap doesn't need to have been converted to upload_format
+   first */
+static gboolean
+_cogl_texture_2d_sliced_upload_to_gl_parallel (CoglTexture2DSliced *tex_2ds,
+                                               CoglBitmap *bmp,
+                                               CoglPixelFormat upload_format)
+{
+  CoglTexture2DSlicedPrepareState state;
+  CoglTexture2DSlicedSlicePrep *preps;
+  CoglPixelFormat bmp_format = _cogl_bitmap_get_format (bmp);
+  int bmp_bpp = _cogl_get_format_bpp (bmp_format);
+  int bmp_rowstride = _cogl_bitmap_get_rowstride (bmp);
+  int upload_bpp = _cogl_get_format_bpp (upload_format);
+  int n_x_slices = tex_2ds->slice_x_spans->len;
+  int n_slices = tex_2ds->slice_textures->len;
+  gboolean success = TRUE;
+  guint8 *bmp_data;
+  int i;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  /* The source has to stay mapped until every slice has been
+     prepared. Mapping may need GL so it is done here */
+  bmp_data = _cogl_bitmap_map (bmp, COGL_BUFFER_ACCESS_READ, 0);
+  if (bmp_data == NULL)
+    return FALSE;
+
+  state.mutex = g_mutex_new ();
+  state.cond = g_cond_new ();
+
+  preps = g_new0 (CoglTexture2DSlicedSlicePrep, n_slices);
+
+  for (i = 0; i < n_slices; i++)
+    {
+      CoglTexture2DSlicedSlicePrep *prep = preps + i;
+      CoglSpan *x_span = &g_array_index (tex_2ds->slice_x_spans, CoglSpan,
+                                         i % n_x_slices);
+      CoglSpan *y_span = &g_array_index (tex_2ds->slice_y_spans, CoglSpan,
+                                         i / n_x_slices);
+      int dst_rowstride = (x_span->size * upload_bpp + 3) & ~3;
+
+      prep->state = &state;
+
+      prep->src_bmp =
+        _cogl_bitmap_new_from_data (bmp_data +
+                                    y_span->start * bmp_rowstride +
+                                    x_span->start * bmp_bpp,
+                                    bmp_format,
+                                    x_span->size - x_span->waste,
+                                    y_span->size - y_span->waste,
+                                    bmp_rowstride,
+                                    NULL, /* destroy_fn */
+                                    NULL);
+
+      prep->dst_data = g_malloc (dst_rowstride * y_span->size);
+      prep->dst_bmp =
+        _cogl_bitmap_new_from_data (prep->dst_data,
+                                    upload_format,
+                                    x_span->size,
+                                    y_span->size,
+                                    dst_rowstride,
+                                    (CoglBitmapDestroyNotify) g_free,
+                                    NULL);
+    }
+
+  /* The bitmaps can't be created once the workers have started
+     because the object bookkeeping isn't thread-safe */
+  for (i = 0; i < n_slices; i++)
+    _cogl_context_push_work (ctx,
+                             _cogl_texture_2d_sliced_prepare_slice_cb,
+                             preps + i);
+
+  for (i = 0; i < n_slices; i++)
+    {
+      CoglTexture2DSlicedSlicePrep *prep = preps + i;
+      CoglSpan *x_span = &g_array_index (tex_2ds->slice_x_spans, CoglSpan,
+                                         i % n_x_slices);
+      CoglSpan *y_span = &g_array_index (tex_2ds->slice_y_spans, CoglSpan,
+                                         i / n_x_slices);
+      CoglHandle slice_tex = g_array_index (tex_2ds->slice_textures,
+                                            CoglHandle, i);
+
+      g_mutex_lock (state.mutex);
+      while (!prep->done)
+        g_cond_wait (state.cond, state.mutex);
+      g_mutex_unlock (state.mutex);
+
+      /* Keep waiting for the rest of the slices even if one fails so
+         that nothing is still using the source data when it is
+         unmapped */
+      if (!prep->success)
+        success = FALSE;
+      else if (success)
+        cogl_texture_set_region_from_bitmap (slice_tex,
+                                             0, 0, /* src_x/y */
+                                             0, 0, /* dst_x/y */
+                                             x_span->size,
+                                             y_span->size,
+                                             prep->dst_bmp);
+    }
+
+  _cogl_bitmap_unmap (bmp);
+
+  for (i = 0; i < n_slices; i++)
+    {
+      cogl_object_unref (preps[i].src_bmp);
+      cogl_object_unref (preps[i].dst_bmp);
+    }
+
+  g_free (preps);
+
+  g_cond_free (state.cond);
+  g_mutex_free (state.mutex);
+
+  return success;
+}
+
 static gboolean
 _cogl_texture_2d_sliced_upload_subregion_to_gl (CoglTexture2DSliced *tex_2ds,
                                                 int          src_x,
@@ -860,6 +1066,9 @@ _cogl_texture_2d_sliced_slices_create (CoglTexture2DSliced *tex_2ds,
             cogl_texture_new_with_size (x_span->size, y_span->size,
                                         COGL_TEXTURE_NO_ATLAS | flags,
                                         format);
+          _cogl_texture_set_memory_category
+            (slice_textures[y * n_x_slices + x],
+             COGL_MEMORY_CATEGORY_SLICED_TEXTURE);
         }
     }
 
@@ -967,10 +1176,15 @@ _cogl_texture_2d_sliced_new_from_bitmap (CoglBitmap      *bmp,
 {
   CoglTexture2DSliced *tex_2ds;
   CoglBitmap          *dst_bmp;
+  CoglPixelFormat      upload_format;
   GLenum               gl_intformat;
   GLenum               gl_format;
   GLenum               gl_type;
   int                  width, height;
+  CoglSpan            *last_x_span;
+  CoglSpan            *last_y_span;
+
+  _COGL_GET_CONTEXT (ctx, COGL_INVALID_HANDLE);
 
   g_return_val_if_fail (cogl_is_bitmap (bmp), COGL_INVALID_HANDLE);
 
@@ -993,24 +1207,59 @@ _cogl_texture_2d_sliced_new_from_bitmap (CoglBitmap      *bmp,
    * CoglHandle is returned, it should also be destroyed
    * with cogl_handle_unref at some point! */
 
+  upload_format =
+    _cogl_texture_determine_upload_format (_cogl_bitmap_get_format (bmp),
+                                           internal_format,
+                                           &internal_format,
+                                           &gl_intformat,
+                                           &gl_format,
+                                           &gl_type);
+
+  if (!_cogl_texture_2d_sliced_init_base (tex_2ds,
+                                          width, height,
+                                          internal_format,
+                                          flags))
+    {
+      _cogl_texture_2d_sliced_free (tex_2ds);
+      return COGL_INVALID_HANDLE;
+    }
+
+  last_x_span = &g_array_index (tex_2ds->slice_x_spans, CoglSpan,
+                                tex_2ds->slice_x_spans->len - 1);
+  last_y_span = &g_array_index (tex_2ds->slice_y_spans, CoglSpan,
+                                tex_2ds->slice_y_spans->len - 1);
+
+  /* If there are several slices and they need any work on the CPU
+     before they can be uploaded then prepare them on the worker
+     threads straight from the unconverted bitmap */
+  if (_cogl_context_has_worker_threads (ctx) &&
+      tex_2ds->slice_textures->len > 1 &&
+      (upload_format != _cogl_bitmap_get_format (bmp) ||
+       last_x_span->waste > 0 || last_y_span->waste > 0))
+    {
+      if (!_cogl_texture_2d_sliced_upload_to_gl_parallel (tex_2ds,
+                                                          bmp,
+                                                          upload_format))
+        {
+          _cogl_texture_2d_sliced_free (tex_2ds);
+          return COGL_INVALID_HANDLE;
+        }
+
+      return _cogl_texture_2d_sliced_handle_new (tex_2ds);
+    }
+
   dst_bmp = _cogl_texture_prepare_for_upload (bmp,
                                               internal_format,
-                                              &internal_format,
-                                              &gl_intformat,
-                                              &gl_format,
-                                              &gl_type);
+                                              NULL,
+                                              NULL,
+                                              NULL,
+                                              NULL);
   if (dst_bmp == COGL_INVALID_HANDLE)
     {
       _cogl_texture_2d_sliced_free (tex_2ds);
       return COGL_INVALID_HANDLE;
     }
 
-  if (!_cogl_texture_2d_sliced_init_base (tex_2ds,
-                                          width, height,
-                                          internal_format,
-                                          flags))
-    goto error;
-
   if (!_cogl_texture_2d_sliced_upload_to_gl (tex_2ds,
                                              dst_bmp))
     goto error;
@@ -40,6 +40,7 @@
 #include "cogl-pipeline-opengl-private.h"
 #include "cogl-framebuffer-private.h"
 #include "cogl-winsys-egl-private.h"
+#include "cogl-compressed-image-private.h"
 
 #include <string.h>
 #include <math.h>
@@ -159,12 +160,24 @@ _cogl_texture_2d_set_wrap_mode_parameters (CoglTexture *tex,
     }
 }
 
+static void
+_cogl_texture_2d_free_mipmap_builder (CoglTexture2D *tex_2d)
+{
+  if (tex_2d->mipmap_builder)
+    {
+      _cogl_mipmap_builder_free (tex_2d->mipmap_builder);
+      tex_2d->mipmap_builder = NULL;
+    }
+}
+
 static void
 _cogl_texture_2d_free (CoglTexture2D *tex_2d)
 {
   if (!tex_2d->is_foreign)
     _cogl_delete_gl_texture (tex_2d->gl_texture);
 
+  _cogl_texture_2d_free_mipmap_builder (tex_2d);
+
   /* Chain up */
   _cogl_texture_free (COGL_TEXTURE (tex_2d));
 }
@@ -230,15 +243,52 @@ _cogl_texture_2d_create_base (unsigned int     width,
 
   tex_2d->format = internal_format;
 
+  tex_2d->mipmap_builder = NULL;
+  tex_2d->mipmap_levels_allocated = FALSE;
+
   return tex_2d;
 }
 
+/* Foreign textures and textures bound to an EGLImage don't own their
+   base level so this is only used when Cogl allocates the storage */
+static void
+_cogl_texture_2d_update_memory_size (CoglTexture2D *tex_2d,
+                                     gboolean mipmaps)
+{
+  _cogl_texture_set_memory_size
+    (COGL_TEXTURE (tex_2d),
+     _cogl_texture_estimate_memory_size (tex_2d->width,
+                                         tex_2d->height,
+                                         1, /* depth */
+                                         tex_2d->format,
+                                         mipmaps));
+}
+
+/* Creates the builder used to generate the mipmaps on the CPU if the
+   flags ask for it. If the format isn't supported then the driver is
+   used instead */
+static void
+_cogl_texture_2d_create_mipmap_builder (CoglTexture2D *tex_2d,
+                                        CoglTextureFlags flags)
+{
+  if ((flags & COGL_TEXTURE_CPU_MIPMAP) &&
+      tex_2d->auto_mipmap &&
+      _cogl_mipmap_builder_format_supported (tex_2d->format))
+    tex_2d->mipmap_builder =
+      _cogl_mipmap_builder_new (tex_2d->width,
+                                tex_2d->height,
+                                tex_2d->format,
+                                (flags &
+                                 COGL_TEXTURE_MIPMAP_LINEAR_LIGHT) != 0);
+}
+
 CoglTexture2D *
-cogl_texture_2d_new_with_size (CoglContext *ctx,
-                               int width,
-                               int height,
-                               CoglPixelFormat internal_format,
-                               GError **error)
+_cogl_texture_2d_new_with_size (CoglContext *ctx,
+                                int width,
+                                int height,
+                                CoglTextureFlags flags,
+                                CoglPixelFormat internal_format,
+                                GError **error)
 {
   CoglTexture2D         *tex_2d;
   GLenum                 gl_intformat;
@@ -263,7 +313,7 @@ cogl_texture_2d_new_with_size (CoglContext *ctx,
                                                              &gl_format,
                                                              &gl_type);
 
-  tex_2d = _cogl_texture_2d_create_base (width, height, COGL_TEXTURE_NONE,
+  tex_2d = _cogl_texture_2d_create_base (width, height, flags,
                                          internal_format);
 
   ctx->texture_driver->gen (GL_TEXTURE_2D, 1, &tex_2d->gl_texture);
@@ -273,9 +323,33 @@ cogl_texture_2d_new_with_size (CoglContext *ctx,
   GE( ctx, glTexImage2D (GL_TEXTURE_2D, 0, gl_intformat,
                          width, height, 0, gl_format, gl_type, NULL) );
 
+  tex_2d->gl_format = gl_intformat;
+
+  /* There is no data yet so the copy starts out cleared and gets
+     filled in by cogl_texture_set_region */
+  _cogl_texture_2d_create_mipmap_builder (tex_2d, flags);
+  if (tex_2d->mipmap_builder)
+    _cogl_mipmap_builder_clear (tex_2d->mipmap_builder);
+
+  _cogl_texture_2d_update_memory_size (tex_2d, FALSE);
+
   return _cogl_texture_2d_handle_new (tex_2d);
 }
 
+CoglTexture2D *
+cogl_texture_2d_new_with_size (CoglContext *ctx,
+                               int width,
+                               int height,
+                               CoglPixelFormat internal_format,
+                               GError **error)
+{
+  return _cogl_texture_2d_new_with_size (ctx,
+                                         width, height,
+                                         COGL_TEXTURE_NONE,
+                                         internal_format,
+                                         error);
+}
+
 CoglHandle
 _cogl_texture_2d_new_from_bitmap (CoglBitmap      *bmp,
                                   CoglTextureFlags flags,
@@ -352,8 +426,175 @@ _cogl_texture_2d_new_from_bitmap (CoglBitmap      *bmp,
 
   tex_2d->gl_format = gl_intformat;
 
+  /* Keep a copy of the image so the mipmaps can be built from it
+     later */
+  _cogl_texture_2d_create_mipmap_builder (tex_2d, flags);
+  if (tex_2d->mipmap_builder &&
+      !_cogl_mipmap_builder_set_region (tex_2d->mipmap_builder,
+                                        dst_bmp,
+                                        0, 0, /* src_x/y */
+                                        0, 0, /* dst_x/y */
+                                        tex_2d->width,
+                                        tex_2d->height))
+    _cogl_texture_2d_free_mipmap_builder (tex_2d);
+
   cogl_object_unref (dst_bmp);
 
+  _cogl_texture_2d_update_memory_size (tex_2d, FALSE);
+
+  return _cogl_texture_2d_handle_new (tex_2d);
+}
+
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
+/* Decompresses every level of the image on the CPU for drivers that
+   don't support its format */
+static gboolean
+_cogl_texture_2d_upload_decompressed (CoglTexture2D *tex_2d,
+                                      CoglCompressedImage *image)
+{
+  GLenum gl_intformat;
+  GLenum gl_format;
+  GLenum gl_type;
+  guint8 *data;
+  int i;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  ctx->texture_driver->pixel_format_to_gl (COGL_PIXEL_FORMAT_RGBA_8888,
+                                           &gl_intformat,
+                                           &gl_format,
+                                           &gl_type);
+
+  /* The first level is the largest so its buffer can be reused for
+     all of the others */
+  data = g_malloc (image->width * image->height * 4);
+
+  for (i = 0; i < image->n_levels; i++)
+    {
+      CoglCompressedImageLevel *level = image->levels + i;
+
+      if (!_cogl_compressed_format_decode (image->format,
+                                           level->width,
+                                           level->height,
+                                           level->data,
+                                           data,
+                                           level->width * 4))
+        {
+          g_free (data);
+          return FALSE;
+        }
+
+      if (i == 0 && !cogl_features_available (COGL_FEATURE_OFFSCREEN))
+        {
+          tex_2d->first_pixel.gl_format = gl_format;
+          tex_2d->first_pixel.gl_type = gl_type;
+          memcpy (tex_2d->first_pixel.data, data, 4);
+        }
+
+      ctx->texture_driver->prep_gl_for_pixels_upload (level->width * 4, 4);
+      GE( ctx, glTexImage2D (GL_TEXTURE_2D, i, gl_intformat,
+                             level->width, level->height, 0,
+                             gl_format, gl_type, data) );
+    }
+
+  g_free (data);
+
+  tex_2d->gl_format = gl_intformat;
+
+  return TRUE;
+}
+
+CoglHandle
+_cogl_texture_2d_new_from_compressed_image (CoglCompressedImage *image,
+                                            CoglTextureFlags flags,
+                                            GError **error)
+{
+  CoglTexture2D *tex_2d;
+  CoglPixelFormat format;
+  GLenum gl_intformat;
+  int i;
+
+  _COGL_GET_CONTEXT (ctx, COGL_INVALID_HANDLE);
+
+  if (!_cogl_texture_2d_can_create (image->width,
+                                    image->height,
+                                    COGL_PIXEL_FORMAT_RGBA_8888))
+    {
+      g_set_error (error, COGL_TEXTURE_ERROR,
+                   COGL_TEXTURE_ERROR_SIZE,
+                   "Failed to create texture 2d due to size/format"
+                   " constraints");
+      return NULL;
+    }
+
+  /* The texture driver only gives back the same format if the GL
+     driver can sample from it directly */
+  format = ctx->texture_driver->pixel_format_to_gl (image->format,
+                                                    &gl_intformat,
+                                                    NULL,
+                                                    NULL);
+
+  tex_2d = _cogl_texture_2d_create_base (image->width,
+                                         image->height,
+                                         flags,
+                                         format);
+
+  ctx->texture_driver->gen (GL_TEXTURE_2D, 1, &tex_2d->gl_texture);
+
+  if (format == image->format)
+    {
+      for (i = 0; i < image->n_levels; i++)
+        ctx->texture_driver->upload_compressed_to_gl (GL_TEXTURE_2D,
+                                                      tex_2d->gl_texture,
+                                                      FALSE,
+                                                      i,
+                                                      image->levels[i].width,
+                                                      image->levels[i].height,
+                                                      gl_intformat,
+                                                      image->levels[i].data,
+                                                      image->levels[i].data_size);
+
+      tex_2d->gl_format = gl_intformat;
+
+      /* Mipmaps can't be generated for compressed textures so only
+         the levels from the file can be used */
+      tex_2d->auto_mipmap = FALSE;
+
+#ifdef HAVE_COGL_GL
+      /* Limit the levels to the ones in the file so that the texture
+         is still complete with a mipmap filter */
+      if (ctx->driver == COGL_DRIVER_GL)
+        GE( ctx, glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                                  image->n_levels - 1) );
+#endif
+    }
+  else
+    {
+      _cogl_bind_gl_texture_transient (GL_TEXTURE_2D,
+                                       tex_2d->gl_texture,
+                                       FALSE);
+
+      if (!_cogl_texture_2d_upload_decompressed (tex_2d, image))
+        {
+          _cogl_texture_2d_free (tex_2d);
+          g_set_error (error, COGL_TEXTURE_ERROR,
+                       COGL_TEXTURE_ERROR_FORMAT,
+                       "The driver doesn't support the compressed texture "
+                       "format and it can't be decompressed");
+          return NULL;
+        }
+    }
+
+  /* If the file had more than one level then they are used instead of
+     generating the mipmaps */
+  if (image->n_levels > 1)
+    tex_2d->mipmaps_dirty = FALSE;
+
+  _cogl_texture_2d_update_memory_size (tex_2d, image->n_levels > 1);
+
   return _cogl_texture_2d_handle_new (tex_2d);
 }
 
@@ -629,6 +870,10 @@ _cogl_texture_2d_externally_modified (CoglHandle handle)
     return;
 
   COGL_TEXTURE_2D (handle)->mipmaps_dirty = TRUE;
+
+  /* The copy of the texture used to build the mipmaps is now out of
+     date so the driver has to generate them instead */
+  _cogl_texture_2d_free_mipmap_builder (COGL_TEXTURE_2D (handle));
 }
 
 void
@@ -665,6 +910,10 @@ _cogl_texture_2d_copy_from_framebuffer (CoglHandle handle,
                             width, height);
 
   tex_2d->mipmaps_dirty = TRUE;
+
+  /* There's no cheap way to update the copy of the texture used to
+     build the mipmaps so the driver is used from now on */
+  _cogl_texture_2d_free_mipmap_builder (tex_2d);
 }
 
 static int
@@ -753,6 +1002,71 @@ _cogl_texture_2d_set_filters (CoglTexture *tex,
   GE( ctx, glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min_filter) );
 }
 
+typedef struct
+{
+  CoglTexture2D *tex_2d;
+  int bpp;
+  GLenum gl_format;
+  GLenum gl_type;
+} CoglTexture2DMipmapUploadData;
+
+static void
+_cogl_texture_2d_upload_mipmap_level_cb (int level,
+                                         int width,
+                                         int height,
+                                         int y,
+                                         int n_rows,
+                                         const guint8 *data,
+                                         int rowstride,
+                                         void *user_data)
+{
+  CoglTexture2DMipmapUploadData *upload_data = user_data;
+  CoglTexture2D *tex_2d = upload_data->tex_2d;
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  ctx->texture_driver->prep_gl_for_pixels_upload (rowstride,
+                                                  upload_data->bpp);
+
+  /* The first update always covers the whole of every level */
+  if (tex_2d->mipmap_levels_allocated)
+    GE( ctx, glTexSubImage2D (GL_TEXTURE_2D, level,
+                              0, y, width, n_rows,
+                              upload_data->gl_format,
+                              upload_data->gl_type,
+                              data) );
+  else
+    GE( ctx, glTexImage2D (GL_TEXTURE_2D, level, tex_2d->gl_format,
+                           width, height, 0,
+                           upload_data->gl_format,
+                           upload_data->gl_type,
+                           data) );
+}
+
+static void
+_cogl_texture_2d_update_cpu_mipmaps (CoglTexture2D *tex_2d)
+{
+  CoglTexture2DMipmapUploadData upload_data;
+  CoglPixelFormat format;
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  format = _cogl_mipmap_builder_get_format (tex_2d->mipmap_builder);
+
+  upload_data.tex_2d = tex_2d;
+  upload_data.bpp = _cogl_get_format_bpp (format);
+  ctx->texture_driver->pixel_format_to_gl (format,
+                                           NULL, /* internal format */
+                                           &upload_data.gl_format,
+                                           &upload_data.gl_type);
+
+  _cogl_mipmap_builder_update (tex_2d->mipmap_builder,
+                               _cogl_texture_2d_upload_mipmap_level_cb,
+                               &upload_data);
+
+  tex_2d->mipmap_levels_allocated = TRUE;
+}
+
 static void
 _cogl_texture_2d_pre_paint (CoglTexture *tex, CoglTexturePrePaintFlags flags)
 {
@@ -768,10 +1082,14 @@ _cogl_texture_2d_pre_paint (CoglTexture *tex, CoglTexturePrePaintFlags flags)
                                        tex_2d->gl_texture,
                                        tex_2d->is_foreign);
 
+      /* Only the parts of the levels that changed are filtered again
+         when the mipmaps are built on the CPU */
+      if (tex_2d->mipmap_builder)
+        _cogl_texture_2d_update_cpu_mipmaps (tex_2d);
       /* glGenerateMipmap is defined in the FBO extension. If it's not
          available we'll fallback to temporarily enabling
          GL_GENERATE_MIPMAP and reuploading the first pixel */
-      if (cogl_features_available (COGL_FEATURE_OFFSCREEN))
+      else if (cogl_features_available (COGL_FEATURE_OFFSCREEN))
         ctx->texture_driver->gl_generate_mipmaps (GL_TEXTURE_2D);
 #if defined(HAVE_COGL_GLES) || defined(HAVE_COGL_GL)
       else
@@ -790,6 +1108,11 @@ _cogl_texture_2d_pre_paint (CoglTexture *tex, CoglTexturePrePaintFlags flags)
 #endif
 
       tex_2d->mipmaps_dirty = FALSE;
+
+      /* The levels below the first one are only allocated once the
+         mipmaps have been generated */
+      if (!tex_2d->is_foreign)
+        _cogl_texture_2d_update_memory_size (tex_2d, TRUE);
     }
 }
 
@@ -816,6 +1139,11 @@ _cogl_texture_2d_set_region (CoglTexture    *tex,
 
   _COGL_GET_CONTEXT (ctx, FALSE);
 
+  /* There's no way to update part of a compressed texture from
+     uncompressed data */
+  if (_cogl_pixel_format_is_compressed (tex_2d->format))
+    return FALSE;
+
   bmp = _cogl_texture_prepare_for_upload (bmp,
                                           cogl_texture_get_format (tex),
                                           NULL,
@@ -852,6 +1180,14 @@ _cogl_texture_2d_set_region (CoglTexture    *tex,
 
   tex_2d->mipmaps_dirty = TRUE;
 
+  if (tex_2d->mipmap_builder &&
+      !_cogl_mipmap_builder_set_region (tex_2d->mipmap_builder,
+                                        bmp,
+                                        src_x, src_y,
+                                        dst_x, dst_y,
+                                        dst_width, dst_height))
+    _cogl_texture_2d_free_mipmap_builder (tex_2d);
+
   cogl_object_unref (bmp);
 
   return TRUE;
@@ -184,6 +184,7 @@ _cogl_texture_3d_create_base (unsigned int     width,
   CoglTexture *tex = COGL_TEXTURE (tex_3d);
 
   _cogl_texture_init (tex, &cogl_texture_3d_vtable);
+  tex->memory_category = COGL_MEMORY_CATEGORY_TEXTURE_3D;
 
   tex_3d->width = width;
   tex_3d->height = height;
@@ -205,6 +206,19 @@ _cogl_texture_3d_create_base (unsigned int     width,
   return tex_3d;
 }
 
+static void
+_cogl_texture_3d_update_memory_size (CoglTexture3D *tex_3d,
+                                     gboolean mipmaps)
+{
+  _cogl_texture_set_memory_size
+    (COGL_TEXTURE (tex_3d),
+     _cogl_texture_estimate_memory_size (tex_3d->width,
+                                         tex_3d->height,
+                                         tex_3d->depth,
+                                         tex_3d->format,
+                                         mipmaps));
+}
+
 static gboolean
 _cogl_texture_3d_can_create (unsigned int     width,
                             unsigned int     height,
@@ -305,6 +319,8 @@ cogl_texture_3d_new_with_size (unsigned int     width,
   GE( ctx, glTexImage3D (GL_TEXTURE_3D, 0, gl_intformat,
                          width, height, depth, 0, gl_format, gl_type, NULL) );
 
+  _cogl_texture_3d_update_memory_size (tex_3d, FALSE);
+
   return _cogl_texture_3d_handle_new (tex_3d);
 }
 
@@ -385,6 +401,8 @@ _cogl_texture_3d_new_from_bitmap (CoglBitmap      *bmp,
 
   cogl_object_unref (dst_bmp);
 
+  _cogl_texture_3d_update_memory_size (tex_3d, FALSE);
+
   return _cogl_texture_3d_handle_new (tex_3d);
 }
 
@@ -604,6 +622,8 @@ _cogl_texture_3d_pre_paint (CoglTexture *tex, CoglTexturePrePaintFlags flags)
 #endif
 
       tex_3d->mipmaps_dirty = FALSE;
+
+      _cogl_texture_3d_update_memory_size (tex_3d, TRUE);
     }
 }
 
@@ -0,0 +1,633 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+#include "cogl.h"
+#include "cogl-internal.h"
+#include "cogl-util.h"
+#include "cogl-context-private.h"
+#include "cogl-object-private.h"
+#include "cogl-buffer-private.h"
+#include "cogl-bitmap-private.h"
+#include "cogl-texture-private.h"
+#include "cogl-texture-2d-private.h"
+#include "cogl-texture-driver.h"
+#include "cogl-framebuffer-private.h"
+#include "cogl-texture-download.h"
+
+/* These aren't defined in the GLES headers or in older GL headers */
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+
+/* Number of nanoseconds to wait for the fence in each call to
+   glClientWaitSync when blocking */
+#define COGL_TEXTURE_DOWNLOAD_WAIT_TIMEOUT G_GUINT64_CONSTANT (1000000000)
+
+typedef enum
+{
+  /* The read has been queued but the GPU might not have finished */
+  COGL_TEXTURE_DOWNLOAD_STATE_READING,
+  /* The data is being converted on a worker thread */
+  COGL_TEXTURE_DOWNLOAD_STATE_CONVERTING,
+  COGL_TEXTURE_DOWNLOAD_STATE_COMPLETE,
+  COGL_TEXTURE_DOWNLOAD_STATE_FAILED
+} CoglTextureDownloadState;
+
+struct _CoglTextureDownload
+{
+  CoglObject _parent;
+
+  CoglTextureDownloadState state;
+
+  int width, height;
+  /* The format that the application asked for */
+  CoglPixelFormat format;
+
+  /* The buffer that GL reads the texture into and the format the
+     data is stored in. If this isn't the same as the requested
+     format then the data is converted into converted_bmp */
+  CoglPixelBuffer *buffer;
+  CoglPixelFormat read_format;
+  unsigned int read_rowstride;
+
+  /* Fence that is signalled when the GPU has finished the read or
+     NULL if fences aren't supported */
+  void *fence;
+
+  /* Bitmap wrapping the mapped buffer. This is only used while the
+     data is being converted */
+  CoglBitmap *read_bmp;
+  CoglBitmap *converted_bmp;
+
+  /* These are written by the worker thread so they are protected by
+     the mutex. The mutex is NULL if GLib threads aren't available in
+     which case the conversion will have been done immediately */
+  GMutex *mutex;
+  GCond *cond;
+  gboolean conversion_done;
+  gboolean conversion_succeeded;
+
+  gboolean mapped;
+};
+
+static void _cogl_texture_download_free (CoglTextureDownload *download);
+
+COGL_OBJECT_DEFINE (TextureDownload, texture_download);
+
+typedef struct
+{
+  CoglTextureDownload *download;
+  guint8 *base;
+  gboolean success;
+} CoglTextureDownloadReadData;
+
+static gboolean
+_cogl_texture_download_read_via_offscreen (CoglHandle texture,
+                                           int x,
+                                           int y,
+                                           int width,
+                                           int height,
+                                           CoglTextureDownloadReadData *data,
+                                           guint8 *dst)
+{
+  CoglTextureDownload *download = data->download;
+  CoglFramebuffer *framebuffer;
+  GLenum gl_format, gl_type;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  if (!cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    return FALSE;
+
+  framebuffer = _cogl_offscreen_new_to_texture_full
+                                      (texture,
+                                       COGL_OFFSCREEN_DISABLE_DEPTH_AND_STENCIL,
+                                       0);
+
+  if (framebuffer == NULL)
+    return FALSE;
+
+  cogl_push_framebuffer (framebuffer);
+
+  /* This does the same as _cogl_read_pixels_with_rowstride except
+     that the data is left in the premult state of the framebuffer
+     and it doesn't need flipping because offscreen rendering is done
+     upside down */
+  _cogl_framebuffer_flush_state (cogl_get_draw_framebuffer (),
+                                 framebuffer,
+                                 0);
+
+  ctx->texture_driver->pixel_format_to_gl (download->read_format,
+                                           NULL, /* internal format */
+                                           &gl_format,
+                                           &gl_type);
+  ctx->texture_driver->prep_gl_for_pixels_download
+    (download->read_rowstride,
+     _cogl_get_format_bpp (download->read_format));
+
+  _cogl_buffer_bind (COGL_BUFFER (download->buffer),
+                     COGL_BUFFER_BIND_TARGET_PIXEL_PACK);
+  _cogl_buffer_ensure_store (COGL_BUFFER (download->buffer));
+
+  GE( ctx, glReadPixels (x, y, width, height, gl_format, gl_type, dst) );
+
+  _cogl_buffer_unbind (COGL_BUFFER (download->buffer));
+
+  cogl_pop_framebuffer ();
+
+  cogl_object_unref (framebuffer);
+
+  return TRUE;
+}
+
+static void
+_cogl_texture_download_read_cb (CoglHandle texture_handle,
+                                const float *subtexture_coords,
+                                const float *virtual_coords,
+                                void *user_data)
+{
+  CoglTextureDownloadReadData *data = user_data;
+  CoglTextureDownload *download = data->download;
+  CoglTexture *tex = COGL_TEXTURE (texture_handle);
+  int bpp = _cogl_get_format_bpp (download->read_format);
+  int subtexture_width = cogl_texture_get_width (texture_handle);
+  int subtexture_height = cogl_texture_get_height (texture_handle);
+
+  int x_in_subtexture = (int) (0.5 + subtexture_width * subtexture_coords[0]);
+  int y_in_subtexture = (int) (0.5 + subtexture_height * subtexture_coords[1]);
+  int width = ((int) (0.5 + subtexture_width * subtexture_coords[2])
+               - x_in_subtexture);
+  int height = ((int) (0.5 + subtexture_height * subtexture_coords[3])
+                - y_in_subtexture);
+  int x_in_bitmap = (int) (0.5 + download->width * virtual_coords[0]);
+  int y_in_bitmap = (int) (0.5 + download->height * virtual_coords[1]);
+
+  guint8 *dst;
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  if (!data->success)
+    return;
+
+  dst = (data->base +
+         x_in_bitmap * bpp +
+         y_in_bitmap * download->read_rowstride);
+
+  /* A whole GL texture can be read directly with glGetTexImage
+     without creating an FBO. This is done through the texture's
+     get_data vfunc which doesn't touch the pixel pack binding */
+  if (ctx->driver == COGL_DRIVER_GL &&
+      cogl_is_texture_2d (texture_handle) &&
+      x_in_subtexture == 0 && y_in_subtexture == 0 &&
+      width == subtexture_width && height == subtexture_height)
+    {
+      gboolean ret;
+
+      _cogl_buffer_bind (COGL_BUFFER (download->buffer),
+                         COGL_BUFFER_BIND_TARGET_PIXEL_PACK);
+      _cogl_buffer_ensure_store (COGL_BUFFER (download->buffer));
+
+      ret = tex->vtable->get_data (tex,
+                                   download->read_format,
+                                   download->read_rowstride,
+                                   dst);
+
+      _cogl_buffer_unbind (COGL_BUFFER (download->buffer));
+
+      if (ret)
+        return;
+    }
+
+  if (_cogl_texture_download_read_via_offscreen (texture_handle,
+                                                 x_in_subtexture,
+                                                 y_in_subtexture,
+                                                 width, height,
+                                                 data,
+                                                 dst))
+    return;
+
+  /* The caller will fall back to reading the whole texture
+     synchronously */
+  data->success = FALSE;
+}
+
+static gboolean
+_cogl_texture_download_read_async (CoglTextureDownload *download,
+                                   CoglHandle texture)
+{
+  CoglTextureDownloadReadData data;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  /* Make sure all of the rendering to the texture has been queued
+     before the read. We don't know which framebuffers the texture
+     depends on so all of the journals are flushed */
+  cogl_flush ();
+
+  /* This is only used when the pixel buffer is a buffer object so
+     the reads are given offsets into the buffer */
+  data.download = download;
+  data.base = NULL;
+  data.success = TRUE;
+
+  _cogl_texture_foreach_sub_texture_in_region (texture,
+                                               0, 0, 1, 1,
+                                               _cogl_texture_download_read_cb,
+                                               &data);
+
+  if (!data.success)
+    return FALSE;
+
+  if (ctx->glFenceSync)
+    {
+      download->fence = ctx->glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      /* Make sure the GPU starts on the read even if the application
+         doesn't poll for a while */
+      GE( ctx, glFlush () );
+    }
+
+  return TRUE;
+}
+
+static gboolean
+_cogl_texture_download_read_sync (CoglTextureDownload *download,
+                                  CoglHandle texture)
+{
+  CoglBuffer *buffer = COGL_BUFFER (download->buffer);
+  guint8 *data;
+  int ret;
+
+  data = _cogl_buffer_map_for_fill_or_fallback (buffer);
+  if (data == NULL)
+    return FALSE;
+
+  ret = cogl_texture_get_data (texture,
+                               download->read_format,
+                               download->read_rowstride,
+                               data);
+
+  _cogl_buffer_unmap_for_fill_or_fallback (buffer);
+
+  return ret != 0;
+}
+
+static void
+_cogl_texture_download_convert_cb (void *user_data)
+{
+  CoglTextureDownload *download = user_data;
+  gboolean success;
+
+  /* This runs on a worker thread. The bitmaps aren't touched by the
+     main thread until conversion_done is set */
+  success = _cogl_bitmap_convert_into (download->read_bmp,
+                                       download->converted_bmp);
+
+  if (download->mutex)
+    g_mutex_lock (download->mutex);
+
+  download->conversion_succeeded = success;
+  download->conversion_done = TRUE;
+
+  if (download->mutex)
+    {
+      g_cond_signal (download->cond);
+      g_mutex_unlock (download->mutex);
+    }
+}
+
+static void
+_cogl_texture_download_finish_reading (CoglTextureDownload *download)
+{
+  int dst_rowstride;
+  guint8 *data;
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  if (download->fence)
+    {
+      ctx->glDeleteSync (download->fence);
+      download->fence = NULL;
+    }
+
+  if (download->read_format == download->format)
+    {
+      download->state = COGL_TEXTURE_DOWNLOAD_STATE_COMPLETE;
+      return;
+    }
+
+  /* The buffer has to be mapped on this thread because it needs the
+     GL context. It stays mapped until the conversion is finished */
+  data = cogl_buffer_map (COGL_BUFFER (download->buffer),
+                          COGL_BUFFER_ACCESS_READ,
+                          0);
+  if (data == NULL)
+    {
+      download->state = COGL_TEXTURE_DOWNLOAD_STATE_FAILED;
+      return;
+    }
+
+  download->read_bmp = _cogl_bitmap_new_from_data (data,
+                                                   download->read_format,
+                                                   download->width,
+                                                   download->height,
+                                                   download->read_rowstride,
+                                                   NULL, NULL);
+
+  dst_rowstride = download->width * _cogl_get_format_bpp (download->format);
+  download->converted_bmp =
+    _cogl_bitmap_new_from_data (g_malloc (dst_rowstride * download->height),
+                                download->format,
+                                download->width,
+                                download->height,
+                                dst_rowstride,
+                                (CoglBitmapDestroyNotify) g_free,
+                                NULL);
+
+  if (g_thread_supported ())
+    {
+      download->mutex = g_mutex_new ();
+      download->cond = g_cond_new ();
+    }
+
+  download->state = COGL_TEXTURE_DOWNLOAD_STATE_CONVERTING;
+
+  _cogl_context_push_work (ctx,
+                           _cogl_texture_download_convert_cb,
+                           download);
+}
+
+static gboolean
+_cogl_texture_download_finish_converting (CoglTextureDownload *download,
+                                          gboolean wait)
+{
+  gboolean done;
+
+  if (download->mutex)
+    {
+      g_mutex_lock (download->mutex);
+      if (wait)
+        while (!download->conversion_done)
+          g_cond_wait (download->cond, download->mutex);
+      done = download->conversion_done;
+      g_mutex_unlock (download->mutex);
+    }
+  else
+    done = download->conversion_done;
+
+  if (!done)
+    return FALSE;
+
+  cogl_object_unref (download->read_bmp);
+  download->read_bmp = NULL;
+  cogl_buffer_unmap (COGL_BUFFER (download->buffer));
+
+  if (download->conversion_succeeded)
+    download->state = COGL_TEXTURE_DOWNLOAD_STATE_COMPLETE;
+  else
+    download->state = COGL_TEXTURE_DOWNLOAD_STATE_FAILED;
+
+  return TRUE;
+}
+
+CoglTextureDownload *
+cogl_texture_download_new (CoglHandle texture,
+                           CoglPixelFormat format)
+{
+  CoglTextureDownload *download;
+  CoglPixelFormat texture_format;
+  gboolean read_async;
+  GLenum gl_format, gl_type;
+
+  _COGL_GET_CONTEXT (ctx, NULL);
+
+  if (!cogl_is_texture (texture))
+    return NULL;
+
+  texture_format = cogl_texture_get_format (texture);
+
+  /* Default to internal format if none specified */
+  if (format == COGL_PIXEL_FORMAT_ANY)
+    format = texture_format;
+
+  download = g_slice_new0 (CoglTextureDownload);
+
+  download->width = cogl_texture_get_width (texture);
+  download->height = cogl_texture_get_height (texture);
+  download->format = format;
+
+  /* Without PBOs the pixel buffer would just be malloc'd memory so
+     there is nothing to gain from deferring the read */
+  read_async = cogl_features_available (COGL_FEATURE_PBOS);
+
+  if (read_async)
+    {
+      /* GL can only read in a limited set of formats and it doesn't
+         change the premult status of the data. Anything else is left
+         for the conversion on the worker thread */
+      download->read_format =
+        ctx->texture_driver->find_best_gl_get_data_format (format,
+                                                           &gl_format,
+                                                           &gl_type);
+      if ((download->read_format & COGL_A_BIT))
+        download->read_format = ((download->read_format &
+                                  COGL_UNPREMULT_MASK) |
+                                 (texture_format & COGL_PREMULT_BIT));
+    }
+  else
+    download->read_format = format;
+
+  download->buffer =
+    cogl_pixel_buffer_new_with_size (download->width,
+                                     download->height,
+                                     download->read_format,
+                                     &download->read_rowstride);
+  if (download->buffer == NULL)
+    {
+      g_slice_free (CoglTextureDownload, download);
+      return NULL;
+    }
+  cogl_buffer_set_update_hint (COGL_BUFFER (download->buffer),
+                               COGL_BUFFER_UPDATE_HINT_STREAM);
+
+  download = _cogl_texture_download_object_new (download);
+
+  if (read_async && _cogl_texture_download_read_async (download, texture))
+    download->state = COGL_TEXTURE_DOWNLOAD_STATE_READING;
+  else if (_cogl_texture_download_read_sync (download, texture))
+    _cogl_texture_download_finish_reading (download);
+  else
+    download->state = COGL_TEXTURE_DOWNLOAD_STATE_FAILED;
+
+  return download;
+}
+
+gboolean
+cogl_texture_download_is_complete (CoglTextureDownload *download)
+{
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  g_return_val_if_fail (cogl_is_texture_download (download), FALSE);
+
+  if (download->state == COGL_TEXTURE_DOWNLOAD_STATE_READING)
+    {
+      if (download->fence &&
+          ctx->glClientWaitSync (download->fence,
+                                 GL_SYNC_FLUSH_COMMANDS_BIT,
+                                 0) == GL_TIMEOUT_EXPIRED)
+        return FALSE;
+
+      _cogl_texture_download_finish_reading (download);
+    }
+
+  if (download->state == COGL_TEXTURE_DOWNLOAD_STATE_CONVERTING)
+    return _cogl_texture_download_finish_converting (download, FALSE);
+
+  return TRUE;
+}
+
+void
+cogl_texture_download_wait (CoglTextureDownload *download)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  g_return_if_fail (cogl_is_texture_download (download));
+
+  if (download->state == COGL_TEXTURE_DOWNLOAD_STATE_READING)
+    {
+      if (download->fence)
+        while (ctx->glClientWaitSync (download->fence,
+                                      GL_SYNC_FLUSH_COMMANDS_BIT,
+                                      COGL_TEXTURE_DOWNLOAD_WAIT_TIMEOUT) ==
+               GL_TIMEOUT_EXPIRED)
+          ;
+
+      _cogl_texture_download_finish_reading (download);
+    }
+
+  if (download->state == COGL_TEXTURE_DOWNLOAD_STATE_CONVERTING)
+    _cogl_texture_download_finish_converting (download, TRUE);
+}
+
+CoglPixelFormat
+cogl_texture_download_get_format (CoglTextureDownload *download)
+{
+  g_return_val_if_fail (cogl_is_texture_download (download),
+                        COGL_PIXEL_FORMAT_ANY);
+
+  return download->format;
+}
+
+const guint8 *
+cogl_texture_download_map (CoglTextureDownload *download,
+                           unsigned int *rowstride)
+{
+  guint8 *data;
+
+  g_return_val_if_fail (cogl_is_texture_download (download), NULL);
+  g_return_val_if_fail (!download->mapped, NULL);
+
+  cogl_texture_download_wait (download);
+
+  if (download->state == COGL_TEXTURE_DOWNLOAD_STATE_FAILED)
+    return NULL;
+
+  if (download->converted_bmp)
+    {
+      data = _cogl_bitmap_map (download->converted_bmp,
+                               COGL_BUFFER_ACCESS_READ,
+                               0);
+      if (rowstride)
+        *rowstride = _cogl_bitmap_get_rowstride (download->converted_bmp);
+    }
+  else
+    {
+      /* The data is already in the right format so the buffer can be
+         returned directly */
+      data = cogl_buffer_map (COGL_BUFFER (download->buffer),
+                              COGL_BUFFER_ACCESS_READ,
+                              0);
+      if (rowstride)
+        *rowstride = download->read_rowstride;
+    }
+
+  if (data)
+    download->mapped = TRUE;
+
+  return data;
+}
+
+void
+cogl_texture_download_unmap (CoglTextureDownload *download)
+{
+  g_return_if_fail (cogl_is_texture_download (download));
+
+  if (!download->mapped)
+    return;
+
+  if (download->converted_bmp)
+    _cogl_bitmap_unmap (download->converted_bmp);
+  else
+    cogl_buffer_unmap (COGL_BUFFER (download->buffer));
+
+  download->mapped = FALSE;
+}
+
+static void
+_cogl_texture_download_free (CoglTextureDownload *download)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  /* The worker thread might still be using the bitmaps */
+  if (download->state == COGL_TEXTURE_DOWNLOAD_STATE_CONVERTING)
+    _cogl_texture_download_finish_converting (download, TRUE);
+
+  cogl_texture_download_unmap (download);
+
+  if (download->fence)
+    ctx->glDeleteSync (download->fence);
+
+  if (download->converted_bmp)
+    cogl_object_unref (download->converted_bmp);
+
+  cogl_object_unref (download->buffer);
+
+  if (download->mutex)
+    {
+      g_mutex_free (download->mutex);
+      g_cond_free (download->cond);
+    }
+
+  g_slice_free (CoglTextureDownload, download);
+}
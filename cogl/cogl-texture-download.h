@@ -0,0 +1,190 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TEXTURE_DOWNLOAD_H__
+#define __COGL_TEXTURE_DOWNLOAD_H__
+
+#include <glib.h>
+
+#include <cogl/cogl-types.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-texture-download
+ * @short_description: Functions for reading back the contents of a
+ *   texture without stalling
+ *
+ * cogl_texture_get_data() waits for the GPU to finish all of the
+ * rendering into a texture before it returns the data. A
+ * #CoglTextureDownload instead only queues the read and the data can
+ * be collected later once the GPU has caught up. Where the driver
+ * supports it the texture is read into a pixel buffer object so that
+ * the result can be mapped without any extra copy. If the data has to
+ * be converted to the requested format then the conversion is done on
+ * a separate thread.
+ */
+
+/* All of the cogl-texture-download API is currently experimental so
+ * we suffix the actual symbols with _EXP so if somone is monitoring
+ * for ABI changes it will hopefully be clearer to them what's going
+ * on if any of the symbols dissapear at a later date.
+ */
+#define cogl_texture_download_new cogl_texture_download_new_EXP
+#define cogl_is_texture_download cogl_is_texture_download_EXP
+#define cogl_texture_download_is_complete \
+  cogl_texture_download_is_complete_EXP
+#define cogl_texture_download_wait cogl_texture_download_wait_EXP
+#define cogl_texture_download_get_format \
+  cogl_texture_download_get_format_EXP
+#define cogl_texture_download_map cogl_texture_download_map_EXP
+#define cogl_texture_download_unmap cogl_texture_download_unmap_EXP
+
+typedef struct _CoglTextureDownload CoglTextureDownload;
+
+#define COGL_TEXTURE_DOWNLOAD(X) ((CoglTextureDownload *)X)
+
+/**
+ * cogl_texture_download_new:
+ * @texture: a #CoglHandle for a texture
+ * @format: the #CoglPixelFormat to store the texture data in or
+ *   %COGL_PIXEL_FORMAT_ANY to use the format of the texture
+ *
+ * Starts reading back the contents of @texture. Any rendering to the
+ * texture that has already been queued will be included in the
+ * data. The function returns as soon as the read has been queued. Use
+ * cogl_texture_download_is_complete() to check whether the data is
+ * ready or cogl_texture_download_map() to wait for it.
+ *
+ * If the driver doesn't support pixel buffer objects then the data
+ * is read back immediately in the same way as
+ * cogl_texture_get_data().
+ *
+ * Return value: a new #CoglTextureDownload or %NULL if @texture is
+ *   not a valid texture
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+CoglTextureDownload *
+cogl_texture_download_new (CoglHandle texture,
+                           CoglPixelFormat format);
+
+/**
+ * cogl_is_texture_download:
+ * @object: a #CoglObject to test
+ *
+ * Checks whether @object is a #CoglTextureDownload.
+ *
+ * Return value: %TRUE if @object is a #CoglTextureDownload and
+ *   %FALSE otherwise
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gboolean
+cogl_is_texture_download (void *object);
+
+/**
+ * cogl_texture_download_is_complete:
+ * @download: a #CoglTextureDownload
+ *
+ * Checks whether the data for @download is ready without
+ * blocking. Once this returns %TRUE, cogl_texture_download_map() will
+ * not need to wait. If the driver can't tell whether the GPU has
+ * finished then this always returns %TRUE and mapping the data may
+ * block.
+ *
+ * Return value: %TRUE if the data is ready
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gboolean
+cogl_texture_download_is_complete (CoglTextureDownload *download);
+
+/**
+ * cogl_texture_download_wait:
+ * @download: a #CoglTextureDownload
+ *
+ * Blocks until the data for @download is ready.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+void
+cogl_texture_download_wait (CoglTextureDownload *download);
+
+/**
+ * cogl_texture_download_get_format:
+ * @download: a #CoglTextureDownload
+ *
+ * Return value: the #CoglPixelFormat of the data that
+ *   cogl_texture_download_map() will return
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+CoglPixelFormat
+cogl_texture_download_get_format (CoglTextureDownload *download);
+
+/**
+ * cogl_texture_download_map:
+ * @download: a #CoglTextureDownload
+ * @rowstride: return location for the number of bytes between the
+ *   start of each row of the data
+ *
+ * Maps the downloaded data so that it can be read by the CPU. This
+ * will wait for the data if it isn't ready yet. The data stays valid
+ * until cogl_texture_download_unmap() is called and it must not be
+ * written to.
+ *
+ * Return value: a pointer to the data or %NULL if the texture could
+ *   not be read
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+const guint8 *
+cogl_texture_download_map (CoglTextureDownload *download,
+                           unsigned int *rowstride);
+
+/**
+ * cogl_texture_download_unmap:
+ * @download: a #CoglTextureDownload
+ *
+ * Unmaps the data previously mapped with cogl_texture_download_map().
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+void
+cogl_texture_download_unmap (CoglTextureDownload *download);
+
+G_END_DECLS
+
+#endif /* __COGL_TEXTURE_DOWNLOAD_H__ */
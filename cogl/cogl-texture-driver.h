@@ -109,6 +109,22 @@ struct _CoglTextureDriver
                        GLuint       source_gl_format,
                        GLuint       source_gl_type);
 
+  /*
+   * Replaces the contents of one mipmap level of the GL texture with
+   * already compressed data. internal_gl_format must be a compressed
+   * format that pixel_format_to_gl reported as supported.
+   */
+  void
+  (* upload_compressed_to_gl) (GLenum        gl_target,
+                               GLuint        gl_handle,
+                               gboolean      is_foreign,
+                               int           level,
+                               int           width,
+                               int           height,
+                               GLint         internal_gl_format,
+                               const guint8 *data,
+                               int           data_size);
+
   /*
    * This sets up the glPixelStore state for an download to a destination with
    * the same size, and with no offset.
@@ -0,0 +1,411 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+#include "cogl.h"
+#include "cogl-internal.h"
+#include "cogl-context-private.h"
+#include "cogl-object-private.h"
+#include "cogl-bitmap-private.h"
+#include "cogl-texture-private.h"
+#include "cogl-texture-2d-private.h"
+#include "cogl-compressed-image-private.h"
+#include "cogl-texture-load.h"
+
+typedef enum
+{
+  /* The file is being decoded on a worker thread */
+  COGL_TEXTURE_LOAD_STATE_DECODING,
+  /* The decoded data is being converted on a worker thread */
+  COGL_TEXTURE_LOAD_STATE_CONVERTING,
+  COGL_TEXTURE_LOAD_STATE_COMPLETE,
+  COGL_TEXTURE_LOAD_STATE_FAILED
+} CoglTextureLoadState;
+
+struct _CoglTextureLoad
+{
+  CoglObject _parent;
+
+  CoglTextureLoadState state;
+
+  char *filename;
+  CoglTextureFlags flags;
+  /* The format that the application asked for. Once the file is
+     decoded this is replaced with the format that was picked for the
+     texture */
+  CoglPixelFormat internal_format;
+
+  /* The results of the decode. Creating Cogl objects isn't thread
+     safe so the decoded pixels are only wrapped in a bitmap once they
+     are back on the main thread */
+  gboolean decoded;
+  CoglBitmapFileData file_data;
+  CoglCompressedImage *compressed_image;
+  GError *error;
+
+  /* If the decoded data isn't in a format that can be uploaded then
+     it is converted from decoded_bmp into converted_bmp on a worker
+     thread */
+  CoglBitmap *decoded_bmp;
+  CoglBitmap *converted_bmp;
+  gboolean conversion_succeeded;
+
+  CoglHandle texture;
+
+  /* work_done is written by the worker thread so it is protected by
+     the mutex. The mutex is NULL if GLib threads aren't available in
+     which case the work will have been done immediately. The results
+     above aren't touched by the main thread until work_done is set */
+  GMutex *mutex;
+  GCond *cond;
+  gboolean work_done;
+};
+
+static void _cogl_texture_load_free (CoglTextureLoad *load);
+
+COGL_OBJECT_DEFINE (TextureLoad, texture_load);
+
+static void
+_cogl_texture_load_signal_work_done (CoglTextureLoad *load)
+{
+  if (load->mutex)
+    g_mutex_lock (load->mutex);
+
+  load->work_done = TRUE;
+
+  if (load->mutex)
+    {
+      g_cond_signal (load->cond);
+      g_mutex_unlock (load->mutex);
+    }
+}
+
+static void
+_cogl_texture_load_decode_cb (void *user_data)
+{
+  CoglTextureLoad *load = user_data;
+
+  /* This runs on a worker thread so it must not touch GL or create
+     any Cogl objects. KTX and DDS files are tried first in the same
+     way as cogl_texture_new_from_file() */
+  load->compressed_image =
+    _cogl_compressed_image_new_from_file (load->filename, &load->error);
+
+  if (load->compressed_image == NULL && load->error == NULL)
+    load->decoded = _cogl_bitmap_decode_file (load->filename,
+                                              &load->file_data,
+                                              &load->error);
+
+  _cogl_texture_load_signal_work_done (load);
+}
+
+static void
+_cogl_texture_load_convert_cb (void *user_data)
+{
+  CoglTextureLoad *load = user_data;
+
+  /* This runs on a worker thread. The bitmaps aren't touched by the
+     main thread until work_done is set */
+  load->conversion_succeeded = _cogl_bitmap_convert_into (load->decoded_bmp,
+                                                          load->converted_bmp);
+
+  _cogl_texture_load_signal_work_done (load);
+}
+
+static gboolean
+_cogl_texture_load_check_work_done (CoglTextureLoad *load,
+                                    gboolean wait)
+{
+  gboolean done;
+
+  if (load->mutex)
+    {
+      g_mutex_lock (load->mutex);
+      if (wait)
+        while (!load->work_done)
+          g_cond_wait (load->cond, load->mutex);
+      done = load->work_done;
+      g_mutex_unlock (load->mutex);
+    }
+  else
+    done = load->work_done;
+
+  return done;
+}
+
+static void
+_cogl_texture_load_push_work (CoglTextureLoad *load,
+                              CoglWorkFunc func)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  load->work_done = FALSE;
+
+  _cogl_context_push_work (ctx, func, load);
+}
+
+static void
+_cogl_texture_load_create_texture (CoglTextureLoad *load,
+                                   CoglBitmap *bmp)
+{
+  /* The bitmap is already in the upload format so this won't need to
+     convert it again */
+  load->texture = cogl_texture_new_from_bitmap (bmp,
+                                                load->flags,
+                                                load->internal_format);
+
+  if (load->texture == COGL_INVALID_HANDLE)
+    {
+      g_set_error (&load->error, COGL_TEXTURE_ERROR,
+                   COGL_TEXTURE_ERROR_SIZE,
+                   "Failed to create a texture for the image");
+      load->state = COGL_TEXTURE_LOAD_STATE_FAILED;
+    }
+  else
+    load->state = COGL_TEXTURE_LOAD_STATE_COMPLETE;
+}
+
+static void
+_cogl_texture_load_finish_decoding (CoglTextureLoad *load)
+{
+  CoglPixelFormat src_format, upload_format;
+  int width, height, rowstride;
+
+  if (load->compressed_image)
+    {
+      load->texture =
+        _cogl_texture_2d_new_from_compressed_image (load->compressed_image,
+                                                    load->flags,
+                                                    &load->error);
+      _cogl_compressed_image_free (load->compressed_image);
+      load->compressed_image = NULL;
+
+      if (load->texture == COGL_INVALID_HANDLE)
+        load->state = COGL_TEXTURE_LOAD_STATE_FAILED;
+      else
+        load->state = COGL_TEXTURE_LOAD_STATE_COMPLETE;
+
+      return;
+    }
+
+  if (!load->decoded)
+    {
+      if (load->error == NULL)
+        g_set_error (&load->error, COGL_BITMAP_ERROR,
+                     COGL_BITMAP_ERROR_FAILED,
+                     "Failed to load the image");
+      load->state = COGL_TEXTURE_LOAD_STATE_FAILED;
+      return;
+    }
+
+  load->decoded = FALSE;
+  load->decoded_bmp =
+    _cogl_bitmap_new_from_data (load->file_data.data,
+                                load->file_data.format,
+                                load->file_data.width,
+                                load->file_data.height,
+                                load->file_data.rowstride,
+                                load->file_data.destroy_fn,
+                                load->file_data.destroy_fn_data);
+
+  src_format = load->file_data.format;
+  upload_format =
+    _cogl_texture_determine_upload_format (src_format,
+                                           load->internal_format,
+                                           &load->internal_format,
+                                           NULL, NULL, NULL);
+
+  if (upload_format == src_format)
+    {
+      _cogl_texture_load_create_texture (load, load->decoded_bmp);
+      cogl_object_unref (load->decoded_bmp);
+      load->decoded_bmp = NULL;
+      return;
+    }
+
+  width = load->file_data.width;
+  height = load->file_data.height;
+  rowstride = width * _cogl_get_format_bpp (upload_format);
+  load->converted_bmp =
+    _cogl_bitmap_new_from_data (g_malloc (rowstride * height),
+                                upload_format,
+                                width, height,
+                                rowstride,
+                                (CoglBitmapDestroyNotify) g_free,
+                                NULL);
+
+  load->state = COGL_TEXTURE_LOAD_STATE_CONVERTING;
+
+  _cogl_texture_load_push_work (load, _cogl_texture_load_convert_cb);
+}
+
+static void
+_cogl_texture_load_finish_converting (CoglTextureLoad *load)
+{
+  cogl_object_unref (load->decoded_bmp);
+  load->decoded_bmp = NULL;
+
+  if (load->conversion_succeeded)
+    _cogl_texture_load_create_texture (load, load->converted_bmp);
+  else
+    {
+      g_set_error (&load->error, COGL_TEXTURE_ERROR,
+                   COGL_TEXTURE_ERROR_FORMAT,
+                   "Failed to convert the image to the texture format");
+      load->state = COGL_TEXTURE_LOAD_STATE_FAILED;
+    }
+
+  cogl_object_unref (load->converted_bmp);
+  load->converted_bmp = NULL;
+}
+
+static gboolean
+_cogl_texture_load_update (CoglTextureLoad *load,
+                           gboolean wait)
+{
+  if (load->state == COGL_TEXTURE_LOAD_STATE_DECODING)
+    {
+      if (!_cogl_texture_load_check_work_done (load, wait))
+        return FALSE;
+
+      _cogl_texture_load_finish_decoding (load);
+    }
+
+  if (load->state == COGL_TEXTURE_LOAD_STATE_CONVERTING)
+    {
+      if (!_cogl_texture_load_check_work_done (load, wait))
+        return FALSE;
+
+      _cogl_texture_load_finish_converting (load);
+    }
+
+  return TRUE;
+}
+
+CoglTextureLoad *
+cogl_texture_load_new_from_file (const char *filename,
+                                 CoglTextureFlags flags,
+                                 CoglPixelFormat internal_format)
+{
+  CoglTextureLoad *load;
+
+  load = g_slice_new0 (CoglTextureLoad);
+
+  load->filename = g_strdup (filename);
+  load->flags = flags;
+  load->internal_format = internal_format;
+  load->texture = COGL_INVALID_HANDLE;
+  load->state = COGL_TEXTURE_LOAD_STATE_DECODING;
+
+  if (g_thread_supported ())
+    {
+      load->mutex = g_mutex_new ();
+      load->cond = g_cond_new ();
+    }
+
+  load = _cogl_texture_load_object_new (load);
+
+  _cogl_texture_load_push_work (load, _cogl_texture_load_decode_cb);
+
+  return load;
+}
+
+gboolean
+cogl_texture_load_is_complete (CoglTextureLoad *load)
+{
+  g_return_val_if_fail (cogl_is_texture_load (load), FALSE);
+
+  return _cogl_texture_load_update (load, FALSE);
+}
+
+void
+cogl_texture_load_wait (CoglTextureLoad *load)
+{
+  g_return_if_fail (cogl_is_texture_load (load));
+
+  _cogl_texture_load_update (load, TRUE);
+}
+
+CoglHandle
+cogl_texture_load_get_texture (CoglTextureLoad *load,
+                               GError **error)
+{
+  g_return_val_if_fail (cogl_is_texture_load (load), COGL_INVALID_HANDLE);
+  g_return_val_if_fail (error == NULL || *error == NULL, COGL_INVALID_HANDLE);
+
+  cogl_texture_load_wait (load);
+
+  if (load->state == COGL_TEXTURE_LOAD_STATE_FAILED)
+    {
+      if (error && load->error)
+        *error = g_error_copy (load->error);
+      return COGL_INVALID_HANDLE;
+    }
+
+  return load->texture;
+}
+
+static void
+_cogl_texture_load_free (CoglTextureLoad *load)
+{
+  /* The worker thread might still be using the load. There's no need
+     to create the texture in that case */
+  if (load->state == COGL_TEXTURE_LOAD_STATE_DECODING ||
+      load->state == COGL_TEXTURE_LOAD_STATE_CONVERTING)
+    _cogl_texture_load_check_work_done (load, TRUE);
+
+  if (load->decoded)
+    load->file_data.destroy_fn (load->file_data.data,
+                                load->file_data.destroy_fn_data);
+
+  if (load->compressed_image)
+    _cogl_compressed_image_free (load->compressed_image);
+
+  if (load->decoded_bmp)
+    cogl_object_unref (load->decoded_bmp);
+
+  if (load->converted_bmp)
+    cogl_object_unref (load->converted_bmp);
+
+  if (load->texture != COGL_INVALID_HANDLE)
+    cogl_handle_unref (load->texture);
+
+  if (load->error)
+    g_error_free (load->error);
+
+  if (load->mutex)
+    {
+      g_mutex_free (load->mutex);
+      g_cond_free (load->cond);
+    }
+
+  g_free (load->filename);
+
+  g_slice_free (CoglTextureLoad, load);
+}
@@ -0,0 +1,168 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+
+#if !defined(__COGL_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TEXTURE_LOAD_H__
+#define __COGL_TEXTURE_LOAD_H__
+
+#include <glib.h>
+
+#include <cogl/cogl-types.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-texture-load
+ * @short_description: Functions for loading textures from files
+ *   without blocking
+ *
+ * cogl_texture_new_from_file() decodes the whole image before it
+ * returns so it can stall an application that is trying to keep
+ * drawing frames. A #CoglTextureLoad instead decodes the file and
+ * converts the data to the format of the texture on a separate
+ * thread. Only creating the texture from the decoded data needs the
+ * GL context so that part is done once the application asks for the
+ * result. The application can keep drawing with its own placeholder
+ * until cogl_texture_load_is_complete() returns %TRUE.
+ */
+
+/* All of the cogl-texture-load API is currently experimental so we
+ * suffix the actual symbols with _EXP so if somone is monitoring for
+ * ABI changes it will hopefully be clearer to them what's going on if
+ * any of the symbols dissapear at a later date.
+ */
+#define cogl_texture_load_new_from_file cogl_texture_load_new_from_file_EXP
+#define cogl_is_texture_load cogl_is_texture_load_EXP
+#define cogl_texture_load_is_complete cogl_texture_load_is_complete_EXP
+#define cogl_texture_load_wait cogl_texture_load_wait_EXP
+#define cogl_texture_load_get_texture cogl_texture_load_get_texture_EXP
+
+typedef struct _CoglTextureLoad CoglTextureLoad;
+
+#define COGL_TEXTURE_LOAD(X) ((CoglTextureLoad *)X)
+
+/**
+ * cogl_texture_load_new_from_file:
+ * @filename: the file to load
+ * @flags: Optional flags for the texture, or %COGL_TEXTURE_NONE
+ * @internal_format: the #CoglPixelFormat to use for the GPU storage of the
+ *    texture. If %COGL_PIXEL_FORMAT_ANY is given then a premultiplied
+ *    format similar to the format of the source data will be used. The
+ *    default blending equations of Cogl expect premultiplied color data;
+ *    the main use of passing a non-premultiplied format here is if you
+ *    have non-premultiplied source data and are going to adjust the blend
+ *    mode (see cogl_material_set_blend()) or use the data for something
+ *    other than straight blending.
+ *
+ * Starts loading a texture from @filename in the background. The
+ * function returns straight away. Use cogl_texture_load_is_complete()
+ * to check whether the texture is ready or
+ * cogl_texture_load_get_texture() to wait for it.
+ *
+ * The same file types are supported as for
+ * cogl_texture_new_from_file(). If GLib threads aren't available then
+ * the file is decoded before this function returns.
+ *
+ * Return value: a new #CoglTextureLoad
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+CoglTextureLoad *
+cogl_texture_load_new_from_file (const char *filename,
+                                 CoglTextureFlags flags,
+                                 CoglPixelFormat internal_format);
+
+/**
+ * cogl_is_texture_load:
+ * @object: a #CoglObject to test
+ *
+ * Checks whether @object is a #CoglTextureLoad.
+ *
+ * Return value: %TRUE if @object is a #CoglTextureLoad and %FALSE
+ *   otherwise
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gboolean
+cogl_is_texture_load (void *object);
+
+/**
+ * cogl_texture_load_is_complete:
+ * @load: a #CoglTextureLoad
+ *
+ * Checks whether the file for @load has been decoded without
+ * blocking. If it has then the texture is created before this
+ * returns so it should be called from the thread that owns the
+ * Cogl context, typically once per frame. Once this returns %TRUE,
+ * cogl_texture_load_get_texture() will not need to wait.
+ *
+ * Return value: %TRUE if the texture is ready or the load failed
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gboolean
+cogl_texture_load_is_complete (CoglTextureLoad *load);
+
+/**
+ * cogl_texture_load_wait:
+ * @load: a #CoglTextureLoad
+ *
+ * Blocks until the file for @load has been decoded and then creates
+ * the texture.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+void
+cogl_texture_load_wait (CoglTextureLoad *load);
+
+/**
+ * cogl_texture_load_get_texture:
+ * @load: a #CoglTextureLoad
+ * @error: A #GError to catch exceptional errors or %NULL
+ *
+ * Gets the texture that was loaded. This will wait for the load if
+ * it isn't complete yet. The texture is owned by @load so
+ * cogl_handle_ref() should be used to keep it after @load is
+ * destroyed.
+ *
+ * Return value: the texture or %COGL_INVALID_HANDLE if the file
+ *   could not be loaded
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+CoglHandle
+cogl_texture_load_get_texture (CoglTextureLoad *load,
+                               GError **error);
+
+G_END_DECLS
+
+#endif /* __COGL_TEXTURE_LOAD_H__ */
@@ -27,6 +27,7 @@
 #include "cogl-bitmap-private.h"
 #include "cogl-handle.h"
 #include "cogl-pipeline-private.h"
+#include "cogl-memory-usage.h"
 
 #define COGL_TEXTURE(tex) ((CoglTexture *)(tex))
 
@@ -139,6 +140,11 @@ struct _CoglTexture
   CoglHandleObject         _parent;
   GList                   *framebuffers;
   const CoglTextureVtable *vtable;
+  /* Estimated number of bytes of GPU memory used by the GL textures
+     that this texture owns directly and the category that they are
+     accounted under in the context */
+  gsize                    memory_size;
+  CoglMemoryCategory       memory_category;
 };
 
 typedef enum _CoglTextureChangeFlags
@@ -175,6 +181,32 @@ _cogl_texture_init (CoglTexture *texture,
 void
 _cogl_texture_free (CoglTexture *texture);
 
+/* Estimates the number of bytes of GPU memory needed for a texture
+   with the given size and format. If @mipmaps is TRUE then the memory
+   for a full mipmap chain is included */
+gsize
+_cogl_texture_estimate_memory_size (int width,
+                                    int height,
+                                    int depth,
+                                    CoglPixelFormat format,
+                                    gboolean mipmaps);
+
+/* Records the estimated GPU memory used by the GL textures that
+   @texture owns in the memory usage of the context. Textures start
+   with a size of zero and the memory is given back when the texture
+   is freed */
+void
+_cogl_texture_set_memory_size (CoglTexture *texture,
+                               gsize size);
+
+/* Moves the memory of a texture to a different category. This is
+   used for textures that are created internally on behalf of
+   something else such as an atlas. For a sliced texture the memory
+   of every slice is moved */
+void
+_cogl_texture_set_memory_category (CoglHandle handle,
+                                   CoglMemoryCategory category);
+
 /* This is used to register a type to the list of handle types that
    will be considered a texture in cogl_is_texture() */
 void
@@ -240,6 +272,18 @@ CoglPixelFormat
 _cogl_texture_determine_internal_format (CoglPixelFormat src_format,
                                          CoglPixelFormat dst_format);
 
+/* Works out which format the data needs to be in before it can be
+   given to GL for a texture of dst_format without converting
+   anything. The GLenums needed for uploading are returned the same as
+   for _cogl_texture_prepare_for_upload */
+CoglPixelFormat
+_cogl_texture_determine_upload_format (CoglPixelFormat  src_format,
+                                       CoglPixelFormat  dst_format,
+                                       CoglPixelFormat *dst_format_out,
+                                       GLenum          *out_glintformat,
+                                       GLenum          *out_glformat,
+                                       GLenum          *out_gltype);
+
 /* Utility function to help uploading a bitmap. If the bitmap needs
    premult conversion then it will be copied and *copied_bitmap will
    be set to TRUE. Otherwise dst_bmp will be set to a shallow copy of
@@ -227,6 +227,7 @@ _cogl_texture_rectangle_create_base (unsigned int     width,
   CoglTexture *tex = COGL_TEXTURE (tex_rect);
 
   _cogl_texture_init (tex, &cogl_texture_rectangle_vtable);
+  tex->memory_category = COGL_MEMORY_CATEGORY_TEXTURE_RECTANGLE;
 
   tex_rect->width = width;
   tex_rect->height = height;
@@ -244,6 +245,20 @@ _cogl_texture_rectangle_create_base (unsigned int     width,
   return tex_rect;
 }
 
+/* Rectangle textures can't have mipmaps so only the base level is
+   counted. Foreign textures aren't counted at all */
+static void
+_cogl_texture_rectangle_update_memory_size (CoglTextureRectangle *tex_rect)
+{
+  _cogl_texture_set_memory_size
+    (COGL_TEXTURE (tex_rect),
+     _cogl_texture_estimate_memory_size (tex_rect->width,
+                                         tex_rect->height,
+                                         1, /* depth */
+                                         tex_rect->format,
+                                         FALSE /* mipmaps */));
+}
+
 CoglHandle
 _cogl_texture_rectangle_new_with_size (unsigned int     width,
                                        unsigned int     height,
@@ -279,6 +294,8 @@ _cogl_texture_rectangle_new_with_size (unsigned int     width,
   GE( ctx, glTexImage2D (GL_TEXTURE_RECTANGLE_ARB, 0, gl_intformat,
                          width, height, 0, gl_format, gl_type, NULL) );
 
+  _cogl_texture_rectangle_update_memory_size (tex_rect);
+
   return _cogl_texture_rectangle_handle_new (tex_rect);
 }
 
@@ -334,6 +351,8 @@ _cogl_texture_rectangle_new_from_bitmap (CoglBitmap      *bmp,
 
   cogl_object_unref (dst_bmp);
 
+  _cogl_texture_rectangle_update_memory_size (tex_rect);
+
   return _cogl_texture_rectangle_handle_new (tex_rect);
 }
 
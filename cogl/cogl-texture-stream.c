@@ -0,0 +1,389 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+#include "cogl.h"
+#include "cogl-internal.h"
+#include "cogl-util.h"
+#include "cogl-context-private.h"
+#include "cogl-object-private.h"
+#include "cogl-texture-stream.h"
+
+#define COGL_TEXTURE_STREAM_DEFAULT_N_BUFFERS 3
+
+typedef enum
+{
+  /* The buffer needs to be mapped by the thread using the context
+     before the producer can use it */
+  COGL_TEXTURE_STREAM_SLOT_UNMAPPED,
+  /* The buffer is mapped and can be given to the producer */
+  COGL_TEXTURE_STREAM_SLOT_FREE,
+  COGL_TEXTURE_STREAM_SLOT_WRITING,
+  /* The producer has finished the frame and it is waiting to be
+     uploaded */
+  COGL_TEXTURE_STREAM_SLOT_READY,
+  COGL_TEXTURE_STREAM_SLOT_UPLOADING
+} CoglTextureStreamSlotState;
+
+typedef struct
+{
+  CoglTextureStreamSlotState state;
+
+  CoglPixelBuffer *buffer;
+  /* Bitmap wrapping the buffer which is used for the upload */
+  CoglBitmap *bitmap;
+  /* Where the buffer is mapped while it is FREE or WRITING */
+  guint8 *data;
+
+  /* Order in which the frames were finished so that the most recent
+     one is uploaded */
+  unsigned int sequence;
+  /* Time in seconds when the frame was finished */
+  double ready_time;
+} CoglTextureStreamSlot;
+
+struct _CoglTextureStream
+{
+  CoglObject _parent;
+
+  CoglHandle texture;
+  int width, height;
+  CoglPixelFormat format;
+  unsigned int rowstride;
+
+  int n_slots;
+  CoglTextureStreamSlot *slots;
+
+  /* The slot states, the sequence counter and the stats can be
+     modified by the producer so they are protected by this lock */
+  GStaticMutex mutex;
+
+  CoglTextureStreamSlot *writing_slot;
+  unsigned int next_sequence;
+
+  GTimer *timer;
+
+  CoglTextureStreamStats stats;
+  double total_latency;
+};
+
+static void _cogl_texture_stream_free (CoglTextureStream *stream);
+
+COGL_OBJECT_DEFINE (TextureStream, texture_stream);
+
+/* Maps the buffer of an UNMAPPED slot so that it can be given to the
+   producer. This needs the GL context so it is only called from
+   cogl_texture_stream_new and cogl_texture_stream_update */
+static void
+_cogl_texture_stream_map_slot (CoglTextureStream *stream,
+                               CoglTextureStreamSlot *slot)
+{
+  guint8 *data;
+
+  /* Discarding the contents lets the driver give us new storage for
+     the buffer instead of waiting for a previous upload from it to
+     finish */
+  data = cogl_buffer_map (COGL_BUFFER (slot->buffer),
+                          COGL_BUFFER_ACCESS_WRITE,
+                          COGL_BUFFER_MAP_HINT_DISCARD);
+
+  /* If this fails then it will be tried again on the next update */
+  if (data == NULL)
+    return;
+
+  g_static_mutex_lock (&stream->mutex);
+  slot->data = data;
+  slot->state = COGL_TEXTURE_STREAM_SLOT_FREE;
+  g_static_mutex_unlock (&stream->mutex);
+}
+
+CoglTextureStream *
+cogl_texture_stream_new (CoglHandle texture,
+                         CoglPixelFormat format,
+                         unsigned int n_buffers)
+{
+  CoglTextureStream *stream;
+  int i;
+
+  if (!cogl_is_texture (texture))
+    return NULL;
+
+  if (n_buffers == 0)
+    n_buffers = COGL_TEXTURE_STREAM_DEFAULT_N_BUFFERS;
+  else if (n_buffers < 2)
+    n_buffers = 2;
+
+  if (format == COGL_PIXEL_FORMAT_ANY)
+    format = cogl_texture_get_format (texture);
+
+  stream = g_slice_new0 (CoglTextureStream);
+
+  stream->texture = cogl_handle_ref (texture);
+  stream->width = cogl_texture_get_width (texture);
+  stream->height = cogl_texture_get_height (texture);
+  stream->format = format;
+
+  g_static_mutex_init (&stream->mutex);
+  stream->timer = g_timer_new ();
+
+  stream->n_slots = n_buffers;
+  stream->slots = g_new0 (CoglTextureStreamSlot, n_buffers);
+
+  for (i = 0; i < stream->n_slots; i++)
+    {
+      CoglTextureStreamSlot *slot = stream->slots + i;
+
+      slot->buffer = cogl_pixel_buffer_new_with_size (stream->width,
+                                                      stream->height,
+                                                      format,
+                                                      &stream->rowstride);
+      cogl_buffer_set_update_hint (COGL_BUFFER (slot->buffer),
+                                   COGL_BUFFER_UPDATE_HINT_STREAM);
+      slot->bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (slot->buffer),
+                                                  format,
+                                                  stream->width,
+                                                  stream->height,
+                                                  stream->rowstride,
+                                                  0 /* offset */);
+      slot->state = COGL_TEXTURE_STREAM_SLOT_UNMAPPED;
+
+      _cogl_texture_stream_map_slot (stream, slot);
+    }
+
+  return _cogl_texture_stream_object_new (stream);
+}
+
+CoglHandle
+cogl_texture_stream_get_texture (CoglTextureStream *stream)
+{
+  g_return_val_if_fail (cogl_is_texture_stream (stream), NULL);
+
+  return stream->texture;
+}
+
+guint8 *
+cogl_texture_stream_begin_frame (CoglTextureStream *stream,
+                                 unsigned int *rowstride)
+{
+  CoglTextureStreamSlot *slot = NULL;
+  int i;
+
+  g_return_val_if_fail (cogl_is_texture_stream (stream), NULL);
+
+  g_static_mutex_lock (&stream->mutex);
+
+  if (stream->writing_slot)
+    {
+      g_static_mutex_unlock (&stream->mutex);
+      g_warning ("cogl_texture_stream_begin_frame called twice without "
+                 "ending the frame");
+      return NULL;
+    }
+
+  for (i = 0; i < stream->n_slots; i++)
+    if (stream->slots[i].state == COGL_TEXTURE_STREAM_SLOT_FREE)
+      {
+        slot = stream->slots + i;
+        break;
+      }
+
+  /* If there is no free buffer then the oldest frame that hasn't
+     been uploaded yet is dropped to make room for the new one */
+  if (slot == NULL)
+    {
+      for (i = 0; i < stream->n_slots; i++)
+        if (stream->slots[i].state == COGL_TEXTURE_STREAM_SLOT_READY &&
+            (slot == NULL || stream->slots[i].sequence < slot->sequence))
+          slot = stream->slots + i;
+
+      /* Either the dropped frame or this one is lost */
+      stream->stats.n_frames_dropped++;
+    }
+
+  if (slot)
+    {
+      slot->state = COGL_TEXTURE_STREAM_SLOT_WRITING;
+      stream->writing_slot = slot;
+    }
+
+  g_static_mutex_unlock (&stream->mutex);
+
+  if (slot == NULL)
+    return NULL;
+
+  if (rowstride)
+    *rowstride = stream->rowstride;
+
+  return slot->data;
+}
+
+void
+cogl_texture_stream_end_frame (CoglTextureStream *stream)
+{
+  CoglTextureStreamSlot *slot;
+
+  g_return_if_fail (cogl_is_texture_stream (stream));
+
+  g_static_mutex_lock (&stream->mutex);
+
+  slot = stream->writing_slot;
+
+  if (slot)
+    {
+      slot->state = COGL_TEXTURE_STREAM_SLOT_READY;
+      slot->sequence = stream->next_sequence++;
+      slot->ready_time = g_timer_elapsed (stream->timer, NULL);
+      stream->writing_slot = NULL;
+    }
+
+  g_static_mutex_unlock (&stream->mutex);
+
+  g_return_if_fail (slot != NULL);
+}
+
+gboolean
+cogl_texture_stream_update (CoglTextureStream *stream)
+{
+  CoglTextureStreamSlot *newest = NULL;
+  unsigned int latency;
+  int i;
+
+  g_return_val_if_fail (cogl_is_texture_stream (stream), FALSE);
+
+  /* Retry any buffers that failed to map last time. The state can
+     only move out of UNMAPPED on this thread so it is safe to check
+     without the lock */
+  for (i = 0; i < stream->n_slots; i++)
+    if (stream->slots[i].state == COGL_TEXTURE_STREAM_SLOT_UNMAPPED)
+      _cogl_texture_stream_map_slot (stream, stream->slots + i);
+
+  g_static_mutex_lock (&stream->mutex);
+
+  for (i = 0; i < stream->n_slots; i++)
+    {
+      CoglTextureStreamSlot *slot = stream->slots + i;
+
+      if (slot->state != COGL_TEXTURE_STREAM_SLOT_READY)
+        continue;
+
+      /* Only the most recent frame is uploaded and the rest are
+         dropped. The buffer is still mapped so it can go straight
+         back to the producer */
+      if (newest == NULL)
+        newest = slot;
+      else
+        {
+          if (slot->sequence > newest->sequence)
+            {
+              CoglTextureStreamSlot *tmp = newest;
+              newest = slot;
+              slot = tmp;
+            }
+
+          slot->state = COGL_TEXTURE_STREAM_SLOT_FREE;
+          stream->stats.n_frames_dropped++;
+        }
+    }
+
+  if (newest)
+    newest->state = COGL_TEXTURE_STREAM_SLOT_UPLOADING;
+
+  g_static_mutex_unlock (&stream->mutex);
+
+  if (newest == NULL)
+    return FALSE;
+
+  latency = (g_timer_elapsed (stream->timer, NULL) -
+             newest->ready_time) * 1000000.0;
+
+  /* The producer can't touch the buffer while it is UPLOADING so the
+     whole frame is copied. With a pixel buffer object the copy is
+     queued on the GPU straight from the buffer */
+  cogl_buffer_unmap (COGL_BUFFER (newest->buffer));
+  newest->data = NULL;
+
+  cogl_texture_set_region_from_bitmap (stream->texture,
+                                       0, 0, /* src_x/y */
+                                       0, 0, /* dst_x/y */
+                                       stream->width, stream->height,
+                                       newest->bitmap);
+
+  g_static_mutex_lock (&stream->mutex);
+  newest->state = COGL_TEXTURE_STREAM_SLOT_UNMAPPED;
+  stream->stats.n_frames_uploaded++;
+  stream->stats.last_latency = latency;
+  stream->stats.max_latency = MAX (stream->stats.max_latency, latency);
+  stream->total_latency += latency;
+  stream->stats.average_latency = (stream->total_latency /
+                                   stream->stats.n_frames_uploaded);
+  g_static_mutex_unlock (&stream->mutex);
+
+  _cogl_texture_stream_map_slot (stream, newest);
+
+  return TRUE;
+}
+
+void
+cogl_texture_stream_get_stats (CoglTextureStream *stream,
+                               CoglTextureStreamStats *stats)
+{
+  g_return_if_fail (cogl_is_texture_stream (stream));
+
+  g_static_mutex_lock (&stream->mutex);
+  *stats = stream->stats;
+  g_static_mutex_unlock (&stream->mutex);
+}
+
+static void
+_cogl_texture_stream_free (CoglTextureStream *stream)
+{
+  int i;
+
+  /* The producer must have stopped by now */
+  g_warn_if_fail (stream->writing_slot == NULL);
+
+  for (i = 0; i < stream->n_slots; i++)
+    {
+      CoglTextureStreamSlot *slot = stream->slots + i;
+
+      if (slot->data)
+        cogl_buffer_unmap (COGL_BUFFER (slot->buffer));
+
+      cogl_object_unref (slot->bitmap);
+      cogl_object_unref (slot->buffer);
+    }
+
+  g_free (stream->slots);
+
+  g_timer_destroy (stream->timer);
+  g_static_mutex_free (&stream->mutex);
+
+  cogl_handle_unref (stream->texture);
+
+  g_slice_free (CoglTextureStream, stream);
+}
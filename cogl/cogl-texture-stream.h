@@ -0,0 +1,223 @@
+/*
+ * Cogl
+ *
+ * An object oriented GL/GLES Abstraction/Utility Layer
+ *
+ * Copyright (C) 2011 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ */
+
+#if !defined(__COGL_H_INSIDE__) && !defined(CLUTTER_COMPILATION)
+#error "Only <cogl/cogl.h> can be included directly."
+#endif
+
+#ifndef __COGL_TEXTURE_STREAM_H__
+#define __COGL_TEXTURE_STREAM_H__
+
+#include <glib.h>
+
+#include <cogl/cogl-types.h>
+
+G_BEGIN_DECLS
+
+/**
+ * SECTION:cogl-texture-stream
+ * @short_description: Functions for streaming frames into a texture
+ *   from another thread
+ *
+ * A #CoglTextureStream keeps a small ring of pixel buffers that a
+ * producer, typically a video decoder running on its own thread,
+ * writes frames into. The thread that owns the Cogl context then
+ * calls cogl_texture_stream_update() once per frame to copy the most
+ * recent complete frame into the texture. Where the driver supports
+ * pixel buffer objects the copy is done by the GPU without blocking
+ * the application.
+ *
+ * A frame is only ever uploaded once the producer has finished
+ * writing it and the producer is never given a buffer that is being
+ * uploaded so the texture never contains a mix of two frames. If the
+ * producer is faster than the application then older frames that
+ * were never uploaded are dropped.
+ */
+
+/* All of the cogl-texture-stream API is currently experimental so we
+ * suffix the actual symbols with _EXP so if somone is monitoring for
+ * ABI changes it will hopefully be clearer to them what's going on if
+ * any of the symbols dissapear at a later date.
+ */
+#define cogl_texture_stream_new cogl_texture_stream_new_EXP
+#define cogl_is_texture_stream cogl_is_texture_stream_EXP
+#define cogl_texture_stream_get_texture cogl_texture_stream_get_texture_EXP
+#define cogl_texture_stream_begin_frame cogl_texture_stream_begin_frame_EXP
+#define cogl_texture_stream_end_frame cogl_texture_stream_end_frame_EXP
+#define cogl_texture_stream_update cogl_texture_stream_update_EXP
+#define cogl_texture_stream_get_stats cogl_texture_stream_get_stats_EXP
+
+typedef struct _CoglTextureStream CoglTextureStream;
+
+#define COGL_TEXTURE_STREAM(X) ((CoglTextureStream *)X)
+
+/**
+ * CoglTextureStreamStats:
+ * @n_frames_uploaded: the number of frames copied into the texture
+ * @n_frames_dropped: the number of frames that were never copied
+ *   into the texture, either because a newer frame was ready first or
+ *   because there was no free buffer for the producer
+ * @last_latency: the time in microseconds between the last uploaded
+ *   frame being finished by the producer and it being uploaded
+ * @max_latency: the largest latency of any uploaded frame in
+ *   microseconds
+ * @average_latency: the average latency of the uploaded frames in
+ *   microseconds
+ *
+ * Counters returned by cogl_texture_stream_get_stats().
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+typedef struct
+{
+  unsigned int n_frames_uploaded;
+  unsigned int n_frames_dropped;
+
+  unsigned int last_latency;
+  unsigned int max_latency;
+  unsigned int average_latency;
+} CoglTextureStreamStats;
+
+/**
+ * cogl_texture_stream_new:
+ * @texture: a #CoglHandle for the texture to stream into
+ * @format: the #CoglPixelFormat of the frames written by the producer
+ * @n_buffers: the number of frames that can be in flight at once or
+ *   0 to use the default of 3
+ *
+ * Creates a new stream that copies frames the size of @texture into
+ * it. At least two buffers are always used. With three buffers the
+ * producer can write a frame while the previous frame is waiting to
+ * be uploaded and another is being uploaded.
+ *
+ * Return value: a new #CoglTextureStream or %NULL if @texture is not
+ *   a valid texture
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+CoglTextureStream *
+cogl_texture_stream_new (CoglHandle texture,
+                         CoglPixelFormat format,
+                         unsigned int n_buffers);
+
+/**
+ * cogl_is_texture_stream:
+ * @object: a #CoglObject to test
+ *
+ * Checks whether @object is a #CoglTextureStream.
+ *
+ * Return value: %TRUE if @object is a #CoglTextureStream and %FALSE
+ *   otherwise
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gboolean
+cogl_is_texture_stream (void *object);
+
+/**
+ * cogl_texture_stream_get_texture:
+ * @stream: a #CoglTextureStream
+ *
+ * Return value: the texture that @stream uploads into
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+CoglHandle
+cogl_texture_stream_get_texture (CoglTextureStream *stream);
+
+/**
+ * cogl_texture_stream_begin_frame:
+ * @stream: a #CoglTextureStream
+ * @rowstride: return location for the number of bytes between the
+ *   start of each row of the frame
+ *
+ * Gets a buffer for the producer to write the next frame into. The
+ * whole frame must be written before calling
+ * cogl_texture_stream_end_frame(). If all of the buffers are in use
+ * then %NULL is returned and the frame is counted as dropped.
+ *
+ * This function and cogl_texture_stream_end_frame() may be called
+ * from any thread but only one frame can be written at a time.
+ *
+ * Return value: a pointer to write the frame into or %NULL
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+guint8 *
+cogl_texture_stream_begin_frame (CoglTextureStream *stream,
+                                 unsigned int *rowstride);
+
+/**
+ * cogl_texture_stream_end_frame:
+ * @stream: a #CoglTextureStream
+ *
+ * Marks the frame started with cogl_texture_stream_begin_frame() as
+ * complete so that it can be uploaded by the next call to
+ * cogl_texture_stream_update(). The pointer returned by
+ * cogl_texture_stream_begin_frame() must not be used afterwards.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+void
+cogl_texture_stream_end_frame (CoglTextureStream *stream);
+
+/**
+ * cogl_texture_stream_update:
+ * @stream: a #CoglTextureStream
+ *
+ * Copies the most recent complete frame into the texture. Any older
+ * frames that haven't been uploaded yet are dropped. This must be
+ * called on the thread that uses the Cogl context, usually once
+ * before painting each frame.
+ *
+ * Return value: %TRUE if the texture was updated
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+gboolean
+cogl_texture_stream_update (CoglTextureStream *stream);
+
+/**
+ * cogl_texture_stream_get_stats:
+ * @stream: a #CoglTextureStream
+ * @stats: return location for the counters
+ *
+ * Retrieves the upload and latency counters for @stream.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+void
+cogl_texture_stream_get_stats (CoglTextureStream *stream,
+                               CoglTextureStreamStats *stats);
+
+G_END_DECLS
+
+#endif /* __COGL_TEXTURE_STREAM_H__ */
@@ -52,6 +52,7 @@
 #include "cogl-object-private.h"
 #include "cogl-primitives.h"
 #include "cogl-framebuffer-private.h"
+#include "cogl-compressed-image-private.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -131,14 +132,96 @@ _cogl_texture_init (CoglTexture *texture,
 {
   texture->vtable = vtable;
   texture->framebuffers = NULL;
+  texture->memory_size = 0;
+  /* Textures that own GL textures set their own category */
+  texture->memory_category = COGL_MEMORY_CATEGORY_TEXTURE_2D;
 }
 
 void
 _cogl_texture_free (CoglTexture *texture)
 {
+  _cogl_texture_set_memory_size (texture, 0);
+
   g_free (texture);
 }
 
+gsize
+_cogl_texture_estimate_memory_size (int width,
+                                    int height,
+                                    int depth,
+                                    CoglPixelFormat format,
+                                    gboolean mipmaps)
+{
+  gsize size;
+
+  if (_cogl_pixel_format_is_compressed (format))
+    size = ((gsize) _cogl_compressed_format_get_data_size (format,
+                                                           width,
+                                                           height) *
+            depth);
+  else
+    size = ((gsize) width * height * depth *
+            _cogl_get_format_bpp (format));
+
+  /* Each mipmap level is at most a quarter of the size of the one
+     before so the whole chain adds about another third */
+  if (mipmaps)
+    size += size / 3;
+
+  return size;
+}
+
+void
+_cogl_texture_set_memory_size (CoglTexture *texture,
+                               gsize size)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  if (texture->memory_size == size)
+    return;
+
+  _cogl_context_update_memory_usage (ctx,
+                                     texture->memory_category,
+                                     texture->memory_size,
+                                     size);
+  texture->memory_size = size;
+}
+
+void
+_cogl_texture_set_memory_category (CoglHandle handle,
+                                   CoglMemoryCategory category)
+{
+  CoglTexture *tex = COGL_TEXTURE (handle);
+
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  if (_cogl_is_texture_2d_sliced (handle))
+    {
+      CoglTexture2DSliced *tex_2ds = handle;
+      int i;
+
+      for (i = 0; i < tex_2ds->slice_textures->len; i++)
+        _cogl_texture_set_memory_category
+          (g_array_index (tex_2ds->slice_textures, CoglHandle, i),
+           category);
+    }
+
+  if (tex->memory_category == category)
+    return;
+
+  /* The memory is freed from the old category before it is added to
+     the new one so that this never goes over the budget */
+  _cogl_context_update_memory_usage (ctx,
+                                     tex->memory_category,
+                                     tex->memory_size,
+                                     0);
+  tex->memory_category = category;
+  _cogl_context_update_memory_usage (ctx,
+                                     category,
+                                     0,
+                                     tex->memory_size);
+}
+
 static gboolean
 _cogl_texture_needs_premult_conversion (CoglPixelFormat src_format,
                                         CoglPixelFormat dst_format)
@@ -157,8 +240,10 @@ _cogl_texture_determine_internal_format (CoglPixelFormat src_format,
   /* If the application hasn't specified a specific format then we'll
    * pick the most appropriate. By default Cogl will use a
    * premultiplied internal format. Later we will add control over
-   * this. */
-  if (dst_format == COGL_PIXEL_FORMAT_ANY)
+   * this. Compressed formats can only be created from a file so
+   * they are treated the same as no format */
+  if (dst_format == COGL_PIXEL_FORMAT_ANY ||
+      _cogl_pixel_format_is_compressed (dst_format))
     {
       if ((src_format & COGL_A_BIT) &&
           src_format != COGL_PIXEL_FORMAT_A_8)
@@ -170,18 +255,17 @@ _cogl_texture_determine_internal_format (CoglPixelFormat src_format,
     return dst_format;
 }
 
-CoglBitmap *
-_cogl_texture_prepare_for_upload (CoglBitmap      *src_bmp,
-                                  CoglPixelFormat  dst_format,
-                                  CoglPixelFormat *dst_format_out,
-                                  GLenum          *out_glintformat,
-                                  GLenum          *out_glformat,
-                                  GLenum          *out_gltype)
+CoglPixelFormat
+_cogl_texture_determine_upload_format (CoglPixelFormat  src_format,
+                                       CoglPixelFormat  dst_format,
+                                       CoglPixelFormat *dst_format_out,
+                                       GLenum          *out_glintformat,
+                                       GLenum          *out_glformat,
+                                       GLenum          *out_gltype)
 {
-  CoglPixelFormat src_format = _cogl_bitmap_get_format (src_bmp);
-  CoglBitmap *dst_bmp;
+  CoglPixelFormat upload_format;
 
-  _COGL_GET_CONTEXT (ctx, NULL);
+  _COGL_GET_CONTEXT (ctx, src_format);
 
   dst_format = _cogl_texture_determine_internal_format (src_format,
                                                         dst_format);
@@ -197,22 +281,12 @@ _cogl_texture_prepare_for_upload (CoglBitmap      *src_bmp,
   if (ctx->driver == COGL_DRIVER_GL)
     {
       /* If the source format does not have the same premult flag as the
-         dst format then we need to copy and convert it */
+         dst format then we need to convert it */
       if (_cogl_texture_needs_premult_conversion (src_format,
                                                   dst_format))
-        {
-          dst_bmp = _cogl_bitmap_copy (src_bmp);
-
-          if (!_cogl_bitmap_convert_premult_status (dst_bmp,
-                                                    src_format ^
-                                                    COGL_PREMULT_BIT))
-            {
-              cogl_object_unref (dst_bmp);
-              return NULL;
-            }
-        }
+        upload_format = src_format ^ COGL_PREMULT_BIT;
       else
-        dst_bmp = cogl_object_ref (src_bmp);
+        upload_format = src_format;
 
       /* Use the source format from the src bitmap type and the internal
          format from the dst format type so that GL can do the
@@ -228,24 +302,55 @@ _cogl_texture_prepare_for_upload (CoglBitmap      *src_bmp,
 
     }
   else
-    {
-      CoglPixelFormat closest_format;
-
-      closest_format = ctx->texture_driver->pixel_format_to_gl (dst_format,
-                                                                out_glintformat,
-                                                                out_glformat,
-                                                                out_gltype);
-
-      if (closest_format != src_format)
-        dst_bmp = _cogl_bitmap_convert_format_and_premult (src_bmp,
-                                                           closest_format);
-      else
-        dst_bmp = cogl_object_ref (src_bmp);
-    }
+    upload_format = ctx->texture_driver->pixel_format_to_gl (dst_format,
+                                                             out_glintformat,
+                                                             out_glformat,
+                                                             out_gltype);
 
   if (dst_format_out)
     *dst_format_out = dst_format;
 
+  return upload_format;
+}
+
+CoglBitmap *
+_cogl_texture_prepare_for_upload (CoglBitmap      *src_bmp,
+                                  CoglPixelFormat  dst_format,
+                                  CoglPixelFormat *dst_format_out,
+                                  GLenum          *out_glintformat,
+                                  GLenum          *out_glformat,
+                                  GLenum          *out_gltype)
+{
+  CoglPixelFormat src_format = _cogl_bitmap_get_format (src_bmp);
+  CoglPixelFormat upload_format;
+  CoglBitmap *dst_bmp;
+
+  _COGL_GET_CONTEXT (ctx, NULL);
+
+  upload_format = _cogl_texture_determine_upload_format (src_format,
+                                                         dst_format,
+                                                         dst_format_out,
+                                                         out_glintformat,
+                                                         out_glformat,
+                                                         out_gltype);
+
+  if (upload_format == src_format)
+    dst_bmp = cogl_object_ref (src_bmp);
+  /* With GL only the premult status is ever changed */
+  else if (ctx->driver == COGL_DRIVER_GL)
+    {
+      dst_bmp = _cogl_bitmap_copy (src_bmp);
+
+      if (!_cogl_bitmap_convert_premult_status (dst_bmp, upload_format))
+        {
+          cogl_object_unref (dst_bmp);
+          return NULL;
+        }
+    }
+  else
+    dst_bmp = _cogl_bitmap_convert_format_and_premult (src_bmp,
+                                                       upload_format);
+
   return dst_bmp;
 }
 
@@ -400,9 +505,11 @@ cogl_texture_new_with_size (unsigned int     width,
   _COGL_GET_CONTEXT (ctx, COGL_INVALID_HANDLE);
 
   /* First try creating a fast-path non-sliced texture */
-  tex = cogl_texture_2d_new_with_size (ctx,
-                                       width, height, internal_format,
-                                       NULL);
+  tex = _cogl_texture_2d_new_with_size (ctx,
+                                        width, height,
+                                        flags,
+                                        internal_format,
+                                        NULL);
 
   /* If it fails resort to sliced textures */
   if (tex == COGL_INVALID_HANDLE)
@@ -426,7 +533,8 @@ cogl_texture_new_from_data (unsigned int      width,
   CoglBitmap *bmp;
   CoglHandle tex;
 
-  if (format == COGL_PIXEL_FORMAT_ANY)
+  if (format == COGL_PIXEL_FORMAT_ANY ||
+      _cogl_pixel_format_is_compressed (format))
     return COGL_INVALID_HANDLE;
 
   if (data == NULL)
@@ -477,18 +585,278 @@ cogl_texture_new_from_bitmap (CoglHandle       bmp_handle,
                                                   internal_format);
 }
 
+/* Images with at least this many pixels are decoded in bands
+   straight into the texture instead of into a bitmap first */
+#define COGL_TEXTURE_FILE_STREAM_MIN_PIXELS (512 * 512)
+/* Rough number of bytes that are uploaded at once when streaming */
+#define COGL_TEXTURE_FILE_STREAM_BAND_SIZE (256 * 1024)
+
+typedef struct
+{
+  CoglTextureFlags flags;
+  /* The format requested by the application */
+  CoglPixelFormat internal_format;
+
+  CoglHandle texture;
+  int width;
+
+  /* The decoded rows are converted into this buffer which is then
+     used to upload them. The same buffer is reused for every band */
+  CoglPixelBuffer *buffer;
+  CoglBitmap *buffer_bmp;
+  unsigned int buffer_rowstride;
+  /* Where the buffer is mapped while it is being filled */
+  guint8 *buffer_data;
+
+  int band_height;
+  /* The texture row of the first row in the buffer and the number of
+     rows that have been filled */
+  int band_y;
+  int band_rows;
+} CoglTextureFileStream;
+
+static gboolean
+_cogl_texture_file_stream_size_cb (int width,
+                                   int height,
+                                   CoglPixelFormat format,
+                                   void *user_data)
+{
+  CoglTextureFileStream *stream = user_data;
+  CoglPixelFormat internal_format;
+  CoglPixelFormat texture_format;
+  CoglHandle tex;
+
+  internal_format =
+    _cogl_texture_determine_internal_format (format,
+                                             stream->internal_format);
+
+  tex = cogl_texture_new_with_size (width, height,
+                                    stream->flags,
+                                    internal_format);
+  if (tex == COGL_INVALID_HANDLE)
+    return FALSE;
+
+  stream->texture = tex;
+  stream->width = width;
+
+  /* Converting straight to the format of the texture avoids another
+     conversion during the upload */
+  texture_format = cogl_texture_get_format (tex);
+
+  stream->band_height =
+    CLAMP (COGL_TEXTURE_FILE_STREAM_BAND_SIZE /
+           (width * _cogl_get_format_bpp (texture_format)),
+           1, height);
+
+  stream->buffer = cogl_pixel_buffer_new_with_size (width,
+                                                    stream->band_height,
+                                                    texture_format,
+                                                    &stream->buffer_rowstride);
+  cogl_buffer_set_update_hint (COGL_BUFFER (stream->buffer),
+                               COGL_BUFFER_UPDATE_HINT_STREAM);
+  stream->buffer_bmp =
+    cogl_bitmap_new_from_buffer (COGL_BUFFER (stream->buffer),
+                                 texture_format,
+                                 width,
+                                 stream->band_height,
+                                 stream->buffer_rowstride,
+                                 0 /* offset */);
+
+  return TRUE;
+}
+
+static gboolean
+_cogl_texture_file_stream_flush (CoglTextureFileStream *stream)
+{
+  gboolean ret;
+
+  if (stream->band_rows == 0)
+    return TRUE;
+
+  /* With a pixel buffer object the upload is done by the GPU from the
+     buffer while the next band is being decoded */
+  cogl_buffer_unmap (COGL_BUFFER (stream->buffer));
+  stream->buffer_data = NULL;
+
+  ret = cogl_texture_set_region_from_bitmap (stream->texture,
+                                             0, 0, /* src_x/y */
+                                             0, stream->band_y, /* dst_x/y */
+                                             stream->width,
+                                             stream->band_rows,
+                                             stream->buffer_bmp);
+
+  stream->band_rows = 0;
+
+  return ret;
+}
+
+static gboolean
+_cogl_texture_file_stream_band_cb (CoglBitmap *band,
+                                   int y,
+                                   void *user_data)
+{
+  CoglTextureFileStream *stream = user_data;
+  CoglPixelFormat band_format = _cogl_bitmap_get_format (band);
+  int band_rowstride = _cogl_bitmap_get_rowstride (band);
+  int n_rows = _cogl_bitmap_get_height (band);
+  guint8 *band_data;
+  int done = 0;
+
+  /* Rows that don't follow on from the ones in the buffer need a new
+     band */
+  if (stream->band_rows > 0 &&
+      y != stream->band_y + stream->band_rows &&
+      !_cogl_texture_file_stream_flush (stream))
+    return FALSE;
+
+  if ((band_data = _cogl_bitmap_map (band, COGL_BUFFER_ACCESS_READ, 0)) == NULL)
+    return FALSE;
+
+  while (done < n_rows)
+    {
+      int n = MIN (n_rows - done, stream->band_height - stream->band_rows);
+      CoglBitmap *src_rows, *dst_rows;
+      gboolean ret;
+
+      if (stream->buffer_data == NULL)
+        {
+          /* Discarding the old contents means the driver doesn't have
+             to wait for the previous upload from the buffer */
+          stream->buffer_data =
+            cogl_buffer_map (COGL_BUFFER (stream->buffer),
+                             COGL_BUFFER_ACCESS_WRITE,
+                             COGL_BUFFER_MAP_HINT_DISCARD);
+          if (stream->buffer_data == NULL)
+            break;
+        }
+
+      if (stream->band_rows == 0)
+        stream->band_y = y + done;
+
+      /* Convert the rows directly into the buffer */
+      src_rows = _cogl_bitmap_new_from_data (band_data +
+                                             done * band_rowstride,
+                                             band_format,
+                                             stream->width, n,
+                                             band_rowstride,
+                                             NULL, NULL);
+      dst_rows = _cogl_bitmap_new_from_data (stream->buffer_data +
+                                             stream->band_rows *
+                                             stream->buffer_rowstride,
+                                             _cogl_bitmap_get_format
+                                               (stream->buffer_bmp),
+                                             stream->width, n,
+                                             stream->buffer_rowstride,
+                                             NULL, NULL);
+
+      ret = _cogl_bitmap_convert_into (src_rows, dst_rows);
+
+      cogl_object_unref (dst_rows);
+      cogl_object_unref (src_rows);
+
+      if (!ret)
+        break;
+
+      stream->band_rows += n;
+      done += n;
+
+      if (stream->band_rows == stream->band_height &&
+          !_cogl_texture_file_stream_flush (stream))
+        break;
+    }
+
+  _cogl_bitmap_unmap (band);
+
+  return done == n_rows;
+}
+
+/* Decodes the file in bands and uploads each one as soon as it is
+   ready so that the whole image never has to be converted at once */
+static CoglHandle
+_cogl_texture_new_from_file_in_bands (const char *filename,
+                                      CoglTextureFlags flags,
+                                      CoglPixelFormat internal_format,
+                                      GError **error)
+{
+  CoglTextureFileStream stream;
+  gboolean ret;
+
+  memset (&stream, 0, sizeof (stream));
+  stream.flags = flags;
+  stream.internal_format = internal_format;
+
+  ret = _cogl_bitmap_from_file_in_bands (filename,
+                                         _cogl_texture_file_stream_size_cb,
+                                         _cogl_texture_file_stream_band_cb,
+                                         &stream,
+                                         error);
+
+  if (ret)
+    ret = _cogl_texture_file_stream_flush (&stream);
+
+  if (stream.buffer_data)
+    cogl_buffer_unmap (COGL_BUFFER (stream.buffer));
+  if (stream.buffer_bmp)
+    cogl_object_unref (stream.buffer_bmp);
+  if (stream.buffer)
+    cogl_object_unref (stream.buffer);
+
+  if (!ret)
+    {
+      if (stream.texture)
+        cogl_handle_unref (stream.texture);
+
+      /* The loader doesn't set an error if we stopped it */
+      if (error && *error == NULL)
+        g_set_error (error, COGL_TEXTURE_ERROR,
+                     COGL_TEXTURE_ERROR_SIZE,
+                     "Failed to create a texture for the image");
+
+      return COGL_INVALID_HANDLE;
+    }
+
+  return stream.texture;
+}
+
 CoglHandle
 cogl_texture_new_from_file (const char        *filename,
                             CoglTextureFlags   flags,
                             CoglPixelFormat    internal_format,
                             GError           **error)
 {
+  CoglCompressedImage *image;
   CoglBitmap *bmp;
   CoglHandle handle = COGL_INVALID_HANDLE;
   CoglPixelFormat src_format;
+  int width, height;
 
   g_return_val_if_fail (error == NULL || *error == NULL, COGL_INVALID_HANDLE);
 
+  /* KTX and DDS files are loaded without decompressing them so that
+     the driver can use the compressed data directly */
+  if ((image = _cogl_compressed_image_new_from_file (filename, error)))
+    {
+      handle = _cogl_texture_2d_new_from_compressed_image (image,
+                                                           flags,
+                                                           error);
+      _cogl_compressed_image_free (image);
+      return handle;
+    }
+  else if (error && *error)
+    return COGL_INVALID_HANDLE;
+
+  /* Large images are streamed into the texture to avoid keeping
+     several copies of them in memory. Small images go through a
+     bitmap so that they can still be put in the atlas. Building the
+     mipmaps on the CPU needs the whole image anyway */
+  if (!(flags & COGL_TEXTURE_CPU_MIPMAP) &&
+      _cogl_bitmap_get_size_from_file (filename, &width, &height) &&
+      width * height >= COGL_TEXTURE_FILE_STREAM_MIN_PIXELS)
+    return _cogl_texture_new_from_file_in_bands (filename,
+                                                 flags,
+                                                 internal_format,
+                                                 error);
+
   bmp = cogl_bitmap_new_from_file (filename, error);
   if (bmp == NULL)
     return COGL_INVALID_HANDLE;
@@ -1381,9 +1749,15 @@ cogl_texture_get_data (CoglHandle       handle,
 
   tex = COGL_TEXTURE (handle);
 
-  /* Default to internal format if none specified */
+  /* Default to internal format if none specified. Compressed
+     textures are always read back decompressed */
   if (format == COGL_PIXEL_FORMAT_ANY)
-    format = cogl_texture_get_format (handle);
+    {
+      format = cogl_texture_get_format (handle);
+
+      if (_cogl_pixel_format_is_compressed (format))
+        format = COGL_PIXEL_FORMAT_RGBA_8888;
+    }
 
   tex_width = cogl_texture_get_width (handle);
   tex_height = cogl_texture_get_height (handle);
@@ -109,6 +109,14 @@ cogl_texture_new_with_size (unsigned int width,
  *
  * Creates a COGL texture from an image file.
  *
+ * KTX and DDS files containing ETC1, ETC2, S3TC or ASTC compressed
+ * data are uploaded to the GPU without being decompressed when the
+ * driver supports the format, in which case @internal_format is
+ * ignored. Any mipmap levels stored in the file are used instead of
+ * generating them. If the driver doesn't support the format then the
+ * image is decompressed on the CPU, except for ASTC images which will
+ * fail to load.
+ *
  * Return value: a #CoglHandle to the newly created texture or
  *    %COGL_INVALID_HANDLE on failure
  *
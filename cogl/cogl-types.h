@@ -196,6 +196,20 @@ typedef struct _CoglTextureVertex       CoglTextureVertex;
  * @COGL_PIXEL_FORMAT_ABGR_8888_PRE: Premultiplied ABGR, 32 bits
  * @COGL_PIXEL_FORMAT_RGBA_4444_PRE: Premultiplied RGBA, 16 bits
  * @COGL_PIXEL_FORMAT_RGBA_5551_PRE: Premultiplied RGBA, 16 bits
+ * @COGL_PIXEL_FORMAT_RGB_ETC1: ETC1 compressed RGB, 4 bits per pixel
+ * @COGL_PIXEL_FORMAT_RGB_ETC2: ETC2 compressed RGB, 4 bits per pixel
+ * @COGL_PIXEL_FORMAT_RGBA_ETC2_EAC: ETC2 compressed RGB with EAC
+ *   compressed alpha, 8 bits per pixel
+ * @COGL_PIXEL_FORMAT_RGB_S3TC_DXT1: S3TC DXT1 compressed RGB, 4 bits
+ *   per pixel
+ * @COGL_PIXEL_FORMAT_RGBA_S3TC_DXT1: S3TC DXT1 compressed RGB with
+ *   optional 1-bit alpha, 4 bits per pixel
+ * @COGL_PIXEL_FORMAT_RGBA_S3TC_DXT3: S3TC DXT3 compressed RGBA, 8 bits
+ *   per pixel
+ * @COGL_PIXEL_FORMAT_RGBA_S3TC_DXT5: S3TC DXT5 compressed RGBA, 8 bits
+ *   per pixel
+ * @COGL_PIXEL_FORMAT_RGBA_ASTC_4x4: ASTC compressed RGBA with 4x4
+ *   blocks, 8 bits per pixel
  *
  * Pixel formats used by COGL. For the formats with a byte per
  * component, the order of the components specify the order in
@@ -215,6 +229,20 @@ typedef struct _CoglTextureVertex       CoglTextureVertex;
  * internal format. Cogl will try to pick the best format to use
  * internally and convert the texture data if necessary.
  *
+ * The compressed formats store the image in blocks of 4x4 pixels.
+ * They can currently only be used for textures loaded from KTX or DDS
+ * files with cogl_texture_new_from_file(). The data is not
+ * premultiplied. If the GL driver doesn't support a format then Cogl
+ * will decompress the data itself when the texture is created, except
+ * for %COGL_PIXEL_FORMAT_RGBA_ASTC_4x4 which can only be used if the
+ * driver supports it.
+ *
+ * The lowest four bits of a format select its layout and the
+ * compressed formats use up all of the remaining values. The two
+ * DXT1 formats share a layout and only differ by %COGL_A_BIT so any
+ * further formats will need to be distinguished in the same way or
+ * by adding a new bit.
+ *
  * Since: 0.8
  */
 typedef enum { /*< prefix=COGL_PIXEL_FORMAT >*/
@@ -240,7 +268,16 @@ typedef enum { /*< prefix=COGL_PIXEL_FORMAT >*/
   COGL_PIXEL_FORMAT_ARGB_8888_PRE = (COGL_PIXEL_FORMAT_32 | COGL_A_BIT | COGL_PREMULT_BIT | COGL_AFIRST_BIT),
   COGL_PIXEL_FORMAT_ABGR_8888_PRE = (COGL_PIXEL_FORMAT_32 | COGL_A_BIT | COGL_PREMULT_BIT | COGL_BGR_BIT | COGL_AFIRST_BIT),
   COGL_PIXEL_FORMAT_RGBA_4444_PRE = (COGL_PIXEL_FORMAT_RGBA_4444 | COGL_A_BIT | COGL_PREMULT_BIT),
-  COGL_PIXEL_FORMAT_RGBA_5551_PRE = (COGL_PIXEL_FORMAT_RGBA_5551 | COGL_A_BIT | COGL_PREMULT_BIT)
+  COGL_PIXEL_FORMAT_RGBA_5551_PRE = (COGL_PIXEL_FORMAT_RGBA_5551 | COGL_A_BIT | COGL_PREMULT_BIT),
+
+  COGL_PIXEL_FORMAT_RGB_ETC1      = 9,
+  COGL_PIXEL_FORMAT_RGB_ETC2      = 10,
+  COGL_PIXEL_FORMAT_RGBA_ETC2_EAC = 11 | COGL_A_BIT,
+  COGL_PIXEL_FORMAT_RGB_S3TC_DXT1 = 12,
+  COGL_PIXEL_FORMAT_RGBA_S3TC_DXT1 = 12 | COGL_A_BIT,
+  COGL_PIXEL_FORMAT_RGBA_S3TC_DXT3 = 13 | COGL_A_BIT,
+  COGL_PIXEL_FORMAT_RGBA_S3TC_DXT5 = 14 | COGL_A_BIT,
+  COGL_PIXEL_FORMAT_RGBA_ASTC_4x4 = 15 | COGL_A_BIT
 } CoglPixelFormat;
 
 /**
@@ -388,6 +425,17 @@ COGL_STRUCT_SIZE_ASSERT (CoglTextureVertex, 36);
  * @COGL_TEXTURE_NO_SLICING: Disables the slicing of the texture
  * @COGL_TEXTURE_NO_ATLAS: Disables the insertion of the texture inside
  *   the texture atlas used by Cogl
+ * @COGL_TEXTURE_CPU_MIPMAP: Generates the mipmaps on the CPU with a
+ *   box filter instead of asking the GL driver to do it. A copy of
+ *   every level is kept in system memory so that only the parts of
+ *   the mipmaps covered by cogl_texture_set_region() need to be
+ *   filtered again. This is only used for textures that don't need
+ *   slicing and that have 8 bits per component. Other textures still
+ *   use the driver. Since: 1.10
+ * @COGL_TEXTURE_MIPMAP_LINEAR_LIGHT: When used with
+ *   %COGL_TEXTURE_CPU_MIPMAP the colour components are treated as
+ *   sRGB encoded and filtered in linear light. The alpha component
+ *   is filtered as it is. Since: 1.10
  *
  * Flags to pass to the cogl_texture_new_* family of functions.
  *
@@ -397,7 +445,9 @@ typedef enum {
   COGL_TEXTURE_NONE           = 0,
   COGL_TEXTURE_NO_AUTO_MIPMAP = 1 << 0,
   COGL_TEXTURE_NO_SLICING     = 1 << 1,
-  COGL_TEXTURE_NO_ATLAS       = 1 << 2
+  COGL_TEXTURE_NO_ATLAS       = 1 << 2,
+  COGL_TEXTURE_CPU_MIPMAP     = 1 << 3,
+  COGL_TEXTURE_MIPMAP_LINEAR_LIGHT = 1 << 4
 } CoglTextureFlags;
 
 /**
@@ -399,6 +399,27 @@ cogl_flush (void)
     _cogl_framebuffer_flush_journal (l->data);
 }
 
+/* Returns TRUE if any framebuffer has primitives logged in its
+   journal. Until these are flushed the journal may still refer to the
+   current contents of any texture */
+gboolean
+_cogl_has_unflushed_journals (void)
+{
+  GList *l;
+
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  for (l = ctx->framebuffers; l; l = l->next)
+    {
+      CoglFramebuffer *framebuffer = l->data;
+
+      if (framebuffer->journal->entries->len > 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 void
 _cogl_read_pixels_with_rowstride (int x,
                                   int y,
@@ -81,6 +81,10 @@ typedef struct _CoglFramebuffer CoglFramebuffer;
 #include <cogl/cogl-quaternion.h>
 #include <cogl/cogl-texture-2d.h>
 #include <cogl/cogl-texture-3d.h>
+#include <cogl/cogl-texture-download.h>
+#include <cogl/cogl-texture-load.h>
+#include <cogl/cogl-memory-usage.h>
+#include <cogl/cogl-texture-stream.h>
 #include <cogl/cogl-index-buffer.h>
 #include <cogl/cogl-attribute-buffer.h>
 #include <cogl/cogl-indices.h>
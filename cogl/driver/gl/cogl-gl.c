@@ -233,6 +233,22 @@ _cogl_gl_update_features (CoglContext *context,
   if (context->glEGLImageTargetTexture2D)
     private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_2D_FROM_EGL_IMAGE;
 
+  if (context->glCompressedTexImage2D)
+    {
+      if (_cogl_check_extension ("GL_OES_compressed_ETC1_RGB8_texture",
+                                 gl_extensions))
+        private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC1;
+      if (COGL_CHECK_GL_VERSION (gl_major, gl_minor, 4, 3) ||
+          _cogl_check_extension ("GL_ARB_ES3_compatibility", gl_extensions))
+        private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC2;
+      if (_cogl_check_extension ("GL_EXT_texture_compression_s3tc",
+                                 gl_extensions))
+        private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_S3TC;
+      if (_cogl_check_extension ("GL_KHR_texture_compression_astc_ldr",
+                                 gl_extensions))
+        private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ASTC;
+    }
+
   /* Cache features */
   context->private_feature_flags |= private_flags;
   context->feature_flags |= flags;
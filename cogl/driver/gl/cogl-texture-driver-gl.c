@@ -35,6 +35,7 @@
 #include "cogl-util.h"
 #include "cogl-bitmap.h"
 #include "cogl-bitmap-private.h"
+#include "cogl-compressed-image-private.h"
 #include "cogl-texture-private.h"
 #include "cogl-pipeline.h"
 #include "cogl-context-private.h"
@@ -257,6 +258,29 @@ _cogl_texture_driver_upload_to_gl_3d (GLenum       gl_target,
   _cogl_bitmap_unbind (source_bmp);
 }
 
+static void
+_cogl_texture_driver_upload_compressed_to_gl (GLenum        gl_target,
+                                              GLuint        gl_handle,
+                                              gboolean      is_foreign,
+                                              int           level,
+                                              int           width,
+                                              int           height,
+                                              GLint         internal_gl_format,
+                                              const guint8 *data,
+                                              int           data_size)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  _cogl_bind_gl_texture_transient (gl_target, gl_handle, is_foreign);
+
+  GE( ctx, glCompressedTexImage2D (gl_target, level,
+                                   internal_gl_format,
+                                   width, height,
+                                   0, /* border */
+                                   data_size,
+                                   data) );
+}
+
 static gboolean
 _cogl_texture_driver_gl_get_tex_image (GLenum  gl_target,
                                        GLenum  dest_gl_format,
@@ -484,6 +508,16 @@ _cogl_texture_driver_pixel_format_to_gl (CoglPixelFormat  format,
 
       /* FIXME: check extensions for YUV support */
     default:
+      /* Compressed data is given to GL untouched if the driver
+         supports the format. Otherwise it is decompressed to RGBA */
+      if (_cogl_pixel_format_is_compressed (format) &&
+          !_cogl_compressed_format_to_gl (format, &glintformat))
+        {
+          glintformat = GL_RGBA;
+          glformat = GL_RGBA;
+          gltype = GL_UNSIGNED_BYTE;
+          required_format = COGL_PIXEL_FORMAT_RGBA_8888;
+        }
       break;
     }
 
@@ -542,6 +576,7 @@ _cogl_texture_driver_gl =
     _cogl_texture_driver_upload_subregion_to_gl,
     _cogl_texture_driver_upload_to_gl,
     _cogl_texture_driver_upload_to_gl_3d,
+    _cogl_texture_driver_upload_compressed_to_gl,
     _cogl_texture_driver_prep_gl_for_pixels_download,
     _cogl_texture_driver_gl_get_tex_image,
     _cogl_texture_driver_size_supported,
@@ -33,6 +33,28 @@
 #include "cogl-feature-private.h"
 #include "cogl-renderer-private.h"
 
+/* The version string for GLES 2 and later is of the form "OpenGL ES
+   N.M <vendor-specific information>". GLES 1 uses a different prefix
+   so it will just be reported as 0 */
+static int
+_cogl_get_gles_major_version (CoglContext *context)
+{
+  const char *version_string =
+    (const char *) context->glGetString (GL_VERSION);
+  int major = 0;
+
+  if (version_string == NULL ||
+      !g_str_has_prefix (version_string, "OpenGL ES "))
+    return 0;
+
+  for (version_string += 10;
+       g_ascii_isdigit (*version_string);
+       version_string++)
+    major = (major * 10) + *version_string - '0';
+
+  return major;
+}
+
 gboolean
 _cogl_gles_update_features (CoglContext *context,
                             GError **error)
@@ -123,6 +145,28 @@ _cogl_gles_update_features (CoglContext *context,
   if (context->glEGLImageTargetTexture2D)
     private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_2D_FROM_EGL_IMAGE;
 
+  if (context->driver == COGL_DRIVER_GLES2 &&
+      _cogl_check_extension ("GL_OES_standard_derivatives", gl_extensions))
+    private_flags |= COGL_PRIVATE_FEATURE_STANDARD_DERIVATIVES;
+
+  /* GLES 3 has GL_UNPACK_ROW_LENGTH and friends in core */
+  if (_cogl_check_extension ("GL_EXT_unpack_subimage", gl_extensions) ||
+      _cogl_get_gles_major_version (context) >= 3)
+    private_flags |= COGL_PRIVATE_FEATURE_UNPACK_SUBIMAGE;
+
+  if (_cogl_check_extension ("GL_OES_compressed_ETC1_RGB8_texture",
+                             gl_extensions))
+    private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC1;
+  /* ETC2 is mandatory in GLES 3 */
+  if (_cogl_get_gles_major_version (context) >= 3)
+    private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ETC2;
+  if (_cogl_check_extension ("GL_EXT_texture_compression_s3tc",
+                             gl_extensions))
+    private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_S3TC;
+  if (_cogl_check_extension ("GL_KHR_texture_compression_astc_ldr",
+                             gl_extensions))
+    private_flags |= COGL_PRIVATE_FEATURE_TEXTURE_COMPRESSION_ASTC;
+
   /* Cache features */
   context->private_feature_flags |= private_flags;
   context->feature_flags |= flags;
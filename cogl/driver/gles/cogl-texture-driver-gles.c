@@ -35,6 +35,7 @@
 #include "cogl-util.h"
 #include "cogl-bitmap.h"
 #include "cogl-bitmap-private.h"
+#include "cogl-compressed-image-private.h"
 #include "cogl-texture-private.h"
 #include "cogl-pipeline.h"
 #include "cogl-pipeline-opengl-private.h"
@@ -52,6 +53,21 @@
 #ifndef GL_MAX_3D_TEXTURE_SIZE_OES
 #define GL_MAX_3D_TEXTURE_SIZE_OES 0x8073
 #endif
+/* These are in GLES 3 and GL_EXT_unpack_subimage */
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+#ifndef GL_UNPACK_SKIP_ROWS
+#define GL_UNPACK_SKIP_ROWS 0x0CF3
+#endif
+#ifndef GL_UNPACK_SKIP_PIXELS
+#define GL_UNPACK_SKIP_PIXELS 0x0CF4
+#endif
+
+/* Sub-regions bigger than this are packed into a temporary buffer
+   instead of the scratch buffer so that one large upload doesn't
+   leave the context holding on to a lot of memory */
+#define COGL_TEXTURE_DRIVER_SCRATCH_MAX_SIZE (64 * 1024)
 
 static void
 _cogl_texture_driver_gen (GLenum   gl_target,
@@ -84,11 +100,47 @@ _cogl_texture_driver_gen (GLenum   gl_target,
     }
 }
 
+/* Returns whether GL can be made to read pixels directly from a
+   buffer with the given rowstride, which may be the rowstride of a
+   larger image than the one being uploaded */
+static gboolean
+can_upload_with_row_length (int pixels_rowstride,
+                            int pixels_bpp)
+{
+  _COGL_GET_CONTEXT (ctx, FALSE);
+
+  return ((ctx->private_feature_flags &
+           COGL_PRIVATE_FEATURE_UNPACK_SUBIMAGE) &&
+          pixels_rowstride % pixels_bpp == 0);
+}
+
+static void
+prep_gl_for_pixels_upload_full (int pixels_rowstride,
+                                int pixels_src_x,
+                                int pixels_src_y,
+                                int pixels_bpp)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  /* Without GL_EXT_unpack_subimage these are never changed so they
+     are always left at the defaults */
+  if ((ctx->private_feature_flags & COGL_PRIVATE_FEATURE_UNPACK_SUBIMAGE))
+    {
+      GE( ctx, glPixelStorei (GL_UNPACK_ROW_LENGTH,
+                              pixels_rowstride / pixels_bpp) );
+
+      GE( ctx, glPixelStorei (GL_UNPACK_SKIP_PIXELS, pixels_src_x) );
+      GE( ctx, glPixelStorei (GL_UNPACK_SKIP_ROWS, pixels_src_y) );
+    }
+
+  _cogl_texture_prep_gl_alignment_for_pixels_upload (pixels_rowstride);
+}
+
 static void
 _cogl_texture_driver_prep_gl_for_pixels_upload (int pixels_rowstride,
                                                 int pixels_bpp)
 {
-  _cogl_texture_prep_gl_alignment_for_pixels_upload (pixels_rowstride);
+  prep_gl_for_pixels_upload_full (pixels_rowstride, 0, 0, pixels_bpp);
 }
 
 static void
@@ -107,7 +159,8 @@ prepare_bitmap_alignment_for_upload (CoglBitmap *src_bmp)
   int width = _cogl_bitmap_get_width (src_bmp);
   int alignment = 1;
 
-  if (src_rowstride == 0)
+  if (src_rowstride == 0 ||
+      can_upload_with_row_length (src_rowstride, bpp))
     return cogl_object_ref (src_bmp);
 
   /* Work out the alignment of the source rowstride */
@@ -119,7 +172,7 @@ prepare_bitmap_alignment_for_upload (CoglBitmap *src_bmp)
   if (((width * bpp + alignment - 1) & ~(alignment - 1)) == src_rowstride)
     return cogl_object_ref (src_bmp);
   /* Otherwise we need to copy the bitmap to pack the alignment
-     because GLES has no GL_ROW_LENGTH */
+     because GLES 2 has no GL_ROW_LENGTH */
   else
     return _cogl_bitmap_copy (src_bmp);
 }
@@ -141,31 +194,61 @@ _cogl_texture_driver_upload_subregion_to_gl (GLenum       gl_target,
   guint8 *data;
   CoglPixelFormat source_format = _cogl_bitmap_get_format (source_bmp);
   int bpp = _cogl_get_format_bpp (source_format);
+  int source_rowstride = _cogl_bitmap_get_rowstride (source_bmp);
   CoglBitmap *slice_bmp;
   int rowstride;
 
   _COGL_GET_CONTEXT (ctx, NO_RETVAL);
 
-  /* If we are copying a sub region of the source bitmap then we need
-     to copy it because GLES does not support GL_UNPACK_ROW_LENGTH */
-  if (src_x != 0 || src_y != 0 ||
-      width != _cogl_bitmap_get_width (source_bmp) ||
-      height != _cogl_bitmap_get_height (source_bmp))
+  /* If the driver supports GL_UNPACK_ROW_LENGTH then we can upload
+     the sub region straight from the source bitmap */
+  if (can_upload_with_row_length (source_rowstride, bpp))
     {
+      slice_bmp = cogl_object_ref (source_bmp);
+      rowstride = source_rowstride;
+    }
+  /* Otherwise if we are copying a sub region of the source bitmap
+     then we need to pack just the rows we need into the scratch
+     buffer first */
+  else if (src_x != 0 || src_y != 0 ||
+           width != _cogl_bitmap_get_width (source_bmp) ||
+           height != _cogl_bitmap_get_height (source_bmp))
+    {
+      GByteArray *scratch = ctx->texture_upload_scratch_array;
+
       rowstride = bpp * width;
       rowstride = (rowstride + 3) & ~3;
-      slice_bmp =
-        _cogl_bitmap_new_from_data (g_malloc (height * rowstride),
-                                    source_format,
-                                    width, height,
-                                    rowstride,
-                                    (CoglBitmapDestroyNotify) g_free,
-                                    NULL);
+
+      if (height * rowstride > COGL_TEXTURE_DRIVER_SCRATCH_MAX_SIZE)
+        slice_bmp =
+          _cogl_bitmap_new_from_data (g_malloc (height * rowstride),
+                                      source_format,
+                                      width, height,
+                                      rowstride,
+                                      (CoglBitmapDestroyNotify) g_free,
+                                      NULL);
+      else
+        {
+          g_byte_array_set_size (scratch, height * rowstride);
+
+          /* The bitmap doesn't own the scratch buffer and it is
+             destroyed again before this function returns so nothing
+             else can use the buffer in the meantime */
+          slice_bmp = _cogl_bitmap_new_from_data (scratch->data,
+                                                  source_format,
+                                                  width, height,
+                                                  rowstride,
+                                                  NULL, /* destroy_fn */
+                                                  NULL);
+        }
       _cogl_bitmap_copy_subregion (source_bmp,
                                    slice_bmp,
                                    src_x, src_y,
                                    0, 0, /* dst_x/y */
                                    width, height);
+
+      src_x = 0;
+      src_y = 0;
     }
   else
     {
@@ -174,7 +257,7 @@ _cogl_texture_driver_upload_subregion_to_gl (GLenum       gl_target,
     }
 
   /* Setup gl alignment to match rowstride and top-left corner */
-  _cogl_texture_driver_prep_gl_for_pixels_upload (rowstride, bpp);
+  prep_gl_for_pixels_upload_full (rowstride, src_x, src_y, bpp);
 
   data = _cogl_bitmap_bind (slice_bmp, COGL_BUFFER_ACCESS_READ, 0);
 
@@ -338,6 +421,29 @@ _cogl_texture_driver_upload_to_gl_3d (GLenum       gl_target,
     }
 }
 
+static void
+_cogl_texture_driver_upload_compressed_to_gl (GLenum        gl_target,
+                                              GLuint        gl_handle,
+                                              gboolean      is_foreign,
+                                              int           level,
+                                              int           width,
+                                              int           height,
+                                              GLint         internal_gl_format,
+                                              const guint8 *data,
+                                              int           data_size)
+{
+  _COGL_GET_CONTEXT (ctx, NO_RETVAL);
+
+  _cogl_bind_gl_texture_transient (gl_target, gl_handle, is_foreign);
+
+  GE( ctx, glCompressedTexImage2D (gl_target, level,
+                                   internal_gl_format,
+                                   width, height,
+                                   0, /* border */
+                                   data_size,
+                                   data) );
+}
+
 /* NB: GLES doesn't support glGetTexImage2D, so cogl-texture will instead
  * fallback to a generic render + readpixels approach to downloading
  * texture data. (See _cogl_texture_draw_and_read() ) */
@@ -474,6 +580,16 @@ _cogl_texture_driver_pixel_format_to_gl (CoglPixelFormat  format,
 
       /* FIXME: check extensions for YUV support */
     default:
+      /* Compressed data is given to GL untouched if the driver
+         supports the format. Otherwise it is decompressed to RGBA */
+      if (_cogl_pixel_format_is_compressed (format) &&
+          !_cogl_compressed_format_to_gl (format, &glintformat))
+        {
+          glintformat = GL_RGBA;
+          glformat = GL_RGBA;
+          gltype = GL_UNSIGNED_BYTE;
+          required_format = COGL_PIXEL_FORMAT_RGBA_8888;
+        }
       break;
     }
 
@@ -527,6 +643,7 @@ _cogl_texture_driver_gles =
     _cogl_texture_driver_upload_subregion_to_gl,
     _cogl_texture_driver_upload_to_gl,
     _cogl_texture_driver_upload_to_gl_3d,
+    _cogl_texture_driver_upload_compressed_to_gl,
     _cogl_texture_driver_prep_gl_for_pixels_download,
     _cogl_texture_driver_gl_get_tex_image,
     _cogl_texture_driver_size_supported,
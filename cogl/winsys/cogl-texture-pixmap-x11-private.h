@@ -71,7 +71,10 @@ struct _CoglTexturePixmapX11
   Damage damage;
   CoglTexturePixmapX11ReportLevel damage_report_level;
   gboolean damage_owned;
-  CoglDamageRectangle damage_rect;
+  /* The damaged area as an array of disjoint CoglDamageRectangles */
+  GArray *damage_rects;
+
+  CoglTexturePixmapX11Stats stats;
 
   void *winsys;
 
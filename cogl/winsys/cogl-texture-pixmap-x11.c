@@ -64,43 +64,159 @@ COGL_TEXTURE_DEFINE (TexturePixmapX11, texture_pixmap_x11);
 
 static const CoglTextureVtable cogl_texture_pixmap_x11_vtable;
 
+/* The damage region is kept as a short list of disjoint rectangles
+   so that small areas in different parts of the pixmap can be copied
+   separately instead of as one big bounding box */
+#define COGL_DAMAGE_REGION_MAX_RECTANGLES 16
+
+/* Copying each rectangle costs a round trip to the X server and an
+   upload so two rectangles are merged if the bounding box would only
+   add this many extra pixels */
+#define COGL_DAMAGE_MERGE_WASTE (32 * 32)
+
+static unsigned int
+cogl_damage_rectangle_area (const CoglDamageRectangle *rect)
+{
+  return (rect->x2 - rect->x1) * (rect->y2 - rect->y1);
+}
+
 static void
-cogl_damage_rectangle_union (CoglDamageRectangle *damage_rect,
-                             int x,
-                             int y,
-                             int width,
-                             int height)
-{
-  /* If the damage region is empty then we'll just copy the new
-     rectangle directly */
-  if (damage_rect->x1 == damage_rect->x2 ||
-      damage_rect->y1 == damage_rect->y2)
+cogl_damage_rectangle_union (CoglDamageRectangle *rect,
+                             const CoglDamageRectangle *other)
+{
+  rect->x1 = MIN (rect->x1, other->x1);
+  rect->y1 = MIN (rect->y1, other->y1);
+  rect->x2 = MAX (rect->x2, other->x2);
+  rect->y2 = MAX (rect->y2, other->y2);
+}
+
+/* Returns the number of pixels that would be copied needlessly if the
+   two rectangles were replaced with their bounding box. Overlapping
+   rectangles always return 0 so that the region stays disjoint */
+static unsigned int
+cogl_damage_rectangle_merge_waste (const CoglDamageRectangle *a,
+                                   const CoglDamageRectangle *b)
+{
+  CoglDamageRectangle bounds;
+
+  if (a->x1 < b->x2 && b->x1 < a->x2 &&
+      a->y1 < b->y2 && b->y1 < a->y2)
+    return 0;
+
+  bounds = *a;
+  cogl_damage_rectangle_union (&bounds, b);
+
+  return (cogl_damage_rectangle_area (&bounds) -
+          cogl_damage_rectangle_area (a) -
+          cogl_damage_rectangle_area (b));
+}
+
+static void
+cogl_damage_region_clear (CoglTexturePixmapX11 *tex_pixmap)
+{
+  g_array_set_size (tex_pixmap->damage_rects, 0);
+}
+
+static void
+cogl_damage_region_add (CoglTexturePixmapX11 *tex_pixmap,
+                        int x,
+                        int y,
+                        int width,
+                        int height)
+{
+  GArray *rects = tex_pixmap->damage_rects;
+  CoglDamageRectangle rect;
+  unsigned int best_waste;
+  int best_index;
+  int i;
+
+  /* Clip the rectangle to the pixmap */
+  if (x < 0)
     {
-      damage_rect->x1 = x;
-      damage_rect->y1 = y;
-      damage_rect->x2 = x + width;
-      damage_rect->y2 = y + height;
+      width += x;
+      x = 0;
     }
-  else
+  if (y < 0)
     {
-      if (damage_rect->x1 > x)
-        damage_rect->x1 = x;
-      if (damage_rect->y1 > y)
-        damage_rect->y1 = y;
-      if (damage_rect->x2 < x + width)
-        damage_rect->x2 = x + width;
-      if (damage_rect->y2 < y + height)
-        damage_rect->y2 = y + height;
+      height += y;
+      y = 0;
     }
+  if (x + width > (int) tex_pixmap->width)
+    width = tex_pixmap->width - x;
+  if (y + height > (int) tex_pixmap->height)
+    height = tex_pixmap->height - y;
+
+  if (width <= 0 || height <= 0)
+    return;
+
+  rect.x1 = x;
+  rect.y1 = y;
+  rect.x2 = x + width;
+  rect.y2 = y + height;
+
+  while (TRUE)
+    {
+      /* Merge the new rectangle with every rectangle that it overlaps
+         or that is cheap to merge with. The search is restarted after
+         each merge because the bigger rectangle may now touch one
+         that was already checked */
+      for (i = 0; i < rects->len; i++)
+        {
+          CoglDamageRectangle *other =
+            &g_array_index (rects, CoglDamageRectangle, i);
+
+          if (cogl_damage_rectangle_merge_waste (&rect, other) <=
+              COGL_DAMAGE_MERGE_WASTE)
+            {
+              cogl_damage_rectangle_union (&rect, other);
+              g_array_remove_index_fast (rects, i);
+              i = -1;
+            }
+        }
+
+      if (rects->len < COGL_DAMAGE_REGION_MAX_RECTANGLES)
+        break;
+
+      /* If the region is full then merge with whichever rectangle
+         wastes the least and check the result again */
+      best_waste = G_MAXUINT;
+      best_index = 0;
+
+      for (i = 0; i < rects->len; i++)
+        {
+          unsigned int waste =
+            cogl_damage_rectangle_merge_waste
+            (&rect, &g_array_index (rects, CoglDamageRectangle, i));
+
+          if (waste < best_waste)
+            {
+              best_waste = waste;
+              best_index = i;
+            }
+        }
+
+      cogl_damage_rectangle_union (&rect,
+                                   &g_array_index (rects,
+                                                   CoglDamageRectangle,
+                                                   best_index));
+      g_array_remove_index_fast (rects, best_index);
+    }
+
+  g_array_append_val (rects, rect);
 }
 
 static gboolean
-cogl_damage_rectangle_is_whole (const CoglDamageRectangle *damage_rect,
-                                unsigned int width,
-                                unsigned int height)
+cogl_damage_region_is_whole (CoglTexturePixmapX11 *tex_pixmap)
 {
-  return (damage_rect->x1 == 0 && damage_rect->y1 == 0
-          && damage_rect->x2 == width && damage_rect->y2 == height);
+  const CoglDamageRectangle *rect;
+
+  if (tex_pixmap->damage_rects->len != 1)
+    return FALSE;
+
+  rect = &g_array_index (tex_pixmap->damage_rects, CoglDamageRectangle, 0);
+
+  return (rect->x1 == 0 && rect->y1 == 0 &&
+          rect->x2 == tex_pixmap->width && rect->y2 == tex_pixmap->height);
 }
 
 static const CoglWinsysVtable *
@@ -158,9 +274,7 @@ process_damage_event (CoglTexturePixmapX11 *tex_pixmap,
   /* If the damage already covers the whole rectangle then we don't
      need to request the bounding box of the region because we're
      going to update the whole texture anyway. */
-  if (cogl_damage_rectangle_is_whole (&tex_pixmap->damage_rect,
-                                      tex_pixmap->width,
-                                      tex_pixmap->height))
+  if (cogl_damage_region_is_whole (tex_pixmap))
     {
       if (handle_mode != DO_NOTHING)
         XDamageSubtract (display, tex_pixmap->damage, None, None);
@@ -171,9 +285,10 @@ process_damage_event (CoglTexturePixmapX11 *tex_pixmap,
       int r_count;
       XRectangle r_bounds;
       XRectangle *r_damage;
+      int i;
 
       /* We need to extract the damage region so we can get the
-         bounding box */
+         rectangles that it is made of */
 
       parts = XFixesCreateRegion (display, 0, 0);
       XDamageSubtract (display, tex_pixmap->damage, None, parts);
@@ -181,13 +296,22 @@ process_damage_event (CoglTexturePixmapX11 *tex_pixmap,
                                              parts,
                                              &r_count,
                                              &r_bounds);
-      cogl_damage_rectangle_union (&tex_pixmap->damage_rect,
-                                   r_bounds.x,
-                                   r_bounds.y,
-                                   r_bounds.width,
-                                   r_bounds.height);
       if (r_damage)
-        XFree (r_damage);
+        {
+          for (i = 0; i < r_count; i++)
+            cogl_damage_region_add (tex_pixmap,
+                                    r_damage[i].x,
+                                    r_damage[i].y,
+                                    r_damage[i].width,
+                                    r_damage[i].height);
+          XFree (r_damage);
+        }
+      else
+        cogl_damage_region_add (tex_pixmap,
+                                r_bounds.x,
+                                r_bounds.y,
+                                r_bounds.width,
+                                r_bounds.height);
 
       XFixesDestroyRegion (display, parts);
     }
@@ -198,11 +322,11 @@ process_damage_event (CoglTexturePixmapX11 *tex_pixmap,
            don't care what the region actually was */
         XDamageSubtract (display, tex_pixmap->damage, None, None);
 
-      cogl_damage_rectangle_union (&tex_pixmap->damage_rect,
-                                   damage_event->area.x,
-                                   damage_event->area.y,
-                                   damage_event->area.width,
-                                   damage_event->area.height);
+      cogl_damage_region_add (tex_pixmap,
+                              damage_event->area.x,
+                              damage_event->area.y,
+                              damage_event->area.width,
+                              damage_event->area.height);
     }
 
   if (tex_pixmap->winsys)
@@ -325,10 +449,13 @@ cogl_texture_pixmap_x11_new (guint32 pixmap,
     }
 
   /* Assume the entire pixmap is damaged to begin with */
-  tex_pixmap->damage_rect.x1 = 0;
-  tex_pixmap->damage_rect.x2 = tex_pixmap->width;
-  tex_pixmap->damage_rect.y1 = 0;
-  tex_pixmap->damage_rect.y2 = tex_pixmap->height;
+  tex_pixmap->damage_rects = g_array_new (FALSE, FALSE,
+                                          sizeof (CoglDamageRectangle));
+  cogl_damage_region_add (tex_pixmap,
+                          0, 0,
+                          tex_pixmap->width, tex_pixmap->height);
+
+  memset (&tex_pixmap->stats, 0, sizeof (tex_pixmap->stats));
 
   winsys = _cogl_texture_pixmap_x11_get_winsys (tex_pixmap);
   if (winsys->texture_pixmap_x11_create)
@@ -438,8 +565,7 @@ cogl_texture_pixmap_x11_update_area (CoglHandle handle,
       winsys->texture_pixmap_x11_damage_notify (tex_pixmap);
     }
 
-  cogl_damage_rectangle_union (&tex_pixmap->damage_rect,
-                               x, y, width, height);
+  cogl_damage_region_add (tex_pixmap, x, y, width, height);
 }
 
 gboolean
@@ -472,26 +598,83 @@ cogl_texture_pixmap_x11_set_damage_object (CoglHandle handle,
     set_damage_object_internal (ctxt, tex_pixmap, damage, report_level);
 }
 
+void
+cogl_texture_pixmap_x11_get_stats (CoglHandle handle,
+                                   CoglTexturePixmapX11Stats *stats)
+{
+  CoglTexturePixmapX11 *tex_pixmap = COGL_TEXTURE_PIXMAP_X11 (handle);
+
+  g_return_if_fail (cogl_is_texture_pixmap_x11 (handle));
+
+  *stats = tex_pixmap->stats;
+}
+
+static CoglPixelFormat
+_cogl_texture_pixmap_x11_get_image_format (XImage *image)
+{
+  CoglPixelFormat image_format;
+
+  /* xlib doesn't appear to fill in image->{red,green,blue}_mask so
+     this just assumes that the image is stored as ARGB from most
+     significant byte to to least significant. If the format is little
+     endian that means the order will be BGRA in memory */
+
+  switch (image->bits_per_pixel)
+    {
+    default:
+    case 32:
+      {
+        /* If the pixmap is actually non-packed-pixel RGB format then
+           the texture would have been created in RGB_888 format so Cogl
+           will ignore the alpha channel and effectively pack it for
+           us */
+        image_format = COGL_PIXEL_FORMAT_RGBA_8888_PRE;
+
+        /* If the format is actually big endian then the alpha
+           component will come first */
+        if (image->byte_order == MSBFirst)
+          image_format |= COGL_AFIRST_BIT;
+      }
+      break;
+
+    case 24:
+      image_format = COGL_PIXEL_FORMAT_RGB_888;
+      break;
+
+    case 16:
+      /* FIXME: this should probably swap the orders around if the
+         endianness does not match */
+      image_format = COGL_PIXEL_FORMAT_RGB_565;
+      break;
+    }
+
+  if (image->bits_per_pixel != 16)
+    {
+      /* If the image is in little-endian then the order in memory is
+         reversed */
+      if (image->byte_order == LSBFirst)
+        image_format |= COGL_BGR_BIT;
+    }
+
+  return image_format;
+}
+
 static void
 _cogl_texture_pixmap_x11_update_image_texture (CoglTexturePixmapX11 *tex_pixmap)
 {
   Display *display;
-  CoglPixelFormat image_format;
   XImage *image;
   int src_x, src_y;
   int x, y, width, height;
+  gboolean fetched_whole_image = FALSE;
+  int i;
 
   display = cogl_xlib_get_display ();
 
   /* If the damage region is empty then there's nothing to do */
-  if (tex_pixmap->damage_rect.x2 == tex_pixmap->damage_rect.x1)
+  if (tex_pixmap->damage_rects->len == 0)
     return;
 
-  x = tex_pixmap->damage_rect.x1;
-  y = tex_pixmap->damage_rect.y1;
-  width = tex_pixmap->damage_rect.x2 - x;
-  height = tex_pixmap->damage_rect.y2 - y;
-
   /* We lazily create the texture the first time it is needed in case
      this texture can be entirely handled using the GLX texture
      instead */
@@ -507,6 +690,8 @@ _cogl_texture_pixmap_x11_update_image_texture (CoglTexturePixmapX11 *tex_pixmap)
                                                     tex_pixmap->height,
                                                     COGL_TEXTURE_NONE,
                                                     texture_format);
+      _cogl_texture_set_memory_category (tex_pixmap->tex,
+                                         COGL_MEMORY_CATEGORY_PIXMAP);
     }
 
   if (tex_pixmap->image == NULL)
@@ -531,19 +716,42 @@ _cogl_texture_pixmap_x11_update_image_texture (CoglTexturePixmapX11 *tex_pixmap)
                                          0, 0,
                                          tex_pixmap->width, tex_pixmap->height,
                                          AllPlanes, ZPixmap);
-          image = tex_pixmap->image;
-          src_x = x;
-          src_y = y;
+          if (tex_pixmap->image == NULL)
+            return;
+          fetched_whole_image = TRUE;
+
+          tex_pixmap->stats.n_bytes_uploaded +=
+            (guint64) tex_pixmap->image->bytes_per_line *
+            tex_pixmap->image->height;
         }
-      else
+    }
+
+  tex_pixmap->stats.n_updates++;
+
+  /* Each damaged rectangle is copied separately so that two small
+     areas far apart don't cause the whole area between them to be
+     copied */
+  for (i = 0; i < tex_pixmap->damage_rects->len; i++)
+    {
+      const CoglDamageRectangle *rect =
+        &g_array_index (tex_pixmap->damage_rects, CoglDamageRectangle, i);
+
+      x = rect->x1;
+      y = rect->y1;
+      width = rect->x2 - x;
+      height = rect->y2 - y;
+
+      if (tex_pixmap->image == NULL)
         {
           COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XShmGetImage",
                      tex_pixmap);
 
           /* Create a temporary image using the beginning of the
              shared memory segment and the right size for the region
-             we want to update. We need to reallocate the XImage every
-             time because there is no XShmGetSubImage. */
+             we want to update. The shared memory segment is big
+             enough for the whole pixmap so it is reused for every
+             rectangle but we need to reallocate the XImage every time
+             because there is no XShmGetSubImage. */
           image = XShmCreateImage (display,
                                    tex_pixmap->visual,
                                    tex_pixmap->depth,
@@ -557,81 +765,53 @@ _cogl_texture_pixmap_x11_update_image_texture (CoglTexturePixmapX11 *tex_pixmap)
           src_y = 0;
 
           XShmGetImage (display, tex_pixmap->pixmap, image, x, y, AllPlanes);
-        }
-    }
-  else
-    {
-      COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XGetSubImage", tex_pixmap);
-
-      image = tex_pixmap->image;
-      src_x = x;
-      src_y = y;
-
-      XGetSubImage (display,
-                    tex_pixmap->pixmap,
-                    x, y, width, height,
-                    AllPlanes, ZPixmap,
-                    image,
-                    x, y);
-    }
-
-  /* xlib doesn't appear to fill in image->{red,green,blue}_mask so
-     this just assumes that the image is stored as ARGB from most
-     significant byte to to least significant. If the format is little
-     endian that means the order will be BGRA in memory */
 
-  switch (image->bits_per_pixel)
-    {
-    default:
-    case 32:
-      {
-        /* If the pixmap is actually non-packed-pixel RGB format then
-           the texture would have been created in RGB_888 format so Cogl
-           will ignore the alpha channel and effectively pack it for
-           us */
-        image_format = COGL_PIXEL_FORMAT_RGBA_8888_PRE;
-
-        /* If the format is actually big endian then the alpha
-           component will come first */
-        if (image->byte_order == MSBFirst)
-          image_format |= COGL_AFIRST_BIT;
-      }
-      break;
-
-    case 24:
-      image_format = COGL_PIXEL_FORMAT_RGB_888;
-      break;
+          tex_pixmap->stats.n_bytes_uploaded +=
+            (guint64) image->bytes_per_line * height;
+        }
+      else
+        {
+          image = tex_pixmap->image;
+          src_x = x;
+          src_y = y;
 
-    case 16:
-      /* FIXME: this should probably swap the orders around if the
-         endianness does not match */
-      image_format = COGL_PIXEL_FORMAT_RGB_565;
-      break;
-    }
+          /* The image already has the right contents if it was just
+             fetched */
+          if (!fetched_whole_image)
+            {
+              COGL_NOTE (TEXTURE_PIXMAP, "Updating %p using XGetSubImage",
+                         tex_pixmap);
+
+              XGetSubImage (display,
+                            tex_pixmap->pixmap,
+                            x, y, width, height,
+                            AllPlanes, ZPixmap,
+                            image,
+                            x, y);
+
+              tex_pixmap->stats.n_bytes_uploaded +=
+                (guint64) width * height * image->bits_per_pixel / 8;
+            }
+        }
 
-  if (image->bits_per_pixel != 16)
-    {
-      /* If the image is in little-endian then the order in memory is
-         reversed */
-      if (image->byte_order == LSBFirst)
-        image_format |= COGL_BGR_BIT;
+      cogl_texture_set_region (tex_pixmap->tex,
+                               src_x, src_y,
+                               x, y, width, height,
+                               image->width,
+                               image->height,
+                               _cogl_texture_pixmap_x11_get_image_format (image),
+                               image->bytes_per_line,
+                               (const guint8 *) image->data);
+
+      tex_pixmap->stats.n_rectangles_uploaded++;
+
+      /* If we have a shared memory segment then the XImage would be a
+         temporary one with no data allocated so we can just XFree it */
+      if (tex_pixmap->shm_info.shmid != -1)
+        XFree (image);
     }
 
-  cogl_texture_set_region (tex_pixmap->tex,
-                           src_x, src_y,
-                           x, y, width, height,
-                           image->width,
-                           image->height,
-                           image_format,
-                           image->bytes_per_line,
-                           (const guint8 *) image->data);
-
-  /* If we have a shared memory segment then the XImage would be a
-     temporary one with no data allocated so we can just XFree it */
-  if (tex_pixmap->shm_info.shmid != -1)
-    XFree (image);
-
-  memset (&tex_pixmap->damage_rect, 0, sizeof (CoglDamageRectangle));
+  cogl_damage_region_clear (tex_pixmap);
 }
 
 static void
@@ -958,6 +1138,8 @@ _cogl_texture_pixmap_x11_free (CoglTexturePixmapX11 *tex_pixmap)
   if (tex_pixmap->tex)
     cogl_handle_unref (tex_pixmap->tex);
 
+  g_array_free (tex_pixmap->damage_rects, TRUE);
+
   if (tex_pixmap->winsys)
     {
       const CoglWinsysVtable *winsys =
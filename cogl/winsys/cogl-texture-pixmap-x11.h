@@ -41,6 +41,8 @@
 #define cogl_texture_pixmap_x11_set_damage_object \
   cogl_texture_pixmap_x11_set_damage_object_EXP
 #define cogl_is_texture_pixmap_x11 cogl_is_texture_pixmap_x11_EXP
+#define cogl_texture_pixmap_x11_get_stats \
+  cogl_texture_pixmap_x11_get_stats_EXP
 
 typedef enum
 {
@@ -50,6 +52,27 @@ typedef enum
   COGL_TEXTURE_PIXMAP_X11_DAMAGE_NON_EMPTY
 } CoglTexturePixmapX11ReportLevel;
 
+/**
+ * CoglTexturePixmapX11Stats:
+ * @n_updates: the number of times the texture was updated from the
+ *   pixmap without using the texture from pixmap extension
+ * @n_rectangles_uploaded: the number of damaged rectangles that were
+ *   copied from the pixmap
+ * @n_bytes_uploaded: the number of bytes of image data that were
+ *   fetched from the X server
+ *
+ * Counters returned by cogl_texture_pixmap_x11_get_stats().
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+typedef struct
+{
+  unsigned int n_updates;
+  unsigned int n_rectangles_uploaded;
+  guint64 n_bytes_uploaded;
+} CoglTexturePixmapX11Stats;
+
 /**
  * cogl_texture_pixmap_x11_new:
  * @pixmap: A X11 pixmap ID
@@ -150,6 +173,25 @@ cogl_texture_pixmap_x11_set_damage_object (CoglHandle handle,
 gboolean
 cogl_is_texture_pixmap_x11 (CoglHandle handle);
 
+/**
+ * cogl_texture_pixmap_x11_get_stats:
+ * @handle: A CoglHandle to a CoglTexturePixmapX11 instance
+ * @stats: return location for the counters
+ *
+ * Retrieves the counters for the copies that have been made from the
+ * pixmap into the texture. The damaged area of the pixmap is tracked
+ * as a list of rectangles and each one is copied separately so these
+ * can be used to see how much data is transferred for a pattern of
+ * damage. Nothing is counted while the texture from pixmap extension
+ * is being used.
+ *
+ * Since: 1.10
+ * Stability: Unstable
+ */
+void
+cogl_texture_pixmap_x11_get_stats (CoglHandle handle,
+                                   CoglTexturePixmapX11Stats *stats);
+
 #endif /* COGL_ENABLE_EXPERIMENTAL_API */
 
 #endif /* __COGL_TEXTURE_PIXMAP_X11_H */
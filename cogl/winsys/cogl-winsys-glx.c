@@ -1899,6 +1899,9 @@ _cogl_winsys_texture_pixmap_x11_update (CoglTexturePixmapX11 *tex_pixmap,
               return FALSE;
             }
         }
+
+      _cogl_texture_set_memory_category (glx_tex_pixmap->glx_tex,
+                                         COGL_MEMORY_CATEGORY_PIXMAP);
     }
 
   if (needs_mipmap)
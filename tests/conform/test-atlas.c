@@ -0,0 +1,521 @@
+#include <cogl/cogl.h>
+#include <cogl/cogl-rectangle-map.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* test_cogl_atlas_compact fills an atlas with rectangles of
+   different colors, removes every other one to fragment it and then
+   compacts it a bit at a time. Each step should copy no more than
+   the budget, the users of the atlas should only be told about the
+   new positions once the compaction is finished and the contents of
+   the rectangles should survive the move.
+
+   test_cogl_atlas_pages fills a fixed size atlas page and checks that
+   nothing is moved when it is full so that the caller has to start a
+   new page. It also checks the statistics of the page and that
+   emptying a page by compacting the atlas textures keeps their
+   contents */
+
+#define RECT_SIZE      32
+#define RECT_BYTES     (RECT_SIZE * RECT_SIZE * 4)
+#define N_RECTANGLES   64
+#define COMPACT_BUDGET (RECT_BYTES * 3)
+#define MAX_PAGE_RECTANGLES 4096
+
+/* Size of the textures used to fill the atlas pages. With the border
+   exactly four of them fit in a 512x512 page */
+#define PAGE_TEXTURE_SIZE 254
+#define N_PAGE_TEXTURES   5
+
+/* This is private API exported for the tests. cogl-atlas.h can't be
+   included from outside of Cogl so these have to match the
+   declarations there */
+typedef struct _CoglAtlas CoglAtlas;
+
+#define COGL_ATLAS_FIXED_SIZE (1 << 2)
+
+typedef struct _CoglAtlasStats
+{
+  unsigned int width, height;
+  unsigned int n_rectangles;
+  unsigned int used_space;
+  unsigned int largest_free_space;
+  int occupancy;
+  int fragmentation;
+} CoglAtlasStats;
+
+typedef void
+(* CoglAtlasUpdatePositionCallback) (void *user_data,
+                                     CoglHandle new_texture,
+                                     const CoglRectangleMapEntry *rect);
+
+CoglAtlas *
+_cogl_atlas_new (CoglPixelFormat texture_format,
+                 int flags,
+                 CoglAtlasUpdatePositionCallback update_position_cb);
+
+gboolean
+_cogl_atlas_reserve_space (CoglAtlas *atlas,
+                           unsigned int width,
+                           unsigned int height,
+                           void *user_data);
+
+void
+_cogl_atlas_remove (CoglAtlas *atlas,
+                    const CoglRectangleMapEntry *rectangle);
+
+gboolean
+_cogl_atlas_compact (CoglAtlas *atlas,
+                     unsigned int max_bytes,
+                     unsigned int *bytes_copied_out);
+
+void
+_cogl_atlas_get_stats (CoglAtlas *atlas,
+                       CoglAtlasStats *stats);
+
+gboolean
+_cogl_atlas_texture_compact (unsigned int max_bytes);
+
+void
+_cogl_atlas_texture_add_reorganize_callback (GHookFunc callback,
+                                             void *user_data);
+
+void
+_cogl_atlas_texture_remove_reorganize_callback (GHookFunc callback,
+                                                void *user_data);
+
+typedef struct _TestRectangle
+{
+  CoglRectangleMapEntry position;
+  CoglHandle texture;
+  int n_updates;
+  gboolean removed;
+  guint8 color[4];
+} TestRectangle;
+
+static void
+update_position_cb (void *user_data,
+                    CoglHandle new_texture,
+                    const CoglRectangleMapEntry *rect)
+{
+  TestRectangle *test_rect = user_data;
+
+  test_rect->position = *rect;
+  test_rect->texture = new_texture;
+  test_rect->n_updates++;
+}
+
+static void
+fill_rectangle (TestRectangle *test_rect)
+{
+  guint8 data[RECT_BYTES];
+  int i;
+
+  for (i = 0; i < RECT_SIZE * RECT_SIZE; i++)
+    memcpy (data + i * 4, test_rect->color, 4);
+
+  cogl_texture_set_region (test_rect->texture,
+                           0, 0, /* src_x/y */
+                           test_rect->position.x,
+                           test_rect->position.y,
+                           RECT_SIZE, RECT_SIZE, /* dst_width/height */
+                           RECT_SIZE, RECT_SIZE, /* width/height */
+                           COGL_PIXEL_FORMAT_RGBA_8888,
+                           RECT_SIZE * 4,
+                           data);
+}
+
+static void
+check_rectangles (TestRectangle *rects)
+{
+  CoglHandle texture = COGL_INVALID_HANDLE;
+  guint8 *data = NULL;
+  int tex_width = 0;
+  int i, x, y;
+
+  for (i = 0; i < N_RECTANGLES; i++)
+    {
+      TestRectangle *test_rect = rects + i;
+
+      if (test_rect->removed)
+        continue;
+
+      /* All of the rectangles should be in the same texture */
+      if (data == NULL)
+        {
+          int tex_height;
+
+          texture = test_rect->texture;
+          tex_width = cogl_texture_get_width (texture);
+          tex_height = cogl_texture_get_height (texture);
+          data = g_malloc (tex_width * tex_height * 4);
+          cogl_texture_get_data (texture,
+                                 COGL_PIXEL_FORMAT_RGBA_8888,
+                                 tex_width * 4,
+                                 data);
+        }
+      else
+        g_assert (test_rect->texture == texture);
+
+      for (y = 0; y < RECT_SIZE; y++)
+        for (x = 0; x < RECT_SIZE; x++)
+          {
+            const guint8 *p = (data +
+                               (test_rect->position.y + y) * tex_width * 4 +
+                               (test_rect->position.x + x) * 4);
+
+            g_assert_cmpint (p[0], ==, test_rect->color[0]);
+            g_assert_cmpint (p[1], ==, test_rect->color[1]);
+            g_assert_cmpint (p[2], ==, test_rect->color[2]);
+            g_assert_cmpint (p[3], ==, test_rect->color[3]);
+          }
+    }
+
+  g_free (data);
+}
+
+void
+test_cogl_atlas_compact (TestUtilsGTestFixture *fixture,
+                         void *data)
+{
+  TestRectangle rects[N_RECTANGLES];
+  CoglRectangleMapEntry old_positions[N_RECTANGLES];
+  CoglHandle old_texture;
+  CoglAtlas *atlas;
+  unsigned int bytes_copied, total_bytes_copied = 0;
+  int n_calls = 0, n_moved = 0;
+  gboolean done;
+  int i;
+
+  memset (rects, 0, sizeof (rects));
+
+  atlas = _cogl_atlas_new (COGL_PIXEL_FORMAT_RGBA_8888,
+                           0, /* flags */
+                           update_position_cb);
+
+  for (i = 0; i < N_RECTANGLES; i++)
+    {
+      rects[i].color[0] = i * 4;
+      rects[i].color[1] = 255 - i * 4;
+      rects[i].color[2] = i * 2 + 1;
+      rects[i].color[3] = 255;
+
+      g_assert (_cogl_atlas_reserve_space (atlas,
+                                           RECT_SIZE, RECT_SIZE,
+                                           rects + i));
+    }
+
+  /* The atlas may have been reorganized while reserving so only fill
+     in the rectangles once they have all found their final place */
+  for (i = 0; i < N_RECTANGLES; i++)
+    fill_rectangle (rects + i);
+
+  /* Fragment the atlas */
+  for (i = 1; i < N_RECTANGLES; i += 2)
+    {
+      _cogl_atlas_remove (atlas, &rects[i].position);
+      rects[i].removed = TRUE;
+    }
+
+  old_texture = rects[0].texture;
+
+  for (i = 0; i < N_RECTANGLES; i++)
+    {
+      old_positions[i] = rects[i].position;
+      rects[i].n_updates = 0;
+    }
+
+  do
+    {
+      done = _cogl_atlas_compact (atlas, COMPACT_BUDGET, &bytes_copied);
+      n_calls++;
+
+      if (g_test_verbose ())
+        g_print ("Compaction step %i copied %u bytes\n",
+                 n_calls, bytes_copied);
+
+      g_assert_cmpuint (bytes_copied, <=, COMPACT_BUDGET);
+      total_bytes_copied += bytes_copied;
+
+      if (!done)
+        {
+          /* Every step should make some progress */
+          g_assert_cmpuint (bytes_copied, >, 0);
+
+          /* The users of the atlas shouldn't see anything change
+             until the compaction is finished */
+          for (i = 0; i < N_RECTANGLES; i++)
+            g_assert_cmpint (rects[i].n_updates, ==, 0);
+        }
+
+      g_assert_cmpint (n_calls, <=, N_RECTANGLES);
+    }
+  while (!done);
+
+  /* Only the remaining rectangles should have been copied and it
+     should have taken more than one step */
+  g_assert_cmpuint (total_bytes_copied, ==, N_RECTANGLES / 2 * RECT_BYTES);
+  g_assert_cmpint (n_calls, >, 1);
+
+  /* Every remaining rectangle should have been told about its
+     position in the new texture */
+  for (i = 0; i < N_RECTANGLES; i++)
+    {
+      if (rects[i].removed)
+        {
+          g_assert_cmpint (rects[i].n_updates, ==, 0);
+          continue;
+        }
+
+      g_assert_cmpint (rects[i].n_updates, ==, 1);
+      g_assert (rects[i].texture != old_texture);
+
+      if (rects[i].position.x != old_positions[i].x ||
+          rects[i].position.y != old_positions[i].y)
+        n_moved++;
+    }
+
+  /* Closing the gaps should have moved at least some of them */
+  g_assert_cmpint (n_moved, >, 0);
+
+  check_rectangles (rects);
+
+  cogl_object_unref (atlas);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
+
+static void
+check_full_page (void)
+{
+  TestRectangle *rects = g_new0 (TestRectangle, MAX_PAGE_RECTANGLES);
+  TestRectangle extra_rect;
+  CoglAtlas *atlas, *next_page;
+  CoglAtlasStats stats, full_stats;
+  unsigned int n_rects, n_removed = 0;
+  unsigned int i;
+
+  atlas = _cogl_atlas_new (COGL_PIXEL_FORMAT_RGBA_8888,
+                           COGL_ATLAS_FIXED_SIZE,
+                           update_position_cb);
+
+  /* An empty page doesn't have a size yet */
+  _cogl_atlas_get_stats (atlas, &stats);
+  g_assert_cmpuint (stats.n_rectangles, ==, 0);
+  g_assert_cmpuint (stats.width, ==, 0);
+
+  for (n_rects = 0; n_rects < MAX_PAGE_RECTANGLES; n_rects++)
+    if (!_cogl_atlas_reserve_space (atlas,
+                                    RECT_SIZE, RECT_SIZE,
+                                    rects + n_rects))
+      break;
+
+  /* The page should have filled up before running out of rectangles */
+  g_assert_cmpuint (n_rects, >, 0);
+  g_assert_cmpuint (n_rects, <, MAX_PAGE_RECTANGLES);
+
+  _cogl_atlas_get_stats (atlas, &full_stats);
+
+  if (g_test_verbose ())
+    g_print ("Full page is %ux%u with %u rectangles\n",
+             full_stats.width, full_stats.height, full_stats.n_rectangles);
+
+  g_assert_cmpuint (full_stats.n_rectangles, ==, n_rects);
+  g_assert_cmpuint (full_stats.used_space, ==, n_rects * RECT_SIZE * RECT_SIZE);
+  g_assert_cmpint (full_stats.occupancy,
+                   ==,
+                   (guint64) full_stats.used_space * 100 /
+                   (full_stats.width * full_stats.height));
+  /* The page size is a power of two so the rectangles should cover
+     it exactly */
+  g_assert_cmpint (full_stats.occupancy, ==, 100);
+  g_assert_cmpint (full_stats.fragmentation, ==, 0);
+
+  /* Trying again shouldn't grow or reorganize the page */
+  for (i = 0; i < n_rects; i++)
+    rects[i].n_updates = 0;
+
+  memset (&extra_rect, 0, sizeof (extra_rect));
+  g_assert (!_cogl_atlas_reserve_space (atlas,
+                                        RECT_SIZE, RECT_SIZE,
+                                        &extra_rect));
+
+  _cogl_atlas_get_stats (atlas, &stats);
+  g_assert_cmpuint (stats.width, ==, full_stats.width);
+  g_assert_cmpuint (stats.height, ==, full_stats.height);
+  g_assert_cmpuint (stats.n_rectangles, ==, n_rects);
+
+  /* Instead the caller starts a new page */
+  next_page = _cogl_atlas_new (COGL_PIXEL_FORMAT_RGBA_8888,
+                               COGL_ATLAS_FIXED_SIZE,
+                               update_position_cb);
+  g_assert (_cogl_atlas_reserve_space (next_page,
+                                       RECT_SIZE, RECT_SIZE,
+                                       &extra_rect));
+  g_assert_cmpint (extra_rect.n_updates, ==, 1);
+  g_assert (extra_rect.texture != rects[0].texture);
+
+  _cogl_atlas_get_stats (next_page, &stats);
+  g_assert_cmpuint (stats.n_rectangles, ==, 1);
+
+  /* None of the existing rectangles should have moved */
+  for (i = 0; i < n_rects; i++)
+    g_assert_cmpint (rects[i].n_updates, ==, 0);
+
+  /* Removing every other rectangle leaves lots of small gaps */
+  for (i = 1; i < n_rects; i += 2)
+    {
+      _cogl_atlas_remove (atlas, &rects[i].position);
+      n_removed++;
+    }
+
+  _cogl_atlas_get_stats (atlas, &stats);
+
+  if (g_test_verbose ())
+    g_print ("Fragmented page is %i%% full and %i%% fragmented\n",
+             stats.occupancy, stats.fragmentation);
+
+  g_assert_cmpuint (stats.n_rectangles, ==, n_rects - n_removed);
+  g_assert_cmpuint (stats.used_space,
+                    ==,
+                    (n_rects - n_removed) * RECT_SIZE * RECT_SIZE);
+  g_assert_cmpint (stats.occupancy,
+                   ==,
+                   (guint64) stats.used_space * 100 /
+                   (stats.width * stats.height));
+  g_assert_cmpuint (stats.largest_free_space, >=, RECT_SIZE * RECT_SIZE);
+  g_assert_cmpint (stats.fragmentation, >, 50);
+
+  cogl_object_unref (next_page);
+  cogl_object_unref (atlas);
+  g_free (rects);
+}
+
+static void
+reorganize_cb (void *user_data)
+{
+  int *n_reorganizes = user_data;
+
+  (*n_reorganizes)++;
+}
+
+static CoglHandle
+create_page_texture (int index)
+{
+  guint8 *data = g_malloc (PAGE_TEXTURE_SIZE * PAGE_TEXTURE_SIZE * 4);
+  CoglHandle texture;
+  int i;
+
+  for (i = 0; i < PAGE_TEXTURE_SIZE * PAGE_TEXTURE_SIZE; i++)
+    {
+      data[i * 4 + 0] = index * 50;
+      data[i * 4 + 1] = 255 - index * 50;
+      data[i * 4 + 2] = i % PAGE_TEXTURE_SIZE;
+      data[i * 4 + 3] = 255;
+    }
+
+  /* Without any flags the texture will be put in an atlas */
+  texture = cogl_texture_new_from_data (PAGE_TEXTURE_SIZE,
+                                        PAGE_TEXTURE_SIZE,
+                                        COGL_TEXTURE_NONE,
+                                        COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                        COGL_PIXEL_FORMAT_ANY,
+                                        PAGE_TEXTURE_SIZE * 4,
+                                        data);
+
+  g_free (data);
+
+  return texture;
+}
+
+static void
+check_page_texture (CoglHandle texture, int index)
+{
+  guint8 *data = g_malloc (PAGE_TEXTURE_SIZE * PAGE_TEXTURE_SIZE * 4);
+  int i;
+
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                         PAGE_TEXTURE_SIZE * 4,
+                         data);
+
+  for (i = 0; i < PAGE_TEXTURE_SIZE * PAGE_TEXTURE_SIZE; i++)
+    {
+      g_assert_cmpint (data[i * 4 + 0], ==, index * 50);
+      g_assert_cmpint (data[i * 4 + 1], ==, 255 - index * 50);
+      g_assert_cmpint (data[i * 4 + 2], ==, i % PAGE_TEXTURE_SIZE);
+      g_assert_cmpint (data[i * 4 + 3], ==, 255);
+    }
+
+  g_free (data);
+}
+
+static void
+check_compact_pages (void)
+{
+  CoglHandle textures[N_PAGE_TEXTURES];
+  int n_reorganizes = 0;
+  int i;
+
+  _cogl_atlas_texture_add_reorganize_callback (reorganize_cb,
+                                               &n_reorganizes);
+
+  /* The first four textures fill the first page so the last one has
+     to start a second page */
+  for (i = 0; i < N_PAGE_TEXTURES; i++)
+    textures[i] = create_page_texture (i);
+
+  /* Starting the second page shouldn't have moved anything */
+  g_assert_cmpint (n_reorganizes, ==, 0);
+
+  /* Make some space in the first page. The second page is now the
+     least used and its texture fits in the first page */
+  cogl_handle_unref (textures[0]);
+  cogl_handle_unref (textures[1]);
+
+  while (_cogl_atlas_texture_compact (G_MAXUINT))
+    ;
+
+  if (g_test_verbose ())
+    g_print ("Compacting the pages reorganized the atlas %i times\n",
+             n_reorganizes);
+
+  /* The texture in the second page should have been moved */
+  g_assert_cmpint (n_reorganizes, >, 0);
+
+  /* Everything is in one page now so there is nothing left to do */
+  g_assert (!_cogl_atlas_texture_compact (G_MAXUINT));
+
+  for (i = 2; i < N_PAGE_TEXTURES; i++)
+    {
+      check_page_texture (textures[i], i);
+      cogl_handle_unref (textures[i]);
+    }
+
+  _cogl_atlas_texture_remove_reorganize_callback (reorganize_cb,
+                                                  &n_reorganizes);
+}
+
+void
+test_cogl_atlas_pages (TestUtilsGTestFixture *fixture,
+                       void *data)
+{
+  /* The mode is only read when the first atlas texture is created
+     and each test runs in a new process so it is safe to set it
+     here */
+  g_setenv ("COGL_ATLAS_MODE", "pages", TRUE);
+
+  check_full_page ();
+
+  if (cogl_features_available (COGL_FEATURE_OFFSCREEN))
+    check_compact_pages ();
+  else if (g_test_verbose ())
+    g_print ("Skipping the atlas texture pages because FBOs "
+             "aren't available\n");
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
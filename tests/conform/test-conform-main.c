@@ -76,6 +76,29 @@ static TestUtilsSharedState *shared_state = NULL;
 	      (void *)(FUNC),                                           \
 	      test_utils_fini);    } G_STMT_END
 
+/* This is the same as ADD_TEST except that the test is run with the
+ * ARBfp and fixed function fragends disabled so that it exercises the
+ * GLSL fragend */
+#define ADD_GLSL_FRAGEND_TEST(NAMESPACE, FUNC)     G_STMT_START {          \
+  extern void FUNC (TestUtilsGTestFixture *, void *);                      \
+  g_test_add ("/conform" NAMESPACE "/" #FUNC,                              \
+              TestUtilsGTestFixture,                                       \
+              shared_state, /* data argument for test */                   \
+              test_utils_init_glsl_fragend,                                \
+              (void *)(FUNC),                                              \
+              test_utils_fini);    } G_STMT_END
+
+/* This is the same as ADD_TEST except that the test is run with NPOT
+ * textures disabled so that textures have to be sliced */
+#define ADD_DISABLE_NPOT_TEST(NAMESPACE, FUNC)     G_STMT_START {          \
+  extern void FUNC (TestUtilsGTestFixture *, void *);                      \
+  g_test_add ("/conform" NAMESPACE "/" #FUNC,                              \
+              TestUtilsGTestFixture,                                       \
+              shared_state, /* data argument for test */                   \
+              test_utils_init_disable_npot,                                \
+              (void *)(FUNC),                                              \
+              test_utils_fini);    } G_STMT_END
+
 /* this is a macro that conditionally executes a test if CONDITION
  * evaluates to TRUE; otherwise, it will put the test under the
  * "/skip" namespace and execute a dummy function that will always
@@ -112,6 +135,10 @@ clutter_test_get_data_file (const gchar *filename)
 int
 main (int argc, char **argv)
 {
+  /* Some of the tests check work that Cogl does on worker threads */
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+
   g_test_init (&argc, &argv, NULL);
 
   g_test_bug_base ("http://bugzilla.gnome.org/show_bug.cgi?id=%s");
@@ -141,7 +168,28 @@ main (int argc, char **argv)
   ADD_TEST ("/cogl", test_cogl_depth_test);
   ADD_TEST ("/cogl", test_cogl_color_mask);
   ADD_TEST ("/cogl", test_cogl_backface_culling);
+  ADD_GLSL_FRAGEND_TEST ("/cogl", test_cogl_shader_templates);
+  ADD_TEST ("/cogl", test_cogl_memory_usage);
+  ADD_GLSL_FRAGEND_TEST ("/cogl", test_cogl_texture_unit_remap);
+  ADD_TEST ("/cogl", test_cogl_atlas_compact);
+  ADD_TEST ("/cogl", test_cogl_atlas_pages);
+
+#ifdef HAVE_COGL_PANGO
+  ADD_TEST ("/cogl-pango", test_cogl_pango_sdf);
+  ADD_TEST ("/cogl-pango", test_cogl_pango_glyph_cache_budget);
+  ADD_TEST ("/cogl-pango", test_cogl_pango_layout_cache);
+#endif
 
+  ADD_TEST ("/cogl/texture", test_cogl_texture_download);
+  ADD_TEST ("/cogl/texture", test_cogl_texture_stream);
+  ADD_TEST ("/cogl/texture", test_cogl_texture_compressed);
+  ADD_TEST ("/cogl/texture", test_cogl_texture_cpu_mipmap);
+  ADD_TEST ("/cogl/texture", test_cogl_texture_file_stream);
+  ADD_TEST ("/cogl/texture", test_cogl_texture_load);
+  ADD_DISABLE_NPOT_TEST ("/cogl/texture", test_cogl_texture_sliced_upload);
+#ifdef COGL_HAS_XLIB
+  ADD_TEST ("/cogl/texture", test_cogl_texture_pixmap_x11_damage);
+#endif
   UNPORTED_TEST ("/cogl/texture", test_cogl_npot_texture);
   UNPORTED_TEST ("/cogl/texture", test_cogl_multitexture);
   UNPORTED_TEST ("/cogl/texture", test_cogl_texture_mipmaps);
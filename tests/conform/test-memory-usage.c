@@ -0,0 +1,114 @@
+#include <cogl/cogl.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Creates some textures and checks that the memory usage of the
+   context follows them and that the budget callback is only called
+   when the usage first goes over the budget */
+
+#define TEXTURE_SIZE 64
+#define TEXTURE_BYTES (TEXTURE_SIZE * TEXTURE_SIZE * 4)
+
+typedef struct _TestState
+{
+  CoglContext *ctx;
+  int n_callbacks;
+  gsize last_usage;
+} TestState;
+
+static void
+budget_cb (CoglContext *context,
+           gsize usage,
+           gsize budget,
+           void *user_data)
+{
+  TestState *state = user_data;
+
+  g_assert (context == state->ctx);
+  g_assert_cmpuint (usage, >, budget);
+
+  state->n_callbacks++;
+  state->last_usage = usage;
+}
+
+static CoglTexture2D *
+create_texture (CoglContext *ctx)
+{
+  GError *error = NULL;
+  CoglTexture2D *tex;
+
+  tex = cogl_texture_2d_new_with_size (ctx,
+                                       TEXTURE_SIZE, TEXTURE_SIZE,
+                                       COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                       &error);
+  g_assert_no_error (error);
+  g_assert (tex != NULL);
+
+  return tex;
+}
+
+void
+test_cogl_memory_usage (TestUtilsGTestFixture *fixture,
+                        void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  CoglContext *ctx = shared_state->ctx;
+  gsize base_usage, base_total;
+  CoglTexture2D *tex1, *tex2, *tex3;
+  TestState state;
+
+  memset (&state, 0, sizeof (state));
+  state.ctx = ctx;
+
+  base_usage =
+    cogl_context_get_memory_usage (ctx, COGL_MEMORY_CATEGORY_TEXTURE_2D);
+  base_total = cogl_context_get_total_memory_usage (ctx);
+
+  tex1 = create_texture (ctx);
+
+  g_assert_cmpuint (cogl_context_get_memory_usage
+                    (ctx, COGL_MEMORY_CATEGORY_TEXTURE_2D),
+                    ==,
+                    base_usage + TEXTURE_BYTES);
+  g_assert_cmpuint (cogl_context_get_total_memory_usage (ctx),
+                    ==,
+                    base_total + TEXTURE_BYTES);
+
+  /* The next texture should take the usage over the budget */
+  cogl_context_set_memory_budget (ctx,
+                                  base_total + TEXTURE_BYTES + 1,
+                                  budget_cb,
+                                  &state);
+  g_assert_cmpuint (cogl_context_get_memory_budget (ctx),
+                    ==,
+                    base_total + TEXTURE_BYTES + 1);
+
+  tex2 = create_texture (ctx);
+
+  g_assert_cmpint (state.n_callbacks, ==, 1);
+  g_assert_cmpuint (state.last_usage, ==, base_total + TEXTURE_BYTES * 2);
+
+  /* Staying over the budget shouldn't call it again */
+  tex3 = create_texture (ctx);
+
+  g_assert_cmpint (state.n_callbacks, ==, 1);
+
+  cogl_object_unref (tex3);
+  cogl_object_unref (tex2);
+  cogl_object_unref (tex1);
+
+  g_assert_cmpuint (cogl_context_get_memory_usage
+                    (ctx, COGL_MEMORY_CATEGORY_TEXTURE_2D),
+                    ==,
+                    base_usage);
+  g_assert_cmpuint (cogl_context_get_total_memory_usage (ctx),
+                    ==,
+                    base_total);
+
+  cogl_context_set_memory_budget (ctx, 0, NULL, NULL);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
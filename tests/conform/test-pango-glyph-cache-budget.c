@@ -0,0 +1,97 @@
+#include <cogl/cogl.h>
+#include <cogl-pango/cogl-pango.h>
+
+#include "test-utils.h"
+
+/* Fills the cache without mipmapping, sets the budget to exactly
+   that much memory and then draws the same text with mipmapping. The
+   mipmapped glyphs are stored in a separate cache but the budget
+   covers both so the glyphs without mipmapping should be evicted to
+   make room for them */
+
+#define TEXT "abcdefghijklmnopqrstuvwxyz"
+#define TEXT_SIZE 32
+
+static void
+draw_text (CoglPangoFontMap *font_map,
+           gboolean use_mipmapping)
+{
+  PangoContext *context;
+  PangoLayout *layout;
+  PangoFontDescription *font_desc;
+  CoglColor color;
+  guint8 pixel[4];
+
+  cogl_pango_font_map_set_use_mipmapping (font_map, use_mipmapping);
+
+  context = cogl_pango_font_map_create_context (font_map);
+  layout = pango_layout_new (context);
+
+  font_desc = pango_font_description_from_string ("Sans");
+  pango_font_description_set_absolute_size (font_desc,
+                                            TEXT_SIZE * PANGO_SCALE);
+  pango_layout_set_font_description (layout, font_desc);
+  pango_font_description_free (font_desc);
+
+  pango_layout_set_text (layout, TEXT, -1);
+
+  cogl_color_init_from_4ub (&color, 0xff, 0xff, 0xff, 0xff);
+  cogl_pango_render_layout (layout, 0, 0, &color, 0);
+
+  /* Reading a pixel flushes the journal so that the space of any
+     evicted glyphs can be reused the next time text is drawn */
+  cogl_read_pixels (0, 0, 1, 1,
+                    COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                    pixel);
+
+  /* Destroying the layout also destroys its display list so its
+     glyphs can be evicted */
+  g_object_unref (layout);
+  g_object_unref (context);
+}
+
+void
+test_cogl_pango_glyph_cache_budget (TestUtilsGTestFixture *fixture,
+                                    void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  CoglPangoFontMap *font_map;
+  int width = cogl_framebuffer_get_width (shared_state->fb);
+  int height = cogl_framebuffer_get_height (shared_state->fb);
+  gsize budget;
+
+  cogl_ortho (0, width, /* left, right */
+              height, 0, /* bottom, top */
+              -1, 100 /* z near, far */);
+
+  font_map = COGL_PANGO_FONT_MAP (cogl_pango_font_map_new ());
+
+  draw_text (font_map, FALSE);
+
+  budget = cogl_pango_font_map_get_glyph_cache_usage (font_map);
+  g_assert_cmpuint (budget, >, 0);
+
+  cogl_pango_font_map_set_glyph_cache_budget (font_map, budget);
+  g_assert_cmpuint (cogl_pango_font_map_get_glyph_cache_budget (font_map),
+                    ==,
+                    budget);
+
+  draw_text (font_map, TRUE);
+  /* Drawing again frees the glyphs that were evicted */
+  draw_text (font_map, TRUE);
+
+  if (g_test_verbose ())
+    g_print ("budget %" G_GSIZE_FORMAT ", usage %" G_GSIZE_FORMAT "\n",
+             budget,
+             cogl_pango_font_map_get_glyph_cache_usage (font_map));
+
+  g_assert_cmpuint (cogl_pango_font_map_get_glyph_cache_usage (font_map),
+                    <=,
+                    budget);
+
+  g_object_unref (font_map);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
@@ -0,0 +1,156 @@
+#include <cogl/cogl.h>
+#include <cogl-pango/cogl-pango.h>
+
+#include "test-utils.h"
+
+/* Draws a layout whose lines are positioned at fractions of a pixel
+   using the display lists cached on the layout and then draws each
+   line again without any caching. The indent moves the first line
+   and the spacing moves the lines after it so that the lines are
+   matched up with the lines cached for the previous offset. The two
+   results should be exactly the same */
+
+#define TEXT "Cogl\nPango\nlayout"
+#define RENDER_WIDTH  200
+#define RENDER_HEIGHT 100
+
+static void
+clear (void)
+{
+  cogl_set_source_color4ub (0x00, 0x00, 0x00, 0xff);
+  cogl_rectangle (0, 0, RENDER_WIDTH, RENDER_HEIGHT);
+}
+
+static guint8 *
+read_pixels (void)
+{
+  guint8 *pixels = g_malloc (RENDER_WIDTH * RENDER_HEIGHT * 4);
+
+  cogl_read_pixels (0, 0, RENDER_WIDTH, RENDER_HEIGHT,
+                    COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                    pixels);
+
+  return pixels;
+}
+
+static guint8 *
+draw_cached (PangoLayout *layout)
+{
+  CoglColor color;
+
+  clear ();
+
+  cogl_color_init_from_4ub (&color, 0xff, 0xff, 0xff, 0xff);
+  cogl_pango_render_layout (layout, 4, 4, &color, 0);
+
+  return read_pixels ();
+}
+
+static guint8 *
+draw_uncached (PangoLayout *layout)
+{
+  PangoLayoutIter *iter;
+  CoglColor color;
+
+  clear ();
+
+  cogl_color_init_from_4ub (&color, 0xff, 0xff, 0xff, 0xff);
+
+  cogl_push_matrix ();
+  cogl_translate (4, 4, 0);
+
+  /* This positions the lines the same way as
+     pango_renderer_draw_layout */
+  iter = pango_layout_get_iter (layout);
+  do
+    {
+      PangoLayoutLine *line = pango_layout_iter_get_line_readonly (iter);
+      PangoRectangle logical_rect;
+
+      pango_layout_iter_get_line_extents (iter, NULL, &logical_rect);
+      cogl_pango_render_layout_line (line,
+                                     logical_rect.x,
+                                     pango_layout_iter_get_baseline (iter),
+                                     &color);
+    }
+  while (pango_layout_iter_next_line (iter));
+  pango_layout_iter_free (iter);
+
+  cogl_pop_matrix ();
+
+  return read_pixels ();
+}
+
+static void
+compare_offset (PangoLayout *layout,
+                int offset)
+{
+  guint8 *cached_pixels, *uncached_pixels;
+  int i;
+
+  pango_layout_set_indent (layout, offset);
+  pango_layout_set_spacing (layout, offset);
+
+  cached_pixels = draw_cached (layout);
+  uncached_pixels = draw_uncached (layout);
+
+  if (g_test_verbose ())
+    g_print ("offset %i/%i\n", offset, PANGO_SCALE);
+
+  for (i = 0; i < RENDER_WIDTH * RENDER_HEIGHT * 4; i++)
+    if (cached_pixels[i] != uncached_pixels[i])
+      {
+        g_printerr ("Pixel %i,%i differs at offset %i/%i\n",
+                    i / 4 % RENDER_WIDTH, i / 4 / RENDER_WIDTH,
+                    offset, PANGO_SCALE);
+        g_assert_not_reached ();
+      }
+
+  g_free (cached_pixels);
+  g_free (uncached_pixels);
+}
+
+void
+test_cogl_pango_layout_cache (TestUtilsGTestFixture *fixture,
+                              void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  CoglPangoFontMap *font_map;
+  PangoContext *context;
+  PangoLayout *layout;
+  PangoFontDescription *font_desc;
+  int width = cogl_framebuffer_get_width (shared_state->fb);
+  int height = cogl_framebuffer_get_height (shared_state->fb);
+
+  cogl_ortho (0, width, /* left, right */
+              height, 0, /* bottom, top */
+              -1, 100 /* z near, far */);
+
+  font_map = COGL_PANGO_FONT_MAP (cogl_pango_font_map_new ());
+  context = cogl_pango_font_map_create_context (font_map);
+  layout = pango_layout_new (context);
+
+  font_desc = pango_font_description_from_string ("Sans");
+  pango_font_description_set_absolute_size (font_desc, 16 * PANGO_SCALE);
+  pango_layout_set_font_description (layout, font_desc);
+  pango_font_description_free (font_desc);
+
+  pango_layout_set_text (layout, TEXT, -1);
+
+  /* Each offset is drawn after the previous one so the cached lines
+     get reused where they can be. Half a pixel is where the rounding
+     changes */
+  compare_offset (layout, 0);
+  compare_offset (layout, PANGO_SCALE / 4);
+  compare_offset (layout, PANGO_SCALE / 2);
+  compare_offset (layout, PANGO_SCALE * 3 / 4);
+  compare_offset (layout, PANGO_SCALE + PANGO_SCALE / 3);
+
+  g_object_unref (layout);
+  g_object_unref (context);
+  g_object_unref (font_map);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
@@ -0,0 +1,179 @@
+#include <cogl/cogl.h>
+#include <cogl-pango/cogl-pango.h>
+
+#include <stdlib.h>
+
+#include "test-utils.h"
+
+/* Draws the same text with the normal glyphs and with the signed
+   distance field glyphs at a few sizes and checks that the results
+   are close. The distance field glyphs are unhinted and come from a
+   single reference size so they can't be exactly the same. The
+   oblique text is drawn after the upright text of the same face to
+   check that the two don't share the same distance fields */
+
+#define TEXT "Cogl Pango"
+#define RENDER_WIDTH  320
+#define RENDER_HEIGHT 80
+
+/* Maximum difference in coverage for each fully inked pixel and
+   maximum difference in total coverage as a fraction. The edges of
+   unhinted glyphs can move by a fraction of a pixel so the first
+   can't be too small, but moving the text by MISPLACED_OFFSET pixels
+   must be enough to go over it (see compare_sizes) */
+#define MAX_MEAN_DIFFERENCE 64
+#define MAX_INK_DIFFERENCE  0.08
+#define MISPLACED_OFFSET    2
+
+static guint8 *
+draw_text (CoglPangoFontMap *font_map,
+           gboolean use_sdf,
+           int size,
+           PangoStyle style,
+           int x_offset)
+{
+  PangoContext *context;
+  PangoLayout *layout;
+  PangoFontDescription *font_desc;
+  CoglColor color;
+  guint8 *pixels = g_malloc (RENDER_WIDTH * RENDER_HEIGHT * 4);
+
+  cogl_pango_font_map_set_use_sdf (font_map, use_sdf);
+
+  context = cogl_pango_font_map_create_context (font_map);
+  layout = pango_layout_new (context);
+
+  font_desc = pango_font_description_from_string ("Sans");
+  pango_font_description_set_absolute_size (font_desc, size * PANGO_SCALE);
+  pango_font_description_set_style (font_desc, style);
+  pango_layout_set_font_description (layout, font_desc);
+  pango_font_description_free (font_desc);
+
+  pango_layout_set_text (layout, TEXT, -1);
+
+  cogl_set_source_color4ub (0x00, 0x00, 0x00, 0xff);
+  cogl_rectangle (0, 0, RENDER_WIDTH, RENDER_HEIGHT);
+
+  cogl_color_init_from_4ub (&color, 0xff, 0xff, 0xff, 0xff);
+  cogl_pango_render_layout (layout, 4 + x_offset, 4, &color, 0);
+
+  cogl_read_pixels (0, 0, RENDER_WIDTH, RENDER_HEIGHT,
+                    COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                    pixels);
+
+  g_object_unref (layout);
+  g_object_unref (context);
+
+  return pixels;
+}
+
+/* Returns the difference in coverage between the two images for
+   each fully inked pixel of the first one. Only the pixels near the
+   text can differ so the difference is measured relative to the
+   number of pixels that were inked */
+static int
+get_mean_difference (const guint8 *a_pixels,
+                     const guint8 *b_pixels,
+                     int *a_ink,
+                     int *b_ink)
+{
+  int total_difference = 0;
+  int i;
+
+  *a_ink = 0;
+  *b_ink = 0;
+
+  /* The text is white on black so the red channel is the coverage */
+  for (i = 0; i < RENDER_WIDTH * RENDER_HEIGHT; i++)
+    {
+      int a_value = a_pixels[i * 4];
+      int b_value = b_pixels[i * 4];
+
+      total_difference += abs (a_value - b_value);
+      *a_ink += a_value;
+      *b_ink += b_value;
+    }
+
+  return total_difference / MAX (*a_ink / 255, 1);
+}
+
+static void
+compare_sizes (CoglPangoFontMap *font_map,
+               int size,
+               PangoStyle style)
+{
+  guint8 *bitmap_pixels, *sdf_pixels, *misplaced_pixels;
+  int bitmap_ink, sdf_ink, misplaced_ink;
+  int mean_difference, misplaced_difference;
+
+  bitmap_pixels = draw_text (font_map, FALSE, size, style, 0);
+  sdf_pixels = draw_text (font_map, TRUE, size, style, 0);
+  misplaced_pixels = draw_text (font_map, FALSE, size, style,
+                                MISPLACED_OFFSET);
+
+  mean_difference = get_mean_difference (bitmap_pixels, sdf_pixels,
+                                         &bitmap_ink, &sdf_ink);
+  misplaced_difference = get_mean_difference (bitmap_pixels,
+                                              misplaced_pixels,
+                                              &bitmap_ink, &misplaced_ink);
+
+  if (g_test_verbose ())
+    g_print ("size %i%s: ink %i vs %i, mean difference %i "
+             "(%i when misplaced)\n",
+             size, style == PANGO_STYLE_NORMAL ? "" : " oblique",
+             bitmap_ink, sdf_ink,
+             mean_difference, misplaced_difference);
+
+  /* Make sure something was actually drawn */
+  g_assert_cmpint (bitmap_ink, >, 0);
+  g_assert_cmpint (sdf_ink, >, 0);
+
+  /* Check that the threshold is tight enough to notice text that is
+     in the wrong place */
+  g_assert_cmpint (misplaced_difference, >, MAX_MEAN_DIFFERENCE);
+
+  g_assert_cmpint (mean_difference, <=, MAX_MEAN_DIFFERENCE);
+  g_assert_cmpfloat (ABS (bitmap_ink - sdf_ink) / (double) bitmap_ink,
+                     <=,
+                     MAX_INK_DIFFERENCE);
+
+  g_free (bitmap_pixels);
+  g_free (sdf_pixels);
+  g_free (misplaced_pixels);
+}
+
+void
+test_cogl_pango_sdf (TestUtilsGTestFixture *fixture,
+                     void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  CoglPangoFontMap *font_map;
+  int width = cogl_framebuffer_get_width (shared_state->fb);
+  int height = cogl_framebuffer_get_height (shared_state->fb);
+
+  cogl_ortho (0, width, /* left, right */
+              height, 0, /* bottom, top */
+              -1, 100 /* z near, far */);
+
+  font_map = COGL_PANGO_FONT_MAP (cogl_pango_font_map_new ());
+
+  cogl_pango_font_map_set_use_sdf (font_map, TRUE);
+
+  if (cogl_pango_font_map_get_use_sdf (font_map))
+    {
+      /* One size smaller than the reference size, one the same and
+         one larger to check that the glyphs scale both ways */
+      compare_sizes (font_map, 24, PANGO_STYLE_NORMAL);
+      compare_sizes (font_map, 48, PANGO_STYLE_NORMAL);
+      compare_sizes (font_map, 64, PANGO_STYLE_NORMAL);
+      compare_sizes (font_map, 48, PANGO_STYLE_OBLIQUE);
+    }
+  else if (g_test_verbose ())
+    g_print ("Skipping because distance field glyphs aren't supported\n");
+
+  g_object_unref (font_map);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
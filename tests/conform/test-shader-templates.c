@@ -0,0 +1,174 @@
+#include <cogl/cogl.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* The GLSL fragend uses hand written shaders for a few common single
+   layer pipelines. This test draws each of those pipelines next to an
+   equivalent pipeline that has to go through the generic code
+   generation and checks that the results are exactly the same. It is
+   run with the other fragends disabled so that both columns really
+   come from the GLSL fragend */
+
+#define TEXTURE_SIZE 4
+#define RENDER_SIZE  32
+
+typedef struct _TestState
+{
+  CoglHandle rgba_texture;
+  CoglHandle alpha_texture;
+} TestState;
+
+static CoglPipeline *
+create_pipeline (CoglHandle texture,
+                 const char *combine)
+{
+  CoglPipeline *pipeline = cogl_pipeline_new ();
+
+  cogl_pipeline_set_color4ub (pipeline, 0x80, 0x40, 0x20, 0x80);
+
+  if (texture)
+    {
+      cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+      cogl_pipeline_set_layer_filters (pipeline, 0,
+                                       COGL_PIPELINE_FILTER_NEAREST,
+                                       COGL_PIPELINE_FILTER_NEAREST);
+    }
+
+  if (combine)
+    {
+      CoglColor white;
+
+      cogl_color_init_from_4ub (&white, 0xff, 0xff, 0xff, 0xff);
+      cogl_pipeline_set_layer_combine_constant (pipeline, 0, &white);
+      cogl_pipeline_set_layer_combine (pipeline, 0, combine, NULL);
+    }
+
+  return pipeline;
+}
+
+static guint8 *
+draw_and_read (CoglPipeline *pipeline, int x)
+{
+  guint8 *pixels = g_malloc (RENDER_SIZE * RENDER_SIZE * 4);
+
+  cogl_set_source (pipeline);
+  cogl_rectangle (x, 0, x + RENDER_SIZE, RENDER_SIZE);
+
+  cogl_read_pixels (x, 0, RENDER_SIZE, RENDER_SIZE,
+                    COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                    pixels);
+
+  cogl_object_unref (pipeline);
+
+  return pixels;
+}
+
+static void
+compare_pipelines (CoglPipeline *template_pipeline,
+                   CoglPipeline *generic_pipeline,
+                   int column)
+{
+  guint8 *template_pixels, *generic_pixels;
+
+  template_pixels = draw_and_read (template_pipeline,
+                                   column * RENDER_SIZE * 2);
+  generic_pixels = draw_and_read (generic_pipeline,
+                                  column * RENDER_SIZE * 2 + RENDER_SIZE);
+
+  g_assert (memcmp (template_pixels, generic_pixels,
+                    RENDER_SIZE * RENDER_SIZE * 4) == 0);
+
+  g_free (template_pixels);
+  g_free (generic_pixels);
+}
+
+static CoglHandle
+make_texture (CoglPixelFormat format, int bpp)
+{
+  guint8 *data = g_malloc (TEXTURE_SIZE * TEXTURE_SIZE * bpp);
+  CoglHandle texture;
+  int i;
+
+  /* Use a different value for every byte so that swizzling mistakes
+     will show up */
+  for (i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE * bpp; i++)
+    data[i] = i * 255 / (TEXTURE_SIZE * TEXTURE_SIZE * bpp);
+
+  texture = cogl_texture_new_from_data (TEXTURE_SIZE, TEXTURE_SIZE,
+                                        COGL_TEXTURE_NO_ATLAS,
+                                        format,
+                                        COGL_PIXEL_FORMAT_ANY,
+                                        TEXTURE_SIZE * bpp,
+                                        data);
+
+  g_free (data);
+
+  return texture;
+}
+
+static void
+paint (TestState *state)
+{
+  /* color only */
+  compare_pipelines (create_pipeline (COGL_INVALID_HANDLE, NULL),
+                     create_pipeline (state->rgba_texture,
+                                      "RGBA = REPLACE (PRIMARY)"),
+                     0);
+
+  /* texture * color */
+  compare_pipelines (create_pipeline (state->rgba_texture, NULL),
+                     create_pipeline (state->rgba_texture,
+                                      "RGBA = MODULATE (TEXTURE, PRIMARY)"),
+                     1);
+
+  /* texture only */
+  compare_pipelines (create_pipeline (state->rgba_texture,
+                                      "RGBA = REPLACE (TEXTURE)"),
+                     create_pipeline (state->rgba_texture,
+                                      "RGBA = MODULATE (TEXTURE, CONSTANT)"),
+                     2);
+
+  /* A8 glyph * color */
+  compare_pipelines (create_pipeline (state->alpha_texture,
+                                      "RGBA = MODULATE (PREVIOUS, "
+                                      "TEXTURE[A])"),
+                     create_pipeline (state->alpha_texture,
+                                      "RGBA = MODULATE (PRIMARY, "
+                                      "TEXTURE[A])"),
+                     3);
+}
+
+void
+test_cogl_shader_templates (TestUtilsGTestFixture *fixture,
+                            void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  TestState state;
+  int width = cogl_framebuffer_get_width (shared_state->fb);
+  int height = cogl_framebuffer_get_height (shared_state->fb);
+
+  if (!cogl_features_available (COGL_FEATURE_SHADERS_GLSL))
+    {
+      if (g_test_verbose ())
+        g_print ("Skipping because GLSL isn't available\n");
+      return;
+    }
+
+  cogl_ortho (0, width, /* left, right */
+              height, 0, /* bottom, top */
+              -1, 100 /* z near, far */);
+
+  state.rgba_texture = make_texture (COGL_PIXEL_FORMAT_RGBA_8888_PRE, 4);
+  state.alpha_texture = make_texture (COGL_PIXEL_FORMAT_A_8, 1);
+
+  paint (&state);
+
+  cogl_handle_unref (state.rgba_texture);
+  cogl_handle_unref (state.alpha_texture);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
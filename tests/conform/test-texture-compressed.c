@@ -0,0 +1,227 @@
+#include <cogl/cogl.h>
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Loads single 4x4 blocks from KTX files and from a DDS file and
+   checks the decoded pixels. This works whether the driver supports
+   the formats or they are decompressed by Cogl */
+
+#define BLOCK_SIZE 4
+
+/* An ETC1 block in individual mode with red on the left half and blue
+   on the right. Every pixel uses the smallest positive modifier */
+static const guint8 etc1_block[] =
+  { 0xf0, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+/* A DXT1 block with red in the top two rows and blue in the bottom
+   two */
+static const guint8 dxt1_block[] =
+  { 0x00, 0xf8, 0x1f, 0x00, 0x00, 0x00, 0x55, 0x55 };
+
+/* A DXT1 block in the three color mode with blue in the top two rows
+   and the fourth color in the bottom two. The fourth color is black
+   and it should only be transparent when the format has alpha */
+static const guint8 dxt1_black_block[] =
+  { 0x1f, 0x00, 0x00, 0xf8, 0x00, 0x00, 0xff, 0xff };
+
+/* Both of the blocks stored in KTX files are the same size */
+static char *
+write_ktx_file (guint32 gl_internal_format,
+                const guint8 *block)
+{
+  static const guint8 identifier[] =
+    { 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
+  guint8 data[64 + 4 + sizeof (etc1_block)];
+  guint32 header[] =
+    {
+      0x04030201, /* endianness */
+      0, /* glType */
+      1, /* glTypeSize */
+      0, /* glFormat */
+      gl_internal_format, /* glInternalFormat */
+      0x1907, /* glBaseInternalFormat = GL_RGB */
+      BLOCK_SIZE, BLOCK_SIZE, /* width, height */
+      0, /* depth */
+      0, /* number of array elements */
+      1, /* number of faces */
+      1, /* number of mipmap levels */
+      0 /* bytes of key value data */
+    };
+  int i;
+
+  memcpy (data, identifier, sizeof (identifier));
+  for (i = 0; i < G_N_ELEMENTS (header); i++)
+    test_utils_write_uint32 (data + sizeof (identifier) + i * 4, header[i]);
+  test_utils_write_uint32 (data + 64, sizeof (etc1_block));
+  memcpy (data + 64 + 4, block, sizeof (etc1_block));
+
+  return test_utils_write_temp_file ("cogl-test-XXXXXX.ktx",
+                                     data, sizeof (data));
+}
+
+static char *
+write_dds_file (void)
+{
+  guint8 data[128 + sizeof (dxt1_block)];
+
+  memset (data, 0, sizeof (data));
+  memcpy (data, "DDS ", 4);
+  test_utils_write_uint32 (data + 4, 124); /* header size */
+  /* caps, height, width and format */
+  test_utils_write_uint32 (data + 8, 0x1007);
+  test_utils_write_uint32 (data + 12, BLOCK_SIZE); /* height */
+  test_utils_write_uint32 (data + 16, BLOCK_SIZE); /* width */
+  test_utils_write_uint32 (data + 76, 32); /* pixel format size */
+  test_utils_write_uint32 (data + 80, 0x4); /* DDPF_FOURCC */
+  memcpy (data + 84, "DXT1", 4);
+  memcpy (data + 128, dxt1_block, sizeof (dxt1_block));
+
+  return test_utils_write_temp_file ("cogl-test-XXXXXX.dds",
+                                     data, sizeof (data));
+}
+
+static void
+check_pixel_with_alpha (const guint8 *p,
+                        guint8 r, guint8 g, guint8 b, guint8 a)
+{
+  if (g_test_verbose ())
+    g_print ("  0x%02x%02x%02x%02x\n", p[0], p[1], p[2], p[3]);
+
+  g_assert_cmpint (p[0], ==, r);
+  g_assert_cmpint (p[1], ==, g);
+  g_assert_cmpint (p[2], ==, b);
+  g_assert_cmpint (p[3], ==, a);
+}
+
+static void
+check_pixel (const guint8 *p,
+             guint8 r, guint8 g, guint8 b)
+{
+  check_pixel_with_alpha (p, r, g, b, 255);
+}
+
+static CoglHandle
+load_texture (const char *filename)
+{
+  GError *error = NULL;
+  CoglHandle texture;
+
+  texture = cogl_texture_new_from_file (filename,
+                                        COGL_TEXTURE_NO_ATLAS,
+                                        COGL_PIXEL_FORMAT_ANY,
+                                        &error);
+  g_assert_no_error (error);
+  g_assert (texture != COGL_INVALID_HANDLE);
+
+  g_assert_cmpint (cogl_texture_get_width (texture), ==, BLOCK_SIZE);
+  g_assert_cmpint (cogl_texture_get_height (texture), ==, BLOCK_SIZE);
+
+  return texture;
+}
+
+static void
+test_etc1 (void)
+{
+  guint8 pixels[BLOCK_SIZE * BLOCK_SIZE * 4];
+  char *filename = write_ktx_file (0x8d64, /* GL_ETC1_RGB8_OES */
+                                   etc1_block);
+  CoglHandle texture = load_texture (filename);
+  int x, y;
+
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888,
+                         BLOCK_SIZE * 4,
+                         pixels);
+
+  for (y = 0; y < BLOCK_SIZE; y++)
+    for (x = 0; x < BLOCK_SIZE; x++)
+      {
+        const guint8 *p = pixels + (y * BLOCK_SIZE + x) * 4;
+
+        if (x < 2)
+          check_pixel (p, 255, 2, 2);
+        else
+          check_pixel (p, 2, 2, 255);
+      }
+
+  cogl_handle_unref (texture);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_dxt1 (void)
+{
+  guint8 pixels[BLOCK_SIZE * BLOCK_SIZE * 4];
+  char *filename = write_dds_file ();
+  CoglHandle texture = load_texture (filename);
+  int x, y;
+
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888,
+                         BLOCK_SIZE * 4,
+                         pixels);
+
+  for (y = 0; y < BLOCK_SIZE; y++)
+    for (x = 0; x < BLOCK_SIZE; x++)
+      {
+        const guint8 *p = pixels + (y * BLOCK_SIZE + x) * 4;
+
+        if (y < 2)
+          check_pixel (p, 255, 0, 0);
+        else
+          check_pixel (p, 0, 0, 255);
+      }
+
+  cogl_handle_unref (texture);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_dxt1_black (guint32 gl_internal_format,
+                 guint8 black_alpha)
+{
+  guint8 pixels[BLOCK_SIZE * BLOCK_SIZE * 4];
+  char *filename = write_ktx_file (gl_internal_format, dxt1_black_block);
+  CoglHandle texture = load_texture (filename);
+  int x, y;
+
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888,
+                         BLOCK_SIZE * 4,
+                         pixels);
+
+  for (y = 0; y < BLOCK_SIZE; y++)
+    for (x = 0; x < BLOCK_SIZE; x++)
+      {
+        const guint8 *p = pixels + (y * BLOCK_SIZE + x) * 4;
+
+        if (y < 2)
+          check_pixel (p, 0, 0, 255);
+        else
+          check_pixel_with_alpha (p, 0, 0, 0, black_alpha);
+      }
+
+  cogl_handle_unref (texture);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+void
+test_cogl_texture_compressed (TestUtilsGTestFixture *fixture,
+                              void *data)
+{
+  test_etc1 ();
+  test_dxt1 ();
+  /* GL_COMPRESSED_RGB_S3TC_DXT1_EXT */
+  test_dxt1_black (0x83f0, 255);
+  /* GL_COMPRESSED_RGBA_S3TC_DXT1_EXT */
+  test_dxt1_black (0x83f1, 0);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
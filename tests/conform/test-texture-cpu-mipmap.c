@@ -0,0 +1,151 @@
+#include <cogl/cogl.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Creates textures with COGL_TEXTURE_CPU_MIPMAP and paints them at
+   1x1 with a mipmap filter so that the smallest level is used. The
+   left half of the texture starts red and the right half blue. Then
+   the left half is replaced with green to check that the mipmaps are
+   rebuilt after cogl_texture_set_region. The textures are either
+   created from the data or created empty with
+   cogl_texture_new_with_size and then filled in with
+   cogl_texture_set_region */
+
+#define TEXTURE_SIZE 8
+
+/* Result of averaging 255 and 0 in linear light */
+#define LINEAR_HALF 188
+
+static CoglHandle
+make_texture (CoglTextureFlags flags,
+              gboolean with_size)
+{
+  guint8 data[TEXTURE_SIZE * TEXTURE_SIZE * 4];
+  guint8 *p = data;
+  CoglHandle texture;
+  int x, y;
+
+  for (y = 0; y < TEXTURE_SIZE; y++)
+    for (x = 0; x < TEXTURE_SIZE; x++)
+      {
+        *(p++) = x < TEXTURE_SIZE / 2 ? 255 : 0;
+        *(p++) = 0;
+        *(p++) = x < TEXTURE_SIZE / 2 ? 0 : 255;
+        *(p++) = 255;
+      }
+
+  flags |= COGL_TEXTURE_CPU_MIPMAP | COGL_TEXTURE_NO_ATLAS;
+
+  if (!with_size)
+    return cogl_texture_new_from_data (TEXTURE_SIZE, TEXTURE_SIZE,
+                                       flags,
+                                       COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                       COGL_PIXEL_FORMAT_ANY,
+                                       TEXTURE_SIZE * 4,
+                                       data);
+
+  texture = cogl_texture_new_with_size (TEXTURE_SIZE, TEXTURE_SIZE,
+                                        flags,
+                                        COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+  cogl_texture_set_region (texture,
+                           0, 0, /* src_x/y */
+                           0, 0, /* dst_x/y */
+                           TEXTURE_SIZE, TEXTURE_SIZE, /* dst size */
+                           TEXTURE_SIZE, TEXTURE_SIZE, /* src size */
+                           COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                           TEXTURE_SIZE * 4,
+                           data);
+
+  return texture;
+}
+
+static void
+set_left_half_green (CoglHandle texture)
+{
+  guint8 data[TEXTURE_SIZE / 2 * TEXTURE_SIZE * 4];
+  int i;
+
+  for (i = 0; i < TEXTURE_SIZE / 2 * TEXTURE_SIZE; i++)
+    {
+      data[i * 4 + 0] = 0;
+      data[i * 4 + 1] = 255;
+      data[i * 4 + 2] = 0;
+      data[i * 4 + 3] = 255;
+    }
+
+  cogl_texture_set_region (texture,
+                           0, 0, /* src_x/y */
+                           0, 0, /* dst_x/y */
+                           TEXTURE_SIZE / 2, TEXTURE_SIZE, /* dst size */
+                           TEXTURE_SIZE / 2, TEXTURE_SIZE, /* src size */
+                           COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                           TEXTURE_SIZE / 2 * 4,
+                           data);
+}
+
+static void
+check_smallest_level (CoglHandle texture,
+                      int r, int g, int b)
+{
+  CoglPipeline *pipeline = cogl_pipeline_new ();
+  guint8 pixel[4];
+
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST_MIPMAP_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+  cogl_set_source (pipeline);
+  cogl_rectangle (0, 0, 1, 1);
+  cogl_object_unref (pipeline);
+
+  cogl_read_pixels (0, 0, 1, 1,
+                    COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                    pixel);
+
+  if (g_test_verbose ())
+    g_print ("  0x%02x%02x%02x%02x\n", pixel[0], pixel[1], pixel[2], pixel[3]);
+
+  /* Allow for rounding differences */
+  g_assert_cmpint (ABS (pixel[0] - r), <=, 1);
+  g_assert_cmpint (ABS (pixel[1] - g), <=, 1);
+  g_assert_cmpint (ABS (pixel[2] - b), <=, 1);
+}
+
+static void
+test_texture (CoglTextureFlags flags,
+              gboolean with_size,
+              int half)
+{
+  CoglHandle texture = make_texture (flags, with_size);
+
+  check_smallest_level (texture, half, 0, half);
+
+  set_left_half_green (texture);
+  check_smallest_level (texture, 0, half, half);
+
+  cogl_handle_unref (texture);
+}
+
+void
+test_cogl_texture_cpu_mipmap (TestUtilsGTestFixture *fixture,
+                              void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  int width = cogl_framebuffer_get_width (shared_state->fb);
+  int height = cogl_framebuffer_get_height (shared_state->fb);
+
+  cogl_ortho (0, width, /* left, right */
+              height, 0, /* bottom, top */
+              -1, 100 /* z near, far */);
+
+  test_texture (COGL_TEXTURE_NONE, FALSE, 128);
+  test_texture (COGL_TEXTURE_MIPMAP_LINEAR_LIGHT, FALSE, LINEAR_HALF);
+  test_texture (COGL_TEXTURE_NONE, TRUE, 128);
+  test_texture (COGL_TEXTURE_MIPMAP_LINEAR_LIGHT, TRUE, LINEAR_HALF);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
@@ -0,0 +1,188 @@
+#include <cogl/cogl.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Reads back a texture with CoglTextureDownload, once in the format
+   of the texture so the pixel buffer can be mapped directly and once
+   with the red and blue channels swapped. GL can read both of those
+   itself so a translucent premultiplied texture is also read back
+   unpremultiplied. GL doesn't change the premult status so that data
+   has to be converted on a worker thread. All of the results should
+   match the data the textures were created from */
+
+#define TEXTURE_WIDTH 33
+#define TEXTURE_HEIGHT 17
+
+/* The longest time in seconds to wait for a download to finish */
+#define DOWNLOAD_TIMEOUT 10.0
+
+static guint8 *
+make_data (void)
+{
+  guint8 *data = g_malloc (TEXTURE_WIDTH * TEXTURE_HEIGHT * 4);
+  guint8 *p = data;
+  int x, y;
+
+  for (y = 0; y < TEXTURE_HEIGHT; y++)
+    for (x = 0; x < TEXTURE_WIDTH; x++)
+      {
+        *(p++) = x * 255 / TEXTURE_WIDTH;
+        *(p++) = y * 255 / TEXTURE_HEIGHT;
+        *(p++) = (x + y) & 0xff;
+        /* Opaque so that premultiplying doesn't change the data */
+        *(p++) = 0xff;
+      }
+
+  return data;
+}
+
+/* Makes premultiplied data with a different alpha value for each
+   column */
+static guint8 *
+make_translucent_data (void)
+{
+  guint8 *data = g_malloc (TEXTURE_WIDTH * TEXTURE_HEIGHT * 4);
+  guint8 *p = data;
+  int x, y;
+
+  for (y = 0; y < TEXTURE_HEIGHT; y++)
+    for (x = 0; x < TEXTURE_WIDTH; x++)
+      {
+        int alpha = 0x40 + x * 0x80 / TEXTURE_WIDTH;
+
+        *(p++) = alpha * x / TEXTURE_WIDTH;
+        *(p++) = alpha * y / TEXTURE_HEIGHT;
+        *(p++) = alpha / 2;
+        *(p++) = alpha;
+      }
+
+  return data;
+}
+
+static guint8 *
+swap_red_and_blue (const guint8 *data)
+{
+  guint8 *swapped = g_memdup (data, TEXTURE_WIDTH * TEXTURE_HEIGHT * 4);
+  int i;
+
+  for (i = 0; i < TEXTURE_WIDTH * TEXTURE_HEIGHT; i++)
+    {
+      swapped[i * 4 + 0] = data[i * 4 + 2];
+      swapped[i * 4 + 2] = data[i * 4 + 0];
+    }
+
+  return swapped;
+}
+
+static guint8 *
+unpremultiply (const guint8 *data)
+{
+  guint8 *unpremult = g_memdup (data, TEXTURE_WIDTH * TEXTURE_HEIGHT * 4);
+  int i, j;
+
+  for (i = 0; i < TEXTURE_WIDTH * TEXTURE_HEIGHT; i++)
+    for (j = 0; j < 3; j++)
+      unpremult[i * 4 + j] = data[i * 4 + j] * 255 / data[i * 4 + 3];
+
+  return unpremult;
+}
+
+static void
+check_download (CoglHandle texture,
+                const guint8 *expected,
+                CoglPixelFormat format,
+                int max_difference)
+{
+  CoglTextureDownload *download;
+  const guint8 *data;
+  unsigned int rowstride;
+  GTimer *timer;
+  int x, y, i;
+
+  download = cogl_texture_download_new (texture, format);
+  g_assert (download != NULL);
+  g_assert (cogl_is_texture_download (download));
+  g_assert_cmpint (cogl_texture_download_get_format (download), ==, format);
+
+  /* Polling should eventually finish without waiting */
+  timer = g_timer_new ();
+  while (!cogl_texture_download_is_complete (download))
+    {
+      g_assert_cmpfloat (g_timer_elapsed (timer, NULL), <, DOWNLOAD_TIMEOUT);
+      g_usleep (1000);
+    }
+  g_timer_destroy (timer);
+
+  data = cogl_texture_download_map (download, &rowstride);
+  g_assert (data != NULL);
+
+  for (y = 0; y < TEXTURE_HEIGHT; y++)
+    for (x = 0; x < TEXTURE_WIDTH; x++)
+      {
+        const guint8 *e = expected + (y * TEXTURE_WIDTH + x) * 4;
+        const guint8 *p = data + y * rowstride + x * 4;
+
+        for (i = 0; i < 4; i++)
+          g_assert_cmpint (ABS (p[i] - e[i]), <=, max_difference);
+      }
+
+  cogl_texture_download_unmap (download);
+
+  cogl_object_unref (download);
+}
+
+static CoglHandle
+make_texture (const guint8 *data)
+{
+  return cogl_texture_new_from_data (TEXTURE_WIDTH, TEXTURE_HEIGHT,
+                                     COGL_TEXTURE_NO_ATLAS,
+                                     COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                     COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                     TEXTURE_WIDTH * 4,
+                                     data);
+}
+
+void
+test_cogl_texture_download (TestUtilsGTestFixture *fixture,
+                            void *data)
+{
+  guint8 *texture_data = make_data ();
+  guint8 *translucent_data = make_translucent_data ();
+  guint8 *expected;
+  CoglHandle texture;
+
+  texture = make_texture (texture_data);
+
+  check_download (texture, texture_data,
+                  COGL_PIXEL_FORMAT_RGBA_8888_PRE, 0);
+
+  expected = swap_red_and_blue (texture_data);
+  check_download (texture, expected,
+                  COGL_PIXEL_FORMAT_BGRA_8888_PRE, 0);
+  g_free (expected);
+
+  /* Destroying a download without mapping it should be safe even if
+     the conversion hasn't finished */
+  cogl_object_unref (cogl_texture_download_new
+                     (texture, COGL_PIXEL_FORMAT_RGBA_8888));
+
+  cogl_handle_unref (texture);
+
+  /* Unpremultiplying can round differently depending on whether GL or
+     the bitmap code does it so allow for an off-by-one error */
+  texture = make_texture (translucent_data);
+
+  expected = unpremultiply (translucent_data);
+  check_download (texture, expected, COGL_PIXEL_FORMAT_RGBA_8888, 1);
+  g_free (expected);
+
+  cogl_handle_unref (texture);
+
+  g_free (translucent_data);
+  g_free (texture_data);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
@@ -0,0 +1,60 @@
+#include <cogl/cogl.h>
+
+#include <glib/gstdio.h>
+
+#include "test-utils.h"
+
+/* Loads an image that is big enough to be decoded in bands straight
+   into the texture and checks that every row ends up in the right
+   place */
+
+#define IMAGE_SIZE 640
+
+void
+test_cogl_texture_file_stream (TestUtilsGTestFixture *fixture,
+                               void *data)
+{
+  char *filename = test_utils_write_bmp_file (IMAGE_SIZE, IMAGE_SIZE);
+  GError *error = NULL;
+  CoglHandle texture;
+  guint8 *pixels, *p;
+  int x, y;
+
+  texture = cogl_texture_new_from_file (filename,
+                                        COGL_TEXTURE_NONE,
+                                        COGL_PIXEL_FORMAT_ANY,
+                                        &error);
+  g_assert_no_error (error);
+  g_assert (texture != COGL_INVALID_HANDLE);
+
+  g_assert_cmpint (cogl_texture_get_width (texture), ==, IMAGE_SIZE);
+  g_assert_cmpint (cogl_texture_get_height (texture), ==, IMAGE_SIZE);
+
+  pixels = g_malloc (IMAGE_SIZE * IMAGE_SIZE * 4);
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888,
+                         IMAGE_SIZE * 4,
+                         pixels);
+
+  for (y = 0, p = pixels; y < IMAGE_SIZE; y++)
+    for (x = 0; x < IMAGE_SIZE; x++, p += 4)
+      {
+        guint8 color[3];
+
+        test_utils_get_bmp_color (x, y, color);
+
+        g_assert_cmpint (p[0], ==, color[0]);
+        g_assert_cmpint (p[1], ==, color[1]);
+        g_assert_cmpint (p[2], ==, color[2]);
+        g_assert_cmpint (p[3], ==, 255);
+      }
+
+  g_free (pixels);
+  cogl_handle_unref (texture);
+
+  g_unlink (filename);
+  g_free (filename);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
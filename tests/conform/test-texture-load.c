@@ -0,0 +1,112 @@
+#include <cogl/cogl.h>
+
+#include <glib/gstdio.h>
+
+#include "test-utils.h"
+
+/* Loads a small image with CoglTextureLoad and polls until it is
+   ready, then checks the texture. Loading a file that doesn't exist
+   should report an error instead of a texture */
+
+#define IMAGE_WIDTH 12
+#define IMAGE_HEIGHT 5
+
+/* The longest time in seconds to wait for a load to finish */
+#define LOAD_TIMEOUT 10.0
+
+static void
+test_load (void)
+{
+  char *filename = test_utils_write_bmp_file (IMAGE_WIDTH, IMAGE_HEIGHT);
+  guint8 pixels[IMAGE_WIDTH * IMAGE_HEIGHT * 4];
+  GError *error = NULL;
+  CoglTextureLoad *load;
+  CoglHandle texture;
+  GTimer *timer;
+  guint8 *p;
+  int x, y;
+
+  load = cogl_texture_load_new_from_file (filename,
+                                          COGL_TEXTURE_NO_ATLAS,
+                                          COGL_PIXEL_FORMAT_ANY);
+  g_assert (load != NULL);
+  g_assert (cogl_is_texture_load (load));
+
+  /* Polling should eventually finish without waiting */
+  timer = g_timer_new ();
+  while (!cogl_texture_load_is_complete (load))
+    {
+      g_assert_cmpfloat (g_timer_elapsed (timer, NULL), <, LOAD_TIMEOUT);
+      g_usleep (1000);
+    }
+  g_timer_destroy (timer);
+
+  texture = cogl_texture_load_get_texture (load, &error);
+  g_assert_no_error (error);
+  g_assert (texture != COGL_INVALID_HANDLE);
+
+  g_assert_cmpint (cogl_texture_get_width (texture), ==, IMAGE_WIDTH);
+  g_assert_cmpint (cogl_texture_get_height (texture), ==, IMAGE_HEIGHT);
+
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888,
+                         IMAGE_WIDTH * 4,
+                         pixels);
+
+  for (y = 0, p = pixels; y < IMAGE_HEIGHT; y++)
+    for (x = 0; x < IMAGE_WIDTH; x++, p += 4)
+      {
+        guint8 color[3];
+
+        test_utils_get_bmp_color (x, y, color);
+
+        g_assert_cmpint (p[0], ==, color[0]);
+        g_assert_cmpint (p[1], ==, color[1]);
+        g_assert_cmpint (p[2], ==, color[2]);
+        g_assert_cmpint (p[3], ==, 255);
+      }
+
+  /* The texture is owned by the load */
+  cogl_object_unref (load);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_missing_file (void)
+{
+  GError *error = NULL;
+  CoglTextureLoad *load;
+  CoglHandle texture;
+
+  load = cogl_texture_load_new_from_file ("/this/file/does/not/exist.png",
+                                          COGL_TEXTURE_NONE,
+                                          COGL_PIXEL_FORMAT_ANY);
+  g_assert (load != NULL);
+
+  texture = cogl_texture_load_get_texture (load, &error);
+  g_assert (texture == COGL_INVALID_HANDLE);
+  g_assert (error != NULL);
+
+  g_error_free (error);
+  cogl_object_unref (load);
+}
+
+void
+test_cogl_texture_load (TestUtilsGTestFixture *fixture,
+                        void *data)
+{
+  test_load ();
+  test_missing_file ();
+
+  /* Destroying a load without waiting for it should be safe even if
+     the file is still being decoded */
+  cogl_object_unref (cogl_texture_load_new_from_file
+                     ("/this/file/does/not/exist.png",
+                      COGL_TEXTURE_NONE,
+                      COGL_PIXEL_FORMAT_ANY));
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
@@ -0,0 +1,200 @@
+#include <cogl/cogl.h>
+#include <cogl/winsys/cogl-texture-pixmap-x11.h>
+
+#include <X11/Xlib.h>
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Damages a pixmap in a few different patterns and checks how much
+   data is copied into the texture for each one. Two small rectangles
+   in opposite corners should only copy those rectangles instead of
+   the bounding box around them */
+
+#define PIXMAP_SIZE 256
+#define CORNER_SIZE 8
+
+typedef struct _TestState
+{
+  Display *display;
+  Pixmap pixmap;
+  GC gc;
+  CoglFramebuffer *fb;
+  CoglHandle texture;
+  CoglTexturePixmapX11Stats last_stats;
+  int bytes_per_pixel;
+} TestState;
+
+static void
+fill_rectangle (TestState *state,
+                unsigned long pixel,
+                int x, int y,
+                int width, int height)
+{
+  XSetForeground (state->display, state->gc, pixel);
+  XFillRectangle (state->display, state->pixmap, state->gc,
+                  x, y, width, height);
+}
+
+/* Paints the texture so that the pending damage is copied and returns
+   the number of bytes and rectangles that it took */
+static void
+update_texture (TestState *state,
+                guint64 *n_bytes,
+                unsigned int *n_rectangles)
+{
+  CoglTexturePixmapX11Stats stats;
+
+  XSync (state->display, False);
+
+  cogl_push_framebuffer (state->fb);
+  cogl_set_source_texture (state->texture);
+  cogl_rectangle (-1, -1, 1, 1);
+  cogl_flush ();
+  cogl_pop_framebuffer ();
+
+  cogl_texture_pixmap_x11_get_stats (state->texture, &stats);
+
+  g_assert_cmpint (stats.n_updates, ==, state->last_stats.n_updates + 1);
+
+  *n_bytes = stats.n_bytes_uploaded - state->last_stats.n_bytes_uploaded;
+  *n_rectangles = (stats.n_rectangles_uploaded -
+                   state->last_stats.n_rectangles_uploaded);
+
+  state->last_stats = stats;
+}
+
+static void
+damage (TestState *state,
+        int x, int y,
+        int width, int height)
+{
+  fill_rectangle (state,
+                  WhitePixel (state->display,
+                              DefaultScreen (state->display)),
+                  x, y, width, height);
+  cogl_texture_pixmap_x11_update_area (state->texture,
+                                       x, y, width, height);
+}
+
+static void
+check_corners (TestState *state)
+{
+  guint8 *pixels = g_malloc (PIXMAP_SIZE * PIXMAP_SIZE * 4);
+
+  cogl_texture_get_data (state->texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888,
+                         PIXMAP_SIZE * 4,
+                         pixels);
+
+  /* The corners should have been copied but not the middle */
+  g_assert_cmpint (pixels[0], ==, 0xff);
+  g_assert_cmpint (pixels[(PIXMAP_SIZE * PIXMAP_SIZE - 1) * 4], ==, 0xff);
+  g_assert_cmpint (pixels[((PIXMAP_SIZE / 2) * PIXMAP_SIZE +
+                           PIXMAP_SIZE / 2) * 4],
+                   ==,
+                   0x00);
+
+  g_free (pixels);
+}
+
+void
+test_cogl_texture_pixmap_x11_damage (TestUtilsGTestFixture *fixture,
+                                     void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  TestState state;
+  guint64 n_bytes;
+  unsigned int n_rectangles;
+  int screen, i;
+
+  memset (&state, 0, sizeof (state));
+
+  state.display = cogl_xlib_get_display ();
+  if (state.display == NULL)
+    {
+      if (g_test_verbose ())
+        g_print ("Skipping because Cogl isn't using X\n");
+      return;
+    }
+
+  screen = DefaultScreen (state.display);
+  state.fb = shared_state->fb;
+  state.pixmap = XCreatePixmap (state.display,
+                                RootWindow (state.display, screen),
+                                PIXMAP_SIZE, PIXMAP_SIZE,
+                                DefaultDepth (state.display, screen));
+  state.gc = XCreateGC (state.display, state.pixmap, 0, NULL);
+
+  fill_rectangle (&state, BlackPixel (state.display, screen),
+                  0, 0, PIXMAP_SIZE, PIXMAP_SIZE);
+  XSync (state.display, False);
+
+  state.texture = cogl_texture_pixmap_x11_new (state.pixmap, FALSE);
+  g_assert (state.texture != COGL_INVALID_HANDLE);
+
+  if (cogl_texture_pixmap_x11_is_using_tfp_extension (state.texture))
+    {
+      if (g_test_verbose ())
+        g_print ("Skipping because the texture from pixmap extension "
+                 "is used\n");
+      goto done;
+    }
+
+  /* The first update copies the whole pixmap */
+  update_texture (&state, &n_bytes, &n_rectangles);
+  g_assert_cmpint (n_rectangles, ==, 1);
+  state.bytes_per_pixel = n_bytes / (PIXMAP_SIZE * PIXMAP_SIZE);
+  g_assert_cmpint (state.bytes_per_pixel, >, 0);
+
+  if (g_test_verbose ())
+    g_print ("Whole pixmap: %" G_GUINT64_FORMAT " bytes\n", n_bytes);
+
+  /* Two small rectangles in opposite corners */
+  damage (&state, 0, 0, CORNER_SIZE, CORNER_SIZE);
+  damage (&state,
+          PIXMAP_SIZE - CORNER_SIZE, PIXMAP_SIZE - CORNER_SIZE,
+          CORNER_SIZE, CORNER_SIZE);
+  update_texture (&state, &n_bytes, &n_rectangles);
+  g_assert_cmpint (n_rectangles, ==, 2);
+  g_assert_cmpint (n_bytes,
+                   ==,
+                   2 * CORNER_SIZE * CORNER_SIZE * state.bytes_per_pixel);
+  check_corners (&state);
+
+  if (g_test_verbose ())
+    g_print ("Opposite corners: %" G_GUINT64_FORMAT " bytes\n", n_bytes);
+
+  /* Overlapping rectangles should be merged so that nothing is
+     copied twice */
+  damage (&state, 32, 32, 32, 32);
+  damage (&state, 48, 48, 32, 32);
+  update_texture (&state, &n_bytes, &n_rectangles);
+  g_assert_cmpint (n_rectangles, ==, 1);
+  g_assert_cmpint (n_bytes, ==, 48 * 48 * state.bytes_per_pixel);
+
+  if (g_test_verbose ())
+    g_print ("Overlapping: %" G_GUINT64_FORMAT " bytes\n", n_bytes);
+
+  /* Lots of scattered damage is limited to a small number of
+     rectangles and still copies less than the whole pixmap */
+  for (i = 0; i < 64; i++)
+    damage (&state, (i % 8) * 32, (i / 8) * 32, 1, 1);
+  update_texture (&state, &n_bytes, &n_rectangles);
+  g_assert_cmpint (n_rectangles, <=, 16);
+  g_assert_cmpint (n_bytes,
+                   <,
+                   PIXMAP_SIZE * PIXMAP_SIZE * state.bytes_per_pixel);
+
+  if (g_test_verbose ())
+    g_print ("Scattered: %" G_GUINT64_FORMAT " bytes in %u rectangles\n",
+             n_bytes, n_rectangles);
+
+ done:
+  cogl_handle_unref (state.texture);
+  XFreeGC (state.display, state.gc);
+  XFreePixmap (state.display, state.pixmap);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
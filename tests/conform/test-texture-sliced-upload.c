@@ -0,0 +1,175 @@
+#include <cogl/cogl.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Creates a texture that has to be split into several slices with
+   waste because the test is run with NPOT textures disabled. The data
+   is given in a different format from the texture so each slice has
+   to be converted as well. The contents of every slice are then read
+   back directly, including the waste, which should be filled with
+   copies of the last column and row of the image */
+
+#define TEXTURE_WIDTH 300
+#define TEXTURE_HEIGHT 200
+
+/* This is private API exported for the tests */
+typedef void (* CoglTextureSliceCallback) (CoglHandle handle,
+                                           const float *slice_coords,
+                                           const float *virtual_coords,
+                                           void *user_data);
+
+void
+_cogl_texture_foreach_sub_texture_in_region (CoglHandle handle,
+                                             float virtual_tx_1,
+                                             float virtual_ty_1,
+                                             float virtual_tx_2,
+                                             float virtual_ty_2,
+                                             CoglTextureSliceCallback callback,
+                                             void *user_data);
+
+typedef struct _TestState
+{
+  const guint8 *source;
+  int n_slices;
+  int n_slices_with_waste;
+} TestState;
+
+static guint8 *
+make_data (void)
+{
+  guint8 *data = g_malloc (TEXTURE_WIDTH * TEXTURE_HEIGHT * 3);
+  guint8 *p = data;
+  int x, y;
+
+  for (y = 0; y < TEXTURE_HEIGHT; y++)
+    for (x = 0; x < TEXTURE_WIDTH; x++)
+      {
+        *(p++) = x & 0xff;
+        *(p++) = y & 0xff;
+        *(p++) = (x / 256) * 0x80 + (y / 256) * 0x40;
+      }
+
+  return data;
+}
+
+static void
+check_pixel (const guint8 *pixel,
+             const guint8 *expected,
+             int slice_x, int slice_y)
+{
+  if (pixel[0] != expected[0] ||
+      pixel[1] != expected[1] ||
+      pixel[2] != expected[2] ||
+      pixel[3] != 0xff)
+    {
+      g_printerr ("Slice pixel %i,%i is 0x%02x%02x%02x%02x but "
+                  "0x%02x%02x%02xff was expected\n",
+                  slice_x, slice_y,
+                  pixel[0], pixel[1], pixel[2], pixel[3],
+                  expected[0], expected[1], expected[2]);
+      g_assert_not_reached ();
+    }
+}
+
+static void
+check_slice_cb (CoglHandle slice,
+                const float *slice_coords,
+                const float *virtual_coords,
+                void *user_data)
+{
+  TestState *state = user_data;
+  int slice_width = cogl_texture_get_width (slice);
+  int slice_height = cogl_texture_get_height (slice);
+  /* The part of the slice that isn't waste */
+  int data_width = (slice_coords[2] - slice_coords[0]) * slice_width + 0.5f;
+  int data_height = (slice_coords[3] - slice_coords[1]) * slice_height + 0.5f;
+  /* Position of the slice in the whole texture */
+  int tex_x = virtual_coords[0] * TEXTURE_WIDTH + 0.5f;
+  int tex_y = virtual_coords[1] * TEXTURE_HEIGHT + 0.5f;
+  guint8 *data = g_malloc (slice_width * slice_height * 4);
+  int x, y;
+
+  if (g_test_verbose ())
+    g_print ("Slice at %i,%i is %ix%i with %ix%i of data\n",
+             tex_x, tex_y,
+             slice_width, slice_height,
+             data_width, data_height);
+
+  g_assert_cmpint (data_width, >, 0);
+  g_assert_cmpint (data_height, >, 0);
+  g_assert_cmpint (data_width, <=, slice_width);
+  g_assert_cmpint (data_height, <=, slice_height);
+
+  cogl_texture_get_data (slice,
+                         COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                         slice_width * 4,
+                         data);
+
+  /* The waste should repeat the last column and row of the data */
+  for (y = 0; y < slice_height; y++)
+    for (x = 0; x < slice_width; x++)
+      {
+        int src_x = tex_x + MIN (x, data_width - 1);
+        int src_y = tex_y + MIN (y, data_height - 1);
+
+        check_pixel (data + (y * slice_width + x) * 4,
+                     state->source + (src_y * TEXTURE_WIDTH + src_x) * 3,
+                     x, y);
+      }
+
+  state->n_slices++;
+  if (data_width < slice_width || data_height < slice_height)
+    state->n_slices_with_waste++;
+
+  g_free (data);
+}
+
+void
+test_cogl_texture_sliced_upload (TestUtilsGTestFixture *fixture,
+                                 void *data)
+{
+  guint8 *source = make_data ();
+  guint8 *readback;
+  CoglHandle texture;
+  TestState state;
+  int i;
+
+  memset (&state, 0, sizeof (state));
+  state.source = source;
+
+  /* The data is RGB so the slices have to be converted to RGBA */
+  texture = cogl_texture_new_from_data (TEXTURE_WIDTH, TEXTURE_HEIGHT,
+                                        COGL_TEXTURE_NO_ATLAS,
+                                        COGL_PIXEL_FORMAT_RGB_888,
+                                        COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                        TEXTURE_WIDTH * 3,
+                                        source);
+  g_assert (texture != COGL_INVALID_HANDLE);
+  g_assert (cogl_texture_is_sliced (texture));
+
+  _cogl_texture_foreach_sub_texture_in_region (texture,
+                                               0.0f, 0.0f, 1.0f, 1.0f,
+                                               check_slice_cb,
+                                               &state);
+
+  g_assert_cmpint (state.n_slices, >, 1);
+  g_assert_cmpint (state.n_slices_with_waste, >, 0);
+
+  /* Reading back the whole texture should skip the waste */
+  readback = g_malloc (TEXTURE_WIDTH * TEXTURE_HEIGHT * 3);
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGB_888,
+                         TEXTURE_WIDTH * 3,
+                         readback);
+  for (i = 0; i < TEXTURE_WIDTH * TEXTURE_HEIGHT * 3; i++)
+    g_assert_cmpint (readback[i], ==, source[i]);
+  g_free (readback);
+
+  cogl_handle_unref (texture);
+  g_free (source);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
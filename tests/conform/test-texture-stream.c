@@ -0,0 +1,102 @@
+#include <cogl/cogl.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Pushes frames through a CoglTextureStream and checks that only
+   complete frames end up in the texture, that the most recent frame
+   wins and that the dropped frames are counted */
+
+#define TEXTURE_SIZE 16
+#define N_BUFFERS 3
+
+static void
+write_frame (CoglTextureStream *stream,
+             guint8 value)
+{
+  unsigned int rowstride;
+  guint8 *data;
+  int y;
+
+  data = cogl_texture_stream_begin_frame (stream, &rowstride);
+  g_assert (data != NULL);
+
+  for (y = 0; y < TEXTURE_SIZE; y++)
+    memset (data + y * rowstride, value, TEXTURE_SIZE * 4);
+
+  cogl_texture_stream_end_frame (stream);
+}
+
+static void
+check_texture (CoglHandle texture,
+               guint8 value)
+{
+  guint8 data[TEXTURE_SIZE * TEXTURE_SIZE * 4];
+  int i;
+
+  cogl_texture_get_data (texture,
+                         COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                         TEXTURE_SIZE * 4,
+                         data);
+
+  for (i = 0; i < sizeof (data); i++)
+    g_assert_cmpint (data[i], ==, value);
+}
+
+void
+test_cogl_texture_stream (TestUtilsGTestFixture *fixture,
+                          void *data)
+{
+  CoglTextureStreamStats stats;
+  CoglTextureStream *stream;
+  CoglHandle texture;
+  int i;
+
+  texture = cogl_texture_new_with_size (TEXTURE_SIZE, TEXTURE_SIZE,
+                                        COGL_TEXTURE_NO_ATLAS,
+                                        COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+
+  stream = cogl_texture_stream_new (texture,
+                                    COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                    N_BUFFERS);
+  g_assert (cogl_is_texture_stream (stream));
+  g_assert (cogl_texture_stream_get_texture (stream) == texture);
+
+  /* Nothing to upload yet */
+  g_assert (!cogl_texture_stream_update (stream));
+
+  /* Only the newest of two finished frames should be uploaded */
+  write_frame (stream, 1);
+  write_frame (stream, 2);
+  g_assert (cogl_texture_stream_update (stream));
+  check_texture (texture, 2);
+
+  cogl_texture_stream_get_stats (stream, &stats);
+  g_assert_cmpint (stats.n_frames_uploaded, ==, 1);
+  g_assert_cmpint (stats.n_frames_dropped, ==, 1);
+
+  /* A frame that has been started but not finished must not be
+     uploaded */
+  g_assert (cogl_texture_stream_begin_frame (stream, NULL) != NULL);
+  g_assert (!cogl_texture_stream_update (stream));
+  cogl_texture_stream_end_frame (stream);
+
+  /* Once every buffer is full the oldest waiting frame is recycled
+     for the producer */
+  for (i = 0; i < N_BUFFERS; i++)
+    write_frame (stream, 10 + i);
+  g_assert (cogl_texture_stream_update (stream));
+  check_texture (texture, 10 + N_BUFFERS - 1);
+
+  cogl_texture_stream_get_stats (stream, &stats);
+  g_assert_cmpint (stats.n_frames_uploaded, ==, 2);
+  g_assert_cmpint (stats.n_frames_dropped, ==, 1 + N_BUFFERS);
+  g_assert_cmpint (stats.max_latency, >=, stats.last_latency);
+
+  cogl_object_unref (stream);
+  cogl_handle_unref (texture);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
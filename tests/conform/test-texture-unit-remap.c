@@ -0,0 +1,148 @@
+#include <cogl/cogl.h>
+
+#include <string.h>
+
+#include "test-utils.h"
+
+/* Draws with two pipelines that use the same pair of textures but in
+   swapped layer order. When the GLSL fragend is used the second
+   pipeline can sample its layers from the units that the first
+   pipeline left the textures bound to, so this checks that switching
+   back and forth between them still samples the right texture for
+   each layer */
+
+#define TEXTURE_SIZE 4
+#define RENDER_SIZE  8
+#define N_RECTANGLES 8
+
+/* This is private API exported for the tests */
+void
+_cogl_pipeline_get_texture_unit_remap_stats (unsigned int *n_binds_saved,
+                                             unsigned int *n_switches_saved);
+
+static CoglHandle
+make_texture (guint8 red, guint8 green, guint8 blue)
+{
+  guint8 data[TEXTURE_SIZE * TEXTURE_SIZE * 4];
+  int i;
+
+  for (i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE; i++)
+    {
+      data[i * 4 + 0] = red;
+      data[i * 4 + 1] = green;
+      data[i * 4 + 2] = blue;
+      data[i * 4 + 3] = 0xff;
+    }
+
+  return cogl_texture_new_from_data (TEXTURE_SIZE, TEXTURE_SIZE,
+                                     COGL_TEXTURE_NO_ATLAS,
+                                     COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                     COGL_PIXEL_FORMAT_ANY,
+                                     TEXTURE_SIZE * 4,
+                                     data);
+}
+
+/* The second layer is subtracted from the first so the result
+   depends on which texture each layer samples */
+static CoglPipeline *
+create_pipeline (CoglHandle first_texture,
+                 CoglHandle second_texture)
+{
+  CoglPipeline *pipeline = cogl_pipeline_new ();
+  GError *error = NULL;
+
+  cogl_pipeline_set_layer_texture (pipeline, 0, first_texture);
+  cogl_pipeline_set_layer_texture (pipeline, 1, second_texture);
+  cogl_pipeline_set_layer_combine (pipeline, 1,
+                                   "RGB = SUBTRACT (PREVIOUS, TEXTURE) "
+                                   "A = REPLACE (PREVIOUS)",
+                                   &error);
+  g_assert_no_error (error);
+
+  return pipeline;
+}
+
+static void
+check_pixel (int x, guint8 red, guint8 green, guint8 blue)
+{
+  guint8 pixel[4];
+
+  cogl_read_pixels (x + RENDER_SIZE / 2, RENDER_SIZE / 2, 1, 1,
+                    COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                    pixel);
+
+  if (g_test_verbose ())
+    g_print ("  x = %i: 0x%02x%02x%02x\n", x, pixel[0], pixel[1], pixel[2]);
+
+  g_assert_cmpint (pixel[0], ==, red);
+  g_assert_cmpint (pixel[1], ==, green);
+  g_assert_cmpint (pixel[2], ==, blue);
+}
+
+void
+test_cogl_texture_unit_remap (TestUtilsGTestFixture *fixture,
+                              void *data)
+{
+  TestUtilsSharedState *shared_state = data;
+  int width = cogl_framebuffer_get_width (shared_state->fb);
+  int height = cogl_framebuffer_get_height (shared_state->fb);
+  CoglHandle red_texture, blue_texture;
+  CoglPipeline *pipelines[2];
+  unsigned int n_binds_saved, n_switches_saved;
+  int i;
+
+  if (!cogl_features_available (COGL_FEATURE_SHADERS_GLSL))
+    {
+      if (g_test_verbose ())
+        g_print ("Skipping because GLSL isn't available\n");
+      return;
+    }
+
+  cogl_ortho (0, width, /* left, right */
+              height, 0, /* bottom, top */
+              -1, 100 /* z near, far */);
+
+  red_texture = make_texture (0xff, 0x00, 0x00);
+  blue_texture = make_texture (0x00, 0x00, 0xff);
+
+  pipelines[0] = create_pipeline (red_texture, blue_texture);
+  pipelines[1] = create_pipeline (blue_texture, red_texture);
+
+  /* Flush after each rectangle so that every switch between the
+     pipelines goes through the texture unit mapping */
+  for (i = 0; i < N_RECTANGLES; i++)
+    {
+      cogl_set_source (pipelines[i % 2]);
+      cogl_rectangle (i * RENDER_SIZE, 0,
+                      (i + 1) * RENDER_SIZE, RENDER_SIZE);
+      cogl_flush ();
+    }
+
+  for (i = 0; i < N_RECTANGLES; i++)
+    {
+      if (i % 2 == 0)
+        check_pixel (i * RENDER_SIZE, 0xff, 0x00, 0x00);
+      else
+        check_pixel (i * RENDER_SIZE, 0x00, 0x00, 0xff);
+    }
+
+  /* Every switch after the first two pipelines should have been able
+     to reuse the existing bindings instead of rebinding */
+  _cogl_pipeline_get_texture_unit_remap_stats (&n_binds_saved,
+                                               &n_switches_saved);
+
+  if (g_test_verbose ())
+    g_print ("Binds saved: %u, active texture switches saved: %u\n",
+             n_binds_saved, n_switches_saved);
+
+  g_assert_cmpuint (n_binds_saved, >=, N_RECTANGLES - 2);
+
+  cogl_object_unref (pipelines[0]);
+  cogl_object_unref (pipelines[1]);
+  cogl_handle_unref (red_texture);
+  cogl_handle_unref (blue_texture);
+
+  if (g_test_verbose ())
+    g_print ("OK\n");
+}
@@ -1,5 +1,6 @@
 #include <cogl/cogl.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "test-utils.h"
 
@@ -64,6 +65,41 @@ test_utils_init (TestUtilsGTestFixture *fixture,
   cogl_push_framebuffer (state->fb);
 }
 
+/* The debug options are only read when the first context is created
+   so this has to be called before test_utils_init */
+static void
+append_debug_options (const char *options)
+{
+  const char *debug = g_getenv ("COGL_DEBUG");
+  char *new_debug;
+
+  if (debug && *debug)
+    new_debug = g_strconcat (debug, ",", options, NULL);
+  else
+    new_debug = g_strdup (options);
+
+  g_setenv ("COGL_DEBUG", new_debug, TRUE);
+  g_free (new_debug);
+}
+
+void
+test_utils_init_glsl_fragend (TestUtilsGTestFixture *fixture,
+                              const void *data)
+{
+  append_debug_options ("disable-arbfp,disable-fixed");
+
+  test_utils_init (fixture, data);
+}
+
+void
+test_utils_init_disable_npot (TestUtilsGTestFixture *fixture,
+                              const void *data)
+{
+  append_debug_options ("disable-npot-textures");
+
+  test_utils_init (fixture, data);
+}
+
 void
 test_utils_fini (TestUtilsGTestFixture *fixture,
                  const void *data)
@@ -78,3 +114,92 @@ test_utils_fini (TestUtilsGTestFixture *fixture,
   if (state->ctx)
     cogl_object_unref (state->ctx);
 }
+
+void
+test_utils_write_uint16 (guint8 *p,
+                         guint16 value)
+{
+  p[0] = value;
+  p[1] = value >> 8;
+}
+
+void
+test_utils_write_uint32 (guint8 *p,
+                         guint32 value)
+{
+  test_utils_write_uint16 (p, value);
+  test_utils_write_uint16 (p + 2, value >> 16);
+}
+
+char *
+test_utils_write_temp_file (const char *template,
+                            const guint8 *data,
+                            gsize length)
+{
+  char *filename;
+  int fd;
+
+  fd = g_file_open_tmp (template, &filename, NULL);
+  g_assert (fd != -1);
+  close (fd);
+
+  g_assert (g_file_set_contents (filename, (const char *) data, length, NULL));
+
+  return filename;
+}
+
+void
+test_utils_get_bmp_color (int x, int y, guint8 *color)
+{
+  color[0] = x;
+  color[1] = y;
+  color[2] = x ^ y;
+}
+
+char *
+test_utils_write_bmp_file (int width,
+                           int height)
+{
+  int data_size = width * height * 3;
+  guint8 *data = g_malloc0 (54 + data_size);
+  guint8 *p = data + 54;
+  char *filename;
+  int x, y;
+
+  g_assert (width % 4 == 0);
+
+  data[0] = 'B';
+  data[1] = 'M';
+  test_utils_write_uint32 (data + 2, 54 + data_size); /* file size */
+  test_utils_write_uint32 (data + 10, 54); /* offset to the pixels */
+  test_utils_write_uint32 (data + 14, 40); /* header size */
+  test_utils_write_uint32 (data + 18, width); /* width */
+  /* negative height is top-down */
+  test_utils_write_uint32 (data + 22, -height);
+  test_utils_write_uint16 (data + 26, 1); /* planes */
+  test_utils_write_uint16 (data + 28, 24); /* bits per pixel */
+  test_utils_write_uint32 (data + 34, data_size);
+
+  /* The rows don't need padding because the width is a multiple of
+     four */
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        guint8 color[3];
+
+        test_utils_get_bmp_color (x, y, color);
+
+        /* BMP stores the pixels as BGR */
+        *(p++) = color[2];
+        *(p++) = color[1];
+        *(p++) = color[0];
+      }
+
+  filename = test_utils_write_temp_file ("cogl-test-XXXXXX.bmp",
+                                         data,
+                                         54 + data_size);
+
+  g_free (data);
+
+  return filename;
+}
@@ -34,8 +34,53 @@ void
 test_utils_init (TestUtilsGTestFixture *fixture,
                  const void *data);
 
+/* This is the same as test_utils_init except that it disables the
+ * ARBfp and fixed function fragends first so that pipelines will be
+ * drawn with the GLSL fragend whenever GLSL is available */
+void
+test_utils_init_glsl_fragend (TestUtilsGTestFixture *fixture,
+                              const void *data);
+
+/* This is the same as test_utils_init except that Cogl is made to
+ * think that NPOT textures aren't supported so that it has to slice
+ * them or add waste */
+void
+test_utils_init_disable_npot (TestUtilsGTestFixture *fixture,
+                              const void *data);
+
 void
 test_utils_fini (TestUtilsGTestFixture *fixture,
                  const void *data);
 
+/* Store a value in little-endian order as used by the image file
+ * formats that the tests write */
+void
+test_utils_write_uint16 (guint8 *p,
+                         guint16 value);
+
+void
+test_utils_write_uint32 (guint8 *p,
+                         guint32 value);
+
+/* Writes the data to a new temporary file named after the template as
+ * in g_file_open_tmp(). The caller should g_unlink() the file and
+ * free the returned filename */
+char *
+test_utils_write_temp_file (const char *template,
+                            const guint8 *data,
+                            gsize length);
+
+/* Gets the RGB color of a pixel in the images written by
+ * test_utils_write_bmp_file() */
+void
+test_utils_get_bmp_color (int x, int y, guint8 *color);
+
+/* Writes a 24-bit top-down BMP file to a temporary file and returns
+ * its name. The image loaders can decode this a row at a time. The
+ * width must be a multiple of four so that the rows don't need any
+ * padding */
+char *
+test_utils_write_bmp_file (int width,
+                           int height);
+
 #endif /* _TEST_UTILS_H_ */
@@ -0,0 +1,91 @@
+#include <cogl/cogl.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Measures the cost of repeatedly setting the same few literal blend
+ * and texture combine strings on a pipeline which is what toolkits
+ * typically do for every actor they paint. */
+
+#define N_ITERATIONS 100000
+
+static const char *blend_strings[] =
+  {
+    "RGBA = ADD (SRC_COLOR, DST_COLOR * (1 - SRC_COLOR[A]))",
+    "RGBA = ADD (SRC_COLOR, 0)",
+    "RGB = ADD (SRC_COLOR * (SRC_COLOR[A]), DST_COLOR * (1-SRC_COLOR[A])) "
+    "A = ADD (SRC_COLOR, DST_COLOR * (1-SRC_COLOR[A]))"
+  };
+
+static const char *combine_strings[] =
+  {
+    "RGBA = MODULATE (PREVIOUS, TEXTURE)",
+    "RGBA = REPLACE (TEXTURE)",
+    "RGB = MODULATE (PREVIOUS, TEXTURE[A]) A = MODULATE (PREVIOUS, TEXTURE)"
+  };
+
+int
+main (int argc, char **argv)
+{
+  CoglContext *ctx;
+  CoglPipeline *pipeline;
+  GError *error = NULL;
+  GTimer *timer;
+  int n_iterations = N_ITERATIONS;
+  double elapsed;
+  int i;
+
+  if (argc > 1)
+    n_iterations = atoi (argv[1]);
+
+  ctx = cogl_context_new (NULL, &error);
+  if (!ctx)
+    {
+      fprintf (stderr, "Failed to create context: %s\n", error->message);
+      return 1;
+    }
+
+  pipeline = cogl_pipeline_new ();
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++)
+    {
+      const char *string = blend_strings[i % G_N_ELEMENTS (blend_strings)];
+
+      if (!cogl_pipeline_set_blend (pipeline, string, &error))
+        {
+          fprintf (stderr, "Failed to set blend: %s\n", error->message);
+          return 1;
+        }
+    }
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("cogl_pipeline_set_blend: %d calls in %f seconds "
+          "(%f us per call)\n",
+          n_iterations, elapsed, elapsed * 1000000.0 / n_iterations);
+
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++)
+    {
+      const char *string = combine_strings[i % G_N_ELEMENTS (combine_strings)];
+
+      if (!cogl_pipeline_set_layer_combine (pipeline, 0, string, &error))
+        {
+          fprintf (stderr, "Failed to set layer combine: %s\n",
+                   error->message);
+          return 1;
+        }
+    }
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("cogl_pipeline_set_layer_combine: %d calls in %f seconds "
+          "(%f us per call)\n",
+          n_iterations, elapsed, elapsed * 1000000.0 / n_iterations);
+
+  g_timer_destroy (timer);
+  cogl_object_unref (pipeline);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include <cogl/cogl.h>
+#include <cogl-pango/cogl-pango.h>
+#include <cogl-pango/cogl-pango-glyph-cache.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Measures the throughput of looking up glyphs that are already in
+ * the glyph cache. The renderer does this for every glyph of every
+ * line that it draws without a cached display list. */
+
+#define N_GLYPHS 2000
+#define N_ITERATIONS 10000000
+
+static void
+time_lookups (CoglPangoGlyphCache *cache,
+              PangoFont *font,
+              int n_glyphs,
+              int n_iterations,
+              const char *name)
+{
+  GTimer *timer = g_timer_new ();
+  int n_found = 0;
+  double elapsed;
+  int i;
+
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++)
+    if (cogl_pango_glyph_cache_lookup (cache, FALSE, font, i % n_glyphs))
+      n_found++;
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("%s: %d lookups in %f seconds (%f ns per lookup, %d found)\n",
+          name, n_iterations, elapsed, elapsed * 1e9 / n_iterations,
+          n_found);
+
+  g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+  CoglContext *ctx;
+  PangoFontMap *font_map;
+  PangoContext *pango_context;
+  PangoFontDescription *font_desc;
+  PangoFont *font;
+  CoglPangoGlyphCache *cache;
+  GError *error = NULL;
+  int n_glyphs = N_GLYPHS;
+  int n_iterations = N_ITERATIONS;
+  int i;
+
+  g_type_init ();
+
+  if (argc > 1)
+    n_glyphs = atoi (argv[1]);
+  if (argc > 2)
+    n_iterations = atoi (argv[2]);
+
+  ctx = cogl_context_new (NULL, &error);
+  if (!ctx)
+    {
+      fprintf (stderr, "Failed to create context: %s\n", error->message);
+      return 1;
+    }
+
+  font_map = cogl_pango_font_map_new ();
+  pango_context =
+    cogl_pango_font_map_create_context (COGL_PANGO_FONT_MAP (font_map));
+
+  font_desc = pango_font_description_from_string ("Sans 12");
+  font = pango_context_load_font (pango_context, font_desc);
+  pango_font_description_free (font_desc);
+
+  if (font == NULL)
+    {
+      fprintf (stderr, "Failed to load font\n");
+      return 1;
+    }
+
+  cache = cogl_pango_glyph_cache_new (FALSE, FALSE, NULL);
+
+  for (i = 0; i < n_glyphs; i++)
+    cogl_pango_glyph_cache_lookup (cache, TRUE, font, i);
+
+  /* Glyphs with low indices are the common case for Latin text */
+  time_lookups (cache, font, MIN (n_glyphs, 128), n_iterations,
+                "low glyphs");
+  time_lookups (cache, font, n_glyphs, n_iterations, "all glyphs");
+
+  cogl_pango_glyph_cache_free (cache);
+
+  g_object_unref (font);
+  g_object_unref (pango_context);
+  g_object_unref (font_map);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
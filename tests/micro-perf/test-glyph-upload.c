@@ -0,0 +1,147 @@
+#include <cogl/cogl.h>
+#include <cogl-pango/cogl-pango.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Measures the time taken to render the first frame of a layout
+ * containing a large number of glyphs that aren't in the glyph cache
+ * yet. Most of the time is spent rasterising the glyphs and uploading
+ * them to the glyph atlases. The second argument sets the number of
+ * threads used to rasterise the glyphs. */
+
+#define N_GLYPHS 5000
+#define FB_WIDTH 1024
+#define FB_HEIGHT 1024
+
+static char *
+make_text (int n_glyphs)
+{
+  GString *text = g_string_new (NULL);
+  int i;
+
+  /* Use a run of consecutive CJK ideographs so that every glyph is
+     distinct */
+  for (i = 0; i < n_glyphs; i++)
+    {
+      g_string_append_unichar (text, 0x4e00 + i);
+      if (i % 64 == 63)
+        g_string_append_c (text, '\n');
+    }
+
+  return g_string_free (text, FALSE);
+}
+
+static void
+finish_frame (void)
+{
+  guint8 pixel[4];
+
+  /* Reading back a pixel makes sure the rendering has actually
+     finished */
+  cogl_read_pixels (0, 0, 1, 1, COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE, pixel);
+}
+
+int
+main (int argc, char **argv)
+{
+  CoglContext *ctx;
+  CoglHandle tex, offscreen;
+  PangoFontMap *font_map;
+  PangoContext *pango_context;
+  PangoLayout *layout;
+  PangoFontDescription *font_desc;
+  CoglColor color;
+  GError *error = NULL;
+  GTimer *timer;
+  int n_glyphs = N_GLYPHS;
+  int n_threads = 1;
+  char *text;
+  double elapsed;
+
+  g_thread_init (NULL);
+  g_type_init ();
+
+  if (argc > 1)
+    n_glyphs = atoi (argv[1]);
+  if (argc > 2)
+    n_threads = atoi (argv[2]);
+
+  ctx = cogl_context_new (NULL, &error);
+  if (!ctx)
+    {
+      fprintf (stderr, "Failed to create context: %s\n", error->message);
+      return 1;
+    }
+
+  tex = cogl_texture_2d_new_with_size (ctx, FB_WIDTH, FB_HEIGHT,
+                                       COGL_PIXEL_FORMAT_ANY, &error);
+  if (!tex)
+    {
+      fprintf (stderr, "Failed to allocate texture: %s\n", error->message);
+      return 1;
+    }
+
+  offscreen = cogl_offscreen_new_to_texture (tex);
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), &error))
+    {
+      fprintf (stderr, "Failed to allocate framebuffer: %s\n",
+               error->message);
+      return 1;
+    }
+
+  cogl_push_framebuffer (COGL_FRAMEBUFFER (offscreen));
+  cogl_ortho (0, FB_WIDTH, FB_HEIGHT, 0, -1, 100);
+
+  font_map = cogl_pango_font_map_new ();
+  cogl_pango_font_map_set_rasterization_threads (COGL_PANGO_FONT_MAP (font_map),
+                                                 n_threads);
+  pango_context =
+    cogl_pango_font_map_create_context (COGL_PANGO_FONT_MAP (font_map));
+
+  layout = pango_layout_new (pango_context);
+  font_desc = pango_font_description_from_string ("Sans 12");
+  pango_layout_set_font_description (layout, font_desc);
+  pango_font_description_free (font_desc);
+
+  text = make_text (n_glyphs);
+  pango_layout_set_text (layout, text, -1);
+  g_free (text);
+
+  /* Make sure the layout itself has been done so that only the glyph
+     cache is measured */
+  pango_layout_get_extents (layout, NULL, NULL);
+
+  cogl_color_init_from_4ub (&color, 0xff, 0xff, 0xff, 0xff);
+
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  cogl_pango_render_layout (layout, 0, 0, &color, 0);
+  finish_frame ();
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("first frame with %d uncached glyphs on %d threads: %f seconds\n",
+          n_glyphs, n_threads, elapsed);
+
+  g_timer_start (timer);
+  cogl_pango_render_layout (layout, 0, 0, &color, 0);
+  finish_frame ();
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("second frame with %d cached glyphs: %f seconds\n",
+          n_glyphs, elapsed);
+
+  g_timer_destroy (timer);
+  g_object_unref (layout);
+  g_object_unref (pango_context);
+  g_object_unref (font_map);
+
+  cogl_pop_framebuffer ();
+  cogl_handle_unref (offscreen);
+  cogl_handle_unref (tex);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include <cogl/cogl.h>
+#include <cogl-pango/cogl-pango.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Measures the time taken to render a large layout again after a
+ * single character of it has been changed, as happens when typing
+ * into a text entry. The glyphs are all cached already so the time
+ * is spent working out which parts of the layout need new
+ * geometry. */
+
+#define N_CHARS 10000
+#define N_FRAMES 100
+#define FB_WIDTH 1024
+#define FB_HEIGHT 1024
+
+static char *
+make_text (int n_chars)
+{
+  GString *text = g_string_new (NULL);
+  int i;
+
+  for (i = 0; i < n_chars; i++)
+    {
+      if (i % 80 == 79)
+        g_string_append_c (text, '\n');
+      else
+        g_string_append_c (text, 'a' + i % 26);
+    }
+
+  return g_string_free (text, FALSE);
+}
+
+static void
+finish_frame (void)
+{
+  guint8 pixel[4];
+
+  /* Reading back a pixel makes sure the rendering has actually
+     finished */
+  cogl_read_pixels (0, 0, 1, 1, COGL_READ_PIXELS_COLOR_BUFFER,
+                    COGL_PIXEL_FORMAT_RGBA_8888_PRE, pixel);
+}
+
+int
+main (int argc, char **argv)
+{
+  CoglContext *ctx;
+  CoglHandle tex, offscreen;
+  PangoFontMap *font_map;
+  PangoContext *pango_context;
+  PangoLayout *layout;
+  PangoFontDescription *font_desc;
+  CoglColor color;
+  GError *error = NULL;
+  GTimer *timer;
+  int n_chars = N_CHARS;
+  int n_frames = N_FRAMES;
+  char *text;
+  double elapsed;
+  int i;
+
+  g_type_init ();
+
+  if (argc > 1)
+    n_chars = atoi (argv[1]);
+  if (argc > 2)
+    n_frames = atoi (argv[2]);
+
+  ctx = cogl_context_new (NULL, &error);
+  if (!ctx)
+    {
+      fprintf (stderr, "Failed to create context: %s\n", error->message);
+      return 1;
+    }
+
+  tex = cogl_texture_2d_new_with_size (ctx, FB_WIDTH, FB_HEIGHT,
+                                       COGL_PIXEL_FORMAT_ANY, &error);
+  if (!tex)
+    {
+      fprintf (stderr, "Failed to allocate texture: %s\n", error->message);
+      return 1;
+    }
+
+  offscreen = cogl_offscreen_new_to_texture (tex);
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), &error))
+    {
+      fprintf (stderr, "Failed to allocate framebuffer: %s\n",
+               error->message);
+      return 1;
+    }
+
+  cogl_push_framebuffer (COGL_FRAMEBUFFER (offscreen));
+  cogl_ortho (0, FB_WIDTH, FB_HEIGHT, 0, -1, 100);
+
+  font_map = cogl_pango_font_map_new ();
+  pango_context =
+    cogl_pango_font_map_create_context (COGL_PANGO_FONT_MAP (font_map));
+
+  layout = pango_layout_new (pango_context);
+  font_desc = pango_font_description_from_string ("Sans 8");
+  pango_layout_set_font_description (layout, font_desc);
+  pango_font_description_free (font_desc);
+
+  text = make_text (n_chars);
+  pango_layout_set_text (layout, text, -1);
+
+  cogl_color_init_from_4ub (&color, 0xff, 0xff, 0xff, 0xff);
+
+  /* Render once so that all of the glyphs are cached */
+  cogl_pango_render_layout (layout, 0, 0, &color, 0);
+  finish_frame ();
+
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  for (i = 0; i < n_frames; i++)
+    {
+      cogl_pango_render_layout (layout, 0, 0, &color, 0);
+      finish_frame ();
+    }
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("unchanged layout of %d characters: %f ms per frame\n",
+          n_chars, elapsed * 1000.0 / n_frames);
+
+  g_timer_start (timer);
+  for (i = 0; i < n_frames; i++)
+    {
+      /* Change one character in the middle of the text. This
+         alternates between two letters so the glyphs are always
+         cached */
+      text[n_chars / 2] = (i & 1) ? 'x' : 'y';
+      pango_layout_set_text (layout, text, -1);
+
+      cogl_pango_render_layout (layout, 0, 0, &color, 0);
+      finish_frame ();
+    }
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("layout of %d characters with 1 character edited: "
+          "%f ms per frame\n",
+          n_chars, elapsed * 1000.0 / n_frames);
+
+  g_free (text);
+  g_timer_destroy (timer);
+  g_object_unref (layout);
+  g_object_unref (pango_context);
+  g_object_unref (font_map);
+
+  cogl_pop_framebuffer ();
+  cogl_handle_unref (offscreen);
+  cogl_handle_unref (tex);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
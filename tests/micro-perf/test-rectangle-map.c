@@ -0,0 +1,378 @@
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cogl-rectangle-map.h"
+
+/* Replays a trace of rectangle allocations and frees against
+ * CoglRectangleMap with each of the packing policies. When the map is
+ * full it is reorganized in the same way as CoglAtlas does it. For
+ * each policy the final fill ratio, the number of reorganizations and
+ * the average time per insertion are reported.
+ *
+ * A trace file can be given as the first argument. Each line is one
+ * of:
+ *
+ *   size <width> <height>
+ *   add <id> <width> <height>
+ *   remove <id>
+ *
+ * Blank lines and lines starting with '#' are ignored. Without a file
+ * a trace is generated that resembles glyphs of a few fonts being
+ * added and evicted.
+ *
+ * Running an application with COGL_DEBUG=trace-rectangle-maps writes
+ * a trace in this format for every map that Cogl creates to a file
+ * called cogl-rectangle-map-<n>.trace in the current directory.
+ */
+
+#define N_SYNTHETIC_RECTANGLES 20000
+
+typedef enum
+{
+  TRACE_ADD,
+  TRACE_REMOVE
+} TraceOpType;
+
+typedef struct
+{
+  TraceOpType type;
+  unsigned int id;
+  unsigned int width, height;
+} TraceOp;
+
+typedef struct
+{
+  unsigned int initial_width, initial_height;
+  unsigned int n_ids;
+  GArray *ops;
+} Trace;
+
+typedef struct
+{
+  /* Current position of the rectangle or a width of zero if it isn't
+     in the map */
+  CoglRectangleMapEntry rectangle;
+} Allocation;
+
+typedef struct
+{
+  CoglRectangleMap *map;
+  CoglRectangleMapPolicy policy;
+  Allocation *allocations;
+  int n_reorganizations;
+} ReplayState;
+
+static const struct
+{
+  const char *name;
+  CoglRectangleMapPolicy policy;
+} policies[] =
+  {
+    { "first-fit", COGL_RECTANGLE_MAP_FIRST_FIT },
+    { "best-area-fit", COGL_RECTANGLE_MAP_BEST_AREA_FIT },
+    { "best-short-side-fit", COGL_RECTANGLE_MAP_BEST_SHORT_SIDE_FIT },
+    { "shelf", COGL_RECTANGLE_MAP_SHELF }
+  };
+
+static void
+trace_add_op (Trace *trace,
+              TraceOpType type,
+              unsigned int id,
+              unsigned int width,
+              unsigned int height)
+{
+  TraceOp op;
+
+  op.type = type;
+  op.id = id;
+  op.width = width;
+  op.height = height;
+
+  g_array_append_val (trace->ops, op);
+
+  if (id >= trace->n_ids)
+    trace->n_ids = id + 1;
+}
+
+static gboolean
+trace_load (Trace *trace,
+            const char *filename)
+{
+  char *contents;
+  char **lines;
+  int i;
+
+  if (!g_file_get_contents (filename, &contents, NULL, NULL))
+    return FALSE;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i]; i++)
+    {
+      unsigned int id, width, height;
+
+      if (lines[i][0] == '\0' || lines[i][0] == '#')
+        continue;
+      else if (sscanf (lines[i], "size %u %u", &width, &height) == 2)
+        {
+          trace->initial_width = width;
+          trace->initial_height = height;
+        }
+      else if (sscanf (lines[i], "add %u %u %u", &id, &width, &height) == 3 &&
+               width > 0 && height > 0)
+        trace_add_op (trace, TRACE_ADD, id, width, height);
+      else if (sscanf (lines[i], "remove %u", &id) == 1)
+        trace_add_op (trace, TRACE_REMOVE, id, 0, 0);
+      else
+        fprintf (stderr, "Ignoring invalid line %i: %s\n", i + 1, lines[i]);
+    }
+
+  g_strfreev (lines);
+
+  return TRUE;
+}
+
+static void
+trace_generate (Trace *trace)
+{
+  GRand *rand = g_rand_new_with_seed (1);
+  GArray *live = g_array_new (FALSE, FALSE, sizeof (unsigned int));
+  unsigned int id;
+
+  trace->initial_width = 256;
+  trace->initial_height = 256;
+
+  for (id = 0; id < N_SYNTHETIC_RECTANGLES; id++)
+    {
+      /* Each glyph comes from one of four font sizes. Glyphs of the
+         same font mostly have the same height but vary in width */
+      unsigned int font_size = 12 + 8 * g_rand_int_range (rand, 0, 4);
+      unsigned int width = g_rand_int_range (rand, font_size / 3,
+                                             font_size + 1);
+      unsigned int height = (g_rand_int_range (rand, 0, 4) ?
+                             font_size :
+                             g_rand_int_range (rand, font_size / 2,
+                                               font_size + 1));
+
+      trace_add_op (trace, TRACE_ADD, id, width + 1, height + 1);
+      g_array_append_val (live, id);
+
+      /* Every so often evict a batch of random glyphs */
+      if (id % 1000 == 999)
+        {
+          unsigned int n_evict = live->len / 4, i;
+
+          for (i = 0; i < n_evict; i++)
+            {
+              unsigned int index = g_rand_int_range (rand, 0, live->len);
+
+              trace_add_op (trace, TRACE_REMOVE,
+                            g_array_index (live, unsigned int, index),
+                            0, 0);
+              g_array_remove_index_fast (live, index);
+            }
+        }
+    }
+
+  g_array_free (live, TRUE);
+  g_rand_free (rand);
+}
+
+static void
+get_rectangles_cb (const CoglRectangleMapEntry *rectangle,
+                   void *rectangle_data,
+                   void *user_data)
+{
+  GPtrArray *allocations = user_data;
+
+  g_ptr_array_add (allocations, rectangle_data);
+}
+
+static int
+compare_size_cb (const void *a,
+                 const void *b)
+{
+  const Allocation *ta = *(const Allocation **) a;
+  const Allocation *tb = *(const Allocation **) b;
+  unsigned int a_size, b_size;
+
+  a_size = ta->rectangle.width * ta->rectangle.height;
+  b_size = tb->rectangle.width * tb->rectangle.height;
+
+  return a_size < b_size ? 1 : a_size > b_size ? -1 : 0;
+}
+
+static void
+reorganize (ReplayState *state,
+            Allocation *new_allocation)
+{
+  GPtrArray *allocations = g_ptr_array_new ();
+  unsigned int map_width = _cogl_rectangle_map_get_width (state->map);
+  unsigned int map_height = _cogl_rectangle_map_get_height (state->map);
+  unsigned int i;
+
+  /* This does the same as _cogl_atlas_reserve_space */
+  _cogl_rectangle_map_foreach (state->map, get_rectangles_cb, allocations);
+  g_ptr_array_add (allocations, new_allocation);
+
+  qsort (allocations->pdata, allocations->len, sizeof (void *),
+         compare_size_cb);
+
+  /* Keep the same size unless there would be less than 6% waste */
+  if ((map_width * map_height -
+       _cogl_rectangle_map_get_remaining_space (state->map) +
+       new_allocation->rectangle.width * new_allocation->rectangle.height) *
+      53 / 50 > map_width * map_height)
+    {
+      if (map_width < map_height)
+        map_width <<= 1;
+      else
+        map_height <<= 1;
+    }
+
+  while (TRUE)
+    {
+      CoglRectangleMap *new_map = _cogl_rectangle_map_new (map_width,
+                                                           map_height,
+                                                           NULL);
+
+      _cogl_rectangle_map_set_policy (new_map, state->policy);
+
+      for (i = 0; i < allocations->len; i++)
+        {
+          Allocation *allocation = g_ptr_array_index (allocations, i);
+
+          if (!_cogl_rectangle_map_add (new_map,
+                                        allocation->rectangle.width,
+                                        allocation->rectangle.height,
+                                        allocation,
+                                        &allocation->rectangle))
+            break;
+        }
+
+      if (i >= allocations->len)
+        {
+          _cogl_rectangle_map_free (state->map);
+          state->map = new_map;
+          break;
+        }
+
+      _cogl_rectangle_map_free (new_map);
+
+      if (map_width < map_height)
+        map_width <<= 1;
+      else
+        map_height <<= 1;
+    }
+
+  state->n_reorganizations++;
+
+  g_ptr_array_free (allocations, TRUE);
+}
+
+static void
+replay (const Trace *trace,
+        const char *name,
+        CoglRectangleMapPolicy policy)
+{
+  ReplayState state;
+  GTimer *timer = g_timer_new ();
+  double add_time = 0.0;
+  int n_adds = 0;
+  unsigned int map_width, map_height, used_space;
+  unsigned int i;
+
+  state.map = _cogl_rectangle_map_new (trace->initial_width,
+                                       trace->initial_height,
+                                       NULL);
+  _cogl_rectangle_map_set_policy (state.map, policy);
+  state.policy = policy;
+  state.allocations = g_new0 (Allocation, trace->n_ids);
+  state.n_reorganizations = 0;
+
+  for (i = 0; i < trace->ops->len; i++)
+    {
+      const TraceOp *op = &g_array_index (trace->ops, TraceOp, i);
+      Allocation *allocation = state.allocations + op->id;
+
+      if (op->type == TRACE_ADD)
+        {
+          /* Ignore ids that are added twice */
+          if (allocation->rectangle.width)
+            continue;
+
+          g_timer_start (timer);
+
+          if (!_cogl_rectangle_map_add (state.map,
+                                        op->width, op->height,
+                                        allocation,
+                                        &allocation->rectangle))
+            {
+              allocation->rectangle.width = op->width;
+              allocation->rectangle.height = op->height;
+              reorganize (&state, allocation);
+            }
+
+          add_time += g_timer_elapsed (timer, NULL);
+          n_adds++;
+        }
+      else if (allocation->rectangle.width)
+        {
+          _cogl_rectangle_map_remove (state.map, &allocation->rectangle);
+          allocation->rectangle.width = 0;
+        }
+    }
+
+  map_width = _cogl_rectangle_map_get_width (state.map);
+  map_height = _cogl_rectangle_map_get_height (state.map);
+  used_space = (map_width * map_height -
+                _cogl_rectangle_map_get_remaining_space (state.map));
+
+  printf ("%-20s %4ux%-4u %5.1f%% full, %3i reorganizations, "
+          "%8.1f ns per insert\n",
+          name,
+          map_width, map_height,
+          used_space * 100.0 / (map_width * map_height),
+          state.n_reorganizations,
+          n_adds ? add_time * 1e9 / n_adds : 0.0);
+
+  _cogl_rectangle_map_free (state.map);
+  g_free (state.allocations);
+  g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+  Trace trace;
+  int i;
+
+  trace.initial_width = 256;
+  trace.initial_height = 256;
+  trace.n_ids = 0;
+  trace.ops = g_array_new (FALSE, FALSE, sizeof (TraceOp));
+
+  if (argc > 1)
+    {
+      if (!trace_load (&trace, argv[1]))
+        {
+          fprintf (stderr, "Failed to load %s\n", argv[1]);
+          return 1;
+        }
+    }
+  else
+    trace_generate (&trace);
+
+  printf ("replaying %u operations on %u rectangles\n",
+          trace.ops->len, trace.n_ids);
+
+  for (i = 0; i < G_N_ELEMENTS (policies); i++)
+    replay (&trace, policies[i].name, policies[i].policy);
+
+  g_array_free (trace.ops, TRUE);
+
+  return 0;
+}
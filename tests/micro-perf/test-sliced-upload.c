@@ -0,0 +1,131 @@
+#include <cogl/cogl.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Measures the time to create large sliced textures from data that
+ * has to be converted before it is uploaded. NPOT textures are
+ * disabled so every texture is split into several slices with waste.
+ * When run with "serial" the worker threads are disabled so that the
+ * slices are converted one after another on the main thread and with
+ * "parallel" they are converted by the worker threads. Without either
+ * argument the benchmark runs itself once for each mode so that the
+ * results can be compared. */
+
+#define TEXTURE_WIDTH 2000
+#define TEXTURE_HEIGHT 1500
+#define N_ITERATIONS 20
+
+static int
+run_benchmark (const char *mode, int n_iterations)
+{
+  CoglContext *ctx;
+  CoglHandle texture;
+  GError *error = NULL;
+  GTimer *timer;
+  guint8 *data;
+  double elapsed;
+  int i;
+
+  if (strcmp (mode, "serial") == 0)
+    g_setenv ("COGL_DEBUG", "disable-npot-textures,disable-threads", TRUE);
+  else
+    g_setenv ("COGL_DEBUG", "disable-npot-textures", TRUE);
+
+  ctx = cogl_context_new (NULL, &error);
+  if (!ctx)
+    {
+      fprintf (stderr, "Failed to create context: %s\n", error->message);
+      return 1;
+    }
+
+  data = g_malloc (TEXTURE_WIDTH * TEXTURE_HEIGHT * 3);
+  for (i = 0; i < TEXTURE_WIDTH * TEXTURE_HEIGHT * 3; i++)
+    data[i] = i & 0xff;
+
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  for (i = 0; i < n_iterations; i++)
+    {
+      texture = cogl_texture_new_from_data (TEXTURE_WIDTH, TEXTURE_HEIGHT,
+                                            COGL_TEXTURE_NO_ATLAS,
+                                            COGL_PIXEL_FORMAT_RGB_888,
+                                            COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                            TEXTURE_WIDTH * 3,
+                                            data);
+      if (texture == COGL_INVALID_HANDLE)
+        {
+          fprintf (stderr, "Failed to create texture\n");
+          return 1;
+        }
+      cogl_handle_unref (texture);
+    }
+  cogl_flush ();
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  printf ("%s: %d %ix%i textures in %f seconds (%f ms per texture)\n",
+          mode, n_iterations, TEXTURE_WIDTH, TEXTURE_HEIGHT,
+          elapsed, elapsed * 1000.0 / n_iterations);
+
+  g_timer_destroy (timer);
+  g_free (data);
+  cogl_object_unref (ctx);
+
+  return 0;
+}
+
+static int
+run_child (const char *program, const char *mode, const char *n_iterations)
+{
+  const char *child_argv[] = { program, mode, n_iterations, NULL };
+  GError *error = NULL;
+  int status;
+
+  fflush (stdout);
+
+  if (!g_spawn_sync (NULL, /* working directory */
+                     (char **) child_argv,
+                     NULL, /* environment */
+                     0, /* flags */
+                     NULL, NULL, /* child setup */
+                     NULL, NULL, /* standard output and error */
+                     &status,
+                     &error))
+    {
+      fprintf (stderr, "Failed to run %s benchmark: %s\n",
+               mode, error->message);
+      return 1;
+    }
+
+  return status;
+}
+
+int
+main (int argc, char **argv)
+{
+  char *n_iterations_string;
+  int n_iterations = N_ITERATIONS;
+  int status;
+
+  if (!g_thread_supported ())
+    g_thread_init (NULL);
+
+  if (argc > 2)
+    n_iterations = atoi (argv[2]);
+
+  if (argc > 1 &&
+      (strcmp (argv[1], "serial") == 0 || strcmp (argv[1], "parallel") == 0))
+    return run_benchmark (argv[1], n_iterations);
+
+  /* The debug options are only read once per process so each mode is
+     run in a separate process */
+  n_iterations_string = g_strdup_printf ("%i", n_iterations);
+  status = run_child (argv[0], "serial", n_iterations_string);
+  if (status == 0)
+    status = run_child (argv[0], "parallel", n_iterations_string);
+  g_free (n_iterations_string);
+
+  return status != 0;
+}